@@ -48,7 +48,11 @@ enum astarte_err_t
     ASTARTE_ERR_INVALID_INTROSPECTION = 19, /**< The introspection is not valid or empty */
     ASTARTE_ERR_INVALID_INTERFACE_VERSION = 20, /**< The interface is not valid */
     ASTARTE_ERR_CONFLICTING_INTERFACE = 21, /**< The interface conflicts with an interface present in introspection */
-    ASTARTE_ERR_INVALID_SIZE = 22 /**< An input parameter has been passed with invalid size */
+    ASTARTE_ERR_INVALID_SIZE = 22, /**< An input parameter has been passed with invalid size */
+    ASTARTE_ERR_PUBLISH_QUEUE_FULL = 23, /**< The outgoing queue of the message priority is full */
+    ASTARTE_ERR_RATE_LIMITED = 24, /**< The message exceeds the rate limits of the device or of its interface */
+    ASTARTE_ERR_PUBLISH_WINDOW_FULL = 25, /**< Too many messages of the device or of the interface are waiting for an acknowledgment */
+    ASTARTE_ERR_OUTBOX_FULL = 26 /**< The MQTT outbox is above its high-water mark and the message cannot be deferred */
 } __attribute__((deprecated("Please use the typedef astarte_err_t")));
 
 // clang-format on
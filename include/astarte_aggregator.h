@@ -0,0 +1,78 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_aggregator.h
+ * @brief Windowed aggregation of high rate samples.
+ *
+ * @details Aggregators are available when CONFIG_ASTARTE_AGGREGATION is enabled and are added to a
+ * device with astarte_device_add_aggregator(). Samples pushed with astarte_aggregator_push() are
+ * reduced in place, without locks or serialization. At the end of each window the device publishes
+ * a single object aggregated message with the selected reducers, for example:
+ *
+ * @code{.c}
+ * {"min": 0.1, "max": 2.3, "mean": 1.2, "last": 0.9, "count": 1000}
+ * @endcode
+ *
+ * The interface must be an object aggregated datastream with a double endpoint for each of min,
+ * max, mean and last and a longinteger endpoint for count, under the configured path. Windows
+ * without samples are not published.
+ */
+
+#ifndef _ASTARTE_AGGREGATOR_H_
+#define _ASTARTE_AGGREGATOR_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Reducers applied to the samples of a window, to be combined as a bitmask.
+ */
+typedef enum
+{
+    ASTARTE_REDUCER_MIN = 1U << 0U, /**< Smallest sample, published as "min". */
+    ASTARTE_REDUCER_MAX = 1U << 1U, /**< Largest sample, published as "max". */
+    ASTARTE_REDUCER_MEAN = 1U << 2U, /**< Arithmetic mean, published as "mean". */
+    ASTARTE_REDUCER_LAST = 1U << 3U, /**< Most recent sample, published as "last". */
+    ASTARTE_REDUCER_COUNT = 1U << 4U, /**< Number of samples, published as "count". */
+} astarte_reducer_t;
+
+/**
+ * @brief Configuration of an aggregator.
+ */
+typedef struct
+{
+    const char *interface_name; /**< Interface of the aggregates, copied. */
+    const char *path; /**< Path prefix of the aggregates, copied. */
+    uint32_t window_ms; /**< Length of a window. */
+    uint32_t reducers; /**< Bitmask of #astarte_reducer_t, at least one. */
+    int qos; /**< QoS of the aggregates. */
+} astarte_aggregator_config_t;
+
+/**
+ * @brief Handle of an aggregator, owned by the device it has been added to.
+ */
+typedef struct astarte_aggregator *astarte_aggregator_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Adds a sample to the current window of an aggregator
+ *
+ * @details Lock free, it never allocates nor blocks. Samples of an aggregator must be pushed by
+ * a single task at a time.
+ *
+ * @param[in] aggregator The aggregator.
+ * @param[in] sample The sample.
+ */
+void astarte_aggregator_push(astarte_aggregator_handle_t aggregator, double sample);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_AGGREGATOR_H_ */
@@ -0,0 +1,121 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_allocator.h
+ * @brief Allocator used by the SDK for its dynamic memory.
+ *
+ * @details All the heap allocations of the SDK go through the allocator set with
+ * astarte_allocator_set(), tagged with the subsystem requesting them. By default the standard
+ * malloc() and free() are used. Setting a custom allocator makes it possible to place the SDK
+ * memory in PSRAM, for example with heap_caps_malloc(size, MALLOC_CAP_SPIRAM), or in a dedicated
+ * pool. Memory allocated internally by the ESP-IDF components used by the SDK, such as the MQTT
+ * client, the HTTP client and mbedtls, is not covered.
+ *
+ * When CONFIG_ASTARTE_ALLOC_ACCOUNTING is enabled the SDK also keeps track of the memory used by
+ * each subsystem, readable with astarte_allocator_get_stats().
+ */
+
+#ifndef _ASTARTE_ALLOCATOR_H_
+#define _ASTARTE_ALLOCATOR_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Subsystems of the SDK allocating dynamic memory.
+ */
+typedef enum
+{
+    /** @brief Device handle, introspection and messages handling. */
+    ASTARTE_ALLOC_SUBSYSTEM_DEVICE = 0,
+    /** @brief BSON serializer. */
+    ASTARTE_ALLOC_SUBSYSTEM_BSON,
+    /** @brief Properties storage. */
+    ASTARTE_ALLOC_SUBSYSTEM_STORAGE,
+    /** @brief Pairing API requests. */
+    ASTARTE_ALLOC_SUBSYSTEM_PAIRING,
+    /** @brief Credentials generation and storage. */
+    ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS,
+    /** @brief Number of subsystems, not a valid subsystem. */
+    ASTARTE_ALLOC_SUBSYSTEM_COUNT,
+} astarte_alloc_subsystem_t;
+
+/**
+ * @brief Allocator functions used by the SDK.
+ */
+typedef struct
+{
+    /**
+     * @brief Allocates a block of memory.
+     *
+     * @details Must return memory aligned as the standard malloc() does, or NULL on failure.
+     */
+    void *(*malloc_fn)(size_t size, astarte_alloc_subsystem_t subsystem, void *user_data);
+    /** @brief Releases a block allocated by malloc_fn, never called with NULL. */
+    void (*free_fn)(void *ptr, void *user_data);
+    /** @brief Opaque pointer passed to the allocator functions. */
+    void *user_data;
+} astarte_allocator_t;
+
+/**
+ * @brief Memory usage of a subsystem, collected when CONFIG_ASTARTE_ALLOC_ACCOUNTING is enabled.
+ */
+typedef struct
+{
+    size_t current_bytes; /**< Bytes currently allocated. */
+    size_t peak_bytes; /**< Highest value reached by current_bytes. */
+    uint32_t current_allocations; /**< Blocks currently allocated. */
+    uint32_t total_allocations; /**< Blocks allocated since boot, freed ones included. */
+} astarte_allocator_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets the allocator used by the SDK
+ *
+ * @details The allocator must be set before calling any other function of the SDK, memory is
+ * always released through the allocator that provided it. The allocator functions can be called
+ * concurrently from multiple tasks.
+ *
+ * @param[in] allocator The allocator to use, it is copied. NULL restores malloc() and free().
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR if the SDK is holding memory obtained from the previous allocator, only detected
+ * when CONFIG_ASTARTE_ALLOC_ACCOUNTING is enabled,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_allocator_set(const astarte_allocator_t *allocator);
+
+/**
+ * @brief Reads the memory usage of a subsystem
+ *
+ * @param[in] subsystem The subsystem.
+ * @param[out] stats Where the memory usage is stored.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if CONFIG_ASTARTE_ALLOC_ACCOUNTING is disabled or the subsystem is
+ * invalid,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_allocator_get_stats(
+    astarte_alloc_subsystem_t subsystem, astarte_allocator_stats_t *stats);
+
+/**
+ * @brief Returns a printable name for a subsystem
+ *
+ * @param[in] subsystem The subsystem.
+ * @return The name of the subsystem, "UNKNOWN" for invalid values.
+ */
+const char *astarte_alloc_subsystem_to_name(astarte_alloc_subsystem_t subsystem);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_ALLOCATOR_H_ */
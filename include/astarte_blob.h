@@ -0,0 +1,36 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_blob.h
+ * @brief Large binaryblob datastreams published without copying the blob.
+ *
+ * @details astarte_device_stream_binaryblob_in_place() publishes a blob stored in a buffer of the
+ * caller with ASTARTE_BLOB_HEADROOM free bytes before it and ASTARTE_BLOB_TAILROOM free bytes after
+ * it. The BSON document is built around the blob in that buffer, and the buffer is handed to the
+ * MQTT client as it is. The MQTT client sends QoS 0 messages straight from the buffer, so the blob
+ * is never copied. QoS 1 and QoS 2 messages are copied once into the outbox of the MQTT client.
+ *
+ * The MQTT client only publishes contiguous messages, a blob cannot be streamed from a smaller
+ * buffer: a blob read from a file or a partition has to be read whole into the buffer before being
+ * published. Features holding messages back, such as the publish lanes, the rate limits backlog,
+ * the burst mode or the outbox deferral, copy the messages.
+ */
+
+#ifndef _ASTARTE_BLOB_H_
+#define _ASTARTE_BLOB_H_
+
+/**
+ * @brief Bytes reserved before the blob, for the BSON document header.
+ */
+#define ASTARTE_BLOB_HEADROOM 12
+
+/**
+ * @brief Bytes reserved after the blob, for the timestamp and the end of the BSON document.
+ */
+#define ASTARTE_BLOB_TAILROOM 12
+
+#endif /* _ASTARTE_BLOB_H_ */
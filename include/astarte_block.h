@@ -0,0 +1,114 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_block.h
+ * @brief Packed blocks of timestamped samples, published as a single binaryblob.
+ *
+ * @details Block streams are available when CONFIG_ASTARTE_BLOCK_ENCODING is enabled and are added
+ * to a device with astarte_device_add_block_stream(). Samples pushed to a stream are encoded in
+ * place and the block is published on a binaryblob datastream endpoint, timestamped with its first
+ * sample, when it holds the configured number of samples or its buffer is full.
+ *
+ * A block starts with a 12 bytes header, little endian:
+ * - byte 0: format version, 1,
+ * - byte 1: sample type, see #astarte_block_type_t,
+ * - bytes 2-3: number of samples,
+ * - bytes 4-11: timestamp of the first sample, in milliseconds since the epoch.
+ *
+ * The header is followed by a bit stream, most significant bit first, holding for each sample the
+ * timestamp (from the second sample on) and then the value:
+ * - timestamps are the delta of the delta from the previous sample, starting from a delta of 0:
+ *   '0' for 0, '10' and 7 bits, '110' and 9 bits, '1110' and 12 bits or '1111' and 32 bits, as
+ *   two's complement,
+ * - doubles are XOR compressed as in Gorilla: the first value is stored in 64 bits, then '0' if
+ *   it is equal to the previous one, '10' and the meaningful bits if they fit the previous window,
+ *   '11', 5 bits of leading zeros, 6 bits of meaningful bits count (0 for 64) and the meaningful
+ *   bits otherwise,
+ * - long integers are the zig-zag encoded difference from the previous value, starting from 0, as
+ *   a base 128 varint of 8 bits groups.
+ *
+ * python_scripts/decode_sample_block.py is a reference decoder.
+ */
+
+#ifndef _ASTARTE_BLOCK_H_
+#define _ASTARTE_BLOCK_H_
+
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Type of the samples of a block.
+ */
+typedef enum
+{
+    ASTARTE_BLOCK_TYPE_DOUBLE = 0, /**< XOR compressed doubles. */
+    ASTARTE_BLOCK_TYPE_LONGINTEGER = 1, /**< Zig-zag varint deltas of 64 bits integers. */
+} astarte_block_type_t;
+
+/**
+ * @brief Configuration of a block stream.
+ */
+typedef struct
+{
+    const char *interface_name; /**< Interface of the blocks, copied. */
+    const char *path; /**< binaryblob endpoint of the blocks, copied. */
+    astarte_block_type_t type;
+    uint16_t samples_per_block; /**< Samples after which a block is published. */
+    int qos; /**< QoS of the blocks. */
+} astarte_block_config_t;
+
+/**
+ * @brief Handle of a block stream, owned by the device it has been added to.
+ */
+typedef struct astarte_block_stream *astarte_block_stream_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Adds a sample to a double block stream
+ *
+ * @details Publishes the block when it is complete, from the calling task.
+ *
+ * @param[in] stream The block stream.
+ * @param[in] ts_epoch_millis Timestamp of the sample.
+ * @param[in] value The sample.
+ * @return ASTARTE_OK on success, ASTARTE_ERR if the stream is not of doubles, otherwise the error
+ * of the publish of the complete block, whose samples are discarded.
+ */
+astarte_err_t astarte_block_stream_push_double(
+    astarte_block_stream_handle_t stream, int64_t ts_epoch_millis, double value);
+
+/**
+ * @brief Adds a sample to a long integer block stream
+ *
+ * @details Publishes the block when it is complete, from the calling task.
+ *
+ * @param[in] stream The block stream.
+ * @param[in] ts_epoch_millis Timestamp of the sample.
+ * @param[in] value The sample.
+ * @return ASTARTE_OK on success, ASTARTE_ERR if the stream is not of long integers, otherwise the
+ * error of the publish of the complete block, whose samples are discarded.
+ */
+astarte_err_t astarte_block_stream_push_longinteger(
+    astarte_block_stream_handle_t stream, int64_t ts_epoch_millis, int64_t value);
+
+/**
+ * @brief Publishes the samples of the current block, if any
+ *
+ * @param[in] stream The block stream.
+ * @return ASTARTE_OK on success, otherwise the error of the publish.
+ */
+astarte_err_t astarte_block_stream_flush(astarte_block_stream_handle_t stream);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_BLOCK_H_ */
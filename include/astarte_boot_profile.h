@@ -0,0 +1,75 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_boot_profile.h
+ * @brief Hooks marking the phases a device goes through from initialization to being connected.
+ *
+ * @details The hooks are called by the SDK only when CONFIG_ASTARTE_BOOT_PROFILING is enabled. The
+ * SDK provides empty weak definitions, applications can override them to collect timings or memory
+ * usage of each phase. The hooks are called from the SDK tasks and the MQTT client task, they
+ * should return quickly.
+ */
+
+#ifndef _ASTARTE_BOOT_PROFILE_H_
+#define _ASTARTE_BOOT_PROFILE_H_
+
+#include "astarte.h"
+
+typedef enum
+{
+    /** @brief Loading or requesting the credentials secret. */
+    ASTARTE_BOOT_PHASE_REGISTRATION = 0,
+    /** @brief Requesting a new client certificate, skipped when a valid one is stored. */
+    ASTARTE_BOOT_PHASE_CERTIFICATE,
+    /** @brief Requesting the MQTT broker URL. */
+    ASTARTE_BOOT_PHASE_BROKER_URL,
+    /** @brief Establishing the TLS connection and the MQTT session. */
+    ASTARTE_BOOT_PHASE_MQTT_CONNECT,
+    /** @brief Subscribing to the control and server owned interfaces topics. */
+    ASTARTE_BOOT_PHASE_SUBSCRIPTIONS,
+    /** @brief Publishing the introspection. */
+    ASTARTE_BOOT_PHASE_INTROSPECTION,
+    /** @brief Sending the empty cache message and the device owned properties. */
+    ASTARTE_BOOT_PHASE_PROPERTIES_RESYNC,
+    /** @brief Number of phases, not a valid phase. */
+    ASTARTE_BOOT_PHASE_COUNT,
+} astarte_boot_phase_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Called when a boot phase begins
+ *
+ * @details The MQTT connection phase begins on every connection attempt and ends only once the
+ * connection is established, a failed attempt is followed by the begin of the next one.
+ *
+ * @param[in] phase The phase that begins.
+ */
+void astarte_boot_profile_begin(astarte_boot_phase_t phase);
+
+/**
+ * @brief Called when a boot phase ends
+ *
+ * @param[in] phase The phase that ends.
+ */
+void astarte_boot_profile_end(astarte_boot_phase_t phase);
+
+/**
+ * @brief Returns a printable name for a boot phase
+ *
+ * @param[in] phase The boot phase.
+ * @return The name of the phase, "UNKNOWN" for invalid values.
+ */
+const char *astarte_boot_phase_to_name(astarte_boot_phase_t phase);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_BOOT_PROFILE_H_ */
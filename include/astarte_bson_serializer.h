@@ -78,7 +78,7 @@ void astarte_bson_serializer_destroy(astarte_bson_serializer_handle_t bson);
  * buffer will be invalid after serializer destruction.
  * @param[in] bson a valid handle for the serializer instance.
  * @param[out] size the size of the internal buffer. Optional, pass NULL if not used.
- * @return Reference to the internal buffer.
+ * @return Reference to the internal buffer, NULL if the serializer ran out of memory.
  */
 const void *astarte_bson_serializer_get_document(astarte_bson_serializer_handle_t bson, int *size);
 
@@ -0,0 +1,49 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_burst.h
+ * @brief Datastreams published in bursts, letting the radio sleep in between.
+ *
+ * @details Burst mode is available when CONFIG_ASTARTE_BURST_FLUSH is enabled. Datastreams are held
+ * by the device and published together once their topics and payloads add up to
+ * CONFIG_ASTARTE_BURST_MAX_BYTES or the oldest one has waited CONFIG_ASTARTE_BURST_MAX_AGE_MS.
+ * Properties and datastreams of interfaces with PRIORITY_ALARM are never held, they are published
+ * right away and the held datastreams follow them. astarte_device_flush_burst() publishes the held
+ * datastreams on demand, for example before entering deep sleep.
+ *
+ * When the ESP-IDF power management is enabled with CONFIG_PM_ENABLE, the device keeps the chip
+ * out of light sleep only while flushing a burst. With automatic light sleep and the Wi-Fi modem
+ * power save, the chip and the radio can sleep between bursts, the age timer being the only wakeup
+ * added by the SDK.
+ *
+ * The SDK does not account the time the chip or the radio spend awake or asleep. With
+ * CONFIG_PM_PROFILING enabled, esp_pm_dump_locks() reports the time spent in each power mode.
+ */
+
+#ifndef _ASTARTE_BURST_H_
+#define _ASTARTE_BURST_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Counters of the bursts published by a device.
+ */
+typedef struct
+{
+    uint32_t bursts; /**< Bursts flushed. */
+    uint32_t messages; /**< Held datastreams published in a burst. */
+    uint64_t bytes; /**< Topic and payload bytes of the held datastreams. */
+    uint32_t failed; /**< Held datastreams whose publish failed. */
+    /**
+     * @brief Time spent handing the held datastreams to the MQTT client, with light sleep
+     * disabled. It is not the time the chip or the radio stay awake: the messages are sent and
+     * acknowledged after the flush.
+     */
+    uint64_t flush_us;
+} astarte_burst_stats_t;
+
+#endif /* _ASTARTE_BURST_H_ */
@@ -14,6 +14,10 @@
 
 #include "astarte.h"
 
+#include <freertos/FreeRTOS.h>
+#include <freertos/event_groups.h>
+#include <mbedtls/x509.h>
+
 #include <stdbool.h>
 #include <string.h>
 
@@ -21,6 +25,7 @@
 #define CN_LENGTH 512
 
 #define ASTARTE_CREDENTIALS_DEFAULT_NVS_PARTITION NULL
+#define ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN 8
 
 enum credential_type_t
 {
@@ -53,8 +58,77 @@ typedef struct
 {
     const astarte_credentials_storage_functions_t *functions;
     void *opaque;
+    /** @brief NVS partition holding the credentials secret, NULL for the default one. */
+    const char *secret_partition_label;
+    /** @brief NVS namespace holding the credentials secret, NULL for the default one. */
+    const char *secret_namespace;
 } astarte_credentials_context_t;
 
+/**
+ * @brief Device credentials parsed once and kept in memory.
+ *
+ * @details Holds the DER encoded private key and client certificate, together with the information
+ * extracted from them, so that they don't have to be read and parsed again at each connection. The
+ * mbedtls contexts used for parsing are freed once the credentials are extracted.
+ */
+typedef struct
+{
+    /** @brief DER encoded client certificate, ready to be handed to the TLS layer. */
+    unsigned char *certificate_der;
+    /** @brief Length of the DER encoded client certificate. */
+    size_t certificate_der_len;
+    /** @brief DER encoded private key, ready to be handed to the TLS layer. */
+    unsigned char *key_der;
+    /** @brief Length of the DER encoded private key. */
+    size_t key_der_len;
+    /** @brief Certificate Common Name, used as device topic. */
+    char common_name[CN_LENGTH];
+    /** @brief Certificate expiration time. */
+    mbedtls_x509_time valid_to;
+} astarte_credentials_parsed_t;
+
+/**
+ * @brief Function called when an asynchronous credentials initialization completes.
+ *
+ * @param[in] ctx The credentials context passed to astarte_credentials_ctx_init_async().
+ * @param[in] result ASTARTE_OK if the private key and CSR are ready, an error code otherwise.
+ * @param[in] user_data The user data set in the initialization configuration.
+ */
+typedef void (*astarte_credentials_init_cbk_t)(
+    astarte_credentials_context_t *ctx, astarte_err_t result, void *user_data);
+
+/**
+ * @brief Configuration of an asynchronous credentials initialization.
+ *
+ * @details Initialize it with ASTARTE_CREDENTIALS_INIT_CONFIG_DEFAULT() and set the completion
+ * notification to use. Both the callback and the event group can be used at the same time.
+ */
+typedef struct
+{
+    /** @brief Called from the initialization task on completion, may be NULL. */
+    astarte_credentials_init_cbk_t callback;
+    /** @brief User data passed to the callback. */
+    void *user_data;
+    /** @brief Event group notified on completion, may be NULL. */
+    EventGroupHandle_t event_group;
+    /** @brief Bits set in the event group on completion, regardless of the result. */
+    EventBits_t done_bits;
+    /** @brief Bits additionally set in the event group when the initialization failed. */
+    EventBits_t error_bits;
+    /** @brief Priority of the initialization task. */
+    UBaseType_t task_priority;
+    /** @brief Core the initialization task is pinned to, -1 for no affinity. */
+    int task_core_id;
+} astarte_credentials_init_config_t;
+
+/** @brief Default asynchronous initialization configuration, using the component configuration. */
+#define ASTARTE_CREDENTIALS_INIT_CONFIG_DEFAULT()                                                  \
+    {                                                                                              \
+        .callback = NULL, .user_data = NULL, .event_group = NULL, .done_bits = 0, .error_bits = 0, \
+        .task_priority = CONFIG_ASTARTE_CREDENTIALS_INIT_TASK_PRIORITY,                            \
+        .task_core_id = CONFIG_ASTARTE_CREDENTIALS_INIT_TASK_CORE_ID,                              \
+    }
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -80,6 +154,94 @@ astarte_err_t astarte_credentials_set_storage_context(astarte_credentials_contex
  */
 astarte_err_t astarte_credentials_use_nvs_storage(const char *partition_label);
 
+/**
+ * @brief use a raw data partition as credentials context.
+ *
+ * @details This function has to be called before any other astarte_credentials function when the
+ * TLV partition storage is required. Credentials are stored as checksummed type-length-value
+ * records in two alternating slots, so that an interrupted write never corrupts the previously
+ * stored credentials. The credentials secret is still stored in the default NVS partition.
+ * @param partition_label the data partition label, it must be at least 8KiB.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_use_tlv_storage(const char *partition_label);
+
+/**
+ * @brief setup a per-device credentials context backed by the FAT filesystem.
+ *
+ * @details The credentials are stored in a subdirectory of the credentials folder named after
+ * @p device_namespace, while the credentials secret is stored in the default NVS partition under
+ * the @p device_namespace namespace. Multiple contexts with different namespaces can be used
+ * concurrently to handle several devices from the same firmware. The context must be released
+ * with astarte_credentials_ctx_release() when no longer needed.
+ * @param[out] ctx The credentials context to setup.
+ * @param[in] device_namespace A non empty alphanumeric string of at most
+ * ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN characters, unique for each device.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_use_fat_storage(
+    astarte_credentials_context_t *ctx, const char *device_namespace);
+
+/**
+ * @brief setup a per-device credentials context backed by a NVS partition.
+ *
+ * @details Both the credentials and the credentials secret are stored in the @p partition_label
+ * partition under the @p device_namespace namespace. The context must be released with
+ * astarte_credentials_ctx_release() when no longer needed.
+ * @param[out] ctx The credentials context to setup.
+ * @param[in] partition_label the NVS partion label. Use ASTARTE_CREDENTIALS_DEFAULT_NVS_PARTITION
+ * when default must be used.
+ * @param[in] device_namespace A non empty alphanumeric string of at most
+ * ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN characters, unique for each device.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_use_nvs_storage(
+    astarte_credentials_context_t *ctx, const char *partition_label, const char *device_namespace);
+
+/**
+ * @brief setup a per-device credentials context backed by a raw TLV partition.
+ *
+ * @details Each device needs its own data partition, see astarte_credentials_use_tlv_storage().
+ * The credentials secret is stored in the default NVS partition under the @p device_namespace
+ * namespace. The context must be released with astarte_credentials_ctx_release() when no longer
+ * needed.
+ * @param[out] ctx The credentials context to setup.
+ * @param[in] partition_label the data partition label, it must be at least 8KiB.
+ * @param[in] device_namespace A non empty alphanumeric string of at most
+ * ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN characters, unique for each device.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_use_tlv_storage(
+    astarte_credentials_context_t *ctx, const char *partition_label, const char *device_namespace);
+
+/**
+ * @brief release the resources held by a per-device credentials context.
+ *
+ * @details The stored credentials are not affected.
+ * @param[in] ctx A context previously setup with astarte_credentials_ctx_use_fat_storage(),
+ * astarte_credentials_ctx_use_nvs_storage() or astarte_credentials_ctx_use_tlv_storage().
+ */
+void astarte_credentials_ctx_release(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief copy the stored credentials from a context to another.
+ *
+ * @details Copies the private key, the CSR and the certificate, when present, then reads them
+ * back from the destination and checks them against the source. The time needed to read the
+ * credentials from both storages is logged, to compare the boot time impact of each backend.
+ * This is meant to be called once at boot, before astarte_device_init(), e.g. to move existing
+ * devices from the FAT storage to the TLV partition storage.
+ * @param[in] from The source context, NULL for the global one.
+ * @param[in] to The destination context, NULL for the global one.
+ * @param[in] remove_source When true the credentials are removed from the source once verified.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if the source holds no credentials,
+ * - ASTARTE_ERR if the credentials read back from the destination don't match,
+ * - ASTARTE_OK if operation has been successful, or an error code from the storages.
+ */
+astarte_err_t astarte_credentials_ctx_migrate(
+    astarte_credentials_context_t *from, astarte_credentials_context_t *to, bool remove_source);
+
 /**
  * @brief initialize Astarte credentials.
  *
@@ -243,6 +405,185 @@ bool astarte_credentials_has_csr();
  */
 bool astarte_credentials_has_key();
 
+/**
+ * @brief initialize the credentials of a credentials context.
+ *
+ * @details Same as astarte_credentials_init(), operating on @p ctx. All the astarte_credentials_ctx
+ * functions below accept a NULL @p ctx, in which case the global credentials context is used.
+ * @param[in] ctx The credentials context.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_init(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief initialize the credentials of a credentials context without blocking.
+ *
+ * @details Generating the private key and the CSR may take several seconds on the first boot. This
+ * function returns immediately and generates them in a dedicated task, so that the generation can
+ * overlap with other startup activities such as the Wi-Fi association. Completion is signaled
+ * through the callback and/or the event group of @p config. When the credentials already exist
+ * the completion is signaled before returning, from the calling task.
+ * The context must stay valid and must not be used by other functions until completion.
+ * @param[in] ctx The credentials context.
+ * @param[in] config The initialization configuration, copied by this function.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR if the initialization task could not be started, no completion will be signaled,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if memory allocation failed, no completion will be signaled,
+ * - ASTARTE_OK if the initialization has been started or the credentials already exist.
+ */
+astarte_err_t astarte_credentials_ctx_init_async(
+    astarte_credentials_context_t *ctx, const astarte_credentials_init_config_t *config);
+
+/**
+ * @brief check if the credentials of a credentials context are initialized.
+ *
+ * @param[in] ctx The credentials context.
+ * @return true if the private key and CSR exist, false otherwise.
+ */
+bool astarte_credentials_ctx_is_initialized(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief create the private key of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_create_key(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief create the CSR of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_create_csr(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief save the certificate of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[in] cert_pem The buffer containing a NULL-terminated certificate in PEM form.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_save_certificate(
+    astarte_credentials_context_t *ctx, const char *cert_pem);
+
+/**
+ * @brief delete the certificate of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_delete_certificate(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief get the CSR of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[out] out A pointer to an allocated buffer where the CSR will be written.
+ * @param[in] length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_get_csr(
+    astarte_credentials_context_t *ctx, char *out, size_t length);
+
+/**
+ * @brief get the certificate of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[out] out A pointer to an allocated buffer where the certificate will be written.
+ * @param[in] length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_get_certificate(
+    astarte_credentials_context_t *ctx, char *out, size_t length);
+
+/**
+ * @brief get the private key of a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[out] out A pointer to an allocated buffer where the key will be written.
+ * @param[in] length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_get_key(
+    astarte_credentials_context_t *ctx, char *out, size_t length);
+
+/**
+ * @brief get the credentials_secret stored for a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[out] out A pointer to an allocated buffer where the credentials_secret will be written.
+ * @param[in] length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if the credentials_secret was found, ASTARTE_ERR_NOT_FOUND if
+ * the credentials secret is not present in the NVS, another astarte_err_t if an error occurs.
+ */
+astarte_err_t astarte_credentials_ctx_get_stored_credentials_secret(
+    astarte_credentials_context_t *ctx, char *out, size_t length);
+
+/**
+ * @brief save the credentials_secret for a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @param[in] credentials_secret A pointer to the buffer that contains the credentials_secret.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_set_stored_credentials_secret(
+    astarte_credentials_context_t *ctx, const char *credentials_secret);
+
+/**
+ * @brief delete the credentials_secret stored for a credentials context.
+ *
+ * @param[in] ctx The credentials context.
+ * @return The status code, ASTARTE_OK if the credentials_secret was found, ASTARTE_ERR_NOT_FOUND if
+ * the credentials secret is not present in the NVS, another astarte_err_t if an error occurs.
+ */
+astarte_err_t astarte_credentials_ctx_erase_stored_credentials_secret(
+    astarte_credentials_context_t *ctx);
+
+/**
+ * @brief check if the certificate of a credentials context exists.
+ *
+ * @param[in] ctx The credentials context.
+ * @return true if the certificate exists and is valid, false otherwise.
+ */
+bool astarte_credentials_ctx_has_certificate(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief check if the CSR of a credentials context exists.
+ *
+ * @param[in] ctx The credentials context.
+ * @return true if the CSR exists, false otherwise.
+ */
+bool astarte_credentials_ctx_has_csr(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief check if the private key of a credentials context exists.
+ *
+ * @param[in] ctx The credentials context.
+ * @return true if the private key exists, false otherwise.
+ */
+bool astarte_credentials_ctx_has_key(astarte_credentials_context_t *ctx);
+
+/**
+ * @brief load and parse the private key and certificate of a credentials context.
+ *
+ * @details The parsed credentials are meant to be kept alive for the whole lifetime of the
+ * connection. They must be released with astarte_credentials_parsed_free().
+ * @param[in] ctx The credentials context, NULL for the global one.
+ * @param[out] parsed The structure that will be filled with the parsed credentials.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_credentials_ctx_parse(
+    astarte_credentials_context_t *ctx, astarte_credentials_parsed_t *parsed);
+
+/**
+ * @brief release the resources held by parsed credentials.
+ *
+ * @param[in] parsed Credentials filled by astarte_credentials_ctx_parse().
+ */
+void astarte_credentials_parsed_free(astarte_credentials_parsed_t *parsed);
+
 /*
  * @brief store a credential using filesystem storage
  *
@@ -303,6 +644,36 @@ bool astarte_credentials_nvs_exists(void *opaque, credential_type_t cred_type);
  */
 astarte_err_t astarte_credentials_nvs_remove(void *opaque, credential_type_t cred_type);
 
+/*
+ * @brief store a credential in a raw TLV partition
+ *
+ * @details opaque is the partition label. this API might change in future versions.
+ */
+astarte_err_t astarte_credentials_tlv_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length);
+
+/*
+ * @brief fetch a credential from a raw TLV partition
+ *
+ * @details opaque is the partition label. this API might change in future versions.
+ */
+astarte_err_t astarte_credentials_tlv_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length);
+
+/*
+ * @brief return true whether a credential exists in a raw TLV partition
+ *
+ * @details opaque is the partition label. this API might change in future versions.
+ */
+bool astarte_credentials_tlv_exists(void *opaque, credential_type_t cred_type);
+
+/*
+ * @brief remove a credential from a raw TLV partition
+ *
+ * @details opaque is the partition label. this API might change in future versions.
+ */
+astarte_err_t astarte_credentials_tlv_remove(void *opaque, credential_type_t cred_type);
+
 #ifdef __cplusplus
 }
 #endif
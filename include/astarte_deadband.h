@@ -0,0 +1,36 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_deadband.h
+ * @brief Dead-band filters suppressing the publish of values that did not change enough.
+ *
+ * @details Filters are available when CONFIG_ASTARTE_DEADBAND is enabled and are set on a single
+ * endpoint with astarte_device_set_deadband(). They apply to the double, integer, longinteger and
+ * boolean datastreams, before any serialization. A value is published if it is the first one, if
+ * it moved from the last published value by more than one of the configured thresholds, or if the
+ * heartbeat expired. Without thresholds any change is published. Integer and longinteger values
+ * are compared exactly. Suppressed values are reported as successfully published, without a
+ * publish token.
+ */
+
+#ifndef _ASTARTE_DEADBAND_H_
+#define _ASTARTE_DEADBAND_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Configuration of a dead-band filter.
+ */
+typedef struct
+{
+    double absolute; /**< Absolute threshold, 0 to disable it. */
+    double relative; /**< Threshold relative to the last published value, 0.05 is 5%, 0 to
+                        disable it. */
+    uint32_t heartbeat_s; /**< Maximum time between two publishes, 0 to disable it. */
+} astarte_deadband_config_t;
+
+#endif /* _ASTARTE_DEADBAND_H_ */
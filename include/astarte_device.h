@@ -13,9 +13,22 @@
 #define _ASTARTE_DEVICE_H_
 
 #include "astarte.h"
+#include "astarte_aggregator.h"
+#include "astarte_blob.h"
+#include "astarte_block.h"
+#include "astarte_burst.h"
 
 #include "astarte_bson_deserializer.h"
+#include "astarte_credentials.h"
+#include "astarte_deadband.h"
+#include "astarte_device_stats.h"
 #include "astarte_interface.h"
+#include "astarte_outbox.h"
+#include "astarte_publish_tracking.h"
+#include "astarte_rate_limit.h"
+#include "astarte_sample_ring.h"
+#include "astarte_shadow.h"
+#include "astarte_transport.h"
 
 #include <stdbool.h>
 #include <stdint.h>
@@ -70,16 +83,42 @@ typedef void (*astarte_device_disconnection_event_callback_t)(
 
 typedef void (*astarte_device_unset_event_callback_t)(astarte_device_unset_event_t *event);
 
+typedef struct
+{
+    astarte_device_handle_t device;
+    astarte_publish_token_t token;
+    const char *interface_name;
+    const char *path;
+    astarte_publish_result_t result;
+    void *user_data;
+} astarte_device_publish_event_t;
+
+typedef void (*astarte_device_publish_event_callback_t)(astarte_device_publish_event_t *event);
+
+typedef struct
+{
+    astarte_device_handle_t device;
+    bool congested;
+    size_t outbox_size;
+    void *user_data;
+} astarte_device_outbox_event_t;
+
+typedef void (*astarte_device_outbox_event_callback_t)(astarte_device_outbox_event_t *event);
+
 typedef struct
 {
     astarte_device_data_event_callback_t data_event_callback;
     astarte_device_unset_event_callback_t unset_event_callback;
     astarte_device_connection_event_callback_t connection_event_callback;
     astarte_device_disconnection_event_callback_t disconnection_event_callback;
+    astarte_device_publish_event_callback_t publish_event_callback;
+    astarte_device_outbox_event_callback_t outbox_event_callback;
     void *callbacks_user_data;
     const char *hwid;
     const char *credentials_secret;
     const char *realm;
+    astarte_credentials_context_t *credentials_context;
+    const astarte_transport_t *transport; /**< Copied, NULL for the esp-mqtt client. */
 } astarte_device_config_t;
 
 #ifdef __cplusplus
@@ -116,6 +155,22 @@ extern "C" {
  *      .hwid = hwid,
  *  };
  *
+ * By default all the devices share the global credentials context. Firmwares handling several
+ * devices should give each of them its own credentials context, so that keys, certificates and
+ * credentials secrets are kept apart:
+ *
+ *  static astarte_credentials_context_t creds_ctx;
+ *  astarte_credentials_ctx_use_fat_storage(&creds_ctx, "dev0");
+ *  astarte_credentials_ctx_init(&creds_ctx);
+ *
+ *  astarte_device_config_t cfg = {
+ *      .data_event_callback = astarte_data_events_handler,
+ *      .hwid = hwid,
+ *      .credentials_context = &creds_ctx,
+ *  };
+ *
+ * The credentials context must outlive the device.
+ *
  * @return The handle to the device, NULL if an error occurred.
  */
 astarte_device_handle_t astarte_device_init(astarte_device_config_t *cfg);
@@ -929,6 +984,283 @@ bool astarte_device_is_connected(astarte_device_handle_t device);
  * @return The string containing the encoded device ID.
  */
 char *astarte_device_get_encoded_id(astarte_device_handle_t device);
+
+/**
+ * @brief Get the statistics collected by the device.
+ *
+ * @details Counters and histograms are cumulative since the device initialization or the last
+ * call to astarte_device_reset_stats(). The MQTT outbox size is sampled by this call.
+ * @param device An Astarte device handle.
+ * @param[out] stats Where the statistics are copied.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if statistics are disabled with CONFIG_ASTARTE_DEVICE_STATS,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_get_stats(
+    astarte_device_handle_t device, astarte_device_stats_t *stats);
+
+/**
+ * @brief Reset the statistics collected by the device.
+ *
+ * @param device An Astarte device handle.
+ */
+void astarte_device_reset_stats(astarte_device_handle_t device);
+
+/**
+ * @brief Set the rate limits of the device or of one of its interfaces.
+ *
+ * @details Limits only apply to datastreams, see astarte_rate_limit.h. Setting the limits again
+ * refills the buckets and keeps the counters. Interfaces without limits are only subject to the
+ * device ones.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface to limit, NULL to set the limits of the whole device.
+ * @param config The limits, NULL to remove them.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if rate limits are disabled with CONFIG_ASTARTE_RATE_LIMIT,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the limits of the interface could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_set_rate_limit(astarte_device_handle_t device,
+    const char *interface_name, const astarte_rate_limit_config_t *config);
+
+/**
+ * @brief Get the rate limit counters of the device or of one of its interfaces.
+ *
+ * @details The device counters include the messages of all the interfaces.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface, NULL for the whole device.
+ * @param[out] counters Where the counters are copied.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if rate limits are disabled or the interface has no limits,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_get_rate_limit_counters(astarte_device_handle_t device,
+    const char *interface_name, astarte_rate_limit_counters_t *counters);
+
+/**
+ * @brief Add an aggregator publishing a summary of its samples at the end of each window.
+ *
+ * @details See astarte_aggregator.h. The aggregator starts its first window immediately and is
+ * released together with the device.
+ * @param device An Astarte device handle.
+ * @param config The aggregator configuration.
+ * @param[out] aggregator The handle to push the samples to.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if aggregation is disabled with CONFIG_ASTARTE_AGGREGATION,
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the path does not start with /,
+ * - ASTARTE_ERR_INVALID_QOS if the QoS is not 0, 1 or 2,
+ * - ASTARTE_ERR_INVALID_SIZE if the window length is 0,
+ * - ASTARTE_ERR if no valid reducer is selected,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the aggregator could not be allocated,
+ * - ASTARTE_ERR_ESP_SDK if the window timer could not be started,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_add_aggregator(astarte_device_handle_t device,
+    const astarte_aggregator_config_t *config, astarte_aggregator_handle_t *aggregator);
+
+/**
+ * @brief Set the dead-band filter of a datastream endpoint.
+ *
+ * @details See astarte_deadband.h. Changing the thresholds of an endpoint keeps its last published
+ * value.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface of the endpoint.
+ * @param path The path of the endpoint.
+ * @param config The thresholds, NULL to remove the filter.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if filters are disabled with CONFIG_ASTARTE_DEADBAND or when removing a
+ * filter that does not exist,
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the path does not start with /,
+ * - ASTARTE_ERR if a threshold is negative or CONFIG_ASTARTE_DEADBAND_MAX_FILTERS is reached,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the filter could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_set_deadband(astarte_device_handle_t device,
+    const char *interface_name, const char *path, const astarte_deadband_config_t *config);
+
+/**
+ * @brief Add a shadow publishing the changed fields of an application struct as properties.
+ *
+ * @details See astarte_shadow.h. Nothing is published until the first commit. The shadow is
+ * released together with the device.
+ * @param device An Astarte device handle.
+ * @param config The shadow configuration.
+ * @param[out] shadow The handle to commit and lock the shadow.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if shadows are disabled with CONFIG_ASTARTE_SHADOW,
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the path of a field does not start with /,
+ * - ASTARTE_ERR_INVALID_SIZE if there are no fields or a field size does not match its type,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the shadow could not be allocated,
+ * - ASTARTE_ERR_ESP_SDK if the commit timer could not be started,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_add_shadow(astarte_device_handle_t device,
+    const astarte_shadow_config_t *config, astarte_shadow_handle_t *shadow);
+
+/**
+ * @brief Add a block stream packing samples into binaryblob messages.
+ *
+ * @details See astarte_block.h. The stream is released together with the device, samples of an
+ * incomplete block are discarded unless flushed with astarte_block_stream_flush().
+ * @param device An Astarte device handle.
+ * @param config The block stream configuration.
+ * @param[out] stream The handle to push the samples to.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if block streams are disabled with CONFIG_ASTARTE_BLOCK_ENCODING,
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the path does not start with /,
+ * - ASTARTE_ERR_INVALID_QOS if the QoS is not 0, 1 or 2,
+ * - ASTARTE_ERR_INVALID_SIZE if the number of samples per block is 0,
+ * - ASTARTE_ERR if the sample type is not valid,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the stream could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_add_block_stream(astarte_device_handle_t device,
+    const astarte_block_config_t *config, astarte_block_stream_handle_t *stream);
+
+/**
+ * @brief Publish the datastreams held for the next burst.
+ *
+ * @details See astarte_burst.h. Held datastreams are discarded when the device is destroyed, flush
+ * them first to keep them.
+ * @param device An Astarte device handle.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if burst mode is disabled with CONFIG_ASTARTE_BURST_FLUSH,
+ * - ASTARTE_OK if operation has been successful, failed publishes are only counted
+ */
+astarte_err_t astarte_device_flush_burst(astarte_device_handle_t device);
+
+/**
+ * @brief Get the burst counters of the device, including the time spent flushing them.
+ *
+ * @details The awake and sleep time of the chip are not reported, see astarte_burst.h.
+ *
+ * @param device An Astarte device handle.
+ * @param[out] stats Where the counters are copied.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if burst mode is disabled with CONFIG_ASTARTE_BURST_FLUSH,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_get_burst_stats(
+    astarte_device_handle_t device, astarte_burst_stats_t *stats);
+
+/**
+ * @brief Add a ring buffering the samples pushed from an ISR for one endpoint.
+ *
+ * @details See astarte_sample_ring.h. The ring is released together with the device, samples not
+ * drained yet are discarded. Pushes must be stopped before destroying the device.
+ * @param device An Astarte device handle.
+ * @param config The ring configuration.
+ * @param[out] ring The handle to push the samples to.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if sample rings are disabled with CONFIG_ASTARTE_SAMPLE_RINGS,
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the path does not start with /,
+ * - ASTARTE_ERR_INVALID_QOS if the QoS is not 0, 1 or 2,
+ * - ASTARTE_ERR_INVALID_SIZE if the capacity is not a power of two or the drain period is 0,
+ * - ASTARTE_ERR if the sample type is not valid,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the ring could not be allocated,
+ * - ASTARTE_ERR_ESP_SDK if the drain timer could not be started,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_add_sample_ring(astarte_device_handle_t device,
+    const astarte_sample_ring_config_t *config, astarte_sample_ring_handle_t *ring);
+
+/**
+ * @brief Get the token of the last message published by the calling task.
+ *
+ * @details See astarte_publish_tracking.h. The token is set by the publish functions, such as
+ * astarte_device_stream_double(), when they hand a QoS 1 or QoS 2 message to the MQTT client, and
+ * is reported to the publish_event_callback of the device once the message is acknowledged.
+ * @param device An Astarte device handle.
+ * @return The token, ASTARTE_PUBLISH_TOKEN_NONE if the last message of the task was not tracked,
+ * was deferred, failed or was published by another device, or if tracking is disabled with
+ * CONFIG_ASTARTE_PUBLISH_TRACKING.
+ */
+astarte_publish_token_t astarte_device_get_last_publish_token(astarte_device_handle_t device);
+
+/**
+ * @brief Set the in-flight window of the device or of one of its interfaces.
+ *
+ * @details Windows only apply to datastreams, see astarte_publish_tracking.h. Setting the window
+ * again replaces it, publishes waiting on it check the new one.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface of the window, NULL for the window of the whole device.
+ * @param config The window, NULL to remove it.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if tracking is disabled with CONFIG_ASTARTE_PUBLISH_TRACKING,
+ * - ASTARTE_ERR_INVALID_SIZE if the window is larger than CONFIG_ASTARTE_PUBLISH_MAX_IN_FLIGHT,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the window could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_set_publish_window(astarte_device_handle_t device,
+    const char *interface_name, const astarte_publish_window_config_t *config);
+
+/**
+ * @brief Get the number of datastreams waiting for an acknowledgment.
+ *
+ * @param device An Astarte device handle.
+ * @param interface_name The interface of the datastreams, NULL to count all of them.
+ * @param[out] in_flight Where the number is stored.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if tracking is disabled with CONFIG_ASTARTE_PUBLISH_TRACKING,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_get_publish_in_flight(
+    astarte_device_handle_t device, const char *interface_name, uint32_t *in_flight);
+
+/**
+ * @brief Set the outbox policy of the device or of one of its interfaces.
+ *
+ * @details Policies only apply to QoS 1 and QoS 2 datastreams published while the MQTT outbox is
+ * congested, see astarte_outbox.h. Interfaces without a policy use the one of the device,
+ * ASTARTE_OUTBOX_POLICY_REJECT unless set.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface of the policy, NULL for the policy of the whole device.
+ * @param policy The policy.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if the governor is disabled with CONFIG_ASTARTE_OUTBOX_GOVERNOR,
+ * - ASTARTE_ERR if the policy is not valid,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the policy could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_set_outbox_policy(
+    astarte_device_handle_t device, const char *interface_name, astarte_outbox_policy_t policy);
+
+/**
+ * @brief Get the counters of the outbox governor.
+ *
+ * @param device An Astarte device handle.
+ * @param[out] stats Where the counters are copied.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if the governor is disabled with CONFIG_ASTARTE_OUTBOX_GOVERNOR,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_device_get_outbox_stats(
+    astarte_device_handle_t device, astarte_outbox_stats_t *stats);
+
+/**
+ * @brief Send a binaryblob datastream built in place in the buffer of the caller.
+ *
+ * @details The blob is stored in the buffer at offset ASTARTE_BLOB_HEADROOM, followed by
+ * ASTARTE_BLOB_TAILROOM free bytes. The BSON document is written around the blob and the buffer is
+ * published without copying the blob, see astarte_blob.h. The buffer can be reused when the
+ * function returns.
+ * @param device An Astarte device handle.
+ * @param interface_name The interface name.
+ * @param path The path of the datastream.
+ * @param buffer The buffer, of at least ASTARTE_BLOB_HEADROOM + blob_size + ASTARTE_BLOB_TAILROOM
+ * bytes, overwritten outside the blob.
+ * @param blob_size The size of the blob.
+ * @param ts_epoch_millis The timestamp, ASTARTE_INVALID_TIMESTAMP to send none.
+ * @param qos The MQTT QoS to be used for the publish (0, 1 or 2).
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_SIZE if the blob does not fit a BSON document,
+ * - another astarte_err_t if the message could not be published,
+ * - ASTARTE_OK if the publish sequence correctly started
+ */
+astarte_err_t astarte_device_stream_binaryblob_in_place(astarte_device_handle_t device,
+    const char *interface_name, const char *path, void *buffer, size_t blob_size,
+    uint64_t ts_epoch_millis, int qos);
+
 #ifdef __cplusplus
 }
 #endif
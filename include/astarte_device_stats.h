@@ -0,0 +1,107 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_stats.h
+ * @brief Counters and latency histograms collected by an Astarte device.
+ *
+ * @details Statistics are collected when CONFIG_ASTARTE_DEVICE_STATS is enabled and can be read
+ * with astarte_device_get_stats().
+ */
+
+#ifndef _ASTARTE_DEVICE_STATS_H_
+#define _ASTARTE_DEVICE_STATS_H_
+
+#include "astarte.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Number of buckets of a latency histogram.
+ *
+ * @details Bucket 0 counts the samples of 0us, bucket i counts the samples in the range
+ * [2^(i-1), 2^i) us. The last bucket also counts all the longer samples, about 4s and above.
+ */
+#define ASTARTE_LATENCY_HISTOGRAM_BUCKETS 24
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Logarithmic histogram of latencies expressed in microseconds.
+ */
+typedef struct
+{
+    uint32_t count; /**< Number of samples. */
+    uint64_t total_us; /**< Sum of all the samples, to compute the average. */
+    uint32_t max_us; /**< Longest sample. */
+    uint32_t buckets[ASTARTE_LATENCY_HISTOGRAM_BUCKETS]; /**< Samples count of each bucket. */
+} astarte_latency_histogram_t;
+
+/**
+ * @brief Statistics of an Astarte device.
+ */
+typedef struct
+{
+    uint32_t publish_ok; /**< Messages handed to the MQTT client. */
+    uint32_t publish_failed; /**< Publishes failed with ASTARTE_ERR_PUBLISH. */
+    uint32_t publish_not_ready; /**< Publishes failed with ASTARTE_ERR_DEVICE_NOT_READY. */
+    uint32_t publish_queue_full; /**< Publishes failed with ASTARTE_ERR_PUBLISH_QUEUE_FULL. */
+    uint32_t publish_suppressed; /**< Datastream values dropped by a dead-band filter. */
+    uint32_t properties_coalesced; /**< Pending property values replaced by a newer one. */
+    astarte_latency_histogram_t publish_serialize; /**< BSON serialization of the payload. */
+    astarte_latency_histogram_t publish_lock_wait; /**< Wait for the device lock. */
+    astarte_latency_histogram_t publish_enqueue; /**< Hand off to the MQTT client. */
+    int32_t mqtt_outbox_size; /**< Bytes held in the MQTT outbox when the stats were read. */
+
+    uint32_t incoming_messages; /**< Messages received from Astarte. */
+    astarte_latency_histogram_t incoming_dispatch; /**< Handling of a received message. */
+
+    uint32_t storage_ops; /**< Properties storage operations, including the NVS commit. */
+    uint32_t storage_errors; /**< Failed properties storage operations. */
+    astarte_latency_histogram_t storage_op; /**< Duration of a properties storage operation. */
+
+    uint32_t connections; /**< MQTT connections established, the first one included. */
+    uint32_t disconnections; /**< MQTT disconnections. */
+    uint32_t connection_errors; /**< MQTT errors reported by the client. */
+    uint32_t reinits; /**< Runs of the device reinitialization, due to certificate errors. */
+    uint32_t certificate_renewals; /**< Reinitializations that obtained a new certificate. */
+    astarte_latency_histogram_t certificate_renewal; /**< Duration of a reinitialization. */
+
+    // Filled only when CONFIG_ASTARTE_STATIC_MEMORY is enabled
+    size_t scratch_publish_peak; /**< Peak usage in bytes of the publish scratch arena. */
+    size_t scratch_receive_peak; /**< Peak usage in bytes of the receive scratch arena. */
+    uint32_t scratch_failures; /**< Allocations the scratch arenas could not serve. */
+} astarte_device_stats_t;
+
+/**
+ * @brief Adds a sample to a latency histogram
+ *
+ * @param[inout] histogram The histogram to update.
+ * @param[in] latency_us The sample, negative values are counted as 0.
+ */
+void astarte_latency_histogram_record(astarte_latency_histogram_t *histogram, int64_t latency_us);
+
+/**
+ * @brief Estimates a percentile of a latency histogram
+ *
+ * @details The estimate is the upper bound of the bucket containing the percentile, capped to the
+ * longest sample.
+ *
+ * @param[in] histogram The histogram.
+ * @param[in] percentile The percentile to estimate, between 0 and 100.
+ * @return The estimated latency in microseconds, 0 for an empty histogram.
+ */
+uint32_t astarte_latency_histogram_percentile(
+    const astarte_latency_histogram_t *histogram, uint32_t percentile);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_DEVICE_STATS_H_ */
@@ -29,6 +29,21 @@ typedef enum
     TYPE_PROPERTIES, /**< Properties interface */
 } astarte_interface_type_t;
 
+/**
+ * @brief interface publish priority
+ *
+ * This enum represents the priority class of the messages published on an Astarte interface. It is
+ * used when CONFIG_ASTARTE_PUBLISH_LANES is enabled, control messages always have the highest
+ * priority.
+ */
+typedef enum
+{
+    PRIORITY_DEFAULT = 0, /**< Properties priority for properties interfaces, bulk otherwise */
+    PRIORITY_PROPERTIES, /**< Same priority as the device owned properties */
+    PRIORITY_ALARM, /**< Alarm datastreams, sent ahead of the bulk ones */
+    PRIORITY_BULK, /**< Bulk telemetry, lowest priority */
+} astarte_interface_priority_t;
+
 /**
  * @brief Astarte interface definition
  *
@@ -43,6 +58,7 @@ typedef struct
     int minor_version; /**< Minor version */
     astarte_interface_ownership_t ownership; /**< Ownership, see #astarte_interface_ownership_t */
     astarte_interface_type_t type; /**< Type, see #astarte_interface_type_t */
+    astarte_interface_priority_t priority; /**< Priority, see #astarte_interface_priority_t */
 } astarte_interface_t;
 
 #endif
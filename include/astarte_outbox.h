@@ -0,0 +1,56 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_outbox.h
+ * @brief Memory budget of the messages stored in the MQTT outbox.
+ *
+ * @details The outbox governor is available when CONFIG_ASTARTE_OUTBOX_GOVERNOR is enabled. The
+ * MQTT client keeps QoS 1 and QoS 2 messages in its outbox until the broker acknowledges them, on a
+ * slow link the outbox grows as long as messages are published faster than they are acknowledged.
+ *
+ * Once the outbox reaches CONFIG_ASTARTE_OUTBOX_HIGH_WATER_BYTES the device is congested: QoS 1 and
+ * QoS 2 datastreams are handled according to the outbox policy of their interface, set with
+ * astarte_device_set_outbox_policy(), until the outbox drains to
+ * CONFIG_ASTARTE_OUTBOX_LOW_WATER_BYTES. Both crossings are reported to the
+ * outbox_event_callback of the device configuration by the device task. Properties and QoS 0
+ * datastreams are never held back.
+ */
+
+#ifndef _ASTARTE_OUTBOX_H_
+#define _ASTARTE_OUTBOX_H_
+
+#include <stdint.h>
+
+/**
+ * @brief What happens to a datastream published while the outbox is congested.
+ */
+typedef enum
+{
+    /** @brief The publish fails with ASTARTE_ERR_OUTBOX_FULL. */
+    ASTARTE_OUTBOX_POLICY_REJECT = 0,
+    /**
+     * @brief The datastream is held by the device and published once the outbox drained, it fails
+     * with ASTARTE_ERR_OUTBOX_FULL when CONFIG_ASTARTE_OUTBOX_DEFER_MAX_BYTES are already held.
+     */
+    ASTARTE_OUTBOX_POLICY_DEFER,
+    /** @brief The datastream is published with QoS 0, that does not go through the outbox. */
+    ASTARTE_OUTBOX_POLICY_DOWNGRADE,
+} astarte_outbox_policy_t;
+
+/**
+ * @brief Counters of the outbox governor of a device.
+ */
+typedef struct
+{
+    uint32_t congestions; /**< Crossings of the high-water mark. */
+    uint32_t rejected; /**< Datastreams failed with ASTARTE_ERR_OUTBOX_FULL. */
+    uint32_t deferred; /**< Datastreams held until the outbox drained. */
+    uint32_t downgraded; /**< Datastreams published with QoS 0. */
+    uint32_t released; /**< Held datastreams handed back to the publish path. */
+} astarte_outbox_stats_t;
+
+#endif /* _ASTARTE_OUTBOX_H_ */
@@ -13,6 +13,7 @@
 #define _ASTARTE_PAIRING_H_
 
 #include "astarte.h"
+#include "astarte_credentials.h"
 
 #include <string.h>
 
@@ -23,6 +24,8 @@ struct astarte_pairing_config
     const char *realm;
     const char *hw_id;
     const char *credentials_secret;
+    /** @brief Credentials context used to store the credentials secret, NULL for the global one */
+    astarte_credentials_context_t *credentials_context;
 } __attribute__((deprecated("Please use astarte_pairing_config_t")));
 
 #pragma GCC diagnostic push
@@ -30,6 +33,16 @@ struct astarte_pairing_config
 typedef struct astarte_pairing_config astarte_pairing_config_t;
 #pragma GCC diagnostic pop
 
+/**
+ * @brief Handle to a pairing session.
+ *
+ * @details A pairing session keeps a single keep-alive HTTPS connection to Pairing API and the
+ * credentials secret in memory, so that consecutive pairing requests don't pay for a new TLS
+ * handshake and a new read of the credentials secret each. A session must not be shared among
+ * tasks.
+ */
+typedef struct astarte_pairing_session *astarte_pairing_session_handle_t;
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -85,6 +98,76 @@ astarte_err_t astarte_pairing_get_mqtt_v1_credentials(
 astarte_err_t astarte_pairing_get_mqtt_v1_broker_url(
     const astarte_pairing_config_t *config, char *out, size_t length);
 
+/**
+ * @brief create a pairing session.
+ *
+ * @details No connection is opened until the first request. The configuration is copied, but the
+ * strings it points to must stay valid for the lifetime of the session.
+ *
+ * @param config A struct containing the pairing configuration.
+ * @return The session handle, NULL if the allocation failed.
+ */
+astarte_pairing_session_handle_t astarte_pairing_session_new(
+    const astarte_pairing_config_t *config);
+
+/**
+ * @brief destroy a pairing session, closing its connection.
+ *
+ * @param session The session to destroy, may be NULL.
+ */
+void astarte_pairing_session_destroy(astarte_pairing_session_handle_t session);
+
+/**
+ * @brief get the credentials secret using a pairing session.
+ *
+ * @details Same as astarte_pairing_get_credentials_secret(). The secret is loaded or obtained
+ * once and then kept in the session.
+ *
+ * @param session The pairing session.
+ * @param out A pointer to an allocated string which the credentials secret will be written to.
+ * @param length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_pairing_session_get_credentials_secret(
+    astarte_pairing_session_handle_t session, char *out, size_t length);
+
+/**
+ * @brief register a device using a pairing session.
+ *
+ * @details Same as astarte_pairing_register_device().
+ *
+ * @param session The pairing session.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_pairing_session_register_device(astarte_pairing_session_handle_t session);
+
+/**
+ * @brief obtain a new Astarte MQTT v1 certificate using a pairing session.
+ *
+ * @details Same as astarte_pairing_get_mqtt_v1_credentials().
+ *
+ * @param session The pairing session.
+ * @param csr A PEM encoded NULL-terminated string containing the CSR
+ * @param out A pointer to an allocated buffer where the certificat will be written.
+ * @param length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_pairing_session_get_mqtt_v1_credentials(
+    astarte_pairing_session_handle_t session, const char *csr, char *out, size_t length);
+
+/**
+ * @brief get the Astarte MQTT v1 broker URL using a pairing session.
+ *
+ * @details Same as astarte_pairing_get_mqtt_v1_broker_url().
+ *
+ * @param session The pairing session.
+ * @param out A pointer to an allocated string where the URL will be written.
+ * @param length The length of the out buffer.
+ * @return The status code, ASTARTE_OK if successful, otherwise an error code is returned.
+ */
+astarte_err_t astarte_pairing_session_get_mqtt_v1_broker_url(
+    astarte_pairing_session_handle_t session, char *out, size_t length);
+
 #ifdef __cplusplus
 }
 #endif
@@ -0,0 +1,76 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_publish_tracking.h
+ * @brief Delivery reports and in-flight windows of the messages published by an Astarte device.
+ *
+ * @details Tracking is available when CONFIG_ASTARTE_PUBLISH_TRACKING is enabled. Each QoS 1 or
+ * QoS 2 message handed to the MQTT client gets a token, returned to the task that published it by
+ * astarte_device_get_last_publish_token(). Once the broker acknowledges the message, or the message
+ * is given up, the publish_event_callback of the device configuration is called by the device task
+ * with the token and the result. QoS 0 messages and control messages are not tracked.
+ *
+ * A window set with astarte_device_set_publish_window() bounds the datastreams waiting for an
+ * acknowledgment, of the whole device or of a single interface. A datastream exceeding a window
+ * waits for an acknowledgment or fails with ASTARTE_ERR_PUBLISH_WINDOW_FULL, depending on the
+ * policy. Properties are tracked but never held back by the windows.
+ *
+ * Messages deferred by the publish lanes, the rate limits, the property coalescing or the burst
+ * mode are tracked once handed to the MQTT client: the windows apply to the task sending them and
+ * their token is only known through the callback.
+ */
+
+#ifndef _ASTARTE_PUBLISH_TRACKING_H_
+#define _ASTARTE_PUBLISH_TRACKING_H_
+
+#include <stdint.h>
+
+/**
+ * @brief Identifier of a tracked message, unique for the lifetime of a device.
+ */
+typedef uint32_t astarte_publish_token_t;
+
+/**
+ * @brief Token of the messages that are not tracked.
+ */
+#define ASTARTE_PUBLISH_TOKEN_NONE 0U
+
+/**
+ * @brief Outcome of a tracked message.
+ */
+typedef enum
+{
+    /** @brief The broker acknowledged the message. */
+    ASTARTE_PUBLISH_RESULT_DELIVERED = 0,
+    /** @brief The MQTT client dropped the message from its outbox before the acknowledgment. */
+    ASTARTE_PUBLISH_RESULT_EXPIRED,
+    /** @brief The message was discarded with the MQTT client when the device was reinitialized. */
+    ASTARTE_PUBLISH_RESULT_LOST,
+} astarte_publish_result_t;
+
+/**
+ * @brief What happens to a datastream exceeding a window.
+ */
+typedef enum
+{
+    /** @brief The publish waits for an acknowledgment, at most for the block timeout. */
+    ASTARTE_PUBLISH_WINDOW_POLICY_BLOCK = 0,
+    /** @brief The publish fails with ASTARTE_ERR_PUBLISH_WINDOW_FULL. */
+    ASTARTE_PUBLISH_WINDOW_POLICY_REJECT,
+} astarte_publish_window_policy_t;
+
+/**
+ * @brief In-flight window of a device or of an interface.
+ */
+typedef struct
+{
+    uint32_t max_in_flight; /**< Unacknowledged datastreams allowed, 0 disables the window. */
+    astarte_publish_window_policy_t policy; /**< Policy for the datastreams exceeding it. */
+    uint32_t block_timeout_ms; /**< Longest wait of the block policy. */
+} astarte_publish_window_config_t;
+
+#endif /* _ASTARTE_PUBLISH_TRACKING_H_ */
@@ -0,0 +1,67 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_rate_limit.h
+ * @brief Token bucket limits applied to the datastreams published by an Astarte device.
+ *
+ * @details Limits are available when CONFIG_ASTARTE_RATE_LIMIT is enabled and are set with
+ * astarte_device_set_rate_limit(), for the whole device or for a single interface. A message is
+ * sent only when both the buckets of its interface and the ones of the device hold enough tokens,
+ * otherwise the policy of the interface, or of the device if the interface has no limit, applies.
+ * Properties are never limited.
+ */
+
+#ifndef _ASTARTE_RATE_LIMIT_H_
+#define _ASTARTE_RATE_LIMIT_H_
+
+#include <stdint.h>
+
+/**
+ * @brief What happens to a message exceeding the limits.
+ */
+typedef enum
+{
+    /** @brief The publish fails with ASTARTE_ERR_RATE_LIMITED. */
+    ASTARTE_RATE_LIMIT_POLICY_REJECT = 0,
+    /** @brief The message is discarded and the publish succeeds. */
+    ASTARTE_RATE_LIMIT_POLICY_DROP,
+    /** @brief The message replaces the one waiting on the same path, if any, and is sent when
+     * tokens are available. */
+    ASTARTE_RATE_LIMIT_POLICY_LATEST,
+    /** @brief The message waits in the backlog and is sent when tokens are available. */
+    ASTARTE_RATE_LIMIT_POLICY_QUEUE,
+} astarte_rate_limit_policy_t;
+
+/**
+ * @brief Limits of a device or of an interface.
+ *
+ * @details Each bucket refills at its rate and holds at most its burst. A rate of 0 disables the
+ * bucket. A burst lower than the rate is raised to the rate.
+ */
+typedef struct
+{
+    uint32_t messages_per_s; /**< Messages allowed each second. */
+    uint32_t messages_burst; /**< Messages that can be sent back to back. */
+    uint32_t bytes_per_s; /**< Payload bytes allowed each second. */
+    uint32_t bytes_burst; /**< Payload bytes that can be sent back to back. */
+    astarte_rate_limit_policy_t policy; /**< Policy for the messages exceeding the limits. */
+} astarte_rate_limit_config_t;
+
+/**
+ * @brief Counters of a device or of an interface limit.
+ */
+typedef struct
+{
+    uint32_t passed; /**< Messages sent without waiting. */
+    uint32_t rejected; /**< Messages failed with ASTARTE_ERR_RATE_LIMITED. */
+    uint32_t dropped; /**< Messages discarded, also when the backlog is full. */
+    uint32_t queued; /**< Messages added to the backlog. */
+    uint32_t replaced; /**< Backlog messages overwritten by a newer value on the same path. */
+    uint32_t released; /**< Backlog messages sent once tokens were available. */
+} astarte_rate_limit_counters_t;
+
+#endif /* _ASTARTE_RATE_LIMIT_H_ */
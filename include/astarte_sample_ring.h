@@ -0,0 +1,94 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_sample_ring.h
+ * @brief Lock-free ingestion of samples from interrupt handlers.
+ *
+ * @details Sample rings are available when CONFIG_ASTARTE_SAMPLE_RINGS is enabled and are added to
+ * a device with astarte_device_add_sample_ring(). Each ring buffers the samples of one datastream
+ * endpoint. astarte_device_push_sample_from_isr() stores a sample together with the time of the
+ * push, without locks, allocations or blocking calls, from an ISR or from a high priority task.
+ * The device task drains the rings periodically, and as soon as a ring is half full, publishing
+ * each sample with the timestamp taken at push time.
+ *
+ * Samples of a ring must be pushed by a single ISR or task at a time. When a ring is full the new
+ * samples are dropped and counted.
+ */
+
+#ifndef _ASTARTE_SAMPLE_RING_H_
+#define _ASTARTE_SAMPLE_RING_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Type of the samples of a ring, the one of the endpoint.
+ */
+typedef enum
+{
+    ASTARTE_SAMPLE_RING_TYPE_DOUBLE = 0, /**< Published as double. */
+    ASTARTE_SAMPLE_RING_TYPE_LONGINTEGER, /**< Published as longinteger. */
+} astarte_sample_ring_type_t;
+
+/**
+ * @brief Configuration of a sample ring.
+ */
+typedef struct
+{
+    const char *interface_name; /**< Interface of the samples, copied. */
+    const char *path; /**< Endpoint of the samples, copied. */
+    astarte_sample_ring_type_t type; /**< Type of the samples. */
+    uint32_t capacity; /**< Samples held by the ring, a power of two. */
+    uint32_t drain_period_ms; /**< Interval between two drains of the ring. */
+    int qos; /**< QoS of the samples. */
+} astarte_sample_ring_config_t;
+
+/**
+ * @brief Handle of a sample ring, owned by the device it has been added to.
+ */
+typedef struct astarte_sample_ring *astarte_sample_ring_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Adds a double sample to a ring, timestamped with the current time
+ *
+ * @details ISR safe and placed in IRAM, it never allocates nor blocks.
+ *
+ * @param[in] ring A ring of doubles.
+ * @param[in] value The sample.
+ * @return true if the sample has been added, false if the ring is full or of another type.
+ */
+bool astarte_device_push_sample_from_isr(astarte_sample_ring_handle_t ring, double value);
+
+/**
+ * @brief Adds a long integer sample to a ring, timestamped with the current time
+ *
+ * @details ISR safe and placed in IRAM, it never allocates nor blocks.
+ *
+ * @param[in] ring A ring of long integers.
+ * @param[in] value The sample.
+ * @return true if the sample has been added, false if the ring is full or of another type.
+ */
+bool astarte_device_push_longinteger_sample_from_isr(
+    astarte_sample_ring_handle_t ring, int64_t value);
+
+/**
+ * @brief Returns the number of samples dropped because the ring was full
+ *
+ * @param[in] ring The ring.
+ * @return The number of dropped samples.
+ */
+uint32_t astarte_sample_ring_dropped(astarte_sample_ring_handle_t ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SAMPLE_RING_H_ */
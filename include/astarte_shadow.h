@@ -0,0 +1,128 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_shadow.h
+ * @brief Shadow of device owned properties kept in an application struct.
+ *
+ * @details Shadows are available when CONFIG_ASTARTE_SHADOW is enabled and are added to a device
+ * with astarte_device_add_shadow(). The application describes its struct with a table of fields,
+ * each mapped to a property path, for example:
+ *
+ * @code{.c}
+ * struct settings
+ * {
+ *     double threshold;
+ *     bool enabled;
+ *     char name[32];
+ * };
+ *
+ * static const astarte_shadow_field_t settings_fields[] = {
+ *     ASTARTE_SHADOW_FIELD(struct settings, threshold, ASTARTE_SHADOW_TYPE_DOUBLE, "/threshold"),
+ *     ASTARTE_SHADOW_FIELD(struct settings, enabled, ASTARTE_SHADOW_TYPE_BOOLEAN, "/enabled"),
+ *     ASTARTE_SHADOW_FIELD(struct settings, name, ASTARTE_SHADOW_TYPE_STRING, "/name"),
+ * };
+ * @endcode
+ *
+ * On each commit, explicit with astarte_shadow_commit() or periodic, the struct is compared with
+ * the values published last and only the changed fields are set. The first commit publishes all of
+ * them. Fields modified while a periodic commit might run must be written between
+ * astarte_shadow_lock() and astarte_shadow_unlock().
+ */
+
+#ifndef _ASTARTE_SHADOW_H_
+#define _ASTARTE_SHADOW_H_
+
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Type of a shadow field and of its property.
+ */
+typedef enum
+{
+    ASTARTE_SHADOW_TYPE_DOUBLE = 0, /**< double. */
+    ASTARTE_SHADOW_TYPE_INTEGER, /**< int32_t. */
+    ASTARTE_SHADOW_TYPE_LONGINTEGER, /**< int64_t. */
+    ASTARTE_SHADOW_TYPE_BOOLEAN, /**< bool. */
+    ASTARTE_SHADOW_TYPE_DATETIME, /**< int64_t, milliseconds since the epoch. */
+    ASTARTE_SHADOW_TYPE_STRING, /**< NUL terminated char array, not a pointer. */
+} astarte_shadow_type_t;
+
+/**
+ * @brief Field of a shadow struct, usually declared with #ASTARTE_SHADOW_FIELD.
+ */
+typedef struct
+{
+    const char *path; /**< Property path, must start with /. */
+    astarte_shadow_type_t type;
+    size_t offset; /**< Offset of the field in the struct. */
+    size_t size; /**< Size of the field in the struct. */
+} astarte_shadow_field_t;
+
+/**
+ * @brief Declares a field of a shadow struct.
+ */
+#define ASTARTE_SHADOW_FIELD(struct_type, member, field_type, field_path)                          \
+    {                                                                                              \
+        .path = (field_path), .type = (field_type), .offset = offsetof(struct_type, member),       \
+        .size = sizeof(((struct_type *) 0)->member),                                               \
+    }
+
+/**
+ * @brief Configuration of a shadow.
+ */
+typedef struct
+{
+    const char *interface_name; /**< Properties interface of all the fields, copied. */
+    const void *data; /**< The application struct, must outlive the device. */
+    const astarte_shadow_field_t *fields; /**< Fields table, must outlive the device. */
+    size_t fields_count;
+    uint32_t period_ms; /**< Period of the automatic commits, 0 to only commit explicitly. */
+} astarte_shadow_config_t;
+
+/**
+ * @brief Handle of a shadow, owned by the device it has been added to.
+ */
+typedef struct astarte_shadow *astarte_shadow_handle_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Publishes the fields changed since the last commit
+ *
+ * @details Must not be called between astarte_shadow_lock() and astarte_shadow_unlock(). Fields
+ * that fail to publish are retried on the next commit.
+ *
+ * @param[in] shadow The shadow.
+ * @return ASTARTE_OK if all the changed fields have been published, otherwise the error of the
+ * first field that failed.
+ */
+astarte_err_t astarte_shadow_commit(astarte_shadow_handle_t shadow);
+
+/**
+ * @brief Prevents commits from reading the struct while the application updates it
+ *
+ * @param[in] shadow The shadow.
+ */
+void astarte_shadow_lock(astarte_shadow_handle_t shadow);
+
+/**
+ * @brief Allows commits to read the struct again
+ *
+ * @param[in] shadow The shadow.
+ */
+void astarte_shadow_unlock(astarte_shadow_handle_t shadow);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SHADOW_H_ */
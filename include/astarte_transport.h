@@ -0,0 +1,143 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_transport.h
+ * @brief MQTT transport of a device.
+ *
+ * @details The device connects, publishes and subscribes through a transport, which reports the
+ * events of the connection back to the device. The esp-mqtt client is the default transport,
+ * another one is set with the transport field of the device configuration. The in-process
+ * transport of astarte_transport_loopback.h needs no network nor broker.
+ *
+ * A transport delivers its events one at a time and never from its own operations: the device
+ * calls them with its locks held, while handling an event takes the same locks.
+ */
+
+#ifndef _ASTARTE_TRANSPORT_H_
+#define _ASTARTE_TRANSPORT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Returned by the publish operation when the broker does not accept the topic alias, the
+ * message is then not published.
+ */
+#define ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED (-100)
+
+/**
+ * @brief Event of the connection of a transport.
+ */
+typedef enum
+{
+    ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT = 0, /**< The transport is about to connect. */
+    ASTARTE_TRANSPORT_EVENT_CONNECTED, /**< The broker accepted the connection. */
+    ASTARTE_TRANSPORT_EVENT_DISCONNECTED, /**< The connection has been lost. */
+    ASTARTE_TRANSPORT_EVENT_PUBLISHED, /**< A QoS 1 or QoS 2 message has been acknowledged. */
+    ASTARTE_TRANSPORT_EVENT_DELETED, /**< A message expired before being acknowledged. */
+    ASTARTE_TRANSPORT_EVENT_DATA, /**< A message has been received. */
+    ASTARTE_TRANSPORT_EVENT_ERROR, /**< The connection failed. */
+} astarte_transport_event_id_t;
+
+/**
+ * @brief Cause of an ASTARTE_TRANSPORT_EVENT_ERROR.
+ */
+typedef enum
+{
+    ASTARTE_TRANSPORT_ERROR_OTHER = 0,
+    ASTARTE_TRANSPORT_ERROR_TLS, /**< The TLS handshake failed, for example on the certificate. */
+    ASTARTE_TRANSPORT_ERROR_CONNECTION_REFUSED, /**< The broker refused the connection. */
+} astarte_transport_error_t;
+
+/**
+ * @brief Event reported by a transport, the fields not used by the event are zeroed.
+ */
+typedef struct
+{
+    astarte_transport_event_id_t id;
+    int msg_id; /**< Message of ASTARTE_TRANSPORT_EVENT_PUBLISHED and _DELETED. */
+    bool session_present; /**< Session kept by the broker, for ASTARTE_TRANSPORT_EVENT_CONNECTED. */
+    const char *topic; /**< Topic of ASTARTE_TRANSPORT_EVENT_DATA, not NUL terminated. */
+    int topic_len;
+    const char *data; /**< Payload of ASTARTE_TRANSPORT_EVENT_DATA. */
+    int data_len;
+    astarte_transport_error_t error; /**< Cause of ASTARTE_TRANSPORT_EVENT_ERROR. */
+    int connect_return_code; /**< CONNACK code for ASTARTE_TRANSPORT_ERROR_CONNECTION_REFUSED. */
+} astarte_transport_event_t;
+
+/**
+ * @brief Handles the events of a client, the event is only valid during the call.
+ */
+typedef void (*astarte_transport_event_handler_t)(
+    void *handler_data, const astarte_transport_event_t *event);
+
+/**
+ * @brief Connection of a client.
+ */
+typedef struct
+{
+    const char *broker_url; /**< NULL for transports without a broker. */
+    const void *certificate; /**< Client certificate in DER form, NULL without credentials. */
+    size_t certificate_len;
+    const void *key; /**< Client private key in DER form. */
+    size_t key_len;
+    bool persistent_session; /**< The session outlives the connection. */
+    bool mqtt5; /**< Connect with MQTT 5 instead of MQTT 3.1.1. */
+} astarte_transport_config_t;
+
+/**
+ * @brief Operations of a transport.
+ *
+ * @details The device creates a client for each connection to the broker, destroying the previous
+ * one. The publish and subscribe operations return the message id, 0 for QoS 0 messages, or a
+ * negative value on failure.
+ */
+typedef struct
+{
+    /**
+     * @brief Creates a client, NULL on failure. The config is only valid during the call.
+     */
+    void *(*create)(void *transport_data, const astarte_transport_config_t *config,
+        astarte_transport_event_handler_t handler, void *handler_data);
+    /** @brief Stops and frees a client. */
+    void (*destroy)(void *client);
+    /** @brief Starts connecting, and reconnecting after losing the connection. */
+    astarte_err_t (*start)(void *client);
+    /** @brief Disconnects, without reporting ASTARTE_TRANSPORT_EVENT_DISCONNECTED. */
+    astarte_err_t (*stop)(void *client);
+    /**
+     * @brief Publishes a message, the data can be reused once the call returns. The MQTT 5 topic
+     * alias is 0 for none, ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED is returned above the Topic Alias
+     * Maximum of the broker or when the transport has no topic aliases.
+     */
+    int (*publish)(void *client, const char *topic, const void *data, int length, int qos,
+        uint16_t topic_alias);
+    /** @brief Subscribes to a topic filter. */
+    int (*subscribe)(void *client, const char *topic, int qos);
+    /** @brief Bytes of the messages waiting for an acknowledgment. */
+    int (*get_outbox_size)(void *client);
+} astarte_transport_ops_t;
+
+/**
+ * @brief A transport, its operations and their data.
+ */
+typedef struct
+{
+    const astarte_transport_ops_t *ops;
+    void *transport_data; /**< Passed to the create operation. */
+    /**
+     * @brief Topic of the device, "<realm>/<device_id>", for transports not connecting to Astarte.
+     * The device is then neither registered nor given credentials. NULL for transports connecting
+     * to Astarte.
+     */
+    const char *device_topic;
+} astarte_transport_t;
+
+#endif /* _ASTARTE_TRANSPORT_H_ */
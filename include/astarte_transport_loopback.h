@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_transport_loopback.h
+ * @brief In-process transport, standing in for the MQTT client and the broker.
+ *
+ * @details The loopback transport needs no network: it records the messages published by the
+ * device and injects the events of the broker when asked to. With it the overhead of the SDK can be
+ * measured deterministically, for example on the Linux target.
+ *
+ * The device uses the loopback through the transport field of its configuration, set to
+ * astarte_transport_loopback_get_transport(). The device is not registered, its topic is the one of
+ * the loopback configuration.
+ *
+ * Published messages are reported to the publish callback from the publishing task, the callback
+ * must not call the loopback. The connection, the acknowledgments and the incoming messages are
+ * delivered to the device by astarte_transport_loopback_connect(),
+ * astarte_transport_loopback_acknowledge() and astarte_transport_loopback_inject() in the calling
+ * task, that plays the task of the MQTT client: these functions must not be called concurrently.
+ */
+
+#ifndef _ASTARTE_TRANSPORT_LOOPBACK_H_
+#define _ASTARTE_TRANSPORT_LOOPBACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_transport.h"
+
+typedef struct astarte_transport_loopback *astarte_transport_loopback_handle_t;
+
+/**
+ * @brief Message published through the loopback, only valid during the publish callback.
+ */
+typedef struct
+{
+    const char *topic; /**< The topic, resolved from its alias when sent empty. */
+    const void *data;
+    int length;
+    int qos;
+    int msg_id; /**< 0 for QoS 0 messages. */
+    uint16_t topic_alias; /**< 0 when sent without alias. */
+} astarte_transport_loopback_message_t;
+
+typedef void (*astarte_transport_loopback_publish_callback_t)(
+    const astarte_transport_loopback_message_t *message, void *user_data);
+
+/**
+ * @brief Configuration of a loopback.
+ */
+typedef struct
+{
+    const char *device_topic; /**< "<realm>/<device_id>", copied. */
+    uint16_t topic_alias_maximum; /**< Topic aliases accepted, 0 for none. */
+    astarte_transport_loopback_publish_callback_t publish_callback; /**< Optional. */
+    void *callback_user_data;
+} astarte_transport_loopback_config_t;
+
+/**
+ * @brief Traffic recorded by a loopback.
+ */
+typedef struct
+{
+    uint32_t published; /**< Messages published. */
+    uint64_t published_bytes; /**< Payload bytes of the published messages. */
+    uint32_t subscriptions; /**< Topic filters subscribed. */
+    uint32_t acknowledged; /**< QoS 1 and QoS 2 messages acknowledged. */
+    uint32_t injected; /**< Messages delivered to the device. */
+    uint32_t outbox_size; /**< Payload bytes of the messages waiting for an acknowledgment. */
+} astarte_transport_loopback_stats_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Create a loopback transport.
+ *
+ * @param config The configuration of the loopback.
+ * @return The loopback, NULL if it could not be allocated.
+ */
+astarte_transport_loopback_handle_t astarte_transport_loopback_new(
+    const astarte_transport_loopback_config_t *config);
+
+/**
+ * @brief Destroy a loopback transport, after the device using it.
+ *
+ * @param loopback The loopback.
+ */
+void astarte_transport_loopback_destroy(astarte_transport_loopback_handle_t loopback);
+
+/**
+ * @brief Get the transport to set in the configuration of a device.
+ *
+ * @details The loopback serves a single device at a time.
+ * @param loopback The loopback.
+ * @return The transport, valid as long as the loopback.
+ */
+const astarte_transport_t *astarte_transport_loopback_get_transport(
+    astarte_transport_loopback_handle_t loopback);
+
+/**
+ * @brief Connect the started device, as the broker accepting its connection.
+ *
+ * @param loopback The loopback.
+ * @param session_present The broker kept the session of the device.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_DEVICE_NOT_READY if the device is not started,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_transport_loopback_connect(
+    astarte_transport_loopback_handle_t loopback, bool session_present);
+
+/**
+ * @brief Disconnect the device, as on a lost connection.
+ *
+ * @param loopback The loopback.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_DEVICE_NOT_READY if the device is not connected,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_transport_loopback_disconnect(astarte_transport_loopback_handle_t loopback);
+
+/**
+ * @brief Acknowledge all the QoS 1 and QoS 2 messages waiting for an acknowledgment.
+ *
+ * @param loopback The loopback.
+ * @return The number of messages acknowledged.
+ */
+uint32_t astarte_transport_loopback_acknowledge(astarte_transport_loopback_handle_t loopback);
+
+/**
+ * @brief Deliver a message to the connected device, as received from the broker.
+ *
+ * @param loopback The loopback.
+ * @param topic The topic of the message.
+ * @param data The payload of the message.
+ * @param length The length of the payload.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_DEVICE_NOT_READY if the device is not connected,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_transport_loopback_inject(astarte_transport_loopback_handle_t loopback,
+    const char *topic, const void *data, int length);
+
+/**
+ * @brief Get the traffic recorded by a loopback.
+ *
+ * @param loopback The loopback.
+ * @param[out] stats Where the counters are copied.
+ */
+void astarte_transport_loopback_get_stats(
+    astarte_transport_loopback_handle_t loopback, astarte_transport_loopback_stats_t *stats);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_TRANSPORT_LOOPBACK_H_ */
@@ -0,0 +1,66 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_alloc.h
+ * @brief Allocation functions used internally by the SDK.
+ *
+ * @details Every allocation is tagged with the subsystem requesting it and served by the allocator
+ * configured with astarte_allocator_set(). Memory can be released by any subsystem, the accounting
+ * always charges the subsystem that allocated it.
+ */
+
+#ifndef _ASTARTE_ALLOC_H_
+#define _ASTARTE_ALLOC_H_
+
+#include <stddef.h>
+
+#include "astarte_allocator.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates a block of memory
+ *
+ * @param[in] subsystem The subsystem requesting the memory.
+ * @param[in] size The size of the block.
+ * @return The allocated block, NULL on failure.
+ */
+void *astarte_alloc_malloc(astarte_alloc_subsystem_t subsystem, size_t size);
+
+/**
+ * @brief Allocates a zero initialized array
+ *
+ * @param[in] subsystem The subsystem requesting the memory.
+ * @param[in] count The number of elements.
+ * @param[in] size The size of each element.
+ * @return The allocated array, NULL on failure or if its size overflows.
+ */
+void *astarte_alloc_calloc(astarte_alloc_subsystem_t subsystem, size_t count, size_t size);
+
+/**
+ * @brief Duplicates a string
+ *
+ * @param[in] subsystem The subsystem requesting the memory.
+ * @param[in] str The string to duplicate.
+ * @return The duplicated string, NULL on failure.
+ */
+char *astarte_alloc_strdup(astarte_alloc_subsystem_t subsystem, const char *str);
+
+/**
+ * @brief Releases a block allocated by one of the functions of this module
+ *
+ * @param[in] ptr The block to release, can be NULL.
+ */
+void astarte_alloc_free(void *ptr);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_ALLOC_H_ */
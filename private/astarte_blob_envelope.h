@@ -0,0 +1,52 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_blob_envelope.h
+ * @brief BSON document of a binaryblob datastream, built in place around the blob.
+ *
+ * @details The document is the one produced by the BSON serializer for a binaryblob datastream:
+ * the blob as the "v" binary element, optionally followed by the "t" datetime element. The header
+ * is written in the ASTARTE_BLOB_HEADROOM bytes preceding the blob and the trailer right after
+ * the blob, in the ASTARTE_BLOB_TAILROOM bytes reserved for it.
+ */
+
+#ifndef _ASTARTE_BLOB_ENVELOPE_H_
+#define _ASTARTE_BLOB_ENVELOPE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte_blob.h"
+
+/**
+ * @brief Largest blob fitting a BSON document published over MQTT.
+ */
+#define ASTARTE_BLOB_ENVELOPE_MAX_BLOB_SIZE                                                        \
+    ((size_t) INT32_MAX - ASTARTE_BLOB_HEADROOM - ASTARTE_BLOB_TAILROOM)
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Writes the header and the trailer of the document around a blob
+ *
+ * @param[inout] buffer The buffer, holding the blob at offset ASTARTE_BLOB_HEADROOM.
+ * @param[in] blob_size The size of the blob, at most ASTARTE_BLOB_ENVELOPE_MAX_BLOB_SIZE.
+ * @param[in] has_timestamp true to append the timestamp.
+ * @param[in] ts_epoch_millis The timestamp, in milliseconds since the epoch.
+ * @return The size of the document, starting at the beginning of the buffer.
+ */
+size_t astarte_blob_envelope_wrap(
+    uint8_t *buffer, size_t blob_size, bool has_timestamp, uint64_t ts_epoch_millis);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_BLOB_ENVELOPE_H_ */
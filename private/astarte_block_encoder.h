@@ -0,0 +1,129 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_block_encoder.h
+ * @brief Encoder of the sample blocks described in astarte_block.h.
+ *
+ * @details The encoder writes into a caller provided buffer. A sample that does not fit the buffer
+ * leaves the block untouched, so that the caller can publish it and add the sample to a new one.
+ */
+
+#ifndef _ASTARTE_BLOCK_ENCODER_H_
+#define _ASTARTE_BLOCK_ENCODER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_block.h"
+
+/** @brief Size of the block header. */
+#define ASTARTE_BLOCK_HEADER_SIZE 12
+
+/** @brief Smallest buffer able to hold any single sample. */
+#define ASTARTE_BLOCK_MIN_SIZE (ASTARTE_BLOCK_HEADER_SIZE + 10)
+
+/**
+ * @brief Block encoder, the fields are private.
+ */
+typedef struct
+{
+    uint8_t *buffer;
+    size_t capacity;
+    astarte_block_type_t type;
+    size_t bit_pos;
+    uint16_t count;
+    int64_t first_ts;
+    int64_t prev_ts;
+    int64_t prev_delta;
+    uint64_t prev_value;
+    uint8_t prev_leading;
+    uint8_t prev_trailing;
+    bool has_window;
+} astarte_block_encoder_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes an encoder with an empty block
+ *
+ * @param[out] encoder The encoder to initialize.
+ * @param[in] type Type of the samples.
+ * @param[in] buffer Where the block is encoded, at least #ASTARTE_BLOCK_MIN_SIZE bytes.
+ * @param[in] capacity Size of the buffer.
+ */
+void astarte_block_encoder_init(astarte_block_encoder_t *encoder, astarte_block_type_t type,
+    uint8_t *buffer, size_t capacity);
+
+/**
+ * @brief Discards the samples of the block
+ *
+ * @param[inout] encoder The encoder.
+ */
+void astarte_block_encoder_reset(astarte_block_encoder_t *encoder);
+
+/**
+ * @brief Adds a double sample to the block
+ *
+ * @param[inout] encoder The encoder.
+ * @param[in] ts_ms Timestamp of the sample.
+ * @param[in] value The sample.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_SIZE if the sample does not fit the block,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_block_encoder_add_double(
+    astarte_block_encoder_t *encoder, int64_t ts_ms, double value);
+
+/**
+ * @brief Adds a long integer sample to the block
+ *
+ * @param[inout] encoder The encoder.
+ * @param[in] ts_ms Timestamp of the sample.
+ * @param[in] value The sample.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_SIZE if the sample does not fit the block,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_block_encoder_add_longinteger(
+    astarte_block_encoder_t *encoder, int64_t ts_ms, int64_t value);
+
+/**
+ * @brief Returns the number of samples in the block
+ *
+ * @param[in] encoder The encoder.
+ * @return The number of samples.
+ */
+uint16_t astarte_block_encoder_count(const astarte_block_encoder_t *encoder);
+
+/**
+ * @brief Returns the timestamp of the first sample of the block
+ *
+ * @param[in] encoder The encoder.
+ * @return The timestamp, meaningless for an empty block.
+ */
+int64_t astarte_block_encoder_first_timestamp(const astarte_block_encoder_t *encoder);
+
+/**
+ * @brief Completes the header of the block
+ *
+ * @details More samples can be added afterwards, the block must be finished again.
+ *
+ * @param[inout] encoder The encoder.
+ * @param[out] length Length of the encoded block.
+ * @return The encoded block, inside the buffer of the encoder.
+ */
+const uint8_t *astarte_block_encoder_finish(astarte_block_encoder_t *encoder, size_t *length);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_BLOCK_ENCODER_H_ */
@@ -0,0 +1,145 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_burst_buffer.h
+ * @brief Datastream messages held back to be published together in a burst.
+ *
+ * @details A burst is due when the held messages reach the size threshold or the oldest one reaches
+ * the age threshold. The size of a message is its topic plus its payload, what goes on the wire.
+ *
+ * The buffer is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_BURST_BUFFER_H_
+#define _ASTARTE_BURST_BUFFER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Held message, strings and payload are stored in the same allocation.
+ */
+typedef struct astarte_burst_msg
+{
+    struct astarte_burst_msg *next;
+    char *interface_name;
+    char *topic;
+    void *data;
+    int length;
+    int qos;
+} astarte_burst_msg_t;
+
+/**
+ * @brief Burst buffer, the fields are private.
+ */
+typedef struct
+{
+    astarte_burst_msg_t *head;
+    astarte_burst_msg_t *tail;
+    size_t count;
+    size_t bytes;
+    int64_t oldest_us;
+    size_t max_bytes;
+    int64_t max_age_us;
+} astarte_burst_buffer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes an empty buffer
+ *
+ * @param[out] buffer The buffer to initialize.
+ * @param[in] max_bytes Held bytes making a burst due.
+ * @param[in] max_age_us Age of the oldest message making a burst due.
+ */
+void astarte_burst_buffer_init(
+    astarte_burst_buffer_t *buffer, size_t max_bytes, int64_t max_age_us);
+
+/**
+ * @brief Frees all the held messages
+ *
+ * @param[inout] buffer The buffer.
+ */
+void astarte_burst_buffer_destroy(astarte_burst_buffer_t *buffer);
+
+/**
+ * @brief Holds a message at the end of the buffer
+ *
+ * @param[inout] buffer The buffer.
+ * @param[in] interface_name The interface of the message, copied.
+ * @param[in] topic The topic of the message, copied.
+ * @param[in] data The payload, copied.
+ * @param[in] length The payload length.
+ * @param[in] qos The QoS of the message.
+ * @param[in] now_us The current time in microseconds.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the message could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_burst_buffer_push(astarte_burst_buffer_t *buffer, const char *interface_name,
+    const char *topic, const void *data, int length, int qos, int64_t now_us);
+
+/**
+ * @brief Checks if the held messages should be published
+ *
+ * @param[in] buffer The buffer.
+ * @param[in] now_us The current time in microseconds.
+ * @return true if a threshold has been reached, false if the buffer is empty or can wait.
+ */
+bool astarte_burst_buffer_due(const astarte_burst_buffer_t *buffer, int64_t now_us);
+
+/**
+ * @brief Returns how long the held messages can still wait
+ *
+ * @param[in] buffer The buffer.
+ * @param[in] now_us The current time in microseconds.
+ * @return The wait in microseconds, 0 if a burst is due, -1 if the buffer is empty.
+ */
+int64_t astarte_burst_buffer_wait_us(const astarte_burst_buffer_t *buffer, int64_t now_us);
+
+/**
+ * @brief Detaches all the held messages, emptying the buffer
+ *
+ * @param[inout] buffer The buffer.
+ * @return The oldest message, linked to the younger ones through next, NULL if the buffer is empty.
+ * Each message must be freed with astarte_burst_buffer_msg_free().
+ */
+astarte_burst_msg_t *astarte_burst_buffer_take_all(astarte_burst_buffer_t *buffer);
+
+/**
+ * @brief Returns the number of held messages
+ *
+ * @param[in] buffer The buffer.
+ * @return The number of held messages.
+ */
+size_t astarte_burst_buffer_count(const astarte_burst_buffer_t *buffer);
+
+/**
+ * @brief Returns the size of the held messages
+ *
+ * @param[in] buffer The buffer.
+ * @return The sum of the topic and payload lengths of the held messages.
+ */
+size_t astarte_burst_buffer_bytes(const astarte_burst_buffer_t *buffer);
+
+/**
+ * @brief Frees a message detached from a buffer
+ *
+ * @param[in] msg The message.
+ */
+void astarte_burst_buffer_msg_free(astarte_burst_msg_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_BURST_BUFFER_H_ */
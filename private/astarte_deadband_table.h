@@ -0,0 +1,156 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_deadband_table.h
+ * @brief Table of the dead-band filters applied to the published endpoints.
+ *
+ * @details Each filter keeps the last value sent on its endpoint and tells if a new value moved
+ * enough to be published. The table is allocated once with a fixed capacity and looked up with a
+ * hash of the endpoint before comparing its name.
+ *
+ * The table is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_DEADBAND_TABLE_H_
+#define _ASTARTE_DEADBAND_TABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_deadband.h"
+
+/**
+ * @brief Filter of an endpoint, the fields are private.
+ */
+typedef struct
+{
+    uint32_t hash;
+    char *interface_name;
+    char *path;
+    double absolute;
+    double relative;
+    int64_t heartbeat_us;
+    double last_value;
+    int64_t last_integer;
+    int64_t last_sent_us;
+    bool has_value;
+} astarte_deadband_filter_t;
+
+/**
+ * @brief Table of filters, the fields are private.
+ */
+typedef struct
+{
+    astarte_deadband_filter_t *filters;
+    size_t count;
+    size_t capacity;
+} astarte_deadband_table_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty table
+ *
+ * @param[out] table The table to initialize.
+ * @param[in] capacity Maximum number of filters.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the table could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_deadband_table_init(astarte_deadband_table_t *table, size_t capacity);
+
+/**
+ * @brief Releases a table together with all its filters
+ *
+ * @param[inout] table The table to destroy.
+ */
+void astarte_deadband_table_destroy(astarte_deadband_table_t *table);
+
+/**
+ * @brief Adds, updates or removes the filter of an endpoint
+ *
+ * @details Updating a filter keeps its last sent value.
+ *
+ * @param[inout] table The table.
+ * @param[in] interface_name The interface of the endpoint.
+ * @param[in] path The path of the endpoint.
+ * @param[in] config The filter configuration, NULL to remove the filter.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR if the table is full,
+ * - ASTARTE_ERR_NOT_FOUND if the filter to remove does not exist,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the endpoint name could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_deadband_table_set(astarte_deadband_table_t *table,
+    const char *interface_name, const char *path, const astarte_deadband_config_t *config);
+
+/**
+ * @brief Finds the filter of an endpoint
+ *
+ * @param[inout] table The table.
+ * @param[in] interface_name The interface of the endpoint.
+ * @param[in] path The path of the endpoint.
+ * @return The filter, NULL if the endpoint is not filtered.
+ */
+astarte_deadband_filter_t *astarte_deadband_table_find(
+    astarte_deadband_table_t *table, const char *interface_name, const char *path);
+
+/**
+ * @brief Checks if a value has to be published
+ *
+ * @param[in] filter The filter of the endpoint.
+ * @param[in] value The new value.
+ * @param[in] now_us The current time in microseconds.
+ * @return true if the value is outside the dead-band or the heartbeat expired, false if the value
+ * can be suppressed.
+ */
+bool astarte_deadband_filter_passes(
+    const astarte_deadband_filter_t *filter, double value, int64_t now_us);
+
+/**
+ * @brief Checks if an integer value has to be published
+ *
+ * @details Integers are compared exactly, also beyond the 53 bits a double can hold.
+ *
+ * @param[in] filter The filter of the endpoint.
+ * @param[in] value The new value.
+ * @param[in] now_us The current time in microseconds.
+ * @return true if the value is outside the dead-band or the heartbeat expired, false if the value
+ * can be suppressed.
+ */
+bool astarte_deadband_filter_passes_integer(
+    const astarte_deadband_filter_t *filter, int64_t value, int64_t now_us);
+
+/**
+ * @brief Records a value as sent
+ *
+ * @param[inout] filter The filter of the endpoint.
+ * @param[in] value The value sent.
+ * @param[in] now_us The current time in microseconds.
+ */
+void astarte_deadband_filter_commit(
+    astarte_deadband_filter_t *filter, double value, int64_t now_us);
+
+/**
+ * @brief Records an integer value as sent
+ *
+ * @param[inout] filter The filter of the endpoint.
+ * @param[in] value The value sent.
+ * @param[in] now_us The current time in microseconds.
+ */
+void astarte_deadband_filter_commit_integer(
+    astarte_deadband_filter_t *filter, int64_t value, int64_t now_us);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_DEADBAND_TABLE_H_ */
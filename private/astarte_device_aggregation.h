@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_aggregation.h
+ * @brief Aggregators of a device, publishing a summary of the samples of each window.
+ */
+
+#ifndef _ASTARTE_DEVICE_AGGREGATION_H_
+#define _ASTARTE_DEVICE_AGGREGATION_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the empty list of aggregators of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_aggregation_destroy().
+ */
+astarte_err_t astarte_device_aggregation_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the window timers, so that they do not notify the device task anymore.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_aggregation_stop(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the aggregators of a device, the samples of their open windows are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_aggregation_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Publishes the summaries of the closed windows, from the device task.
+ *
+ * @param[in] device Device owning the aggregators.
+ */
+void astarte_device_aggregation_publish(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_AGGREGATION_H_ */
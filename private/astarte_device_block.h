@@ -0,0 +1,45 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_block.h
+ * @brief Block streams of a device, packing samples into binary blobs.
+ */
+
+#ifndef _ASTARTE_DEVICE_BLOCK_H_
+#define _ASTARTE_DEVICE_BLOCK_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the empty list of block streams of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_block_destroy().
+ */
+astarte_err_t astarte_device_block_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the block streams of a device, the samples of their open blocks are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_block_destroy(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_BLOCK_H_ */
@@ -0,0 +1,76 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_burst.h
+ * @brief Burst mode of a device, holding datastreams back to publish them in a single wakeup.
+ */
+
+#ifndef _ASTARTE_DEVICE_BURST_H_
+#define _ASTARTE_DEVICE_BURST_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the burst buffer of a device, with its timer and power lock.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_burst_destroy().
+ */
+astarte_err_t astarte_device_burst_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the burst timer, so that it does not notify the device task anymore.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_burst_stop(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the burst buffer of a device, the held messages are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_burst_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief First publish stage, holding datastreams back until the burst is due.
+ *
+ * @details Properties and alarms are published right away, and wake up the device task to flush
+ * the held datastreams after them.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] interface_name Interface of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return ASTARTE_OK if the message was held or sent, an error otherwise.
+ */
+astarte_err_t astarte_device_burst_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Publishes all the held messages, keeping their order.
+ *
+ * @param[in] device Device owning the burst buffer.
+ */
+void astarte_device_burst_flush(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_BURST_H_ */
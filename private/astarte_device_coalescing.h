@@ -0,0 +1,75 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_coalescing.h
+ * @brief Property values held back while the outbox is congested, only the latest one per path.
+ */
+
+#ifndef _ASTARTE_DEVICE_COALESCING_H_
+#define _ASTARTE_DEVICE_COALESCING_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the pending properties of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_coalescing_destroy().
+ */
+astarte_err_t astarte_device_coalescing_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the pending properties of a device, they are not published.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_coalescing_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Publish stage for properties, holding back the value while the outbox is congested.
+ *
+ * @details A pending value of the same path is replaced, so that only the latest one is sent.
+ *
+ * @param[in] device Device publishing the property.
+ * @param[in] interface_name Interface of the property.
+ * @param[in] topic Full MQTT topic of the property.
+ * @param[in] data Payload of the property.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the property.
+ * @return ASTARTE_OK if the property was sent or is pending, an error otherwise.
+ */
+astarte_err_t astarte_device_coalescing_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Wakes up the device task to flush the pending properties, if there are any.
+ *
+ * @param[in] device Device owning the pending properties.
+ */
+void astarte_device_coalescing_schedule_flush(astarte_device_handle_t device);
+
+/**
+ * @brief Publishes the pending properties while the outbox is not congested, from the device task.
+ *
+ * @param[in] device Device owning the pending properties.
+ */
+void astarte_device_coalescing_flush(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_COALESCING_H_ */
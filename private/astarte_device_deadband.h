@@ -0,0 +1,122 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_deadband.h
+ * @brief Dead-band filters of a device, applied to the streamed numeric values.
+ *
+ * @details The stream functions filter a value with DEADBAND_FILTER() before serializing it, and
+ * commit it as the new reference with DEADBAND_COMMIT() once published. The macros expand to
+ * nothing when the filters are disabled.
+ */
+
+#ifndef _ASTARTE_DEVICE_DEADBAND_H_
+#define _ASTARTE_DEVICE_DEADBAND_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+#define DEADBAND_FILTER(device, interface_name, path, value)                                       \
+    if (astarte_device_deadband_suppresses(device, interface_name, path, value)) {                 \
+        return ASTARTE_OK;                                                                         \
+    }
+#define DEADBAND_COMMIT(device, interface_name, path, value, exit_code)                            \
+    if ((exit_code) == ASTARTE_OK) {                                                               \
+        astarte_device_deadband_commit(device, interface_name, path, value);                       \
+    }
+// Integers are filtered as int64_t, a double does not hold all of them
+#define DEADBAND_FILTER_INTEGER(device, interface_name, path, value)                               \
+    if (astarte_device_deadband_suppresses_integer(                                                \
+            device, interface_name, path, (int64_t) (value))) {                                    \
+        return ASTARTE_OK;                                                                         \
+    }
+#define DEADBAND_COMMIT_INTEGER(device, interface_name, path, value, exit_code)                    \
+    if ((exit_code) == ASTARTE_OK) {                                                               \
+        astarte_device_deadband_commit_integer(                                                    \
+            device, interface_name, path, (int64_t) (value));                                      \
+    }
+#else
+#define DEADBAND_FILTER(device, interface_name, path, value)
+#define DEADBAND_COMMIT(device, interface_name, path, value, exit_code)
+#define DEADBAND_FILTER_INTEGER(device, interface_name, path, value)
+#define DEADBAND_COMMIT_INTEGER(device, interface_name, path, value, exit_code)
+#endif
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates the dead-band filters of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_deadband_destroy().
+ */
+astarte_err_t astarte_device_deadband_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the dead-band filters of a device.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_deadband_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Tells if a value is within the dead-band of its endpoint, use DEADBAND_FILTER().
+ *
+ * @param[in] device Device publishing the value.
+ * @param[in] interface_name Interface of the endpoint.
+ * @param[in] path Path of the endpoint.
+ * @param[in] value Value to publish.
+ * @return true if the value must not be published, false otherwise.
+ */
+bool astarte_device_deadband_suppresses(
+    astarte_device_handle_t device, const char *interface_name, const char *path, double value);
+
+/**
+ * @brief Makes a published value the reference of its endpoint, use DEADBAND_COMMIT().
+ *
+ * @param[in] device Device that published the value.
+ * @param[in] interface_name Interface of the endpoint.
+ * @param[in] path Path of the endpoint.
+ * @param[in] value Published value.
+ */
+void astarte_device_deadband_commit(
+    astarte_device_handle_t device, const char *interface_name, const char *path, double value);
+
+/**
+ * @brief Integer variant of astarte_device_deadband_suppresses(), use DEADBAND_FILTER_INTEGER().
+ *
+ * @param[in] device Device publishing the value.
+ * @param[in] interface_name Interface of the endpoint.
+ * @param[in] path Path of the endpoint.
+ * @param[in] value Value to publish.
+ * @return true if the value must not be published, false otherwise.
+ */
+bool astarte_device_deadband_suppresses_integer(
+    astarte_device_handle_t device, const char *interface_name, const char *path, int64_t value);
+
+/**
+ * @brief Integer variant of astarte_device_deadband_commit(), use DEADBAND_COMMIT_INTEGER().
+ *
+ * @param[in] device Device that published the value.
+ * @param[in] interface_name Interface of the endpoint.
+ * @param[in] path Path of the endpoint.
+ * @param[in] value Published value.
+ */
+void astarte_device_deadband_commit_integer(
+    astarte_device_handle_t device, const char *interface_name, const char *path, int64_t value);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_DEADBAND_H_ */
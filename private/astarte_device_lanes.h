@@ -0,0 +1,83 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_lanes.h
+ * @brief Priority lanes of a device, drained into the MQTT client by the publish task.
+ */
+
+#ifndef _ASTARTE_DEVICE_LANES_H_
+#define _ASTARTE_DEVICE_LANES_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates the lanes of a device and starts its publish task.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_lanes_destroy().
+ */
+astarte_err_t astarte_device_lanes_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the publish task of a device, waiting for it, and frees the queued messages.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_lanes_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Starts draining the lanes, once the MQTT session of the device is set up.
+ *
+ * @param[in] device Device that got connected.
+ */
+void astarte_device_lanes_open(astarte_device_handle_t device);
+
+/**
+ * @brief Stops draining the lanes, the queued messages are kept until the device reconnects.
+ *
+ * @param[in] device Device that got disconnected.
+ */
+void astarte_device_lanes_close(astarte_device_handle_t device);
+
+/**
+ * @brief Selects the lane of the messages of an interface, from its priority.
+ *
+ * @param[in] device Device publishing the messages.
+ * @param[in] interface_name Interface of the messages.
+ * @return The lane of the interface, the bulk lane when the interface is unknown.
+ */
+astarte_publish_lane_t astarte_device_lanes_select(
+    astarte_device_handle_t device, const char *interface_name);
+
+/**
+ * @brief Copies a message into a lane and wakes up the publish task.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] lane Lane of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return ASTARTE_OK if the message was queued, ASTARTE_ERR_PUBLISH_QUEUE_FULL if the lane is full.
+ */
+astarte_err_t astarte_device_lanes_enqueue(astarte_device_handle_t device,
+    astarte_publish_lane_t lane, const char *topic, const void *data, int length, int qos);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_LANES_H_ */
@@ -0,0 +1,77 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_outbox.h
+ * @brief Outbox governor of a device, holding back datastreams while the MQTT outbox is congested.
+ */
+
+#ifndef _ASTARTE_DEVICE_OUTBOX_H_
+#define _ASTARTE_DEVICE_OUTBOX_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the outbox governor of a device, rejecting messages by default.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_outbox_destroy().
+ */
+astarte_err_t astarte_device_outbox_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the outbox governor of a device, the deferred messages are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_outbox_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Applies the outbox policy of a message before it is published.
+ *
+ * @details While the outbox is congested, datastreams are rejected, deferred or downgraded to
+ * QoS 0, depending on the policy of their interface. Properties and QoS 0 messages are admitted.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] interface_name Interface of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in,out] qos QoS of the message, lowered to 0 when downgraded.
+ * @param[out] res Result of the publish when the message is not admitted.
+ * @return true if the message is to be published now, false if it was deferred or rejected.
+ */
+bool astarte_device_outbox_admit(astarte_device_handle_t device, const char *interface_name,
+    const char *topic, const void *data, int length, int *qos, astarte_err_t *res);
+
+/**
+ * @brief Wakes up the device task when a message left the outbox and the governor is waiting.
+ *
+ * @param[in] device Device whose MQTT client released a message.
+ */
+void astarte_device_outbox_on_drained(astarte_device_handle_t device);
+
+/**
+ * @brief Reports the outbox crossings and releases the deferred messages, from the device task.
+ *
+ * @param[in] device Device owning the outbox governor.
+ */
+void astarte_device_outbox_regulate(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_OUTBOX_H_ */
@@ -0,0 +1,335 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_private.h
+ * @brief Device state and publish pipeline shared by the device features.
+ *
+ * @details The core of the device, in astarte_device.c, owns the connection and the publish
+ * pipeline. Each optional feature keeps its glue in its own astarte_device_<feature>.c and hooks
+ * into the pipeline through the functions declared by its astarte_device_<feature>.h header.
+ */
+
+#ifndef _ASTARTE_DEVICE_PRIVATE_H_
+#define _ASTARTE_DEVICE_PRIVATE_H_
+
+#include "astarte.h"
+#include "astarte_device.h"
+#include "astarte_linked_list.h"
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+#include "astarte_publish_queue.h"
+#endif
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+#include "astarte_rate_limiter.h"
+#endif
+#ifdef CONFIG_ASTARTE_DEADBAND
+#include "astarte_deadband_table.h"
+#endif
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+#include "astarte_property_coalescer.h"
+#endif
+#if defined(CONFIG_ASTARTE_BURST_FLUSH) || defined(CONFIG_ASTARTE_OUTBOX_GOVERNOR)
+#include "astarte_burst_buffer.h"
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+#include "astarte_inflight_table.h"
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+#include "astarte_outbox_governor.h"
+#endif
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+#include "astarte_topic_alias_table.h"
+#endif
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include "astarte_scratch.h"
+#endif
+#include "astarte_bson_serializer.h"
+
+#if defined(CONFIG_ASTARTE_BURST_FLUSH) && defined(CONFIG_PM_ENABLE)
+#include <esp_pm.h>
+#endif
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+#include <freertos/queue.h>
+#endif
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Notifications of the device task, and of the publish task for the first two
+#define NOTIFY_TERMINATE (1U << 0U)
+#define NOTIFY_REINIT (1U << 1U)
+#define NOTIFY_PUBLISH (1U << 2U)
+#define NOTIFY_RATE_LIMIT (1U << 3U)
+#define NOTIFY_AGGREGATE (1U << 4U)
+#define NOTIFY_PROPERTIES (1U << 5U)
+#define NOTIFY_SHADOW (1U << 6U)
+#define NOTIFY_BURST (1U << 7U)
+#define NOTIFY_SAMPLES (1U << 8U)
+#define NOTIFY_PUBLISHED (1U << 9U)
+#define NOTIFY_OUTBOX (1U << 10U)
+#define NOTIFY_MQTT3_FALLBACK (1U << 11U)
+
+// Wait before retrying a failed reinitialization of the MQTT client
+#define REINIT_RETRY_INTERVAL_MS (30 * 1000)
+
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+#define STATS_TIMESTAMP() esp_timer_get_time()
+#define STATS_COUNT(device, counter) astarte_device_stats_count(device, &(device)->stats.counter)
+#define STATS_RECORD(device, histogram, start_us)                                                  \
+    astarte_device_stats_record(device, &(device)->stats.histogram, start_us)
+#else
+#define STATS_TIMESTAMP() 0
+#define STATS_COUNT(device, counter)
+#define STATS_RECORD(device, histogram, start_us) ((void) (start_us))
+#endif
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#define PUBLISH_SCRATCH_BEGIN(device)                                                              \
+    astarte_scratch_mark_t scratch_mark = astarte_device_publish_scratch_begin(device)
+#define PUBLISH_SCRATCH_END(device) astarte_device_publish_scratch_end(device, scratch_mark)
+#else
+#define PUBLISH_SCRATCH_BEGIN(device)
+#define PUBLISH_SCRATCH_END(device)
+#endif
+
+struct astarte_device
+{
+    char *encoded_hwid;
+    char *credentials_secret;
+    const char *device_topic;
+    size_t device_topic_len;
+    astarte_credentials_parsed_t *credentials;
+    bool connected;
+    astarte_device_data_event_callback_t data_event_callback;
+    astarte_device_unset_event_callback_t unset_event_callback;
+    astarte_device_connection_event_callback_t connection_event_callback;
+    astarte_device_disconnection_event_callback_t disconnection_event_callback;
+    void *callbacks_user_data;
+    astarte_transport_t transport;
+    void *transport_client;
+    TaskHandle_t reinit_task_handle;
+    SemaphoreHandle_t reinit_task_exited;
+    SemaphoreHandle_t reinit_mutex;
+    astarte_linked_list_handle_t introspection;
+    char *realm;
+    astarte_credentials_context_t *credentials_context;
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    astarte_device_stats_t stats;
+    SemaphoreHandle_t stats_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_t publish_scratch;
+    astarte_scratch_t receive_scratch;
+    SemaphoreHandle_t publish_scratch_mutex;
+    TaskHandle_t publish_scratch_holder;
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    astarte_publish_queue_t publish_queue;
+    SemaphoreHandle_t publish_queue_mutex;
+    TaskHandle_t publish_task_handle;
+    SemaphoreHandle_t publish_task_exited;
+    bool publish_lanes_open;
+#endif
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    SemaphoreHandle_t rate_limit_mutex;
+    astarte_rate_limiter_t device_limiter;
+    astarte_linked_list_handle_t interface_limiters;
+    astarte_rate_limit_backlog_t rate_limit_backlog;
+    esp_timer_handle_t rate_limit_timer;
+    bool rate_limit_timer_armed;
+#endif
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    astarte_linked_list_handle_t aggregators;
+    SemaphoreHandle_t aggregators_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_DEADBAND
+    astarte_deadband_table_t deadband_table;
+    SemaphoreHandle_t deadband_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    astarte_property_coalescer_t pending_properties;
+    SemaphoreHandle_t pending_properties_mutex;
+    bool properties_pending;
+#endif
+#ifdef CONFIG_ASTARTE_SHADOW
+    astarte_linked_list_handle_t shadows;
+    SemaphoreHandle_t shadows_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    astarte_linked_list_handle_t block_streams;
+    SemaphoreHandle_t block_streams_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    astarte_burst_buffer_t burst_buffer;
+    astarte_burst_stats_t burst_stats;
+    SemaphoreHandle_t burst_mutex;
+    SemaphoreHandle_t burst_flush_mutex;
+    esp_timer_handle_t burst_timer;
+    bool burst_timer_armed;
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_handle_t burst_pm_lock;
+#endif
+#endif
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    astarte_linked_list_handle_t sample_rings;
+    SemaphoreHandle_t sample_rings_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_publish_event_callback_t publish_event_callback;
+    astarte_inflight_table_t inflight;
+    SemaphoreHandle_t inflight_mutex;
+    SemaphoreHandle_t inflight_released;
+    QueueHandle_t publish_acks;
+    uint32_t mqtt_generation;
+    astarte_publish_window_config_t device_window;
+    astarte_linked_list_handle_t interface_windows;
+    bool reporting_publish;
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    astarte_device_outbox_event_callback_t outbox_event_callback;
+    astarte_outbox_governor_t outbox_governor;
+    astarte_outbox_stats_t outbox_stats;
+    // The burst buffer is a plain FIFO of copied messages, here the deferred datastreams
+    astarte_burst_buffer_t outbox_deferred;
+    astarte_outbox_policy_t device_outbox_policy;
+    astarte_linked_list_handle_t interface_outbox_policies;
+    bool outbox_congestion_reported;
+    SemaphoreHandle_t outbox_mutex;
+#endif
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+    astarte_topic_alias_table_t topic_aliases;
+    SemaphoreHandle_t topic_aliases_mutex;
+    bool mqtt5_refused;
+#endif
+};
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Connects a device to Astarte, registering it and fetching its credentials when needed.
+ *
+ * @param[in] device Device to connect, its previous transport client is destroyed.
+ * @param[in] encoded_hwid Encoded hardware ID of the device.
+ * @param[in] realm Realm of the device.
+ * @return ASTARTE_OK on success, an error otherwise.
+ */
+astarte_err_t astarte_device_init_connection(
+    astarte_device_handle_t device, const char *encoded_hwid, const char *realm);
+
+/**
+ * @brief Routes a message, with its topic already encoded, through the optional publish stages.
+ *
+ * @details This is the entry point of the pipeline for messages that skipped the burst buffer.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] interface_name Interface of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return ASTARTE_OK if the message was sent or queued, an error otherwise.
+ */
+astarte_err_t astarte_device_route_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Sends a message past the coalescing and rate limiting stages of the pipeline.
+ *
+ * @details The message is still subject to the outbox governor and to the publish lanes.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] interface_name Interface of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return ASTARTE_OK if the message was sent or queued, an error otherwise.
+ */
+astarte_err_t astarte_device_send_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Hands a message to the transport client, the last stage of the pipeline.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @param[in] lock_timeout Time to wait for a reinitialization in progress.
+ * @return ASTARTE_OK if the transport accepted the message, an error otherwise.
+ */
+astarte_err_t astarte_device_mqtt_publish(astarte_device_handle_t device, const char *topic,
+    const void *data, int length, int qos, TickType_t lock_timeout);
+
+/**
+ * @brief Looks up an interface in the introspection of a device.
+ *
+ * @param[in] device Device to look into.
+ * @param[in] name Name of the interface.
+ * @return The interface, NULL if the device does not have it.
+ */
+astarte_interface_t *astarte_device_get_interface(astarte_device_handle_t device, const char *name);
+
+/**
+ * @brief Converts a time taken from esp_timer_get_time() to milliseconds since the epoch.
+ *
+ * @param[in] monotonic_us Time since boot, in microseconds.
+ * @return The epoch time, ASTARTE_INVALID_TIMESTAMP while the system clock is not set.
+ */
+uint64_t astarte_device_get_epoch_timestamp(int64_t monotonic_us);
+
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+/**
+ * @brief Increments a statistics counter of a device, use STATS_COUNT().
+ *
+ * @param[in] device Device owning the counter.
+ * @param[inout] counter Counter in the statistics of the device.
+ */
+void astarte_device_stats_count(astarte_device_handle_t device, uint32_t *counter);
+
+/**
+ * @brief Records a latency in a statistics histogram of a device, use STATS_RECORD().
+ *
+ * @param[in] device Device owning the histogram.
+ * @param[inout] histogram Histogram in the statistics of the device.
+ * @param[in] start_us Start of the measured operation, from esp_timer_get_time().
+ */
+void astarte_device_stats_record(
+    astarte_device_handle_t device, astarte_latency_histogram_t *histogram, int64_t start_us);
+#endif
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+/**
+ * @brief Opens a scope of the publish scratch arena, use PUBLISH_SCRATCH_BEGIN().
+ *
+ * @param[in] device Device owning the arena.
+ * @return The mark to pass to astarte_device_publish_scratch_end().
+ */
+astarte_scratch_mark_t astarte_device_publish_scratch_begin(astarte_device_handle_t device);
+
+/**
+ * @brief Closes a scope of the publish scratch arena, use PUBLISH_SCRATCH_END().
+ *
+ * @param[in] device Device owning the arena.
+ * @param[in] mark Mark returned by astarte_device_publish_scratch_begin().
+ */
+void astarte_device_publish_scratch_end(
+    astarte_device_handle_t device, astarte_scratch_mark_t mark);
+#endif
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_DEVICE_PRIVATE_H_ */
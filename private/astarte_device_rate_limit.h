@@ -0,0 +1,76 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_rate_limit.h
+ * @brief Per-device and per-interface publish rate limits, with the backlog of deferred messages.
+ */
+
+#ifndef _ASTARTE_DEVICE_RATE_LIMIT_H_
+#define _ASTARTE_DEVICE_RATE_LIMIT_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the rate limits of a device, initially without limits.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_rate_limit_destroy().
+ */
+astarte_err_t astarte_device_rate_limit_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the backlog timer, so that it does not notify the device task anymore.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_rate_limit_stop(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the rate limits of a device and the messages left in the backlog.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_rate_limit_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Publish stage applying the rate limits, the messages within the limits are sent on.
+ *
+ * @details Messages over the limits are dropped, rejected or deferred depending on the policy of
+ * their limiter. Properties are never limited.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] interface_name Interface of the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return ASTARTE_OK if the message was sent, deferred or dropped, an error otherwise.
+ */
+astarte_err_t astarte_device_rate_limit_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Publishes the deferred messages allowed by the limits, from the device task.
+ *
+ * @param[in] device Device owning the backlog.
+ */
+void astarte_device_rate_limit_flush(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_RATE_LIMIT_H_ */
@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_sample_rings.h
+ * @brief Sample rings of a device, filled from interrupts and drained by the device task.
+ */
+
+#ifndef _ASTARTE_DEVICE_SAMPLE_RINGS_H_
+#define _ASTARTE_DEVICE_SAMPLE_RINGS_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the empty list of sample rings of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_sample_rings_destroy().
+ */
+astarte_err_t astarte_device_sample_rings_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the drain timers, so that they do not notify the device task anymore.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_sample_rings_stop(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the sample rings of a device, the samples not drained yet are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_sample_rings_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Publishes the samples queued in the rings, from the device task.
+ *
+ * @param[in] device Device owning the sample rings.
+ */
+void astarte_device_sample_rings_drain(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_SAMPLE_RINGS_H_ */
@@ -0,0 +1,59 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_shadow.h
+ * @brief Shadows of a device, committed periodically by the device task.
+ */
+
+#ifndef _ASTARTE_DEVICE_SHADOW_H_
+#define _ASTARTE_DEVICE_SHADOW_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_SHADOW
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the empty list of shadows of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_shadow_destroy().
+ */
+astarte_err_t astarte_device_shadow_init(astarte_device_handle_t device);
+
+/**
+ * @brief Stops the commit timers, so that they do not notify the device task anymore.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_shadow_stop(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the shadows of a device, the changes not committed yet are lost.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_shadow_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Commits the shadows whose period has elapsed, from the device task.
+ *
+ * @param[in] device Device owning the shadows.
+ */
+void astarte_device_shadow_commit_due(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_SHADOW_H_ */
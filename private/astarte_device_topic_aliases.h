@@ -0,0 +1,83 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_topic_aliases.h
+ * @brief MQTT 5 topic aliases of a device, with the fall back to MQTT 3.1.1.
+ */
+
+#ifndef _ASTARTE_DEVICE_TOPIC_ALIASES_H_
+#define _ASTARTE_DEVICE_TOPIC_ALIASES_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the topic alias table of a device.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_topic_aliases_destroy().
+ */
+astarte_err_t astarte_device_topic_aliases_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the topic alias table of a device.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_topic_aliases_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Publishes a message on the MQTT client, with the alias of its topic when it has one.
+ *
+ * @details Must be called with the device locked. Only QoS 0 messages use aliases.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] client MQTT client of the device.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] data Payload of the message.
+ * @param[in] length Length of the payload.
+ * @param[in] qos QoS of the message.
+ * @return The message id from the MQTT client, negative on failure.
+ */
+int astarte_device_topic_aliases_publish(astarte_device_handle_t device, void *client,
+    const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Forgets the aliases known to the broker, once a new connection is set up.
+ *
+ * @param[in] device Device that got connected.
+ */
+void astarte_device_topic_aliases_reset(astarte_device_handle_t device);
+
+/**
+ * @brief Schedules the fall back to MQTT 3.1.1 when the broker refused MQTT 5.
+ *
+ * @param[in] device Device whose connection was refused.
+ * @param[in] return_code CONNACK code of the refusal.
+ */
+void astarte_device_topic_aliases_on_refused(astarte_device_handle_t device, int return_code);
+
+/**
+ * @brief Replaces the MQTT client of a device with an MQTT 3.1.1 one, from the device task.
+ *
+ * @param[in] device Device whose connection was refused.
+ */
+void astarte_device_topic_aliases_fall_back(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_TOPIC_ALIASES_H_ */
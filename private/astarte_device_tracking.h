@@ -0,0 +1,109 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_device_tracking.h
+ * @brief Tracking of the published messages until their acknowledgment, with in-flight windows.
+ */
+
+#ifndef _ASTARTE_DEVICE_TRACKING_H_
+#define _ASTARTE_DEVICE_TRACKING_H_
+
+#include "astarte_device_private.h"
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Sets up the in-flight table of a device, without windows.
+ *
+ * @param[in] device Device being initialized.
+ * @return ASTARTE_OK on success, an error otherwise. A partial initialization is released by
+ * astarte_device_tracking_destroy().
+ */
+astarte_err_t astarte_device_tracking_init(astarte_device_handle_t device);
+
+/**
+ * @brief Frees the in-flight table and the windows of a device, without reporting the messages.
+ *
+ * @param[in] device Device being destroyed.
+ */
+void astarte_device_tracking_destroy(astarte_device_handle_t device);
+
+/**
+ * @brief Tracks a message before it is published, waiting for room in its in-flight windows.
+ *
+ * @details Must be called without holding the device lock. Only QoS 1 and QoS 2 messages of the
+ * interfaces are tracked, the other ones get ASTARTE_PUBLISH_TOKEN_NONE.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] topic Full MQTT topic of the message.
+ * @param[in] qos QoS of the message.
+ * @param[out] token Token of the tracked message.
+ * @return ASTARTE_OK if the message can be published, ASTARTE_ERR_PUBLISH_WINDOW_FULL otherwise.
+ */
+astarte_err_t astarte_device_tracking_prepare(
+    astarte_device_handle_t device, const char *topic, int qos, astarte_publish_token_t *token);
+
+/**
+ * @brief Records the outcome of the publish of a tracked message, with the device locked.
+ *
+ * @param[in] device Device publishing the message.
+ * @param[in] token Token from astarte_device_tracking_prepare().
+ * @param[in] msg_id Message id from the MQTT client, not positive if the publish failed.
+ */
+void astarte_device_tracking_record(
+    astarte_device_handle_t device, astarte_publish_token_t token, int msg_id);
+
+/**
+ * @brief Forgets the token of the last message published by the calling task.
+ *
+ * @details Called when a publish does not reach the tracking, so that
+ * astarte_device_get_last_publish_token() does not return the token of a previous message.
+ */
+void astarte_device_tracking_clear_token(void);
+
+/**
+ * @brief Queues an acknowledgment from the MQTT client, to be matched by the device task.
+ *
+ * @param[in] device Device that published the message.
+ * @param[in] msg_id Message id of the acknowledged message.
+ * @param[in] result Outcome of the publish.
+ */
+void astarte_device_tracking_on_ack(
+    astarte_device_handle_t device, int msg_id, astarte_publish_result_t result);
+
+/**
+ * @brief Reports the messages whose acknowledgment is queued, from the device task.
+ *
+ * @param[in] device Device owning the in-flight table.
+ */
+void astarte_device_tracking_complete(astarte_device_handle_t device);
+
+/**
+ * @brief Reports as lost the messages published by the previous MQTT clients.
+ *
+ * @param[in] device Device owning the in-flight table.
+ */
+void astarte_device_tracking_fail_stale(astarte_device_handle_t device);
+
+/**
+ * @brief Starts a new MQTT session, the messages in flight become stale.
+ *
+ * @param[in] device Device whose MQTT client is being destroyed.
+ */
+void astarte_device_tracking_reset_session(astarte_device_handle_t device);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
+
+#endif /* _ASTARTE_DEVICE_TRACKING_H_ */
@@ -0,0 +1,168 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_inflight_table.h
+ * @brief Messages handed to the MQTT client and waiting for an acknowledgment.
+ *
+ * @details An entry is inserted before the message is published, holding a slot of the windows
+ * while the MQTT client is busy, and gets its MQTT message id once the client accepted it. Message
+ * ids are only unique for an MQTT client, each entry records the generation of the client it has
+ * been handed to.
+ *
+ * The table is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_INFLIGHT_TABLE_H_
+#define _ASTARTE_INFLIGHT_TABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_publish_tracking.h"
+
+/**
+ * @brief Tracked message, interface name and path are stored in the same allocation.
+ */
+typedef struct
+{
+    astarte_publish_token_t token; /**< ASTARTE_PUBLISH_TOKEN_NONE for a free slot. */
+    int msg_id; /**< Negative until the MQTT client accepted the message. */
+    uint32_t generation; /**< Generation of the MQTT client that accepted the message. */
+    bool windowed; /**< Counted by the windows, set for datastreams. */
+    char *interface_name;
+    char *path;
+} astarte_inflight_entry_t;
+
+/**
+ * @brief Table of tracked messages, the fields are private.
+ */
+typedef struct
+{
+    astarte_inflight_entry_t *entries;
+    size_t capacity;
+    size_t count;
+    astarte_publish_token_t last_token;
+} astarte_inflight_table_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty table
+ *
+ * @param[out] table The table to initialize.
+ * @param[in] capacity Maximum number of tracked messages.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the entries could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_inflight_table_init(astarte_inflight_table_t *table, size_t capacity);
+
+/**
+ * @brief Frees the table and all its entries
+ *
+ * @param[inout] table The table.
+ */
+void astarte_inflight_table_destroy(astarte_inflight_table_t *table);
+
+/**
+ * @brief Prepares an entry for a message, before taking the lock of the table
+ *
+ * @param[out] entry The entry to prepare, not windowed.
+ * @param[in] endpoint The interface name followed by the path, as in the MQTT topic.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if the endpoint has no path,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the names could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_inflight_entry_prepare(
+    astarte_inflight_entry_t *entry, const char *endpoint);
+
+/**
+ * @brief Frees the names of an entry prepared or taken from a table
+ *
+ * @param[inout] entry The entry.
+ */
+void astarte_inflight_entry_free(astarte_inflight_entry_t *entry);
+
+/**
+ * @brief Inserts a prepared entry, assigning its token
+ *
+ * @details On success the table owns the names of the entry.
+ *
+ * @param[inout] table The table.
+ * @param[inout] entry The prepared entry, its token is set.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_PUBLISH_WINDOW_FULL if the table is full,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_inflight_table_insert(
+    astarte_inflight_table_t *table, astarte_inflight_entry_t *entry);
+
+/**
+ * @brief Records the MQTT message id of an inserted entry
+ *
+ * @param[inout] table The table.
+ * @param[in] token The token of the entry.
+ * @param[in] msg_id The message id returned by the MQTT client.
+ * @param[in] generation The generation of the MQTT client.
+ */
+void astarte_inflight_table_assign(astarte_inflight_table_t *table, astarte_publish_token_t token,
+    int msg_id, uint32_t generation);
+
+/**
+ * @brief Removes the entry with a token
+ *
+ * @param[inout] table The table.
+ * @param[in] token The token of the entry.
+ * @param[out] entry The removed entry, to be freed with astarte_inflight_entry_free().
+ * @return true if the entry has been found, false otherwise.
+ */
+bool astarte_inflight_table_take(astarte_inflight_table_t *table, astarte_publish_token_t token,
+    astarte_inflight_entry_t *entry);
+
+/**
+ * @brief Removes the entry of an acknowledged message
+ *
+ * @param[inout] table The table.
+ * @param[in] msg_id The message id of the acknowledgment.
+ * @param[in] generation The generation of the MQTT client reporting the acknowledgment.
+ * @param[out] entry The removed entry, to be freed with astarte_inflight_entry_free().
+ * @return true if the entry has been found, false otherwise.
+ */
+bool astarte_inflight_table_take_acked(astarte_inflight_table_t *table, int msg_id,
+    uint32_t generation, astarte_inflight_entry_t *entry);
+
+/**
+ * @brief Removes an entry accepted by an MQTT client of another generation
+ *
+ * @param[inout] table The table.
+ * @param[in] generation The generation of the current MQTT client.
+ * @param[out] entry The removed entry, to be freed with astarte_inflight_entry_free().
+ * @return true if an entry has been found, false otherwise.
+ */
+bool astarte_inflight_table_take_stale(
+    astarte_inflight_table_t *table, uint32_t generation, astarte_inflight_entry_t *entry);
+
+/**
+ * @brief Counts the windowed entries
+ *
+ * @param[in] table The table.
+ * @param[in] interface_name The interface of the entries, NULL to count all of them.
+ * @return The number of windowed entries.
+ */
+size_t astarte_inflight_table_count(
+    const astarte_inflight_table_t *table, const char *interface_name);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_INFLIGHT_TABLE_H_ */
@@ -0,0 +1,94 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_json_extract.h
+ * @brief Streaming extractor of a single string field from a JSON document.
+ *
+ * @details The document can be fed in chunks of any size, as they are received. The value of the
+ * field is unescaped and copied directly in the output buffer provided by the caller, without any
+ * dynamic allocation. The field is identified by the path of object keys leading to it, for
+ * example { "data", "client_crt" }. Values inside arrays are never matched.
+ */
+
+#ifndef _ASTARTE_JSON_EXTRACT_H_
+#define _ASTARTE_JSON_EXTRACT_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/** @brief Maximum nesting level of the parsed documents. */
+#define ASTARTE_JSON_EXTRACT_MAX_DEPTH 32
+
+/**
+ * @brief Extractor state.
+ *
+ * @details All the fields are private, the struct is exposed only to allow its allocation on the
+ * stack.
+ */
+typedef struct
+{
+    const char *const *path;
+    size_t path_len;
+    char *out;
+    size_t out_size;
+    size_t out_len;
+    int state;
+    int string_mode;
+    // One bit for each open container, set for objects and cleared for arrays
+    uint32_t containers;
+    size_t depth;
+    size_t matched;
+    size_t key_pos;
+    bool key_compare;
+    bool key_match;
+    uint32_t unicode;
+    uint8_t unicode_digits;
+    bool found;
+} astarte_json_extract_t;
+
+/**
+ * @brief Initializes an extractor
+ *
+ * @param[out] extract Extractor to initialize.
+ * @param[in] path Keys leading to the field, they must stay valid until the extraction ends.
+ * @param[in] path_len Number of keys in the path, at most ASTARTE_JSON_EXTRACT_MAX_DEPTH.
+ * @param[out] out Buffer where the NULL terminated value of the field will be written.
+ * @param[in] out_size Size of the out buffer.
+ */
+void astarte_json_extract_init(astarte_json_extract_t *extract, const char *const *path,
+    size_t path_len, char *out, size_t out_size);
+
+/**
+ * @brief Feeds a chunk of the document to an extractor
+ *
+ * @details Once the field has been found the rest of the document is ignored.
+ *
+ * @param[in] extract Extractor.
+ * @param[in] data Chunk of the document.
+ * @param[in] len Length of the chunk.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR if the document is malformed or nested too deeply,
+ * - ASTARTE_ERR_INVALID_SIZE if the value of the field doesn't fit in the out buffer,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_json_extract_feed(
+    astarte_json_extract_t *extract, const char *data, size_t len);
+
+/**
+ * @brief Checks the result of an extraction
+ *
+ * @param[in] extract Extractor fed with the whole document.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if the document does not contain the field as a string,
+ * - ASTARTE_OK if the value of the field has been written in the out buffer
+ */
+astarte_err_t astarte_json_extract_finish(const astarte_json_extract_t *extract);
+
+#endif /* _ASTARTE_JSON_EXTRACT_H_ */
@@ -0,0 +1,81 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_outbox_governor.h
+ * @brief Hysteresis between the high-water and the low-water marks of the MQTT outbox.
+ *
+ * @details The governor becomes congested when the outbox size reaches the high-water mark and
+ * stays congested until the size drops to the low-water mark, so that a size oscillating around a
+ * single threshold does not toggle the state at each message. The size is always passed by the
+ * caller.
+ *
+ * The governor is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_OUTBOX_GOVERNOR_H_
+#define _ASTARTE_OUTBOX_GOVERNOR_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Change of state caused by a new outbox size.
+ */
+typedef enum
+{
+    ASTARTE_OUTBOX_CROSSING_NONE = 0, /**< The state did not change. */
+    ASTARTE_OUTBOX_CROSSING_HIGH, /**< The high-water mark has been reached. */
+    ASTARTE_OUTBOX_CROSSING_LOW, /**< The outbox drained to the low-water mark. */
+} astarte_outbox_crossing_t;
+
+/**
+ * @brief Outbox governor, the fields are private.
+ */
+typedef struct
+{
+    size_t high_water;
+    size_t low_water;
+    bool congested;
+} astarte_outbox_governor_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a governor that is not congested
+ *
+ * @param[out] governor The governor to initialize.
+ * @param[in] high_water Outbox size in bytes starting a congestion.
+ * @param[in] low_water Outbox size in bytes ending a congestion, capped to the high-water mark.
+ */
+void astarte_outbox_governor_init(
+    astarte_outbox_governor_t *governor, size_t high_water, size_t low_water);
+
+/**
+ * @brief Updates the state with the current outbox size
+ *
+ * @param[inout] governor The governor.
+ * @param[in] outbox_size The outbox size in bytes.
+ * @return The crossing caused by the size, if any.
+ */
+astarte_outbox_crossing_t astarte_outbox_governor_update(
+    astarte_outbox_governor_t *governor, size_t outbox_size);
+
+/**
+ * @brief Checks if the outbox is congested
+ *
+ * @param[in] governor The governor.
+ * @return true between a high-water and a low-water crossing, false otherwise.
+ */
+bool astarte_outbox_governor_congested(const astarte_outbox_governor_t *governor);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_OUTBOX_GOVERNOR_H_ */
@@ -0,0 +1,115 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_property_coalescer.h
+ * @brief Latest pending value of the properties that could not be published yet.
+ *
+ * @details At most one value is kept for each property topic, a new value replaces the pending one
+ * in place. Properties are released in the order they first became pending.
+ *
+ * The coalescer is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_PROPERTY_COALESCER_H_
+#define _ASTARTE_PROPERTY_COALESCER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Pending property, strings and payload are stored in the same allocation.
+ */
+typedef struct astarte_pending_property
+{
+    struct astarte_pending_property *next;
+    char *interface_name;
+    char *topic;
+    void *data;
+    int length; /**< 0 for an unset. */
+    int qos;
+} astarte_pending_property_t;
+
+/**
+ * @brief Bounded set of pending properties, the fields are private.
+ */
+typedef struct
+{
+    astarte_pending_property_t *head;
+    astarte_pending_property_t *tail;
+    size_t count;
+    size_t capacity;
+} astarte_property_coalescer_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes an empty coalescer
+ *
+ * @param[out] coalescer The coalescer to initialize.
+ * @param[in] capacity Maximum number of distinct pending properties.
+ */
+void astarte_property_coalescer_init(astarte_property_coalescer_t *coalescer, size_t capacity);
+
+/**
+ * @brief Frees all the pending properties
+ *
+ * @param[inout] coalescer The coalescer.
+ */
+void astarte_property_coalescer_destroy(astarte_property_coalescer_t *coalescer);
+
+/**
+ * @brief Sets the pending value of a property, replacing the previous one
+ *
+ * @param[inout] coalescer The coalescer.
+ * @param[in] interface_name The interface of the property, copied.
+ * @param[in] topic The topic of the property, copied.
+ * @param[in] data The payload, copied.
+ * @param[in] length The payload length.
+ * @param[in] qos The QoS of the message.
+ * @param[out] replaced Set to true if a pending value has been replaced.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_PUBLISH_QUEUE_FULL if the property is not pending and the coalescer is full,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the value could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_property_coalescer_put(astarte_property_coalescer_t *coalescer,
+    const char *interface_name, const char *topic, const void *data, int length, int qos,
+    bool *replaced);
+
+/**
+ * @brief Returns the oldest pending property, leaving it in the coalescer
+ *
+ * @param[in] coalescer The coalescer.
+ * @return The property or NULL if none is pending.
+ */
+const astarte_pending_property_t *astarte_property_coalescer_front(
+    const astarte_property_coalescer_t *coalescer);
+
+/**
+ * @brief Frees the oldest pending property, if any
+ *
+ * @param[inout] coalescer The coalescer.
+ */
+void astarte_property_coalescer_remove_front(astarte_property_coalescer_t *coalescer);
+
+/**
+ * @brief Returns the number of pending properties
+ *
+ * @param[in] coalescer The coalescer.
+ * @return The number of pending properties.
+ */
+size_t astarte_property_coalescer_count(const astarte_property_coalescer_t *coalescer);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_PROPERTY_COALESCER_H_ */
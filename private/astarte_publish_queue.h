@@ -0,0 +1,155 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_publish_queue.h
+ * @brief Bounded priority lanes holding the outgoing MQTT messages.
+ *
+ * @details Messages are copied in the lane of their priority class and popped with control
+ * messages always first. The remaining lanes are drained either in strict priority order or with a
+ * smooth weighted round robin, so that lower lanes still progress under load.
+ *
+ * The queue is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_PUBLISH_QUEUE_H_
+#define _ASTARTE_PUBLISH_QUEUE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Priority lanes, from the highest to the lowest priority.
+ */
+typedef enum
+{
+    ASTARTE_PUBLISH_LANE_CONTROL = 0, /**< Introspection, empty cache and purge properties. */
+    ASTARTE_PUBLISH_LANE_PROPERTIES, /**< Device owned properties. */
+    ASTARTE_PUBLISH_LANE_ALARM, /**< Datastreams flagged as alarms. */
+    ASTARTE_PUBLISH_LANE_BULK, /**< All the other datastreams. */
+    ASTARTE_PUBLISH_LANE_COUNT, /**< Number of lanes, not a valid lane. */
+} astarte_publish_lane_t;
+
+/**
+ * @brief Message held in a lane, topic and payload are stored in the same allocation.
+ */
+typedef struct
+{
+    char *topic;
+    void *data;
+    int length;
+    int qos;
+} astarte_publish_queue_msg_t;
+
+/**
+ * @brief Configuration of a lane.
+ */
+typedef struct
+{
+    size_t capacity; /**< Maximum number of messages in the lane. */
+    uint8_t weight; /**< Share of the weighted draining, unused by the control lane. */
+} astarte_publish_lane_config_t;
+
+/**
+ * @brief Ring buffer of a lane, the fields are private.
+ */
+typedef struct
+{
+    astarte_publish_queue_msg_t **msgs;
+    size_t capacity;
+    size_t head;
+    size_t count;
+    int32_t weight;
+    int32_t current_weight;
+} astarte_publish_lane_ring_t;
+
+/**
+ * @brief Priority lanes, the fields are private.
+ */
+typedef struct
+{
+    astarte_publish_lane_ring_t lanes[ASTARTE_PUBLISH_LANE_COUNT];
+    bool weighted;
+} astarte_publish_queue_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates the lanes of a queue
+ *
+ * @param[out] queue The queue to initialize.
+ * @param[in] config Configuration of each lane.
+ * @param[in] weighted true to drain with a weighted round robin, false for strict priority.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the lanes could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_publish_queue_init(astarte_publish_queue_t *queue,
+    const astarte_publish_lane_config_t config[ASTARTE_PUBLISH_LANE_COUNT], bool weighted);
+
+/**
+ * @brief Releases a queue together with all the messages it holds
+ *
+ * @param[inout] queue The queue to destroy.
+ */
+void astarte_publish_queue_destroy(astarte_publish_queue_t *queue);
+
+/**
+ * @brief Copies a message in a lane
+ *
+ * @param[inout] queue The queue.
+ * @param[in] lane The lane of the message.
+ * @param[in] topic The MQTT topic.
+ * @param[in] data The payload, copied.
+ * @param[in] length The payload length.
+ * @param[in] qos The MQTT QoS.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_PUBLISH_QUEUE_FULL if the lane is full,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the message could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_publish_queue_push(astarte_publish_queue_t *queue,
+    astarte_publish_lane_t lane, const char *topic, const void *data, int length, int qos);
+
+/**
+ * @brief Removes the next message to publish
+ *
+ * @param[inout] queue The queue.
+ * @param[out] msg The message, to be released with astarte_publish_queue_msg_free().
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if all the lanes are empty,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_publish_queue_pop(
+    astarte_publish_queue_t *queue, astarte_publish_queue_msg_t **msg);
+
+/**
+ * @brief Returns the number of messages held in a lane
+ *
+ * @param[in] queue The queue.
+ * @param[in] lane The lane.
+ * @return The number of messages.
+ */
+size_t astarte_publish_queue_count(
+    const astarte_publish_queue_t *queue, astarte_publish_lane_t lane);
+
+/**
+ * @brief Releases a message returned by astarte_publish_queue_pop()
+ *
+ * @param[in] msg The message, can be NULL.
+ */
+void astarte_publish_queue_msg_free(astarte_publish_queue_msg_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_PUBLISH_QUEUE_H_ */
@@ -0,0 +1,190 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_rate_limiter.h
+ * @brief Token buckets and backlog enforcing the publish rate limits.
+ *
+ * @details A limiter is made of a messages bucket and a bytes bucket. Tokens are stored in
+ * millionths, so that a bucket refilling at N tokens per second gains exactly N millionths each
+ * microsecond and no floating point is needed. Time is always passed by the caller.
+ *
+ * The backlog holds the messages waiting for tokens in arrival order. A message is released only
+ * when no older message of the same interface is still waiting, and never before an older message
+ * the device limiter cannot afford.
+ *
+ * Limiters and backlog are not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_RATE_LIMITER_H_
+#define _ASTARTE_RATE_LIMITER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_rate_limit.h"
+
+/**
+ * @brief Token bucket, the fields are private.
+ */
+typedef struct
+{
+    uint32_t rate;
+    uint32_t burst;
+    uint64_t level;
+    int64_t last_refill_us;
+} astarte_token_bucket_t;
+
+/**
+ * @brief Limits of a device or of an interface.
+ *
+ * @details The counters are updated by the caller, the other fields are private.
+ */
+typedef struct
+{
+    astarte_rate_limit_policy_t policy;
+    astarte_token_bucket_t messages;
+    astarte_token_bucket_t bytes;
+    astarte_rate_limit_counters_t counters;
+} astarte_rate_limiter_t;
+
+/**
+ * @brief Message waiting in the backlog, strings and payload are stored in the same allocation.
+ */
+typedef struct astarte_rate_limit_msg
+{
+    struct astarte_rate_limit_msg *next;
+    astarte_rate_limiter_t *limiter; /**< Limiter of the interface, NULL if it has none. */
+    char *interface_name;
+    char *topic;
+    void *data;
+    int length;
+    int qos;
+} astarte_rate_limit_msg_t;
+
+/**
+ * @brief Bounded FIFO of the messages waiting for tokens, the fields are private.
+ */
+typedef struct
+{
+    astarte_rate_limit_msg_t *head;
+    astarte_rate_limit_msg_t *tail;
+    size_t count;
+    size_t capacity;
+} astarte_rate_limit_backlog_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a limiter with full buckets
+ *
+ * @param[out] limiter The limiter to initialize.
+ * @param[in] config The limits.
+ * @param[in] now_us The current time in microseconds.
+ */
+void astarte_rate_limiter_init(
+    astarte_rate_limiter_t *limiter, const astarte_rate_limit_config_t *config, int64_t now_us);
+
+/**
+ * @brief Takes the tokens needed by a message from an interface and a device limiter
+ *
+ * @details Tokens are taken only if both limiters can afford the message. A message larger than
+ * the bytes burst is sent as soon as the bucket is full.
+ *
+ * @param[inout] interface_limiter The limiter of the interface, can be NULL.
+ * @param[inout] device_limiter The limiter of the device, can be NULL.
+ * @param[in] length The payload length.
+ * @param[in] now_us The current time in microseconds.
+ * @return true if the tokens have been taken, false if the message exceeds the limits.
+ */
+bool astarte_rate_limiter_try_acquire(astarte_rate_limiter_t *interface_limiter,
+    astarte_rate_limiter_t *device_limiter, int length, int64_t now_us);
+
+/**
+ * @brief Initializes an empty backlog
+ *
+ * @param[out] backlog The backlog to initialize.
+ * @param[in] capacity Maximum number of messages in the backlog.
+ */
+void astarte_rate_limit_backlog_init(astarte_rate_limit_backlog_t *backlog, size_t capacity);
+
+/**
+ * @brief Releases all the messages of a backlog
+ *
+ * @param[inout] backlog The backlog to destroy.
+ */
+void astarte_rate_limit_backlog_destroy(astarte_rate_limit_backlog_t *backlog);
+
+/**
+ * @brief Copies a message in a backlog
+ *
+ * @param[inout] backlog The backlog.
+ * @param[in] limiter The limiter of the interface, can be NULL.
+ * @param[in] interface_name The interface name.
+ * @param[in] topic The MQTT topic.
+ * @param[in] data The payload, copied.
+ * @param[in] length The payload length.
+ * @param[in] qos The MQTT QoS.
+ * @param[in] replace true to overwrite the message waiting on the same topic, keeping its place.
+ * @param[out] replaced Set to true if a waiting message has been overwritten.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_PUBLISH_QUEUE_FULL if the backlog is full and no message has been overwritten,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the message could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_rate_limit_backlog_push(astarte_rate_limit_backlog_t *backlog,
+    astarte_rate_limiter_t *limiter, const char *interface_name, const char *topic,
+    const void *data, int length, int qos, bool replace, bool *replaced);
+
+/**
+ * @brief Removes the oldest message that can be sent, taking its tokens
+ *
+ * @param[inout] backlog The backlog.
+ * @param[inout] device_limiter The limiter of the device, can be NULL.
+ * @param[in] now_us The current time in microseconds.
+ * @param[out] msg The message, to be released with astarte_rate_limit_backlog_msg_free().
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if no message can be sent yet,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_rate_limit_backlog_pop(astarte_rate_limit_backlog_t *backlog,
+    astarte_rate_limiter_t *device_limiter, int64_t now_us, astarte_rate_limit_msg_t **msg);
+
+/**
+ * @brief Computes when the next message of a backlog can be sent
+ *
+ * @param[inout] backlog The backlog.
+ * @param[inout] device_limiter The limiter of the device, can be NULL.
+ * @param[in] now_us The current time in microseconds.
+ * @return The delay in microseconds, -1 if the backlog is empty.
+ */
+int64_t astarte_rate_limit_backlog_wait_us(
+    astarte_rate_limit_backlog_t *backlog, astarte_rate_limiter_t *device_limiter, int64_t now_us);
+
+/**
+ * @brief Returns the number of messages held in a backlog
+ *
+ * @param[in] backlog The backlog.
+ * @return The number of messages.
+ */
+size_t astarte_rate_limit_backlog_count(const astarte_rate_limit_backlog_t *backlog);
+
+/**
+ * @brief Releases a message returned by astarte_rate_limit_backlog_pop()
+ *
+ * @param[in] msg The message, can be NULL.
+ */
+void astarte_rate_limit_backlog_msg_free(astarte_rate_limit_msg_t *msg);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_RATE_LIMITER_H_ */
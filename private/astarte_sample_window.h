@@ -0,0 +1,104 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_sample_window.h
+ * @brief Double buffered summary of the samples of a time window.
+ *
+ * @details A single producer adds samples to the active slot without locks. Closing a window
+ * swaps the slots, the closed one is then read and reset by the consumer with
+ * astarte_sample_window_collect(). If the consumer did not collect the previous window yet, closing
+ * is skipped and the current window gets longer.
+ */
+
+#ifndef _ASTARTE_SAMPLE_WINDOW_H_
+#define _ASTARTE_SAMPLE_WINDOW_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Summary of the samples of a window.
+ */
+typedef struct
+{
+    double min;
+    double max;
+    double sum;
+    double last;
+    uint32_t count;
+    int64_t start_us; /**< When the window has been opened. */
+    int64_t end_us; /**< When the window has been closed. */
+} astarte_window_summary_t;
+
+/**
+ * @brief Slot of a sample window, the fields are private.
+ */
+typedef struct
+{
+    astarte_window_summary_t summary;
+    atomic_uint writers;
+    atomic_bool closed;
+} astarte_sample_window_slot_t;
+
+/**
+ * @brief Sample window, the fields are private.
+ */
+typedef struct
+{
+    astarte_sample_window_slot_t slots[2];
+    atomic_uint active;
+} astarte_sample_window_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes a window, opening it
+ *
+ * @param[out] window The window to initialize.
+ * @param[in] now_us The current time in microseconds.
+ */
+void astarte_sample_window_init(astarte_sample_window_t *window, int64_t now_us);
+
+/**
+ * @brief Adds a sample to the open window
+ *
+ * @details Must not be called concurrently on the same window.
+ *
+ * @param[inout] window The window.
+ * @param[in] sample The sample.
+ */
+void astarte_sample_window_push(astarte_sample_window_t *window, double sample);
+
+/**
+ * @brief Closes the open window and opens the next one
+ *
+ * @param[inout] window The window.
+ * @param[in] now_us The current time in microseconds.
+ * @return true if the window has been closed, false if the previous one has not been collected.
+ */
+bool astarte_sample_window_close(astarte_sample_window_t *window, int64_t now_us);
+
+/**
+ * @brief Reads the summary of the closed window and makes its slot available again
+ *
+ * @details Waits for a push started before the window was closed to complete.
+ *
+ * @param[inout] window The window.
+ * @param[out] summary The summary of the closed window.
+ * @return true if a closed window has been collected, false if there is none.
+ */
+bool astarte_sample_window_collect(
+    astarte_sample_window_t *window, astarte_window_summary_t *summary);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SAMPLE_WINDOW_H_ */
@@ -0,0 +1,192 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_scratch.h
+ * @brief Fixed size arenas serving the transient allocations of the SDK.
+ *
+ * @details A task makes an arena active with astarte_scratch_begin(). While active, all the
+ * allocations made by the task through astarte_alloc are bump allocated from the arena and
+ * releasing them is a no-op. astarte_scratch_end() rewinds the arena to where it was when the
+ * matching begin was called, so scopes can be nested. A nested scope always uses the arena already
+ * active on the task, so a task never holds more than one arena at a time.
+ *
+ * Memory obtained from an arena must not outlive the scope it was allocated in.
+ */
+
+#ifndef _ASTARTE_SCRATCH_H_
+#define _ASTARTE_SCRATCH_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Scratch arena.
+ *
+ * @details All the fields are private, the struct is exposed only to allow its embedding.
+ */
+typedef struct
+{
+    uint8_t *buffer;
+    size_t size;
+    size_t used;
+    size_t high_water;
+    uint32_t failures;
+} astarte_scratch_t;
+
+/**
+ * @brief Position of an arena when a scope has been opened.
+ */
+typedef struct
+{
+    astarte_scratch_t *scratch;
+    size_t used;
+    bool activated;
+} astarte_scratch_mark_t;
+
+/**
+ * @brief Blocks in use of an arena, moved to the heap by astarte_scratch_save().
+ */
+typedef struct
+{
+    astarte_scratch_t *scratch;
+    uint8_t *blocks;
+    size_t used;
+    bool active;
+} astarte_scratch_saved_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Reserves the memory of an arena
+ *
+ * @param[out] scratch The arena to initialize.
+ * @param[in] size Size of the arena in bytes.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the memory of the arena could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_scratch_init(astarte_scratch_t *scratch, size_t size);
+
+/**
+ * @brief Releases the memory of an arena
+ *
+ * @param[inout] scratch The arena to destroy, must not be active on any task.
+ */
+void astarte_scratch_destroy(astarte_scratch_t *scratch);
+
+/**
+ * @brief Checks if the calling task has an active arena
+ *
+ * @return true if an arena is active on the calling task, false otherwise.
+ */
+bool astarte_scratch_is_active(void);
+
+/**
+ * @brief Opens a scope on the calling task
+ *
+ * @details If the task has no active arena, @p scratch becomes the active one. Otherwise the scope
+ * is opened on the arena already active and @p scratch is not used.
+ *
+ * @param[in] scratch The arena to activate, the caller must ensure no other task is using it.
+ * @return The mark to pass to astarte_scratch_end().
+ */
+astarte_scratch_mark_t astarte_scratch_begin(astarte_scratch_t *scratch);
+
+/**
+ * @brief Closes a scope, releasing all the memory allocated in it
+ *
+ * @param[in] mark The mark returned by the matching astarte_scratch_begin().
+ */
+void astarte_scratch_end(astarte_scratch_mark_t mark);
+
+/**
+ * @brief Deactivates the arena of the calling task, so that its allocations use the heap
+ *
+ * @details Used for memory that has to outlive the current scope.
+ *
+ * @return The arena to pass to astarte_scratch_resume(), NULL if none was active.
+ */
+astarte_scratch_t *astarte_scratch_suspend(void);
+
+/**
+ * @brief Reactivates an arena deactivated with astarte_scratch_suspend()
+ *
+ * @param[in] scratch The arena returned by astarte_scratch_suspend().
+ */
+void astarte_scratch_resume(astarte_scratch_t *scratch);
+
+/**
+ * @brief Moves the blocks in use of an arena to the heap, leaving the arena empty
+ *
+ * @details Lets other tasks use the arena while the calling task blocks with scopes still open on
+ * it. If the arena is active on the calling task, it is deactivated. astarte_scratch_restore()
+ * copies the blocks back to their addresses, so the pointers obtained in the open scopes are valid
+ * again once restored. The caller must ensure no other task is using the arena, both when saving
+ * and when restoring it.
+ *
+ * @param[in] scratch The arena to save.
+ * @param[out] saved Where to store the saved blocks.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the blocks could not be copied, the arena is left untouched,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_scratch_save(astarte_scratch_t *scratch, astarte_scratch_saved_t *saved);
+
+/**
+ * @brief Puts back the blocks moved to the heap by astarte_scratch_save()
+ *
+ * @details The blocks allocated from the arena since it has been saved are lost. The arena is
+ * reactivated on the calling task if it was active when saved.
+ *
+ * @param[inout] saved The saved blocks, released by this call.
+ */
+void astarte_scratch_restore(astarte_scratch_saved_t *saved);
+
+/**
+ * @brief Allocates from the arena active on the calling task
+ *
+ * @param[in] size The size of the block.
+ * @param[out] ptr The allocated block, NULL if the arena is exhausted.
+ * @return true if an arena is active and served the request, false if the caller has to use the
+ * heap.
+ */
+bool astarte_scratch_alloc(size_t size, void **ptr);
+
+/**
+ * @brief Checks if a block belongs to the arena active on the calling task
+ *
+ * @param[in] ptr The block.
+ * @return true if the block has been allocated from the active arena, false otherwise.
+ */
+bool astarte_scratch_owns(const void *ptr);
+
+/**
+ * @brief Returns the highest usage reached by an arena
+ *
+ * @param[in] scratch The arena.
+ * @return The highest number of bytes used at the same time, alignment padding included.
+ */
+size_t astarte_scratch_high_water(const astarte_scratch_t *scratch);
+
+/**
+ * @brief Returns the number of requests an arena could not serve
+ *
+ * @param[in] scratch The arena.
+ * @return The number of failed allocations.
+ */
+uint32_t astarte_scratch_failures(const astarte_scratch_t *scratch);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SCRATCH_H_ */
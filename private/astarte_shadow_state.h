@@ -0,0 +1,87 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_shadow_state.h
+ * @brief Snapshot of the published values of a shadow struct.
+ *
+ * @details The snapshot has the same layout as the application struct, a field is changed when its
+ * bytes differ from the snapshot or when it has never been published. String fields are compared
+ * up to their terminator.
+ */
+
+#ifndef _ASTARTE_SHADOW_STATE_H_
+#define _ASTARTE_SHADOW_STATE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+#include "astarte_shadow.h"
+
+/**
+ * @brief Published state of a shadow, the fields are private.
+ */
+typedef struct
+{
+    const astarte_shadow_field_t *fields;
+    size_t fields_count;
+    uint8_t *snapshot;
+    bool *published;
+} astarte_shadow_state_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Validates a fields table and allocates its snapshot
+ *
+ * @param[out] state The state to initialize.
+ * @param[in] fields The fields table, must outlive the state.
+ * @param[in] fields_count Number of fields.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_INTERFACE_PATH if a path does not start with /,
+ * - ASTARTE_ERR_INVALID_SIZE if a field size does not match its type or there are no fields,
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the snapshot could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_shadow_state_init(
+    astarte_shadow_state_t *state, const astarte_shadow_field_t *fields, size_t fields_count);
+
+/**
+ * @brief Frees the snapshot
+ *
+ * @param[inout] state The state.
+ */
+void astarte_shadow_state_destroy(astarte_shadow_state_t *state);
+
+/**
+ * @brief Checks if a field differs from its last published value
+ *
+ * @param[in] state The state.
+ * @param[in] data The application struct.
+ * @param[in] index Index of the field.
+ * @return true if the field has to be published.
+ */
+bool astarte_shadow_state_changed(
+    const astarte_shadow_state_t *state, const void *data, size_t index);
+
+/**
+ * @brief Records the current value of a field as published
+ *
+ * @param[inout] state The state.
+ * @param[in] data The application struct.
+ * @param[in] index Index of the field.
+ */
+void astarte_shadow_state_update(astarte_shadow_state_t *state, const void *data, size_t index);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SHADOW_STATE_H_ */
@@ -0,0 +1,113 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_spsc_ring.h
+ * @brief Lock-free ring of timestamped samples with a single producer and a single consumer.
+ *
+ * @details The producer and the consumer only share the two free running indexes, published with
+ * release stores. Pushing never blocks nor allocates and can be done from an ISR, a sample pushed
+ * on a full ring is dropped and counted. The capacity must be a power of two.
+ */
+
+#ifndef _ASTARTE_SPSC_RING_H_
+#define _ASTARTE_SPSC_RING_H_
+
+#include <stdatomic.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+/**
+ * @brief Value of a sample, its type is known by the owner of the ring.
+ */
+typedef union
+{
+    double double_value;
+    int64_t longinteger_value;
+} astarte_ring_value_t;
+
+/**
+ * @brief Sample with the time it has been pushed at.
+ */
+typedef struct
+{
+    int64_t timestamp_us;
+    astarte_ring_value_t value;
+} astarte_ring_sample_t;
+
+/**
+ * @brief Ring of samples, the fields are private.
+ */
+typedef struct
+{
+    astarte_ring_sample_t *samples;
+    uint32_t mask;
+    atomic_uint head; /**< Next slot written by the producer. */
+    atomic_uint tail; /**< Next slot read by the consumer. */
+    atomic_uint dropped;
+} astarte_spsc_ring_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Initializes an empty ring
+ *
+ * @param[out] ring The ring to initialize.
+ * @param[in] samples The storage of the samples, owned by the caller.
+ * @param[in] capacity Number of samples of the storage, a power of two.
+ */
+void astarte_spsc_ring_init(
+    astarte_spsc_ring_t *ring, astarte_ring_sample_t *samples, uint32_t capacity);
+
+/**
+ * @brief Adds a sample, to be called by the producer only
+ *
+ * @details ISR safe, placed in IRAM.
+ *
+ * @param[inout] ring The ring.
+ * @param[in] timestamp_us The time of the sample in microseconds.
+ * @param[in] value The value of the sample.
+ * @return true if the sample has been added, false if the ring is full and it has been dropped.
+ */
+bool astarte_spsc_ring_push(
+    astarte_spsc_ring_t *ring, int64_t timestamp_us, astarte_ring_value_t value);
+
+/**
+ * @brief Removes the oldest samples, to be called by the consumer only
+ *
+ * @param[inout] ring The ring.
+ * @param[out] samples Where the samples are copied, oldest first.
+ * @param[in] max_samples Size of the samples array.
+ * @return The number of copied samples.
+ */
+uint32_t astarte_spsc_ring_pop(
+    astarte_spsc_ring_t *ring, astarte_ring_sample_t *samples, uint32_t max_samples);
+
+/**
+ * @brief Returns the number of samples in the ring
+ *
+ * @details ISR safe, placed in IRAM. The result is exact only for the producer and the consumer.
+ *
+ * @param[in] ring The ring.
+ * @return The number of samples.
+ */
+uint32_t astarte_spsc_ring_count(astarte_spsc_ring_t *ring);
+
+/**
+ * @brief Returns the number of samples dropped since the ring has been initialized
+ *
+ * @param[in] ring The ring.
+ * @return The number of dropped samples.
+ */
+uint32_t astarte_spsc_ring_dropped(astarte_spsc_ring_t *ring);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_SPSC_RING_H_ */
@@ -21,6 +21,7 @@
 typedef struct
 {
     nvs_handle_t nvs_handle;
+    int64_t open_time_us; // Used to measure the duration of storage operations
 } astarte_storage_handle_t;
 
 typedef struct
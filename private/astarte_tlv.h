@@ -0,0 +1,129 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_tlv.h
+ * @brief Utility module to handle checksummed type-length-value records.
+ *
+ * @details Records are stored in slots. Each slot is made of a fixed size header followed by a
+ * payload containing a sequence of records. Each record is encoded as a one byte type, a two bytes
+ * little endian length and the value itself. The header contains a sequence number, used to select
+ * the newest of two slots, and the checksums of both the payload and the header itself.
+ * This module only handles memory buffers, reading and writing the slots is up to the caller.
+ */
+
+#ifndef _ASTARTE_TLV_H_
+#define _ASTARTE_TLV_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/** @brief Size of the encoded slot header. */
+#define ASTARTE_TLV_HEADER_SIZE 32
+/** @brief Size of the header of each record. */
+#define ASTARTE_TLV_RECORD_HEADER_SIZE 3
+/** @brief Maximum length of the value of a record. */
+#define ASTARTE_TLV_VALUE_MAX_LEN UINT16_MAX
+
+typedef struct
+{
+    uint32_t sequence;
+    uint32_t payload_len;
+    uint32_t payload_crc;
+} astarte_tlv_header_t;
+
+/**
+ * @brief Computes the CRC32 (IEEE 802.3) of a buffer
+ *
+ * @param[in] crc Initial value, use 0 for a new computation or a previous result to continue it.
+ * @param[in] buf Buffer to process.
+ * @param[in] len Length of the buffer.
+ * @return The updated CRC32.
+ */
+uint32_t astarte_tlv_crc32(uint32_t crc, const uint8_t *buf, size_t len);
+
+/**
+ * @brief Encodes a slot header, sealing it with its own checksum
+ *
+ * @param[in] header Header to encode.
+ * @param[out] out Buffer of at least ASTARTE_TLV_HEADER_SIZE bytes.
+ */
+void astarte_tlv_header_encode(const astarte_tlv_header_t *header, uint8_t *out);
+
+/**
+ * @brief Decodes and validates a slot header
+ *
+ * @param[in] buf Buffer of ASTARTE_TLV_HEADER_SIZE bytes read from the slot.
+ * @param[out] header Decoded header.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if the buffer does not contain a valid header (e.g. erased flash),
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_tlv_header_decode(const uint8_t *buf, astarte_tlv_header_t *header);
+
+/**
+ * @brief Checks a payload against the checksum stored in its header
+ *
+ * @param[in] header Header of the slot.
+ * @param[in] payload Payload read from the slot, of header->payload_len bytes.
+ * @return true if the payload is intact, false otherwise.
+ */
+bool astarte_tlv_payload_is_valid(const astarte_tlv_header_t *header, const uint8_t *payload);
+
+/**
+ * @brief Selects the newest between two slots
+ *
+ * @details Sequence numbers are compared with serial number arithmetic, so wrap arounds are
+ * handled correctly.
+ *
+ * @param[in] a Header of the first slot, NULL if the slot is not valid.
+ * @param[in] b Header of the second slot, NULL if the slot is not valid.
+ * @return 0 if the first slot is the newest, 1 if the second is, -1 if none is valid.
+ */
+int astarte_tlv_select_newest(const astarte_tlv_header_t *a, const astarte_tlv_header_t *b);
+
+/**
+ * @brief Finds a record in a payload
+ *
+ * @param[in] payload Payload to search.
+ * @param[in] payload_len Length of the payload.
+ * @param[in] type Type of the record to find.
+ * @param[out] value Pointer to the value of the record, inside the payload.
+ * @param[out] value_len Length of the value of the record.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_NOT_FOUND if there is no record of the requested type,
+ * - ASTARTE_ERR if the payload is malformed,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_tlv_find(const uint8_t *payload, size_t payload_len, uint8_t type,
+    const uint8_t **value, size_t *value_len);
+
+/**
+ * @brief Builds a new payload replacing, adding or removing a record
+ *
+ * @details All the records of the old payload with a type different from the one specified are
+ * copied to the new payload. Then, if a value is specified, a record with it is appended.
+ *
+ * @param[in] payload Old payload, may be NULL when payload_len is 0.
+ * @param[in] payload_len Length of the old payload.
+ * @param[in] type Type of the record to set.
+ * @param[in] value Value of the record, NULL to remove the record.
+ * @param[in] value_len Length of the value.
+ * @param[out] out Buffer where the new payload will be written, it must not overlap the old one.
+ * @param[in] out_size Size of the out buffer.
+ * @param[out] out_len Length of the new payload.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_INVALID_SIZE if the value or the new payload are too big,
+ * - ASTARTE_ERR if the old payload is malformed,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_tlv_update(const uint8_t *payload, size_t payload_len, uint8_t type,
+    const void *value, size_t value_len, uint8_t *out, size_t out_size, size_t *out_len);
+
+#endif /* _ASTARTE_TLV_H_ */
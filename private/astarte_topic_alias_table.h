@@ -0,0 +1,128 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_topic_alias_table.h
+ * @brief MQTT 5 topic aliases assigned to the topics published by a device.
+ *
+ * @details Aliases go from 1 to the capacity of the table. A topic gets a free alias, or the least
+ * recently used one, the first time it is published. The alias is confirmed once a message with
+ * both the topic and the alias has been sent, from then on the topic can be omitted.
+ *
+ * Aliases only last as long as the MQTT connection, the table is reset on each new connection and
+ * its generation changes, so that confirmations of messages sent before the reset are ignored.
+ *
+ * The table is not thread safe, the caller is responsible for locking.
+ */
+
+#ifndef _ASTARTE_TOPIC_ALIAS_TABLE_H_
+#define _ASTARTE_TOPIC_ALIAS_TABLE_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "astarte.h"
+
+/**
+ * @brief Topic assigned to an alias, NULL for a free alias.
+ */
+typedef struct
+{
+    char *topic;
+    bool confirmed;
+    uint32_t last_use;
+} astarte_topic_alias_slot_t;
+
+/**
+ * @brief Table of topic aliases, the fields are private.
+ */
+typedef struct
+{
+    astarte_topic_alias_slot_t *slots;
+    uint16_t capacity;
+    uint16_t limit; /**< Aliases accepted by the broker on this connection. */
+    uint32_t uses;
+    uint32_t generation;
+} astarte_topic_alias_table_t;
+
+/**
+ * @brief Alias to use for a message.
+ */
+typedef struct
+{
+    uint16_t alias; /**< 0 when the topic has no alias. */
+    bool confirmed; /**< The topic can be omitted. */
+    uint32_t generation; /**< Generation of the table when the alias has been assigned. */
+} astarte_topic_alias_t;
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Allocates an empty table
+ *
+ * @param[out] table The table to initialize.
+ * @param[in] capacity Number of aliases.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the aliases could not be allocated,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_topic_alias_table_init(astarte_topic_alias_table_t *table, uint16_t capacity);
+
+/**
+ * @brief Frees the table and the topics of its aliases
+ *
+ * @param[inout] table The table.
+ */
+void astarte_topic_alias_table_destroy(astarte_topic_alias_table_t *table);
+
+/**
+ * @brief Forgets all the aliases, for a new connection
+ *
+ * @param[inout] table The table.
+ */
+void astarte_topic_alias_table_reset(astarte_topic_alias_table_t *table);
+
+/**
+ * @brief Gets the alias of a topic, assigning one if needed
+ *
+ * @param[inout] table The table.
+ * @param[in] topic The topic, copied when a new alias is assigned.
+ * @param[out] alias The alias, without alias when the broker accepts none.
+ * @return One of the follwing error codes:
+ * - ASTARTE_ERR_OUT_OF_MEMORY if the topic could not be copied,
+ * - ASTARTE_OK if operation has been successful
+ */
+astarte_err_t astarte_topic_alias_table_get(
+    astarte_topic_alias_table_t *table, const char *topic, astarte_topic_alias_t *alias);
+
+/**
+ * @brief Confirms an alias after a message with its topic has been sent
+ *
+ * @param[inout] table The table.
+ * @param[in] alias The alias returned by astarte_topic_alias_table_get().
+ */
+void astarte_topic_alias_table_confirm(
+    astarte_topic_alias_table_t *table, const astarte_topic_alias_t *alias);
+
+/**
+ * @brief Stops using an alias refused by the MQTT client and all the larger ones
+ *
+ * @details The limit lasts until the next reset.
+ *
+ * @param[inout] table The table.
+ * @param[in] alias The alias returned by astarte_topic_alias_table_get().
+ */
+void astarte_topic_alias_table_refuse(
+    astarte_topic_alias_table_t *table, const astarte_topic_alias_t *alias);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_TOPIC_ALIAS_TABLE_H_ */
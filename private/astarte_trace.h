@@ -0,0 +1,78 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_trace.h
+ * @brief Tracepoints marking the begin and the end of the SDK hot paths.
+ *
+ * @details The tracepoints are compiled out unless CONFIG_ASTARTE_TRACE is enabled, in which case
+ * they are forwarded to the backend selected in the configuration: SystemView user events or, on
+ * the Linux target, a Chrome/Perfetto JSON trace file. Begin and end of the same event must be
+ * called from the same task, events of a task can be nested.
+ */
+
+#ifndef _ASTARTE_TRACE_H_
+#define _ASTARTE_TRACE_H_
+
+#include "astarte.h"
+
+typedef enum
+{
+    /** @brief BSON serialization of a published payload. */
+    ASTARTE_TRACE_SERIALIZE = 0,
+    /** @brief Publish of a serialized payload, from the topic encoding to the MQTT enqueue. */
+    ASTARTE_TRACE_PUBLISH,
+    /** @brief Wait for the device lock during a publish. */
+    ASTARTE_TRACE_LOCK_WAIT,
+    /** @brief Hand off of a message to the MQTT client. */
+    ASTARTE_TRACE_ENQUEUE,
+    /** @brief Handling of a message received from Astarte. */
+    ASTARTE_TRACE_INCOMING,
+    /** @brief Properties storage operation, from the open to the close of the storage. */
+    ASTARTE_TRACE_STORAGE,
+    /** @brief Compression of the device properties list. */
+    ASTARTE_TRACE_ZLIB,
+    /** @brief Device reinitialization after a certificate error. */
+    ASTARTE_TRACE_REINIT,
+    /** @brief Number of events, not a valid event. */
+    ASTARTE_TRACE_EVENT_COUNT,
+} astarte_trace_event_t;
+
+#ifdef CONFIG_ASTARTE_TRACE
+#define ASTARTE_TRACE_BEGIN(event) astarte_trace_begin(event)
+#define ASTARTE_TRACE_END(event) astarte_trace_end(event)
+#else
+#define ASTARTE_TRACE_BEGIN(event)
+#define ASTARTE_TRACE_END(event)
+#endif
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Marks the begin of an event on the calling task
+ *
+ * @note Use the ASTARTE_TRACE_BEGIN macro, that is compiled out when tracing is disabled.
+ *
+ * @param[in] event The event that begins.
+ */
+void astarte_trace_begin(astarte_trace_event_t event);
+
+/**
+ * @brief Marks the end of an event on the calling task
+ *
+ * @note Use the ASTARTE_TRACE_END macro, that is compiled out when tracing is disabled.
+ *
+ * @param[in] event The event that ends.
+ */
+void astarte_trace_end(astarte_trace_event_t event);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_TRACE_H_ */
@@ -0,0 +1,32 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+/**
+ * @file astarte_transport_esp_mqtt.h
+ * @brief Default transport of a device, the esp-mqtt client.
+ */
+
+#ifndef _ASTARTE_TRANSPORT_ESP_MQTT_H_
+#define _ASTARTE_TRANSPORT_ESP_MQTT_H_
+
+#include "astarte_transport.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Gets the esp-mqtt transport
+ *
+ * @return The transport, valid for the whole program.
+ */
+const astarte_transport_t *astarte_transport_esp_mqtt(void);
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* _ASTARTE_TRANSPORT_ESP_MQTT_H_ */
@@ -0,0 +1,176 @@
+#
+# This file is part of Astarte.
+#
+# Copyright 2024 SECO Mind Srl
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+#
+
+"""
+Reference decoder of the sample blocks published by the block streams of the device.
+
+The format is described in include/astarte_block.h. The decode_block function can be imported by
+server side tools, when run as a script the blocks are read as base64 or hex strings, one per line,
+from the command line or standard input and the samples are printed as CSV.
+
+Checked using pylint with the following command:
+python3.8 -m pylint --rcfile=./python_scripts/.pylintrc ./python_scripts/*.py
+Formatted using black with the following command:
+python3 -m black --line-length 100 ./python_scripts/*.py
+
+"""
+
+import argparse
+import base64
+import binascii
+import struct
+import sys
+
+BLOCK_FORMAT_VERSION = 1
+BLOCK_TYPE_DOUBLE = 0
+BLOCK_TYPE_LONGINTEGER = 1
+HEADER_FORMAT = "<BBHq"
+HEADER_SIZE = struct.calcsize(HEADER_FORMAT)
+
+# Prefix length and payload bits of the timestamp delta of delta
+TIMESTAMP_BUCKETS = [(2, 7), (3, 9), (4, 12), (4, 32)]
+
+
+class BitReader:
+    """Reads a bit stream, most significant bit first."""
+
+    def __init__(self, data: bytes):
+        self.data = data
+        self.pos = 0
+
+    def read(self, bits: int) -> int:
+        """Reads an unsigned value of the given number of bits."""
+        if self.pos + bits > len(self.data) * 8:
+            raise ValueError("Truncated block")
+        value = 0
+        for _ in range(bits):
+            byte = self.data[self.pos // 8]
+            value = (value << 1) | ((byte >> (7 - self.pos % 8)) & 1)
+            self.pos += 1
+        return value
+
+    def read_signed(self, bits: int) -> int:
+        """Reads a two's complement value of the given number of bits."""
+        value = self.read(bits)
+        return value - (1 << bits) if value & (1 << (bits - 1)) else value
+
+
+def read_delta_of_delta(reader: BitReader) -> int:
+    """Reads the delta of delta of a timestamp."""
+    if reader.read(1) == 0:
+        return 0
+    ones = 1
+    while ones < 4 and reader.read(1) == 1:
+        ones += 1
+    _, bits = TIMESTAMP_BUCKETS[ones - 1]
+    return reader.read_signed(bits)
+
+
+def read_doubles(reader: BitReader, count: int):
+    """Generator of the XOR compressed doubles."""
+    value = reader.read(64)
+    leading = trailing = 0
+    yield value
+    for _ in range(count - 1):
+        if reader.read(1) == 1:
+            if reader.read(1) == 1:
+                leading = reader.read(5)
+                meaningful = reader.read(6) or 64
+                trailing = 64 - leading - meaningful
+            value ^= reader.read(64 - leading - trailing) << trailing
+        yield value
+
+
+def read_longintegers(reader: BitReader):
+    """Generator of the zig-zag varint deltas, accumulated with 64 bits wrapping."""
+    value = 0
+    while True:
+        zigzag = shift = 0
+        while True:
+            group = reader.read(8)
+            zigzag |= (group & 0x7F) << shift
+            shift += 7
+            if not group & 0x80:
+                break
+        delta = (zigzag >> 1) ^ -(zigzag & 1)
+        value = (value + delta) & 0xFFFFFFFFFFFFFFFF
+        yield value - (1 << 64) if value & (1 << 63) else value
+
+
+def decode_block(block: bytes):
+    """Decodes a block into a list of (timestamp in ms, value) tuples."""
+    if len(block) < HEADER_SIZE:
+        raise ValueError("Block shorter than its header")
+    version, block_type, count, timestamp = struct.unpack_from(HEADER_FORMAT, block)
+    if version != BLOCK_FORMAT_VERSION:
+        raise ValueError(f"Unsupported block version {version}")
+    if block_type not in (BLOCK_TYPE_DOUBLE, BLOCK_TYPE_LONGINTEGER):
+        raise ValueError(f"Unknown block type {block_type}")
+    if count == 0:
+        return []
+
+    reader = BitReader(block[HEADER_SIZE:])
+    delta = 0
+    if block_type == BLOCK_TYPE_DOUBLE:
+        doubles = read_doubles(reader, count)
+        values = (struct.unpack("<d", struct.pack("<Q", next(doubles)))[0] for _ in range(count))
+    else:
+        longintegers = read_longintegers(reader)
+        values = (next(longintegers) for _ in range(count))
+
+    samples = []
+    for index in range(count):
+        # Timestamps come before the value of the same sample
+        if index > 0:
+            delta += read_delta_of_delta(reader)
+            timestamp += delta
+        samples.append((timestamp, next(values)))
+    return samples
+
+
+def parse_block(text: str) -> bytes:
+    """Parses a block given as hex or base64."""
+    text = text.strip()
+    try:
+        return bytes.fromhex(text)
+    except ValueError:
+        return base64.b64decode(text, validate=True)
+
+
+def main():
+    """Decodes the blocks given on the command line or on standard input."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n", maxsplit=1)[0].strip())
+    parser.add_argument("blocks", nargs="*", help="Blocks as hex or base64 (default: stdin)")
+    args = parser.parse_args()
+
+    lines = args.blocks or [line for line in sys.stdin if line.strip()]
+    print("timestamp_ms,value")
+    for line in lines:
+        try:
+            samples = decode_block(parse_block(line))
+        except (ValueError, binascii.Error) as err:
+            print(f"Invalid block: {err}", file=sys.stderr)
+            sys.exit(1)
+        for timestamp, value in samples:
+            print(f"{timestamp},{value!r}")
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,326 @@
+#
+# This file is part of Astarte.
+#
+# Copyright 2024 SECO Mind Srl
+#
+# Licensed under the Apache License, Version 2.0 (the "License");
+# you may not use this file except in compliance with the License.
+# You may obtain a copy of the License at
+#
+#    http://www.apache.org/licenses/LICENSE-2.0
+#
+# Unless required by applicable law or agreed to in writing, software
+# distributed under the License is distributed on an "AS IS" BASIS,
+# WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+# See the License for the specific language governing permissions and
+# limitations under the License.
+#
+# SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+#
+
+"""
+Local stand-in for the Astarte pairing API and MQTT broker, used by the boot benchmark in
+tests/boot_bench_app.
+
+The script creates a throwaway certification authority, serves the three pairing endpoints used by
+the device (registration, certificate signing and device info) and starts a mosquitto broker
+accepting only client certificates signed by that authority. Nothing leaves the local machine.
+
+Before the first run install the requirements.txt and mosquitto.
+
+Checked using pylint with the following command:
+python3.8 -m pylint --rcfile=./python_scripts/.pylintrc ./python_scripts/*.py
+Formatted using black with the following command:
+python3 -m black --line-length 100 ./python_scripts/*.py
+
+"""
+
+import argparse
+import base64
+import datetime
+import ipaddress
+import json
+import os
+import re
+import secrets
+import subprocess
+import sys
+import tempfile
+import threading
+import time
+from http.server import BaseHTTPRequestHandler, ThreadingHTTPServer
+
+from cryptography import x509
+from cryptography.hazmat.primitives import hashes, serialization
+from cryptography.hazmat.primitives.asymmetric import ec
+from cryptography.x509.oid import NameOID
+
+REGISTRATION_RE = re.compile(r"^/v1/(?P<realm>[^/]+)/agent/devices$")
+CREDENTIALS_RE = re.compile(
+    r"^/v1/(?P<realm>[^/]+)/devices/(?P<device_id>[^/]+)/protocols/astarte_mqtt_v1/credentials$"
+)
+INFO_RE = re.compile(r"^/v1/(?P<realm>[^/]+)/devices/(?P<device_id>[^/]+)$")
+
+CERT_VALIDITY = datetime.timedelta(days=1)
+
+
+class CertificateAuthority:
+    """
+    Throwaway certification authority signing the broker and the device certificates.
+    """
+
+    def __init__(self):
+        self.key = ec.generate_private_key(ec.SECP256R1())
+        name = x509.Name([x509.NameAttribute(NameOID.COMMON_NAME, "Boot benchmark CA")])
+        now = datetime.datetime.now(datetime.timezone.utc)
+        self.cert = (
+            x509.CertificateBuilder()
+            .subject_name(name)
+            .issuer_name(name)
+            .public_key(self.key.public_key())
+            .serial_number(x509.random_serial_number())
+            .not_valid_before(now - datetime.timedelta(minutes=5))
+            .not_valid_after(now + CERT_VALIDITY)
+            .add_extension(x509.BasicConstraints(ca=True, path_length=None), critical=True)
+            .sign(self.key, hashes.SHA256())
+        )
+
+    def sign(self, common_name: str, public_key, san: list = None) -> x509.Certificate:
+        """
+        Issue a certificate for the given public key.
+
+        Parameters
+        ----------
+        common_name : str
+            Common name of the certificate subject.
+        public_key :
+            Public key to certify.
+        san : list
+            Optional subject alternative names.
+
+        Returns
+        -------
+        x509.Certificate
+            The signed certificate.
+        """
+        now = datetime.datetime.now(datetime.timezone.utc)
+        builder = (
+            x509.CertificateBuilder()
+            .subject_name(x509.Name([x509.NameAttribute(NameOID.COMMON_NAME, common_name)]))
+            .issuer_name(self.cert.subject)
+            .public_key(public_key)
+            .serial_number(x509.random_serial_number())
+            .not_valid_before(now - datetime.timedelta(minutes=5))
+            .not_valid_after(now + CERT_VALIDITY)
+        )
+        if san:
+            builder = builder.add_extension(x509.SubjectAlternativeName(san), critical=False)
+        return builder.sign(self.key, hashes.SHA256())
+
+
+class PairingState:
+    """
+    Devices registered since the stand-in has been started.
+    """
+
+    def __init__(self, ca: CertificateAuthority, broker_url: str, latency_s: float):
+        self.ca = ca
+        self.broker_url = broker_url
+        self.latency_s = latency_s
+        self.secrets = {}
+        self.lock = threading.Lock()
+
+    def register(self, device_id: str) -> str:
+        """Create (or replace) the credentials secret of a device."""
+        secret = base64.b64encode(secrets.token_bytes(32)).decode()
+        with self.lock:
+            self.secrets[device_id] = secret
+        return secret
+
+    def is_authorized(self, device_id: str, auth_header: str) -> bool:
+        """Check the bearer token sent by a device against its credentials secret."""
+        with self.lock:
+            secret = self.secrets.get(device_id)
+        return secret is not None and auth_header == f"Bearer {secret}"
+
+
+def make_handler(state: PairingState):
+    """Build the HTTP request handler class bound to the pairing state."""
+
+    class PairingHandler(BaseHTTPRequestHandler):
+        """Serves the subset of the pairing API used by the device."""
+
+        # Keep-alive is needed to exercise the connection reuse of pairing sessions
+        protocol_version = "HTTP/1.1"
+
+        def log_message(self, format, *args):  # pylint: disable=redefined-builtin
+            sys.stderr.write(f"[pairing] {format % args}\n")
+
+        def do_POST(self):  # pylint: disable=invalid-name
+            """Handle registration and certificate requests."""
+            time.sleep(state.latency_s)
+            length = int(self.headers.get("Content-Length", 0))
+            try:
+                body = json.loads(self.rfile.read(length) or b"{}")
+            except json.JSONDecodeError:
+                self.reply(400, {"errors": {"detail": "Malformed JSON"}})
+                return
+
+            match = REGISTRATION_RE.match(self.path)
+            if match:
+                if not self.headers.get("Authorization", "").startswith("Bearer "):
+                    self.reply(401, {"errors": {"detail": "Missing JWT"}})
+                    return
+                hw_id = body.get("data", {}).get("hw_id")
+                if not hw_id:
+                    self.reply(422, {"errors": {"hw_id": ["can't be blank"]}})
+                    return
+                self.reply(201, {"data": {"credentials_secret": state.register(hw_id)}})
+                return
+
+            match = CREDENTIALS_RE.match(self.path)
+            if match:
+                device_id = match.group("device_id")
+                if not state.is_authorized(device_id, self.headers.get("Authorization", "")):
+                    self.reply(401, {"errors": {"detail": "Unauthorized"}})
+                    return
+                try:
+                    csr = x509.load_pem_x509_csr(body["data"]["csr"].encode())
+                except (KeyError, ValueError):
+                    self.reply(422, {"errors": {"csr": ["is invalid"]}})
+                    return
+                cert = state.ca.sign(f"{match.group('realm')}/{device_id}", csr.public_key())
+                pem = cert.public_bytes(serialization.Encoding.PEM).decode()
+                self.reply(201, {"data": {"client_crt": pem}})
+                return
+
+            self.reply(404, {"errors": {"detail": "Not found"}})
+
+        def do_GET(self):  # pylint: disable=invalid-name
+            """Handle device info requests."""
+            time.sleep(state.latency_s)
+            match = INFO_RE.match(self.path)
+            if not match:
+                self.reply(404, {"errors": {"detail": "Not found"}})
+                return
+            if not state.is_authorized(
+                match.group("device_id"), self.headers.get("Authorization", "")
+            ):
+                self.reply(401, {"errors": {"detail": "Unauthorized"}})
+                return
+            protocols = {"astarte_mqtt_v1": {"broker_url": state.broker_url}}
+            data = {"version": "1.0", "status": "confirmed", "protocols": protocols}
+            self.reply(200, {"data": data})
+
+        def reply(self, status: int, payload: dict):
+            """Send a JSON response."""
+            body = json.dumps(payload).encode()
+            self.send_response(status)
+            self.send_header("Content-Type", "application/json")
+            self.send_header("Content-Length", str(len(body)))
+            self.end_headers()
+            self.wfile.write(body)
+
+    return PairingHandler
+
+
+def write_broker_files(ca: CertificateAuthority, workdir: str, host: str, port: int) -> str:
+    """
+    Write the broker TLS material and the mosquitto configuration.
+
+    Parameters
+    ----------
+    ca : CertificateAuthority
+        Authority signing the broker certificate and trusted for client certificates.
+    workdir : str
+        Directory where the files are written.
+    host : str
+        Address the broker listens on.
+    port : int
+        Port the broker listens on.
+
+    Returns
+    -------
+    str
+        Path of the mosquitto configuration file.
+    """
+    key = ec.generate_private_key(ec.SECP256R1())
+    san = [x509.DNSName("localhost")]
+    try:
+        san.append(x509.IPAddress(ipaddress.ip_address(host)))
+    except ValueError:
+        san.append(x509.DNSName(host))
+    cert = ca.sign("localhost", key.public_key(), san)
+
+    files = {
+        "ca.pem": ca.cert.public_bytes(serialization.Encoding.PEM),
+        "broker.pem": cert.public_bytes(serialization.Encoding.PEM),
+        "broker.key": key.private_bytes(
+            serialization.Encoding.PEM,
+            serialization.PrivateFormat.PKCS8,
+            serialization.NoEncryption(),
+        ),
+    }
+    for name, content in files.items():
+        with open(os.path.join(workdir, name), "wb") as file:
+            file.write(content)
+
+    conf_path = os.path.join(workdir, "mosquitto.conf")
+    with open(conf_path, "w", encoding="utf-8") as conf:
+        conf.write(
+            f"listener {port} {host}\n"
+            f"cafile {os.path.join(workdir, 'ca.pem')}\n"
+            f"certfile {os.path.join(workdir, 'broker.pem')}\n"
+            f"keyfile {os.path.join(workdir, 'broker.key')}\n"
+            "require_certificate true\n"
+            "use_identity_as_username true\n"
+            "persistence false\n"
+        )
+    return conf_path
+
+
+def main():
+    """Parse the arguments, start the broker and serve the pairing API until interrupted."""
+    parser = argparse.ArgumentParser(description=__doc__.split("\n\n", maxsplit=1)[0].strip())
+    parser.add_argument("--host", default="127.0.0.1", help="Address to listen on")
+    parser.add_argument("--port", type=int, default=4003, help="Pairing API port")
+    parser.add_argument("--broker-port", type=int, default=8883, help="MQTT broker port")
+    parser.add_argument("--mosquitto", default="mosquitto", help="Mosquitto executable")
+    parser.add_argument(
+        "--no-broker", action="store_true", help="Do not start mosquitto, only serve pairing"
+    )
+    parser.add_argument(
+        "--latency-ms", type=int, default=0, help="Delay added to each pairing response"
+    )
+    parser.add_argument("--workdir", help="Directory for the generated files (default: temporary)")
+    args = parser.parse_args()
+
+    workdir = args.workdir or tempfile.mkdtemp(prefix="astarte_boot_bench_")
+    os.makedirs(workdir, exist_ok=True)
+
+    ca = CertificateAuthority()
+    conf_path = write_broker_files(ca, workdir, args.host, args.broker_port)
+
+    broker = None
+    if not args.no_broker:
+        broker = subprocess.Popen([args.mosquitto, "-c", conf_path])  # pylint: disable=R1732
+
+    broker_url = f"mqtts://{args.host}:{args.broker_port}"
+    state = PairingState(ca, broker_url, args.latency_ms / 1000)
+    server = ThreadingHTTPServer((args.host, args.port), make_handler(state))
+    print(f"Pairing stand-in on http://{args.host}:{args.port}, broker {broker_url}", flush=True)
+    print(f"Generated files in {workdir}", flush=True)
+
+    try:
+        server.serve_forever()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        server.server_close()
+        if broker:
+            broker.terminate()
+            broker.wait()
+
+
+if __name__ == "__main__":
+    main()
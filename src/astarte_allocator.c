@@ -0,0 +1,231 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_alloc.h>
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+#include <stdatomic.h>
+#endif
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+static const char *const subsystem_names[ASTARTE_ALLOC_SUBSYSTEM_COUNT] = {
+    [ASTARTE_ALLOC_SUBSYSTEM_DEVICE] = "device",
+    [ASTARTE_ALLOC_SUBSYSTEM_BSON] = "bson",
+    [ASTARTE_ALLOC_SUBSYSTEM_STORAGE] = "storage",
+    [ASTARTE_ALLOC_SUBSYSTEM_PAIRING] = "pairing",
+    [ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS] = "credentials",
+};
+
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+// Prepended to each block to charge its release to the right subsystem, the union keeps the
+// returned memory aligned as the allocator one
+typedef union
+{
+    struct
+    {
+        size_t size;
+        astarte_alloc_subsystem_t subsystem;
+    } info;
+    max_align_t align;
+} alloc_header_t;
+
+typedef struct
+{
+    atomic_size_t current_bytes;
+    atomic_size_t peak_bytes;
+    atomic_uint_least32_t current_allocations;
+    atomic_uint_least32_t total_allocations;
+} subsystem_accounting_t;
+
+static subsystem_accounting_t accounting[ASTARTE_ALLOC_SUBSYSTEM_COUNT];
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void *default_malloc(size_t size, astarte_alloc_subsystem_t subsystem, void *user_data);
+static void default_free(void *ptr, void *user_data);
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+static void account_malloc(astarte_alloc_subsystem_t subsystem, size_t size);
+static void account_free(astarte_alloc_subsystem_t subsystem, size_t size);
+#endif
+
+static astarte_allocator_t allocator = {
+    .malloc_fn = default_malloc,
+    .free_fn = default_free,
+    .user_data = NULL,
+};
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_allocator_set(const astarte_allocator_t *new_allocator)
+{
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+    for (size_t i = 0; i < ASTARTE_ALLOC_SUBSYSTEM_COUNT; i++) {
+        if (atomic_load(&accounting[i].current_allocations) != 0) {
+            return ASTARTE_ERR;
+        }
+    }
+#endif
+
+    if (!new_allocator) {
+        allocator.malloc_fn = default_malloc;
+        allocator.free_fn = default_free;
+        allocator.user_data = NULL;
+    } else {
+        allocator = *new_allocator;
+    }
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_allocator_get_stats(
+    astarte_alloc_subsystem_t subsystem, astarte_allocator_stats_t *stats)
+{
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+    if ((size_t) subsystem >= ASTARTE_ALLOC_SUBSYSTEM_COUNT) {
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+    stats->current_bytes = atomic_load(&accounting[subsystem].current_bytes);
+    stats->peak_bytes = atomic_load(&accounting[subsystem].peak_bytes);
+    stats->current_allocations = atomic_load(&accounting[subsystem].current_allocations);
+    stats->total_allocations = atomic_load(&accounting[subsystem].total_allocations);
+    return ASTARTE_OK;
+#else
+    (void) subsystem;
+    (void) stats;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+const char *astarte_alloc_subsystem_to_name(astarte_alloc_subsystem_t subsystem)
+{
+    if (((size_t) subsystem >= ASTARTE_ALLOC_SUBSYSTEM_COUNT) || !subsystem_names[subsystem]) {
+        return "UNKNOWN";
+    }
+    return subsystem_names[subsystem];
+}
+
+void *astarte_alloc_malloc(astarte_alloc_subsystem_t subsystem, size_t size)
+{
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Transient allocations are served by the scratch arena active on the task, if any
+    void *scratch_ptr = NULL;
+    if (astarte_scratch_alloc(size, &scratch_ptr)) {
+        return scratch_ptr;
+    }
+#endif
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+    if (size > SIZE_MAX - sizeof(alloc_header_t)) {
+        return NULL;
+    }
+    alloc_header_t *header
+        = allocator.malloc_fn(sizeof(alloc_header_t) + size, subsystem, allocator.user_data);
+    if (!header) {
+        return NULL;
+    }
+    header->info.size = size;
+    header->info.subsystem = subsystem;
+    account_malloc(subsystem, size);
+    return header + 1;
+#else
+    return allocator.malloc_fn(size, subsystem, allocator.user_data);
+#endif
+}
+
+void *astarte_alloc_calloc(astarte_alloc_subsystem_t subsystem, size_t count, size_t size)
+{
+    if ((size != 0) && (count > SIZE_MAX / size)) {
+        return NULL;
+    }
+    void *ptr = astarte_alloc_malloc(subsystem, count * size);
+    if (ptr) {
+        memset(ptr, 0, count * size);
+    }
+    return ptr;
+}
+
+char *astarte_alloc_strdup(astarte_alloc_subsystem_t subsystem, const char *str)
+{
+    size_t size = strlen(str) + 1;
+    char *copy = astarte_alloc_malloc(subsystem, size);
+    if (copy) {
+        memcpy(copy, str, size);
+    }
+    return copy;
+}
+
+void astarte_alloc_free(void *ptr)
+{
+    if (!ptr) {
+        return;
+    }
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    if (astarte_scratch_owns(ptr)) {
+        return;
+    }
+#endif
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+    alloc_header_t *header = (alloc_header_t *) ptr - 1;
+    account_free(header->info.subsystem, header->info.size);
+    allocator.free_fn(header, allocator.user_data);
+#else
+    allocator.free_fn(ptr, allocator.user_data);
+#endif
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void *default_malloc(size_t size, astarte_alloc_subsystem_t subsystem, void *user_data)
+{
+    (void) subsystem;
+    (void) user_data;
+    return malloc(size);
+}
+
+static void default_free(void *ptr, void *user_data)
+{
+    (void) user_data;
+    free(ptr);
+}
+
+#ifdef CONFIG_ASTARTE_ALLOC_ACCOUNTING
+static void account_malloc(astarte_alloc_subsystem_t subsystem, size_t size)
+{
+    subsystem_accounting_t *subsystem_accounting = &accounting[subsystem];
+    size_t current = atomic_fetch_add(&subsystem_accounting->current_bytes, size) + size;
+    atomic_fetch_add(&subsystem_accounting->current_allocations, 1);
+    atomic_fetch_add(&subsystem_accounting->total_allocations, 1);
+
+    size_t peak = atomic_load(&subsystem_accounting->peak_bytes);
+    while ((current > peak)
+        && !atomic_compare_exchange_weak(&subsystem_accounting->peak_bytes, &peak, current)) {
+        // On failure peak has been reloaded, retry only if still lower
+    }
+}
+
+static void account_free(astarte_alloc_subsystem_t subsystem, size_t size)
+{
+    subsystem_accounting_t *subsystem_accounting = &accounting[subsystem];
+    atomic_fetch_sub(&subsystem_accounting->current_bytes, size);
+    atomic_fetch_sub(&subsystem_accounting->current_allocations, 1);
+}
+#endif
@@ -0,0 +1,63 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_blob_envelope.h>
+
+#include <astarte_bson_types.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+// Type, "t" with its terminator and the datetime
+#define TIMESTAMP_ELEMENT_SIZE (1 + 2 + sizeof(uint64_t))
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void write_le(uint8_t *out, uint64_t value, size_t size);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+size_t astarte_blob_envelope_wrap(
+    uint8_t *buffer, size_t blob_size, bool has_timestamp, uint64_t ts_epoch_millis)
+{
+    size_t trailer_size = (has_timestamp ? TIMESTAMP_ELEMENT_SIZE : 0) + 1;
+    size_t document_size = ASTARTE_BLOB_HEADROOM + blob_size + trailer_size;
+
+    // Document size, then the type, the name and the size of the "v" element and the subtype
+    write_le(buffer, document_size, sizeof(uint32_t));
+    buffer[4] = BSON_TYPE_BINARY;
+    buffer[5] = 'v';
+    buffer[6] = '\0';
+    write_le(&buffer[7], blob_size, sizeof(uint32_t));
+    buffer[11] = BSON_SUBTYPE_DEFAULT_BINARY;
+
+    uint8_t *trailer = buffer + ASTARTE_BLOB_HEADROOM + blob_size;
+    if (has_timestamp) {
+        trailer[0] = BSON_TYPE_DATETIME;
+        trailer[1] = 't';
+        trailer[2] = '\0';
+        write_le(&trailer[3], ts_epoch_millis, sizeof(uint64_t));
+        trailer += TIMESTAMP_ELEMENT_SIZE;
+    }
+    trailer[0] = '\0';
+    return document_size;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void write_le(uint8_t *out, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        out[i] = (uint8_t) (value >> (8U * i));
+    }
+}
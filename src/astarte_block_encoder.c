@@ -0,0 +1,230 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_block_encoder.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define BLOCK_FORMAT_VERSION 1
+// Leading zeros are stored in 5 bits
+#define MAX_LEADING_ZEROS 31
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static bool write_bits(astarte_block_encoder_t *encoder, uint64_t value, unsigned int bits);
+static bool write_timestamp(astarte_block_encoder_t *encoder, int64_t ts_ms);
+static bool write_double(astarte_block_encoder_t *encoder, double value);
+static bool write_varint(astarte_block_encoder_t *encoder, uint64_t value);
+static void rollback(astarte_block_encoder_t *encoder, const astarte_block_encoder_t *saved);
+static void put_le(uint8_t *dest, uint64_t value, size_t size);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_block_encoder_init(astarte_block_encoder_t *encoder, astarte_block_type_t type,
+    uint8_t *buffer, size_t capacity)
+{
+    memset(encoder, 0, sizeof(astarte_block_encoder_t));
+    encoder->buffer = buffer;
+    encoder->capacity = capacity;
+    encoder->type = type;
+    astarte_block_encoder_reset(encoder);
+}
+
+void astarte_block_encoder_reset(astarte_block_encoder_t *encoder)
+{
+    memset(encoder->buffer, 0, encoder->capacity);
+    encoder->buffer[0] = BLOCK_FORMAT_VERSION;
+    encoder->buffer[1] = (uint8_t) encoder->type;
+    encoder->bit_pos = 0;
+    encoder->count = 0;
+    encoder->first_ts = 0;
+    encoder->prev_ts = 0;
+    encoder->prev_delta = 0;
+    encoder->prev_value = 0;
+    encoder->has_window = false;
+}
+
+astarte_err_t astarte_block_encoder_add_double(
+    astarte_block_encoder_t *encoder, int64_t ts_ms, double value)
+{
+    if (encoder->count == UINT16_MAX) {
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    astarte_block_encoder_t saved = *encoder;
+    if (!write_timestamp(encoder, ts_ms) || !write_double(encoder, value)) {
+        rollback(encoder, &saved);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    encoder->count++;
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_block_encoder_add_longinteger(
+    astarte_block_encoder_t *encoder, int64_t ts_ms, int64_t value)
+{
+    if (encoder->count == UINT16_MAX) {
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    astarte_block_encoder_t saved = *encoder;
+    // Wrapping unsigned arithmetic, the decoder wraps the same way
+    uint64_t delta = (uint64_t) value - encoder->prev_value;
+    uint64_t zigzag = (delta << 1U) ^ ((delta & (1ULL << 63U)) ? UINT64_MAX : 0);
+    if (!write_timestamp(encoder, ts_ms) || !write_varint(encoder, zigzag)) {
+        rollback(encoder, &saved);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    encoder->prev_value = (uint64_t) value;
+    encoder->count++;
+    return ASTARTE_OK;
+}
+
+uint16_t astarte_block_encoder_count(const astarte_block_encoder_t *encoder)
+{
+    return encoder->count;
+}
+
+int64_t astarte_block_encoder_first_timestamp(const astarte_block_encoder_t *encoder)
+{
+    return encoder->first_ts;
+}
+
+const uint8_t *astarte_block_encoder_finish(astarte_block_encoder_t *encoder, size_t *length)
+{
+    put_le(&encoder->buffer[2], encoder->count, 2);
+    put_le(&encoder->buffer[4], (uint64_t) encoder->first_ts, 8);
+    *length = ASTARTE_BLOCK_HEADER_SIZE + (encoder->bit_pos + 7) / 8;
+    return encoder->buffer;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static bool write_bits(astarte_block_encoder_t *encoder, uint64_t value, unsigned int bits)
+{
+    if (encoder->bit_pos + bits > (encoder->capacity - ASTARTE_BLOCK_HEADER_SIZE) * 8) {
+        return false;
+    }
+    uint8_t *stream = encoder->buffer + ASTARTE_BLOCK_HEADER_SIZE;
+    for (unsigned int i = bits; i > 0; i--) {
+        if ((value >> (i - 1)) & 1U) {
+            stream[encoder->bit_pos / 8] |= (uint8_t) (0x80U >> (encoder->bit_pos % 8));
+        }
+        encoder->bit_pos++;
+    }
+    return true;
+}
+
+static bool write_timestamp(astarte_block_encoder_t *encoder, int64_t ts_ms)
+{
+    if (encoder->count == 0) {
+        // Stored in the header
+        encoder->first_ts = ts_ms;
+        encoder->prev_ts = ts_ms;
+        return true;
+    }
+
+    int64_t delta = ts_ms - encoder->prev_ts;
+    int64_t dod = delta - encoder->prev_delta;
+    encoder->prev_ts = ts_ms;
+    encoder->prev_delta = delta;
+    if (dod == 0) {
+        return write_bits(encoder, 0x0, 1);
+    }
+    if ((dod >= -64) && (dod <= 63)) {
+        return write_bits(encoder, 0x2, 2) && write_bits(encoder, (uint64_t) dod, 7);
+    }
+    if ((dod >= -256) && (dod <= 255)) {
+        return write_bits(encoder, 0x6, 3) && write_bits(encoder, (uint64_t) dod, 9);
+    }
+    if ((dod >= -2048) && (dod <= 2047)) {
+        return write_bits(encoder, 0xE, 4) && write_bits(encoder, (uint64_t) dod, 12);
+    }
+    if ((dod >= INT32_MIN) && (dod <= INT32_MAX)) {
+        return write_bits(encoder, 0xF, 4) && write_bits(encoder, (uint64_t) dod, 32);
+    }
+    // Such a jump starts a new block
+    return false;
+}
+
+static bool write_double(astarte_block_encoder_t *encoder, double value)
+{
+    uint64_t bits = 0;
+    memcpy(&bits, &value, sizeof(bits));
+    if (encoder->count == 0) {
+        encoder->prev_value = bits;
+        return write_bits(encoder, bits, 64);
+    }
+
+    uint64_t xor = bits ^ encoder->prev_value;
+    encoder->prev_value = bits;
+    if (xor == 0) {
+        return write_bits(encoder, 0x0, 1);
+    }
+
+    unsigned int leading = (unsigned int) __builtin_clzll(xor);
+    unsigned int trailing = (unsigned int) __builtin_ctzll(xor);
+    if (leading > MAX_LEADING_ZEROS) {
+        leading = MAX_LEADING_ZEROS;
+    }
+    if (encoder->has_window && (leading >= encoder->prev_leading)
+        && (trailing >= encoder->prev_trailing)) {
+        unsigned int meaningful = 64 - encoder->prev_leading - encoder->prev_trailing;
+        return write_bits(encoder, 0x2, 2)
+            && write_bits(encoder, xor >> encoder->prev_trailing, meaningful);
+    }
+
+    unsigned int meaningful = 64 - leading - trailing;
+    encoder->has_window = true;
+    encoder->prev_leading = (uint8_t) leading;
+    encoder->prev_trailing = (uint8_t) trailing;
+    // A count of 64 does not fit 6 bits, it is stored as 0
+    return write_bits(encoder, 0x3, 2) && write_bits(encoder, leading, 5)
+        && write_bits(encoder, meaningful & 0x3FU, 6)
+        && write_bits(encoder, xor >> trailing, meaningful);
+}
+
+static bool write_varint(astarte_block_encoder_t *encoder, uint64_t value)
+{
+    while (value >= 0x80U) {
+        if (!write_bits(encoder, (value & 0x7FU) | 0x80U, 8)) {
+            return false;
+        }
+        value >>= 7U;
+    }
+    return write_bits(encoder, value, 8);
+}
+
+static void rollback(astarte_block_encoder_t *encoder, const astarte_block_encoder_t *saved)
+{
+    // Clear the bits written after the saved position
+    uint8_t *stream = encoder->buffer + ASTARTE_BLOCK_HEADER_SIZE;
+    size_t first_byte = saved->bit_pos / 8;
+    if (saved->bit_pos % 8) {
+        stream[first_byte] &= (uint8_t) (0xFFU << (8 - saved->bit_pos % 8));
+        first_byte++;
+    }
+    size_t end_byte = (encoder->bit_pos + 7) / 8;
+    if (end_byte > first_byte) {
+        memset(&stream[first_byte], 0, end_byte - first_byte);
+    }
+    *encoder = *saved;
+}
+
+static void put_le(uint8_t *dest, uint64_t value, size_t size)
+{
+    for (size_t i = 0; i < size; i++) {
+        dest[i] = (uint8_t) (value >> (8 * i));
+    }
+}
@@ -0,0 +1,45 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_boot_profile.h>
+
+#include <stddef.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+static const char *const boot_phase_names[ASTARTE_BOOT_PHASE_COUNT] = {
+    [ASTARTE_BOOT_PHASE_REGISTRATION] = "registration",
+    [ASTARTE_BOOT_PHASE_CERTIFICATE] = "certificate",
+    [ASTARTE_BOOT_PHASE_BROKER_URL] = "broker_url",
+    [ASTARTE_BOOT_PHASE_MQTT_CONNECT] = "mqtt_connect",
+    [ASTARTE_BOOT_PHASE_SUBSCRIPTIONS] = "subscriptions",
+    [ASTARTE_BOOT_PHASE_INTROSPECTION] = "introspection",
+    [ASTARTE_BOOT_PHASE_PROPERTIES_RESYNC] = "properties_resync",
+};
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+__attribute__((weak)) void astarte_boot_profile_begin(astarte_boot_phase_t phase)
+{
+    (void) phase;
+}
+
+__attribute__((weak)) void astarte_boot_profile_end(astarte_boot_phase_t phase)
+{
+    (void) phase;
+}
+
+const char *astarte_boot_phase_to_name(astarte_boot_phase_t phase)
+{
+    if (((size_t) phase >= ASTARTE_BOOT_PHASE_COUNT) || !boot_phase_names[phase]) {
+        return "UNKNOWN";
+    }
+    return boot_phase_names[phase];
+}
@@ -6,6 +6,7 @@
 
 #include <astarte_bson_serializer.h>
 
+#include <astarte_alloc.h>
 #include <astarte_bson_types.h>
 
 #include <esp_log.h>
@@ -77,11 +78,14 @@ static void astarte_byte_array_init(astarte_byte_array *byte_arr, void *bytes, s
 {
     byte_arr->capacity = size;
     byte_arr->size = size;
-    byte_arr->buf = malloc(size);
+    byte_arr->buf = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_BSON, size);
 
     if (!byte_arr->buf) {
+        // A NULL buffer marks the array as failed, the document will be reported as invalid
         ESP_LOGE(TAG, "Cannot allocate memory for BSON payload (size: %zu)!", size);
-        abort();
+        byte_arr->capacity = 0;
+        byte_arr->size = 0;
+        return;
     }
 
     memcpy(byte_arr->buf, bytes, size);
@@ -91,35 +95,48 @@ static void astarte_byte_array_destroy(astarte_byte_array *byte_arr)
 {
     byte_arr->capacity = 0;
     byte_arr->size = 0;
-    free(byte_arr->buf);
+    astarte_alloc_free(byte_arr->buf);
     byte_arr->buf = NULL;
 }
 
-static void astarte_byte_array_grow(astarte_byte_array *byte_arr, size_t needed)
+static bool astarte_byte_array_grow(astarte_byte_array *byte_arr, size_t needed)
 {
+    if (!byte_arr->buf) {
+        return false;
+    }
     if (byte_arr->size + needed >= byte_arr->capacity) {
         size_t new_capacity = byte_arr->capacity * 2;
         if (new_capacity < byte_arr->capacity + needed) {
             new_capacity = byte_arr->capacity + needed;
         }
-        byte_arr->capacity = new_capacity;
-        void *new_buf = malloc(new_capacity);
+        void *new_buf = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_BSON, new_capacity);
+        if (!new_buf) {
+            ESP_LOGE(TAG, "Cannot allocate memory for BSON payload (size: %zu)!", new_capacity);
+            astarte_byte_array_destroy(byte_arr);
+            return false;
+        }
         memcpy(new_buf, byte_arr->buf, byte_arr->size);
-        free(byte_arr->buf);
+        astarte_alloc_free(byte_arr->buf);
         byte_arr->buf = new_buf;
+        byte_arr->capacity = new_capacity;
     }
+    return true;
 }
 
 static void astarte_byte_array_append_byte(astarte_byte_array *byte_arr, uint8_t byte)
 {
-    astarte_byte_array_grow(byte_arr, sizeof(uint8_t));
+    if (!astarte_byte_array_grow(byte_arr, sizeof(uint8_t))) {
+        return;
+    }
     byte_arr->buf[byte_arr->size] = byte;
     byte_arr->size++;
 }
 
 static void astarte_byte_array_append(astarte_byte_array *byte_arr, const void *bytes, size_t count)
 {
-    astarte_byte_array_grow(byte_arr, count);
+    if (!astarte_byte_array_grow(byte_arr, count)) {
+        return;
+    }
 
     memcpy(byte_arr->buf + byte_arr->size, bytes, count);
     byte_arr->size += count;
@@ -128,6 +145,9 @@ static void astarte_byte_array_append(astarte_byte_array *byte_arr, const void *
 static void astarte_byte_array_replace(
     astarte_byte_array *byte_arr, unsigned int pos, size_t count, const uint8_t *bytes)
 {
+    if (!byte_arr->buf) {
+        return;
+    }
     memcpy(byte_arr->buf + pos, bytes, count);
 }
 
@@ -138,7 +158,8 @@ void astarte_bson_serializer_init(astarte_bson_serializer_handle_t bson)
 
 astarte_bson_serializer_handle_t astarte_bson_serializer_new(void)
 {
-    astarte_bson_serializer_handle_t bson = calloc(1, sizeof(astarte_bson_serializer));
+    astarte_bson_serializer_handle_t bson
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_BSON, 1, sizeof(astarte_bson_serializer));
     if (!bson) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return NULL;
@@ -150,7 +171,7 @@ astarte_bson_serializer_handle_t astarte_bson_serializer_new(void)
 void astarte_bson_serializer_destroy(astarte_bson_serializer_handle_t bson)
 {
     astarte_byte_array_destroy(&bson->ba);
-    free(bson);
+    astarte_alloc_free(bson);
 }
 
 const void *astarte_bson_serializer_get_document(astarte_bson_serializer_handle_t bson, int *size)
@@ -164,6 +185,10 @@ const void *astarte_bson_serializer_get_document(astarte_bson_serializer_handle_
 astarte_err_t astarte_bson_serializer_write_document(
     astarte_bson_serializer_handle_t bson, void *out_buf, int out_buf_len, int *out_doc_size)
 {
+    if (!bson->ba.buf) {
+        return ASTARTE_ERR;
+    }
+
     size_t doc_size = bson->ba.size;
     if (out_doc_size) {
         *out_doc_size = (int) doc_size;
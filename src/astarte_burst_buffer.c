@@ -0,0 +1,119 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_burst_buffer.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_BURST_BUFFER"
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_burst_buffer_init(
+    astarte_burst_buffer_t *buffer, size_t max_bytes, int64_t max_age_us)
+{
+    memset(buffer, 0, sizeof(astarte_burst_buffer_t));
+    buffer->max_bytes = max_bytes;
+    buffer->max_age_us = max_age_us;
+}
+
+void astarte_burst_buffer_destroy(astarte_burst_buffer_t *buffer)
+{
+    astarte_burst_msg_t *msg = astarte_burst_buffer_take_all(buffer);
+    while (msg) {
+        astarte_burst_msg_t *next = msg->next;
+        astarte_burst_buffer_msg_free(msg);
+        msg = next;
+    }
+}
+
+astarte_err_t astarte_burst_buffer_push(astarte_burst_buffer_t *buffer, const char *interface_name,
+    const char *topic, const void *data, int length, int qos, int64_t now_us)
+{
+    size_t interface_name_size = strlen(interface_name) + 1;
+    size_t topic_size = strlen(topic) + 1;
+    astarte_burst_msg_t *msg = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE,
+        sizeof(astarte_burst_msg_t) + interface_name_size + topic_size + (size_t) length);
+    if (!msg) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    msg->next = NULL;
+    msg->interface_name = (char *) (msg + 1);
+    memcpy(msg->interface_name, interface_name, interface_name_size);
+    msg->topic = msg->interface_name + interface_name_size;
+    memcpy(msg->topic, topic, topic_size);
+    msg->data = msg->topic + topic_size;
+    if (length > 0) {
+        memcpy(msg->data, data, (size_t) length);
+    }
+    msg->length = length;
+    msg->qos = qos;
+
+    if (buffer->tail) {
+        buffer->tail->next = msg;
+    } else {
+        buffer->head = msg;
+        buffer->oldest_us = now_us;
+    }
+    buffer->tail = msg;
+    buffer->count++;
+    buffer->bytes += topic_size - 1 + (size_t) length;
+    return ASTARTE_OK;
+}
+
+bool astarte_burst_buffer_due(const astarte_burst_buffer_t *buffer, int64_t now_us)
+{
+    return astarte_burst_buffer_wait_us(buffer, now_us) == 0;
+}
+
+int64_t astarte_burst_buffer_wait_us(const astarte_burst_buffer_t *buffer, int64_t now_us)
+{
+    if (!buffer->head) {
+        return -1;
+    }
+    if (buffer->bytes >= buffer->max_bytes) {
+        return 0;
+    }
+    int64_t wait_us = buffer->oldest_us + buffer->max_age_us - now_us;
+    return (wait_us > 0) ? wait_us : 0;
+}
+
+astarte_burst_msg_t *astarte_burst_buffer_take_all(astarte_burst_buffer_t *buffer)
+{
+    astarte_burst_msg_t *head = buffer->head;
+    buffer->head = NULL;
+    buffer->tail = NULL;
+    buffer->count = 0;
+    buffer->bytes = 0;
+    buffer->oldest_us = 0;
+    return head;
+}
+
+size_t astarte_burst_buffer_count(const astarte_burst_buffer_t *buffer)
+{
+    return buffer->count;
+}
+
+size_t astarte_burst_buffer_bytes(const astarte_burst_buffer_t *buffer)
+{
+    return buffer->bytes;
+}
+
+void astarte_burst_buffer_msg_free(astarte_burst_msg_t *msg)
+{
+    astarte_alloc_free(msg);
+}
@@ -6,17 +6,25 @@
 
 #include <astarte_credentials.h>
 
+#include <astarte_alloc.h>
+
 #include <esp_err.h>
 #include <esp_log.h>
+#include <esp_timer.h>
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
 #include <esp_vfs.h>
 #include <esp_vfs_fat.h>
+#endif
+#include <freertos/semphr.h>
 #include <freertos/task.h>
 #include <nvs.h>
 
+#include <mbedtls/asn1.h>
 #include <mbedtls/ctr_drbg.h>
 #include <mbedtls/ecp.h>
 #include <mbedtls/entropy.h>
 #include <mbedtls/oid.h>
+#include <mbedtls/pem.h>
 #include <mbedtls/pk.h>
 #include <mbedtls/x509_crt.h>
 #include <mbedtls/x509_csr.h>
@@ -32,35 +40,88 @@
 #define PARTITION_NAME "astarte"
 #define CREDENTIALS_MOUNTPOINT "/astarte"
 #define CREDENTIALS_DIR_PATH CREDENTIALS_MOUNTPOINT "/ast_cred"
-#define PRIVKEY_PATH CREDENTIALS_DIR_PATH "/device.key"
-#define CSR_PATH CREDENTIALS_DIR_PATH "/device.csr"
-#define CRT_PATH CREDENTIALS_DIR_PATH "/device.crt"
+#define CSR_FILENAME "device.csr"
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+// DER credentials use their own names, so that toggling the format regenerates them
+#define PRIVKEY_FILENAME "key.der"
+#define CRT_FILENAME "crt.der"
+#else
+#define PRIVKEY_FILENAME "device.key"
+#define CRT_FILENAME "device.crt"
+#endif
+#define CREDENTIAL_PATH_LENGTH 64
 
 #define KEY_SIZE 2048
 #define EXPONENT 65537
 #define PRIVKEY_BUFFER_LENGTH 16000
+#define PRIVKEY_DER_BUFFER_LENGTH 2048
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+#define STORED_PRIVKEY_BUFFER_LENGTH PRIVKEY_DER_BUFFER_LENGTH
+#else
+#define STORED_PRIVKEY_BUFFER_LENGTH PRIVKEY_BUFFER_LENGTH
+#endif
 
 #define CSR_BUFFER_LENGTH 4096
 
 #define PAIRING_NAMESPACE "astarte_pairing"
 #define CRED_SECRET_KEY "cred_secret"
 
-#define CREDS_STORAGE_FUNCS(NAME)                                                                  \
-    const astarte_credentials_storage_functions_t *NAME = creds_ctx.functions;
+#define CREDS_STORAGE_FUNCS(NAME, CTX)                                                             \
+    const astarte_credentials_storage_functions_t *NAME = (CTX)->functions;
 
-static wl_handle_t s_wl_handle = WL_INVALID_HANDLE;
-static QueueHandle_t s_init_result_queue = NULL;
+// Storage of the per-device credentials contexts, used as opaque for the namespaced backends
+typedef struct
+{
+    char *partition_label;
+    char device_namespace[ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN + 1];
+} credentials_ns_storage_t;
 
-static astarte_err_t ensure_mounted();
+#define CREDENTIALS_INIT_TASK_STACK_DEPTH 16384
 
-static char *s_credentials_secret_partition_label = NVS_DEFAULT_PART_NAME;
+// Either result_queue is set, when the caller waits for the result, or config is used to notify it
+typedef struct
+{
+    astarte_credentials_context_t *ctx;
+    QueueHandle_t result_queue;
+    astarte_credentials_init_config_t config;
+} credentials_init_task_args_t;
 
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
+static wl_handle_t s_wl_handle = WL_INVALID_HANDLE;
+static StaticSemaphore_t s_mount_mutex_buffer;
+static SemaphoreHandle_t s_mount_mutex = NULL;
+static portMUX_TYPE s_mount_mutex_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+static astarte_err_t ensure_mounted(const char *device_namespace);
+
+static astarte_err_t fat_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length);
+static astarte_err_t fat_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length);
+static bool fat_ns_exists(void *opaque, credential_type_t cred_type);
+static astarte_err_t fat_ns_remove(void *opaque, credential_type_t cred_type);
+#endif
+static astarte_err_t nvs_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length);
+static astarte_err_t nvs_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length);
+static bool nvs_ns_exists(void *opaque, credential_type_t cred_type);
+static astarte_err_t nvs_ns_remove(void *opaque, credential_type_t cred_type);
+static astarte_err_t tlv_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length);
+static astarte_err_t tlv_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length);
+static bool tlv_ns_exists(void *opaque, credential_type_t cred_type);
+static astarte_err_t tlv_ns_remove(void *opaque, credential_type_t cred_type);
+
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
 static const astarte_credentials_storage_functions_t storage_funcs = {
     .astarte_credentials_store = astarte_credentials_store,
     .astarte_credentials_fetch = astarte_credentials_fetch,
     .astarte_credentials_exists = astarte_credentials_exists,
     .astarte_credentials_remove = astarte_credentials_remove,
 };
+#endif
 
 static const astarte_credentials_storage_functions_t nvs_storage_funcs = {
     .astarte_credentials_store = astarte_credentials_nvs_store,
@@ -69,89 +130,218 @@ static const astarte_credentials_storage_functions_t nvs_storage_funcs = {
     .astarte_credentials_remove = astarte_credentials_nvs_remove,
 };
 
+static const astarte_credentials_storage_functions_t tlv_storage_funcs = {
+    .astarte_credentials_store = astarte_credentials_tlv_store,
+    .astarte_credentials_fetch = astarte_credentials_tlv_fetch,
+    .astarte_credentials_exists = astarte_credentials_tlv_exists,
+    .astarte_credentials_remove = astarte_credentials_tlv_remove,
+};
+
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
+static const astarte_credentials_storage_functions_t fat_ns_storage_funcs = {
+    .astarte_credentials_store = fat_ns_store,
+    .astarte_credentials_fetch = fat_ns_fetch,
+    .astarte_credentials_exists = fat_ns_exists,
+    .astarte_credentials_remove = fat_ns_remove,
+};
+#endif
+
+static const astarte_credentials_storage_functions_t nvs_ns_storage_funcs = {
+    .astarte_credentials_store = nvs_ns_store,
+    .astarte_credentials_fetch = nvs_ns_fetch,
+    .astarte_credentials_exists = nvs_ns_exists,
+    .astarte_credentials_remove = nvs_ns_remove,
+};
+
+static const astarte_credentials_storage_functions_t tlv_ns_storage_funcs = {
+    .astarte_credentials_store = tlv_ns_store,
+    .astarte_credentials_fetch = tlv_ns_fetch,
+    .astarte_credentials_exists = tlv_ns_exists,
+    .astarte_credentials_remove = tlv_ns_remove,
+};
+
 static astarte_credentials_context_t creds_ctx = {
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
     .functions = &storage_funcs,
     .opaque = NULL,
+#else
+    .functions = &tlv_storage_funcs,
+    .opaque = CONFIG_ASTARTE_CREDENTIALS_TLV_PARTITION_LABEL,
+#endif
+    .secret_partition_label = NULL,
+    .secret_namespace = NULL,
 };
 
-void credentials_init_task(void *ctx)
+static astarte_credentials_context_t *resolve_ctx(astarte_credentials_context_t *ctx)
 {
-    (void) ctx;
+    return ctx ? ctx : &creds_ctx;
+}
 
-    astarte_err_t res = ASTARTE_ERR;
-    if (!astarte_credentials_has_key()) {
+static astarte_err_t generate_credentials(astarte_credentials_context_t *ctx)
+{
+    astarte_err_t res = ASTARTE_OK;
+    if (!astarte_credentials_ctx_has_key(ctx)) {
         ESP_LOGD(TAG, "Private key not found, creating it.");
-        res = astarte_credentials_create_key();
+        res = astarte_credentials_ctx_create_key(ctx);
         if (res != ASTARTE_OK) {
-            xQueueSend(s_init_result_queue, &res, portMAX_DELAY);
-            vTaskDelete(NULL);
-            return;
+            return res;
         }
     }
 
-    if (!astarte_credentials_has_csr()) {
+    if (!astarte_credentials_ctx_has_csr(ctx)) {
         ESP_LOGD(TAG, "CSR not found, creating it.");
-        res = astarte_credentials_create_csr();
-        if (res != ASTARTE_OK) {
-            xQueueSend(s_init_result_queue, &res, portMAX_DELAY);
-            vTaskDelete(NULL);
-            return;
-        }
+        res = astarte_credentials_ctx_create_csr(ctx);
     }
 
-    res = ASTARTE_OK;
-    xQueueSend(s_init_result_queue, &res, portMAX_DELAY);
-    vTaskDelete(NULL);
+    return res;
 }
 
-astarte_err_t astarte_credentials_init()
+static void notify_init_completion(astarte_credentials_context_t *ctx,
+    const astarte_credentials_init_config_t *config, astarte_err_t result)
 {
-    // astarte_credentials_is_initialized may mount filesystem as side effect
-    if (astarte_credentials_is_initialized()) {
-        return ASTARTE_OK;
+    if (config->event_group) {
+        EventBits_t bits = config->done_bits;
+        if (result != ASTARTE_OK) {
+            bits |= config->error_bits;
+        }
+        xEventGroupSetBits(config->event_group, bits);
     }
+    if (config->callback) {
+        config->callback(ctx, result, config->user_data);
+    }
+}
 
-    if (!s_init_result_queue) {
-        s_init_result_queue = xQueueCreate(1, sizeof(astarte_err_t));
-        if (!s_init_result_queue) {
-            ESP_LOGE(TAG, "Cannot initialize s_init_result_queue");
-            return ASTARTE_ERR;
-        }
+void credentials_init_task(void *args)
+{
+    credentials_init_task_args_t *init_args = args;
+
+    astarte_err_t res = generate_credentials(init_args->ctx);
+    if (init_args->result_queue) {
+        xQueueSend(init_args->result_queue, &res, portMAX_DELAY);
+    } else {
+        // Asynchronous initializations own their arguments
+        notify_init_completion(init_args->ctx, &init_args->config, res);
+        astarte_alloc_free(init_args);
     }
 
+    vTaskDelete(NULL);
+}
+
+static astarte_err_t start_init_task(
+    credentials_init_task_args_t *init_args, UBaseType_t priority, int core_id)
+{
     TaskHandle_t task_handle = NULL;
-    const configSTACK_DEPTH_TYPE stack_depth = 16384;
-    xTaskCreate(credentials_init_task, "credentials_init_task", stack_depth, NULL, tskIDLE_PRIORITY,
-        &task_handle);
+    xTaskCreatePinnedToCore(credentials_init_task, "credentials_init_task",
+        CREDENTIALS_INIT_TASK_STACK_DEPTH, init_args, priority, &task_handle,
+        (core_id < 0) ? tskNO_AFFINITY : core_id);
     if (!task_handle) {
         ESP_LOGE(TAG, "Cannot create credentials_init_task");
         return ASTARTE_ERR;
     }
 
-    astarte_err_t result = ASTARTE_OK;
-    xQueueReceive(s_init_result_queue, &result, portMAX_DELAY);
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_credentials_init()
+{
+    return astarte_credentials_ctx_init(&creds_ctx);
+}
+
+astarte_err_t astarte_credentials_ctx_init(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+
+    // astarte_credentials_ctx_is_initialized may mount filesystem as side effect
+    if (astarte_credentials_ctx_is_initialized(ctx)) {
+        return ASTARTE_OK;
+    }
+
+    // Each call owns its result queue, so that several contexts can be initialized concurrently
+    credentials_init_task_args_t init_args = {
+        .ctx = ctx,
+        .result_queue = xQueueCreate(1, sizeof(astarte_err_t)),
+    };
+    if (!init_args.result_queue) {
+        ESP_LOGE(TAG, "Cannot initialize credentials init result queue");
+        return ASTARTE_ERR;
+    }
+
+    const UBaseType_t priority = CONFIG_ASTARTE_CREDENTIALS_INIT_TASK_PRIORITY;
+    const int core_id = CONFIG_ASTARTE_CREDENTIALS_INIT_TASK_CORE_ID;
+    astarte_err_t result = start_init_task(&init_args, priority, core_id);
+    if (result == ASTARTE_OK) {
+        xQueueReceive(init_args.result_queue, &result, portMAX_DELAY);
+    }
+    vQueueDelete(init_args.result_queue);
 
     return result;
 }
 
+astarte_err_t astarte_credentials_ctx_init_async(
+    astarte_credentials_context_t *ctx, const astarte_credentials_init_config_t *config)
+{
+    ctx = resolve_ctx(ctx);
+
+    // astarte_credentials_ctx_is_initialized may mount filesystem as side effect
+    if (astarte_credentials_ctx_is_initialized(ctx)) {
+        notify_init_completion(ctx, config, ASTARTE_OK);
+        return ASTARTE_OK;
+    }
+
+    credentials_init_task_args_t *init_args = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, 1, sizeof(credentials_init_task_args_t));
+    if (!init_args) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    init_args->ctx = ctx;
+    init_args->config = *config;
+
+    astarte_err_t res = start_init_task(init_args, config->task_priority, config->task_core_id);
+    if (res != ASTARTE_OK) {
+        astarte_alloc_free(init_args);
+    }
+
+    return res;
+}
+
 bool astarte_credentials_is_initialized()
 {
+    return astarte_credentials_ctx_is_initialized(&creds_ctx);
+}
+
+bool astarte_credentials_ctx_is_initialized(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
     // use automount when using default storage functions
-    if (creds_ctx.functions == &storage_funcs) {
+    if (ctx->functions == &storage_funcs || ctx->functions == &fat_ns_storage_funcs) {
         // automount must be kept for compatibility reasons
-        astarte_err_t err = ensure_mounted();
+        const char *device_namespace = NULL;
+        if (ctx->functions == &fat_ns_storage_funcs) {
+            device_namespace = ((credentials_ns_storage_t *) ctx->opaque)->device_namespace;
+        }
+        astarte_err_t err = ensure_mounted(device_namespace);
         if (err != ASTARTE_OK) {
             return false;
         }
     }
+#endif
 
-    return astarte_credentials_has_key() && astarte_credentials_has_csr();
+    return astarte_credentials_ctx_has_key(ctx) && astarte_credentials_ctx_has_csr(ctx);
 }
 
 astarte_err_t astarte_credentials_set_storage_context(astarte_credentials_context_t *creds_context)
 {
     creds_ctx.functions = creds_context->functions;
     creds_ctx.opaque = creds_context->opaque;
+    if (creds_context->secret_partition_label) {
+        creds_ctx.secret_partition_label = creds_context->secret_partition_label;
+    }
+    if (creds_context->secret_namespace) {
+        creds_ctx.secret_namespace = creds_context->secret_namespace;
+    }
 
     return ASTARTE_OK;
 }
@@ -160,9 +350,10 @@ astarte_err_t astarte_credentials_use_nvs_storage(const char *partition_label)
 {
     creds_ctx.functions = &nvs_storage_funcs;
     if (partition_label) {
-        creds_ctx.opaque = strdup(partition_label);
+        creds_ctx.opaque
+            = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, partition_label);
         // Use the partition label also for the credentials secret
-        s_credentials_secret_partition_label = creds_ctx.opaque;
+        creds_ctx.secret_partition_label = creds_ctx.opaque;
     } else {
         creds_ctx.opaque = NVS_DEFAULT_PART_NAME;
     }
@@ -170,27 +361,187 @@ astarte_err_t astarte_credentials_use_nvs_storage(const char *partition_label)
     return ASTARTE_OK;
 }
 
-static const char *astarte_credentials_filesystem_path(credential_type_t cred_type)
+astarte_err_t astarte_credentials_use_tlv_storage(const char *partition_label)
+{
+    if (!partition_label) {
+        ESP_LOGE(TAG, "A partition label is required for the TLV storage");
+        return ASTARTE_ERR;
+    }
+
+    char *label = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, partition_label);
+    if (!label) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    creds_ctx.functions = &tlv_storage_funcs;
+    creds_ctx.opaque = label;
+
+    return ASTARTE_OK;
+}
+
+static credentials_ns_storage_t *new_ns_storage(const char *device_namespace)
+{
+    size_t ns_len = device_namespace ? strlen(device_namespace) : 0;
+    if ((ns_len == 0) || (ns_len > ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN)) {
+        ESP_LOGE(TAG, "Invalid device namespace length: %zu", ns_len);
+        return NULL;
+    }
+    for (size_t i = 0; i < ns_len; i++) {
+        char c = device_namespace[i];
+        if (!((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9'))) {
+            ESP_LOGE(TAG, "Device namespace %s must be alphanumeric", device_namespace);
+            return NULL;
+        }
+    }
+
+    credentials_ns_storage_t *storage = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, 1, sizeof(credentials_ns_storage_t));
+    if (!storage) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
+    strncpy(storage->device_namespace, device_namespace, ASTARTE_CREDENTIALS_NAMESPACE_MAX_LEN);
+
+    return storage;
+}
+
+astarte_err_t astarte_credentials_ctx_use_fat_storage(
+    astarte_credentials_context_t *ctx, const char *device_namespace)
+{
+#ifndef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
+    (void) ctx;
+    (void) device_namespace;
+    ESP_LOGE(TAG, "FAT storage disabled, enable CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE to use it");
+    return ASTARTE_ERR;
+#else
+    credentials_ns_storage_t *storage = new_ns_storage(device_namespace);
+    if (!storage) {
+        return ASTARTE_ERR;
+    }
+
+    ctx->functions = &fat_ns_storage_funcs;
+    ctx->opaque = storage;
+    ctx->secret_partition_label = NULL;
+    ctx->secret_namespace = storage->device_namespace;
+
+    return ASTARTE_OK;
+#endif
+}
+
+astarte_err_t astarte_credentials_ctx_use_nvs_storage(
+    astarte_credentials_context_t *ctx, const char *partition_label, const char *device_namespace)
+{
+    credentials_ns_storage_t *storage = new_ns_storage(device_namespace);
+    if (!storage) {
+        return ASTARTE_ERR;
+    }
+
+    storage->partition_label = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS,
+        partition_label ? partition_label : NVS_DEFAULT_PART_NAME);
+    if (!storage->partition_label) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        astarte_alloc_free(storage);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    ctx->functions = &nvs_ns_storage_funcs;
+    ctx->opaque = storage;
+    ctx->secret_partition_label = storage->partition_label;
+    ctx->secret_namespace = storage->device_namespace;
+
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_credentials_ctx_use_tlv_storage(
+    astarte_credentials_context_t *ctx, const char *partition_label, const char *device_namespace)
+{
+    if (!partition_label) {
+        ESP_LOGE(TAG, "A partition label is required for the TLV storage");
+        return ASTARTE_ERR;
+    }
+
+    credentials_ns_storage_t *storage = new_ns_storage(device_namespace);
+    if (!storage) {
+        return ASTARTE_ERR;
+    }
+
+    storage->partition_label
+        = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, partition_label);
+    if (!storage->partition_label) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        astarte_alloc_free(storage);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    ctx->functions = &tlv_ns_storage_funcs;
+    ctx->opaque = storage;
+    // The credentials secret is kept in the default NVS partition
+    ctx->secret_partition_label = NULL;
+    ctx->secret_namespace = storage->device_namespace;
+
+    return ASTARTE_OK;
+}
+
+void astarte_credentials_ctx_release(astarte_credentials_context_t *ctx)
+{
+    if (!ctx || ctx == &creds_ctx) {
+        return;
+    }
+
+    if (
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
+        ctx->functions == &fat_ns_storage_funcs ||
+#endif
+        ctx->functions == &nvs_ns_storage_funcs || ctx->functions == &tlv_ns_storage_funcs) {
+        credentials_ns_storage_t *storage = ctx->opaque;
+        astarte_alloc_free(storage->partition_label);
+        astarte_alloc_free(storage);
+    }
+
+    ctx->functions = NULL;
+    ctx->opaque = NULL;
+    ctx->secret_partition_label = NULL;
+    ctx->secret_namespace = NULL;
+}
+
+#ifdef CONFIG_ASTARTE_CREDENTIALS_FAT_STORAGE
+static const char *astarte_credentials_filename(credential_type_t cred_type)
 {
     switch (cred_type) {
         case ASTARTE_CREDENTIALS_CSR:
-            return CSR_PATH;
+            return CSR_FILENAME;
         case ASTARTE_CREDENTIALS_KEY:
-            return PRIVKEY_PATH;
+            return PRIVKEY_FILENAME;
         case ASTARTE_CREDENTIALS_CERTIFICATE:
-            return CRT_PATH;
+            return CRT_FILENAME;
         default:
             return NULL;
     }
 }
 
-astarte_err_t astarte_credentials_store(
-    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+static bool astarte_credentials_filesystem_path(
+    const char *device_namespace, credential_type_t cred_type, char *out, size_t length)
 {
-    (void) opaque;
+    const char *filename = astarte_credentials_filename(cred_type);
+    if (!filename) {
+        return false;
+    }
+
+    int ret = 0;
+    if (device_namespace) {
+        ret = snprintf(out, length, CREDENTIALS_DIR_PATH "/%s/%s", device_namespace, filename);
+    } else {
+        ret = snprintf(out, length, CREDENTIALS_DIR_PATH "/%s", filename);
+    }
+
+    return (ret > 0) && (ret < length);
+}
 
-    const char *path = astarte_credentials_filesystem_path(cred_type);
-    if (!path) {
+static astarte_err_t filesystem_store(const char *device_namespace, credential_type_t cred_type,
+    const void *credential, size_t length)
+{
+    char path[CREDENTIAL_PATH_LENGTH];
+    if (!astarte_credentials_filesystem_path(device_namespace, cred_type, path, sizeof(path))) {
         return ASTARTE_ERR;
     }
 
@@ -215,13 +566,11 @@ astarte_err_t astarte_credentials_store(
     return ASTARTE_OK;
 }
 
-astarte_err_t astarte_credentials_fetch(
-    void *opaque, credential_type_t cred_type, char *out, size_t length)
+static astarte_err_t filesystem_fetch(
+    const char *device_namespace, credential_type_t cred_type, char *out, size_t length)
 {
-    (void) opaque;
-
-    const char *path = astarte_credentials_filesystem_path(cred_type);
-    if (!path) {
+    char path[CREDENTIAL_PATH_LENGTH];
+    if (!astarte_credentials_filesystem_path(device_namespace, cred_type, path, sizeof(path))) {
         return ASTARTE_ERR;
     }
 
@@ -245,29 +594,116 @@ astarte_err_t astarte_credentials_fetch(
     return ASTARTE_OK;
 }
 
-bool astarte_credentials_exists(void *opaque, credential_type_t cred_type)
+static bool filesystem_exists(const char *device_namespace, credential_type_t cred_type)
 {
-    (void) opaque;
-
-    const char *path = astarte_credentials_filesystem_path(cred_type);
-    if (!path) {
+    char path[CREDENTIAL_PATH_LENGTH];
+    if (!astarte_credentials_filesystem_path(device_namespace, cred_type, path, sizeof(path))) {
         return false;
     }
     return access(path, R_OK) == 0;
 }
 
+static astarte_err_t filesystem_remove(const char *device_namespace, credential_type_t cred_type)
+{
+    char path[CREDENTIAL_PATH_LENGTH];
+    if (!astarte_credentials_filesystem_path(device_namespace, cred_type, path, sizeof(path))) {
+        return ASTARTE_ERR;
+    }
+    return remove(path) == 0 ? ASTARTE_OK : ASTARTE_ERR;
+}
+
+astarte_err_t astarte_credentials_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    (void) opaque;
+    return filesystem_store(NULL, cred_type, credential, length);
+}
+
+astarte_err_t astarte_credentials_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    (void) opaque;
+    return filesystem_fetch(NULL, cred_type, out, length);
+}
+
+bool astarte_credentials_exists(void *opaque, credential_type_t cred_type)
+{
+    (void) opaque;
+    return filesystem_exists(NULL, cred_type);
+}
+
 astarte_err_t astarte_credentials_remove(void *opaque, credential_type_t cred_type)
 {
     (void) opaque;
+    return filesystem_remove(NULL, cred_type);
+}
 
-    const char *path = astarte_credentials_filesystem_path(cred_type);
-    if (!path) {
-        return ASTARTE_ERR;
+static astarte_err_t fat_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return filesystem_store(storage->device_namespace, cred_type, credential, length);
+}
+
+static astarte_err_t fat_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return filesystem_fetch(storage->device_namespace, cred_type, out, length);
+}
+
+static bool fat_ns_exists(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return filesystem_exists(storage->device_namespace, cred_type);
+}
+
+static astarte_err_t fat_ns_remove(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return filesystem_remove(storage->device_namespace, cred_type);
+}
+
+static astarte_err_t make_dir(const char *path)
+{
+    struct stat stats;
+    if (stat(path, &stats) == 0) {
+        return ASTARTE_OK;
     }
-    return remove(path) == 0 ? ASTARTE_OK : ASTARTE_ERR;
+
+    ESP_LOGD(TAG, "Directory %s doesn't exist, creating it", path);
+    // mkdir uses the same modes as chmod.
+    // This macro will give: read/write/execute permission for the user class and no permissions
+    // for group and others classes.
+    const mode_t mkdir_mode = 0700;
+    if (mkdir(path, mkdir_mode) < 0) {
+#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
+        ESP_LOGE(TAG, "Cannot create %s directory", path);
+        return ASTARTE_ERR_IO;
+#else
+        ESP_LOGD(TAG, "First attempt at creating %s directory failed", path);
+        esp_err_t err = esp_vfs_fat_spiflash_format_rw_wl(CREDENTIALS_MOUNTPOINT, PARTITION_NAME);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Failed to format FATFS (%s)", esp_err_to_name(err));
+            return ASTARTE_ERR_IO;
+        }
+        // Formatting wiped the parent directories too
+        if ((strcmp(path, CREDENTIALS_DIR_PATH) != 0)
+            && (mkdir(CREDENTIALS_DIR_PATH, mkdir_mode) < 0)) {
+            ESP_LOGE(TAG, "Cannot create %s directory", CREDENTIALS_DIR_PATH);
+            return ASTARTE_ERR_IO;
+        }
+        if (mkdir(path, mkdir_mode) < 0) {
+            ESP_LOGE(TAG, "Cannot create %s directory", path);
+            return ASTARTE_ERR_IO;
+        }
+#endif
+    }
+
+    return ASTARTE_OK;
 }
 
-static astarte_err_t ensure_mounted()
+static astarte_err_t ensure_mounted_locked(const char *device_namespace)
 {
     const esp_vfs_fat_mount_config_t mount_config = {
         .max_files = 4,
@@ -291,34 +727,33 @@ static astarte_err_t ensure_mounted()
         return ASTARTE_ERR_PARTITION_SCHEME;
     }
 
-    struct stat stats;
-    if (stat(CREDENTIALS_DIR_PATH, &stats) < 0) {
-        ESP_LOGD(TAG, "Directory %s doesn't exist, creating it", CREDENTIALS_DIR_PATH);
-        // mkdir uses the same modes as chmod.
-        // This macro will give: read/write/execute permission for the user class and no permissions
-        // for group and others classes.
-        const mode_t mkdir_mode = 0700;
-        if (mkdir(CREDENTIALS_DIR_PATH, mkdir_mode) < 0) {
-#if ESP_IDF_VERSION < ESP_IDF_VERSION_VAL(5, 1, 0)
-            ESP_LOGE(TAG, "Cannot create %s directory", CREDENTIALS_DIR_PATH);
-            return ASTARTE_ERR_IO;
-#else
-            ESP_LOGD(TAG, "First attempt at creating %s directory failed", CREDENTIALS_DIR_PATH);
-            err = esp_vfs_fat_spiflash_format_rw_wl(CREDENTIALS_MOUNTPOINT, PARTITION_NAME);
-            if (err != ESP_OK) {
-                ESP_LOGE(TAG, "Failed to format FATFS (%s)", esp_err_to_name(err));
-                return ASTARTE_ERR_IO;
-            }
-            if (mkdir(CREDENTIALS_DIR_PATH, mkdir_mode) < 0) {
-                ESP_LOGE(TAG, "Cannot create %s directory", CREDENTIALS_DIR_PATH);
-                return ASTARTE_ERR_IO;
-            }
-#endif
-        }
+    astarte_err_t res = make_dir(CREDENTIALS_DIR_PATH);
+    if ((res != ASTARTE_OK) || !device_namespace) {
+        return res;
     }
 
-    return ASTARTE_OK;
+    char device_dir_path[CREDENTIAL_PATH_LENGTH];
+    snprintf(device_dir_path, sizeof(device_dir_path), CREDENTIALS_DIR_PATH "/%s",
+        device_namespace);
+    return make_dir(device_dir_path);
+}
+
+static astarte_err_t ensure_mounted(const char *device_namespace)
+{
+    // The filesystem is shared by all the contexts, serialize only the mount and mkdir operations
+    taskENTER_CRITICAL(&s_mount_mutex_spinlock);
+    if (!s_mount_mutex) {
+        s_mount_mutex = xSemaphoreCreateMutexStatic(&s_mount_mutex_buffer);
+    }
+    taskEXIT_CRITICAL(&s_mount_mutex_spinlock);
+
+    xSemaphoreTake(s_mount_mutex, portMAX_DELAY);
+    astarte_err_t res = ensure_mounted_locked(device_namespace);
+    xSemaphoreGive(s_mount_mutex);
+
+    return res;
 }
+#endif
 
 astarte_err_t astarte_nvs_open_err_to_astarte(esp_err_t err)
 {
@@ -362,20 +797,28 @@ static const char *astarte_credentials_nvs_key(credential_type_t cred_type)
         case ASTARTE_CREDENTIALS_CSR:
             return "device.csr";
         case ASTARTE_CREDENTIALS_KEY:
-            return "device.key";
+            return PRIVKEY_FILENAME;
         case ASTARTE_CREDENTIALS_CERTIFICATE:
-            return "device.crt";
+            return CRT_FILENAME;
         default:
             return NULL;
     }
 }
 
-astarte_err_t astarte_credentials_nvs_store(
-    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+static bool nvs_credential_is_binary(credential_type_t cred_type)
 {
-    (void) length;
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    // The CSR is always kept in PEM form, since it's sent as is to Pairing API
+    return cred_type != ASTARTE_CREDENTIALS_CSR;
+#else
+    (void) cred_type;
+    return false;
+#endif
+}
 
-    const char *partition_label = opaque;
+static astarte_err_t nvs_store(const char *partition_label, const char *nvs_namespace,
+    credential_type_t cred_type, const void *credential, size_t length)
+{
     const char *key = astarte_credentials_nvs_key(cred_type);
     if (!key) {
         return ASTARTE_ERR;
@@ -383,12 +826,16 @@ astarte_err_t astarte_credentials_nvs_store(
 
     nvs_handle_t nvs = 0U;
     astarte_err_t res = astarte_nvs_open_err_to_astarte(
-        nvs_open_from_partition(partition_label, PAIRING_NAMESPACE, NVS_READWRITE, &nvs));
+        nvs_open_from_partition(partition_label, nvs_namespace, NVS_READWRITE, &nvs));
     if (res != ASTARTE_OK) {
         goto err;
     }
 
-    res = astarte_nvs_rw_err_to_astarte(nvs_set_str(nvs, key, credential));
+    if (nvs_credential_is_binary(cred_type)) {
+        res = astarte_nvs_rw_err_to_astarte(nvs_set_blob(nvs, key, credential, length));
+    } else {
+        res = astarte_nvs_rw_err_to_astarte(nvs_set_str(nvs, key, credential));
+    }
     nvs_close(nvs);
 
 err:
@@ -400,10 +847,9 @@ err:
     return ASTARTE_OK;
 }
 
-astarte_err_t astarte_credentials_nvs_fetch(
-    void *opaque, credential_type_t cred_type, char *out, size_t length)
+static astarte_err_t nvs_fetch(const char *partition_label, const char *nvs_namespace,
+    credential_type_t cred_type, char *out, size_t length)
 {
-    const char *partition_label = opaque;
     const char *key = astarte_credentials_nvs_key(cred_type);
     if (!key) {
         return ASTARTE_ERR;
@@ -411,24 +857,25 @@ astarte_err_t astarte_credentials_nvs_fetch(
 
     nvs_handle_t nvs = 0U;
     astarte_err_t res = astarte_nvs_open_err_to_astarte(
-        nvs_open_from_partition(partition_label, PAIRING_NAMESPACE, NVS_READONLY, &nvs));
+        nvs_open_from_partition(partition_label, nvs_namespace, NVS_READONLY, &nvs));
     if (res != ASTARTE_OK) {
         goto err;
     }
 
-    size_t len = 0U;
-    nvs_get_str(nvs, key, NULL, &len);
-
-    res = astarte_nvs_rw_err_to_astarte(nvs_get_str(nvs, key, out, &length));
+    if (nvs_credential_is_binary(cred_type)) {
+        res = astarte_nvs_rw_err_to_astarte(nvs_get_blob(nvs, key, out, &length));
+    } else {
+        res = astarte_nvs_rw_err_to_astarte(nvs_get_str(nvs, key, out, &length));
+    }
 
 err:
     nvs_close(nvs);
     return res;
 }
 
-bool astarte_credentials_nvs_exists(void *opaque, credential_type_t cred_type)
+static bool nvs_exists(
+    const char *partition_label, const char *nvs_namespace, credential_type_t cred_type)
 {
-    const char *partition_label = opaque;
     const char *key = astarte_credentials_nvs_key(cred_type);
     if (!key) {
         return false;
@@ -436,43 +883,251 @@ bool astarte_credentials_nvs_exists(void *opaque, credential_type_t cred_type)
 
     nvs_handle_t nvs = 0U;
     astarte_err_t res = astarte_nvs_open_err_to_astarte(
-        nvs_open_from_partition(partition_label, PAIRING_NAMESPACE, NVS_READONLY, &nvs));
+        nvs_open_from_partition(partition_label, nvs_namespace, NVS_READONLY, &nvs));
     if (res != ASTARTE_OK) {
         goto err;
     }
 
     size_t length = 0U;
-    res = astarte_nvs_rw_err_to_astarte(nvs_get_str(nvs, key, NULL, &length));
+    if (nvs_credential_is_binary(cred_type)) {
+        res = astarte_nvs_rw_err_to_astarte(nvs_get_blob(nvs, key, NULL, &length));
+    } else {
+        res = astarte_nvs_rw_err_to_astarte(nvs_get_str(nvs, key, NULL, &length));
+    }
 
 err:
     nvs_close(nvs);
     return res == ASTARTE_OK;
 }
 
-astarte_err_t astarte_credentials_nvs_remove(void *opaque, credential_type_t cred_type)
+static astarte_err_t nvs_remove(
+    const char *partition_label, const char *nvs_namespace, credential_type_t cred_type)
 {
-    const char *partition_label = opaque;
     const char *key = astarte_credentials_nvs_key(cred_type);
     if (!key) {
         return ASTARTE_ERR;
     }
 
-    nvs_handle_t nvs = 0U;
-    astarte_err_t res = astarte_nvs_open_err_to_astarte(
-        nvs_open_from_partition(partition_label, PAIRING_NAMESPACE, NVS_READWRITE, &nvs));
-    if (res != ASTARTE_OK) {
-        goto err;
+    nvs_handle_t nvs = 0U;
+    astarte_err_t res = astarte_nvs_open_err_to_astarte(
+        nvs_open_from_partition(partition_label, nvs_namespace, NVS_READWRITE, &nvs));
+    if (res != ASTARTE_OK) {
+        goto err;
+    }
+
+    res = nvs_erase_key(nvs, key);
+
+err:
+    nvs_close(nvs);
+    return res;
+}
+
+astarte_err_t astarte_credentials_nvs_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    return nvs_store(opaque, PAIRING_NAMESPACE, cred_type, credential, length);
+}
+
+astarte_err_t astarte_credentials_nvs_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    return nvs_fetch(opaque, PAIRING_NAMESPACE, cred_type, out, length);
+}
+
+bool astarte_credentials_nvs_exists(void *opaque, credential_type_t cred_type)
+{
+    return nvs_exists(opaque, PAIRING_NAMESPACE, cred_type);
+}
+
+astarte_err_t astarte_credentials_nvs_remove(void *opaque, credential_type_t cred_type)
+{
+    return nvs_remove(opaque, PAIRING_NAMESPACE, cred_type);
+}
+
+static astarte_err_t nvs_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return nvs_store(
+        storage->partition_label, storage->device_namespace, cred_type, credential, length);
+}
+
+static astarte_err_t nvs_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return nvs_fetch(storage->partition_label, storage->device_namespace, cred_type, out, length);
+}
+
+static bool nvs_ns_exists(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return nvs_exists(storage->partition_label, storage->device_namespace, cred_type);
+}
+
+static astarte_err_t nvs_ns_remove(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return nvs_remove(storage->partition_label, storage->device_namespace, cred_type);
+}
+
+static astarte_err_t tlv_ns_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return astarte_credentials_tlv_store(storage->partition_label, cred_type, credential, length);
+}
+
+static astarte_err_t tlv_ns_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return astarte_credentials_tlv_fetch(storage->partition_label, cred_type, out, length);
+}
+
+static bool tlv_ns_exists(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return astarte_credentials_tlv_exists(storage->partition_label, cred_type);
+}
+
+static astarte_err_t tlv_ns_remove(void *opaque, credential_type_t cred_type)
+{
+    credentials_ns_storage_t *storage = opaque;
+    return astarte_credentials_tlv_remove(storage->partition_label, cred_type);
+}
+
+// Length of a key or certificate read back from storage, in the form expected by mbedtls parsers
+static size_t stored_credential_length(const unsigned char *buffer, size_t size)
+{
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    // DER credentials are an ASN.1 SEQUENCE, whose header encodes the total length
+    unsigned char *p = (unsigned char *) buffer;
+    size_t len = 0;
+    if (mbedtls_asn1_get_tag(
+            &p, buffer + size, &len, MBEDTLS_ASN1_CONSTRUCTED | MBEDTLS_ASN1_SEQUENCE)
+        != 0) {
+        return 0;
+    }
+    return (p - buffer) + len;
+#else
+    // + 1 for NULL terminator, as per documentation
+    return strnlen((const char *) buffer, size - 1) + 1;
+#endif
+}
+
+static astarte_err_t parse_stored_key(astarte_credentials_context_t *ctx, mbedtls_pk_context *key,
+    int (*f_rng)(void *, unsigned char *, size_t), void *p_rng)
+{
+    astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
+
+    ESP_LOGD(TAG, "Loading the private key");
+    unsigned char *privkey_buffer = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, STORED_PRIVKEY_BUFFER_LENGTH, sizeof(unsigned char));
+    if (!privkey_buffer) {
+        ESP_LOGE(TAG, "Cannot allocate private key buffer");
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    astarte_err_t sres = funcs->astarte_credentials_fetch(ctx->opaque, ASTARTE_CREDENTIALS_KEY,
+        (char *) privkey_buffer, STORED_PRIVKEY_BUFFER_LENGTH);
+    if (sres != ASTARTE_OK) {
+        exit_code = sres;
+        ESP_LOGE(TAG, "Cannot load the private key");
+        goto exit;
+    }
+
+    size_t len = stored_credential_length(privkey_buffer, STORED_PRIVKEY_BUFFER_LENGTH);
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    int ret = mbedtls_pk_parse_key(key, privkey_buffer, len, NULL, 0, f_rng, p_rng);
+#else
+    (void) f_rng;
+    (void) p_rng;
+    int ret = mbedtls_pk_parse_key(key, privkey_buffer, len, NULL, 0);
+#endif
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_pk_parse_key returned %d", ret);
+        goto exit;
+    }
+    exit_code = ASTARTE_OK;
+
+exit:
+    astarte_alloc_free(privkey_buffer);
+
+    return exit_code;
+}
+
+static astarte_err_t parse_stored_certificate(
+    astarte_credentials_context_t *ctx, mbedtls_x509_crt *crt)
+{
+    astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
+
+    unsigned char *cert_buffer = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, CERT_LENGTH, sizeof(unsigned char));
+    if (!cert_buffer) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    astarte_err_t sres = funcs->astarte_credentials_fetch(
+        ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE, (char *) cert_buffer, CERT_LENGTH);
+    if (sres != ASTARTE_OK) {
+        exit_code = sres;
+        goto exit;
+    }
+
+    int ret = mbedtls_x509_crt_parse(
+        crt, cert_buffer, stored_credential_length(cert_buffer, CERT_LENGTH));
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_x509_crt_parse returned %d", ret);
+        goto exit;
+    }
+    exit_code = ASTARTE_OK;
+
+exit:
+    astarte_alloc_free(cert_buffer);
+
+    return exit_code;
+}
+
+static const mbedtls_x509_name *find_common_name(const mbedtls_x509_crt *crt)
+{
+    const mbedtls_x509_name *subj_it = &crt->subject;
+    while (subj_it && (MBEDTLS_OID_CMP(MBEDTLS_OID_AT_CN, &subj_it->oid) != 0)) {
+        subj_it = subj_it->next;
+    }
+
+    return subj_it;
+}
+
+static astarte_err_t copy_common_name(const mbedtls_x509_crt *crt, char *out, size_t length)
+{
+    const mbedtls_x509_name *subj_it = find_common_name(crt);
+    if (!subj_it) {
+        ESP_LOGE(TAG, "CN not found in certificate");
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+
+    int ret = snprintf(out, length, "%.*s", subj_it->val.len, subj_it->val.p);
+    if ((ret < 0) || (ret >= length)) {
+        ESP_LOGE(TAG, "Error encoding certificate common name");
+        return ASTARTE_ERR;
     }
 
-    res = nvs_erase_key(nvs, key);
-
-err:
-    nvs_close(nvs);
-    return res;
+    return ASTARTE_OK;
 }
 
 astarte_err_t astarte_credentials_create_key()
 {
+    return astarte_credentials_ctx_create_key(&creds_ctx);
+}
+
+astarte_err_t astarte_credentials_ctx_create_key(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+
     astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
 
     mbedtls_pk_context key;
@@ -510,24 +1165,37 @@ astarte_err_t astarte_credentials_create_key()
 
     ESP_LOGD(TAG, "Key succesfully generated");
 
-    privkey_buffer = calloc(PRIVKEY_BUFFER_LENGTH, sizeof(unsigned char));
+    privkey_buffer = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, PRIVKEY_BUFFER_LENGTH, sizeof(unsigned char));
     if (!privkey_buffer) {
         exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Cannot allocate private key buffer");
         goto exit;
     }
 
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    // The DER key is written at the end of the buffer
+    ret = mbedtls_pk_write_key_der(&key, privkey_buffer, PRIVKEY_BUFFER_LENGTH);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "mbedtls_pk_write_key_der returned %d", ret);
+        goto exit;
+    }
+    size_t len = ret;
+    const unsigned char *privkey = privkey_buffer + PRIVKEY_BUFFER_LENGTH - len;
+#else
     ret = mbedtls_pk_write_key_pem(&key, privkey_buffer, PRIVKEY_BUFFER_LENGTH);
     if (ret != 0) {
         ESP_LOGE(TAG, "mbedtls_pk_write_key_pem returned %d", ret);
         goto exit;
     }
     size_t len = strlen((char *) privkey_buffer);
+    const unsigned char *privkey = privkey_buffer;
+#endif
 
     ESP_LOGD(TAG, "Saving the private key");
-    CREDS_STORAGE_FUNCS(funcs);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
     astarte_err_t sres = funcs->astarte_credentials_store(
-        creds_ctx.opaque, ASTARTE_CREDENTIALS_KEY, privkey_buffer, len);
+        ctx->opaque, ASTARTE_CREDENTIALS_KEY, privkey, len);
     if (sres != ASTARTE_OK) {
         exit_code = sres;
         ESP_LOGE(TAG, "Cannot store private");
@@ -535,19 +1203,21 @@ astarte_err_t astarte_credentials_create_key()
     }
 
     ESP_LOGD(TAG, "Private key succesfully saved.");
+#ifndef CONFIG_ASTARTE_CREDENTIALS_USE_DER
     // TODO: this is useful in this phase, remove it later
     ESP_LOGD(TAG, "%.*s", len, privkey_buffer);
+#endif
     exit_code = ASTARTE_OK;
 
     // Remove the CSR if present since the key is changed
     // We don't care if we fail since it could be not yet created
-    if (funcs->astarte_credentials_remove(creds_ctx.opaque, ASTARTE_CREDENTIALS_CSR)
+    if (funcs->astarte_credentials_remove(ctx->opaque, ASTARTE_CREDENTIALS_CSR)
         == ASTARTE_OK) {
         ESP_LOGD(TAG, "Deleted old CSR");
     }
 
 exit:
-    free(privkey_buffer);
+    astarte_alloc_free(privkey_buffer);
 
     mbedtls_pk_free(&key);
     mbedtls_ctr_drbg_free(&ctr_drbg);
@@ -558,13 +1228,19 @@ exit:
 
 astarte_err_t astarte_credentials_create_csr()
 {
+    return astarte_credentials_ctx_create_csr(&creds_ctx);
+}
+
+astarte_err_t astarte_credentials_ctx_create_csr(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+
     astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
 
     mbedtls_pk_context key;
     mbedtls_x509write_csr req;
     mbedtls_entropy_context entropy;
     mbedtls_ctr_drbg_context ctr_drbg;
-    unsigned char *privkey_buffer = NULL;
     unsigned char *csr_buffer = NULL;
     const char *pers = "astarte_credentials_create_csr";
 
@@ -591,37 +1267,16 @@ astarte_err_t astarte_credentials_create_csr()
         goto exit;
     }
 
-    ESP_LOGD(TAG, "Loading the private key");
-    privkey_buffer = calloc(PRIVKEY_BUFFER_LENGTH, sizeof(unsigned char));
-    if (!privkey_buffer) {
-        exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Cannot allocate private key buffer");
-        goto exit;
-    }
-
-    CREDS_STORAGE_FUNCS(funcs);
-    astarte_err_t sres = funcs->astarte_credentials_fetch(
-        creds_ctx.opaque, ASTARTE_CREDENTIALS_KEY, (char *) privkey_buffer, PRIVKEY_BUFFER_LENGTH);
+    astarte_err_t sres = parse_stored_key(ctx, &key, mbedtls_ctr_drbg_random, &ctr_drbg);
     if (sres != ASTARTE_OK) {
         exit_code = sres;
-        ESP_LOGE(TAG, "Cannot load the private key");
-        goto exit;
-    }
-
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-    ret = mbedtls_pk_parse_key(
-        &key, privkey_buffer, PRIVKEY_BUFFER_LENGTH, NULL, 0, mbedtls_ctr_drbg_random, &ctr_drbg);
-#else
-    ret = mbedtls_pk_parse_key(&key, privkey_buffer, PRIVKEY_BUFFER_LENGTH, NULL, 0);
-#endif
-    if (ret != 0) {
-        ESP_LOGE(TAG, "mbedtls_pk_parse_key returned %d", ret);
         goto exit;
     }
 
     mbedtls_x509write_csr_set_key(&req, &key);
 
-    csr_buffer = calloc(CSR_BUFFER_LENGTH, sizeof(unsigned char));
+    csr_buffer = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, CSR_BUFFER_LENGTH, sizeof(unsigned char));
     if (!csr_buffer) {
         exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Cannot allocate CSR buffer");
@@ -637,8 +1292,9 @@ astarte_err_t astarte_credentials_create_csr()
     size_t len = strlen((char *) csr_buffer);
 
     ESP_LOGD(TAG, "Saving the CSR");
+    CREDS_STORAGE_FUNCS(funcs, ctx);
     sres = funcs->astarte_credentials_store(
-        creds_ctx.opaque, ASTARTE_CREDENTIALS_CSR, csr_buffer, len);
+        ctx->opaque, ASTARTE_CREDENTIALS_CSR, csr_buffer, len);
     if (sres != ASTARTE_OK) {
         exit_code = sres;
         ESP_LOGE(TAG, "Cannot store the CSR");
@@ -651,8 +1307,7 @@ astarte_err_t astarte_credentials_create_csr()
     exit_code = ASTARTE_OK;
 
 exit:
-    free(csr_buffer);
-    free(privkey_buffer);
+    astarte_alloc_free(csr_buffer);
 
     mbedtls_x509write_csr_free(&req);
     mbedtls_pk_free(&key);
@@ -664,17 +1319,38 @@ exit:
 
 astarte_err_t astarte_credentials_save_certificate(const char *cert_pem)
 {
+    return astarte_credentials_ctx_save_certificate(&creds_ctx, cert_pem);
+}
+
+astarte_err_t astarte_credentials_ctx_save_certificate(
+    astarte_credentials_context_t *ctx, const char *cert_pem)
+{
+    ctx = resolve_ctx(ctx);
     if (!cert_pem) {
         ESP_LOGE(TAG, "cert_pem is NULL");
         return ASTARTE_ERR;
     }
 
-    size_t len = strlen(cert_pem);
-
     ESP_LOGD(TAG, "Saving the certificate");
-    CREDS_STORAGE_FUNCS(funcs);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
+
+    astarte_err_t sres = ASTARTE_ERR_MBED_TLS;
+    int ret = mbedtls_x509_crt_parse(&crt, (const unsigned char *) cert_pem, strlen(cert_pem) + 1);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_x509_crt_parse returned %d", ret);
+    } else {
+        // mbedtls keeps the DER encoding of the parsed certificate
+        sres = funcs->astarte_credentials_store(
+            ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE, crt.raw.p, crt.raw.len);
+    }
+    mbedtls_x509_crt_free(&crt);
+#else
     astarte_err_t sres = funcs->astarte_credentials_store(
-        creds_ctx.opaque, ASTARTE_CREDENTIALS_CERTIFICATE, cert_pem, len);
+        ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE, cert_pem, strlen(cert_pem));
+#endif
     if (sres != ASTARTE_OK) {
         return sres;
     }
@@ -684,10 +1360,16 @@ astarte_err_t astarte_credentials_save_certificate(const char *cert_pem)
 
 astarte_err_t astarte_credentials_delete_certificate()
 {
-    CREDS_STORAGE_FUNCS(funcs);
+    return astarte_credentials_ctx_delete_certificate(&creds_ctx);
+}
+
+astarte_err_t astarte_credentials_ctx_delete_certificate(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
 
     astarte_err_t ret
-        = funcs->astarte_credentials_remove(creds_ctx.opaque, ASTARTE_CREDENTIALS_CERTIFICATE);
+        = funcs->astarte_credentials_remove(ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE);
     if (ret != ASTARTE_OK) {
         ESP_LOGE(TAG, "certificate remove failed");
     }
@@ -697,15 +1379,50 @@ astarte_err_t astarte_credentials_delete_certificate()
 
 astarte_err_t astarte_credentials_get_csr(char *out, size_t length)
 {
-    CREDS_STORAGE_FUNCS(funcs);
-    return funcs->astarte_credentials_fetch(creds_ctx.opaque, ASTARTE_CREDENTIALS_CSR, out, length);
+    return astarte_credentials_ctx_get_csr(&creds_ctx, out, length);
+}
+
+astarte_err_t astarte_credentials_ctx_get_csr(
+    astarte_credentials_context_t *ctx, char *out, size_t length)
+{
+    ctx = resolve_ctx(ctx);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    return funcs->astarte_credentials_fetch(ctx->opaque, ASTARTE_CREDENTIALS_CSR, out, length);
 }
 
 astarte_err_t astarte_credentials_get_certificate(char *out, size_t length)
 {
-    CREDS_STORAGE_FUNCS(funcs);
+    return astarte_credentials_ctx_get_certificate(&creds_ctx, out, length);
+}
+
+astarte_err_t astarte_credentials_ctx_get_certificate(
+    astarte_credentials_context_t *ctx, char *out, size_t length)
+{
+    ctx = resolve_ctx(ctx);
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    // Convert back to PEM, as expected by the callers of this function
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
+
+    astarte_err_t exit_code = parse_stored_certificate(ctx, &crt);
+    if (exit_code == ASTARTE_OK) {
+        size_t olen = 0;
+        int ret = mbedtls_pem_write_buffer("-----BEGIN CERTIFICATE-----\n",
+            "-----END CERTIFICATE-----\n", crt.raw.p, crt.raw.len, (unsigned char *) out, length,
+            &olen);
+        if (ret != 0) {
+            ESP_LOGE(TAG, "mbedtls_pem_write_buffer returned %d", ret);
+            exit_code = ASTARTE_ERR_MBED_TLS;
+        }
+    }
+    mbedtls_x509_crt_free(&crt);
+
+    return exit_code;
+#else
+    CREDS_STORAGE_FUNCS(funcs, ctx);
     return funcs->astarte_credentials_fetch(
-        creds_ctx.opaque, ASTARTE_CREDENTIALS_CERTIFICATE, out, length);
+        ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE, out, length);
+#endif
 }
 
 astarte_err_t astarte_credentials_get_certificate_common_name(
@@ -722,42 +1439,204 @@ astarte_err_t astarte_credentials_get_certificate_common_name(
         goto exit;
     }
 
-    mbedtls_x509_name *subj_it = &crt.subject;
-    while (subj_it && (MBEDTLS_OID_CMP(MBEDTLS_OID_AT_CN, &subj_it->oid) != 0)) {
-        subj_it = subj_it->next;
+    exit_code = copy_common_name(&crt, out, length);
+
+exit:
+    mbedtls_x509_crt_free(&crt);
+
+    return exit_code;
+}
+
+astarte_err_t astarte_credentials_get_key(char *out, size_t length)
+{
+    return astarte_credentials_ctx_get_key(&creds_ctx, out, length);
+}
+
+astarte_err_t astarte_credentials_ctx_get_key(
+    astarte_credentials_context_t *ctx, char *out, size_t length)
+{
+    ctx = resolve_ctx(ctx);
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    // Convert back to PEM, as expected by the callers of this function
+    astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
+    mbedtls_pk_context key;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    const char *pers = "astarte_credentials_get_key";
+
+    mbedtls_pk_init(&key);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_entropy_init(&entropy);
+
+    int ret = mbedtls_ctr_drbg_seed(
+        &ctr_drbg, mbedtls_entropy_func, &entropy, (const unsigned char *) pers, strlen(pers));
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_ctr_drbg_seed returned %d", ret);
+        goto exit;
     }
 
-    if (!subj_it) {
-        ESP_LOGE(TAG, "CN not found in certificate");
-        exit_code = ASTARTE_ERR_NOT_FOUND;
+    exit_code = parse_stored_key(ctx, &key, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (exit_code != ASTARTE_OK) {
         goto exit;
     }
 
-    ret = snprintf(out, length, "%.*s", subj_it->val.len, subj_it->val.p);
-    if ((ret < 0) || (ret >= length)) {
-        ESP_LOGE(TAG, "Error encoding certificate common name");
-        exit_code = ASTARTE_ERR;
+    ret = mbedtls_pk_write_key_pem(&key, (unsigned char *) out, length);
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_pk_write_key_pem returned %d", ret);
+        exit_code = ASTARTE_ERR_MBED_TLS;
+    }
+
+exit:
+    mbedtls_pk_free(&key);
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+
+    return exit_code;
+#else
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    return funcs->astarte_credentials_fetch(ctx->opaque, ASTARTE_CREDENTIALS_KEY, out, length);
+#endif
+}
+
+astarte_err_t astarte_credentials_ctx_parse(
+    astarte_credentials_context_t *ctx, astarte_credentials_parsed_t *parsed)
+{
+    ctx = resolve_ctx(ctx);
+
+    astarte_err_t exit_code = ASTARTE_ERR_MBED_TLS;
+    mbedtls_pk_context key;
+    mbedtls_x509_crt certificate;
+    mbedtls_entropy_context entropy;
+    mbedtls_ctr_drbg_context ctr_drbg;
+    unsigned char *key_der_buffer = NULL;
+    const char *pers = "astarte_credentials_parse";
+
+    // Only the DER credentials handed to the TLS layer and the information extracted from them are
+    // kept, the mbedtls contexts are freed once done
+    memset(parsed, 0, sizeof(astarte_credentials_parsed_t));
+    mbedtls_pk_init(&key);
+    mbedtls_x509_crt_init(&certificate);
+    mbedtls_ctr_drbg_init(&ctr_drbg);
+    mbedtls_entropy_init(&entropy);
+
+    int ret = mbedtls_ctr_drbg_seed(
+        &ctr_drbg, mbedtls_entropy_func, &entropy, (const unsigned char *) pers, strlen(pers));
+    if (ret != 0) {
+        ESP_LOGE(TAG, "mbedtls_ctr_drbg_seed returned %d", ret);
+        goto exit;
+    }
+
+    exit_code = parse_stored_key(ctx, &key, mbedtls_ctr_drbg_random, &ctr_drbg);
+    if (exit_code != ASTARTE_OK) {
+        goto exit;
+    }
+
+    exit_code = parse_stored_certificate(ctx, &certificate);
+    if (exit_code != ASTARTE_OK) {
+        goto exit;
+    }
+
+    exit_code = copy_common_name(&certificate, parsed->common_name, CN_LENGTH);
+    if (exit_code != ASTARTE_OK) {
+        goto exit;
+    }
+    parsed->valid_to = certificate.valid_to;
+
+    parsed->certificate_der
+        = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, certificate.raw.len);
+    if (!parsed->certificate_der) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto exit;
+    }
+    memcpy(parsed->certificate_der, certificate.raw.p, certificate.raw.len);
+    parsed->certificate_der_len = certificate.raw.len;
+
+    // Hand the key to the TLS layer in DER form, skipping the PEM decoding at each handshake
+    key_der_buffer = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, PRIVKEY_DER_BUFFER_LENGTH, sizeof(unsigned char));
+    if (!key_der_buffer) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto exit;
+    }
+
+    // The DER key is written at the end of the buffer
+    ret = mbedtls_pk_write_key_der(&key, key_der_buffer, PRIVKEY_DER_BUFFER_LENGTH);
+    if (ret < 0) {
+        ESP_LOGE(TAG, "mbedtls_pk_write_key_der returned %d", ret);
+        exit_code = ASTARTE_ERR_MBED_TLS;
+        goto exit;
+    }
+
+    parsed->key_der = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, ret);
+    if (!parsed->key_der) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        exit_code = ASTARTE_ERR_OUT_OF_MEMORY;
         goto exit;
     }
+    memcpy(parsed->key_der, key_der_buffer + PRIVKEY_DER_BUFFER_LENGTH - ret, ret);
+    parsed->key_der_len = ret;
     exit_code = ASTARTE_OK;
 
 exit:
-    mbedtls_x509_crt_free(&crt);
+    if (key_der_buffer) {
+        // Don't leave key material around in the heap
+        memset(key_der_buffer, 0, PRIVKEY_DER_BUFFER_LENGTH);
+        astarte_alloc_free(key_der_buffer);
+    }
+    mbedtls_pk_free(&key);
+    mbedtls_x509_crt_free(&certificate);
+    mbedtls_ctr_drbg_free(&ctr_drbg);
+    mbedtls_entropy_free(&entropy);
+
+    if (exit_code != ASTARTE_OK) {
+        astarte_credentials_parsed_free(parsed);
+    }
 
     return exit_code;
 }
 
-astarte_err_t astarte_credentials_get_key(char *out, size_t length)
+void astarte_credentials_parsed_free(astarte_credentials_parsed_t *parsed)
+{
+    if (!parsed) {
+        return;
+    }
+
+    astarte_alloc_free(parsed->certificate_der);
+    parsed->certificate_der = NULL;
+    parsed->certificate_der_len = 0;
+    if (parsed->key_der) {
+        memset(parsed->key_der, 0, parsed->key_der_len);
+        astarte_alloc_free(parsed->key_der);
+    }
+    parsed->key_der = NULL;
+    parsed->key_der_len = 0;
+}
+
+static const char *secret_partition_label(const astarte_credentials_context_t *ctx)
 {
-    CREDS_STORAGE_FUNCS(funcs);
-    return funcs->astarte_credentials_fetch(creds_ctx.opaque, ASTARTE_CREDENTIALS_KEY, out, length);
+    return ctx->secret_partition_label ? ctx->secret_partition_label : NVS_DEFAULT_PART_NAME;
+}
+
+static const char *secret_namespace(const astarte_credentials_context_t *ctx)
+{
+    return ctx->secret_namespace ? ctx->secret_namespace : PAIRING_NAMESPACE;
 }
 
 astarte_err_t astarte_credentials_get_stored_credentials_secret(char *out, size_t length)
 {
+    return astarte_credentials_ctx_get_stored_credentials_secret(&creds_ctx, out, length);
+}
+
+astarte_err_t astarte_credentials_ctx_get_stored_credentials_secret(
+    astarte_credentials_context_t *ctx, char *out, size_t length)
+{
+    ctx = resolve_ctx(ctx);
+    const char *partition_label = secret_partition_label(ctx);
     nvs_handle_t nvs = 0U;
-    esp_err_t err = nvs_open_from_partition(
-        s_credentials_secret_partition_label, PAIRING_NAMESPACE, NVS_READONLY, &nvs);
+    esp_err_t err
+        = nvs_open_from_partition(partition_label, secret_namespace(ctx), NVS_READONLY, &nvs);
     switch (err) {
         // NVS_NOT_FOUND is ok if we don't have credentials_secret yet
         case ESP_ERR_NVS_NOT_FOUND:
@@ -794,9 +1673,17 @@ astarte_err_t astarte_credentials_get_stored_credentials_secret(char *out, size_
 
 astarte_err_t astarte_credentials_set_stored_credentials_secret(const char *credentials_secret)
 {
+    return astarte_credentials_ctx_set_stored_credentials_secret(&creds_ctx, credentials_secret);
+}
+
+astarte_err_t astarte_credentials_ctx_set_stored_credentials_secret(
+    astarte_credentials_context_t *ctx, const char *credentials_secret)
+{
+    ctx = resolve_ctx(ctx);
+    const char *partition_label = secret_partition_label(ctx);
     nvs_handle_t nvs = 0U;
-    esp_err_t err = nvs_open_from_partition(
-        s_credentials_secret_partition_label, PAIRING_NAMESPACE, NVS_READWRITE, &nvs);
+    esp_err_t err
+        = nvs_open_from_partition(partition_label, secret_namespace(ctx), NVS_READWRITE, &nvs);
     switch (err) {
         case ESP_OK:
             break;
@@ -824,9 +1711,17 @@ astarte_err_t astarte_credentials_set_stored_credentials_secret(const char *cred
 
 astarte_err_t astarte_credentials_erase_stored_credentials_secret()
 {
+    return astarte_credentials_ctx_erase_stored_credentials_secret(&creds_ctx);
+}
+
+astarte_err_t astarte_credentials_ctx_erase_stored_credentials_secret(
+    astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+    const char *partition_label = secret_partition_label(ctx);
     nvs_handle_t nvs = 0U;
-    esp_err_t err = nvs_open_from_partition(
-        s_credentials_secret_partition_label, PAIRING_NAMESPACE, NVS_READWRITE, &nvs);
+    esp_err_t err
+        = nvs_open_from_partition(partition_label, secret_namespace(ctx), NVS_READWRITE, &nvs);
     switch (err) {
         case ESP_OK:
             break;
@@ -862,57 +1757,177 @@ astarte_err_t astarte_credentials_erase_stored_credentials_secret()
 
 bool astarte_credentials_has_certificate()
 {
-    CREDS_STORAGE_FUNCS(funcs);
-    if (!funcs->astarte_credentials_exists(creds_ctx.opaque, ASTARTE_CREDENTIALS_CERTIFICATE)) {
+    return astarte_credentials_ctx_has_certificate(&creds_ctx);
+}
+
+bool astarte_credentials_ctx_has_certificate(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    if (!funcs->astarte_credentials_exists(ctx->opaque, ASTARTE_CREDENTIALS_CERTIFICATE)) {
         return false;
     }
 
-    astarte_err_t astarte_ret = ASTARTE_ERR;
-    char *client_crt_cn = NULL;
-
-    char *client_crt_pem = calloc(CERT_LENGTH, sizeof(char));
-    if (!client_crt_pem) {
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        astarte_ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        goto exit;
-    }
+    mbedtls_x509_crt crt;
+    mbedtls_x509_crt_init(&crt);
 
-    astarte_ret = astarte_credentials_get_certificate(client_crt_pem, CERT_LENGTH);
+    astarte_err_t astarte_ret = parse_stored_certificate(ctx, &crt);
     if (astarte_ret != ASTARTE_OK) {
-        ESP_LOGE(TAG, "astarte_credentials_get_certificate returned %d", astarte_ret);
-        goto exit;
-    }
-
-    client_crt_cn = calloc(CN_LENGTH, sizeof(char));
-    if (!client_crt_cn) {
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        ESP_LOGE(TAG, "Cannot parse the stored certificate: %d", astarte_ret);
         goto exit;
     }
 
-    astarte_ret
-        = astarte_credentials_get_certificate_common_name(client_crt_pem, client_crt_cn, CN_LENGTH);
-    if (astarte_ret != ASTARTE_OK) {
-        ESP_LOGE(TAG, "astarte_credentials_get_certificate_common_name returned %d", astarte_ret);
-        goto exit;
+    if (!find_common_name(&crt)) {
+        ESP_LOGE(TAG, "CN not found in certificate");
+        astarte_ret = ASTARTE_ERR_NOT_FOUND;
     }
 
-    astarte_ret = ASTARTE_OK;
-
 exit:
-    free(client_crt_pem);
-    free(client_crt_cn);
+    mbedtls_x509_crt_free(&crt);
 
     return astarte_ret == ASTARTE_OK;
 }
 
 bool astarte_credentials_has_csr()
 {
-    CREDS_STORAGE_FUNCS(funcs);
-    return funcs->astarte_credentials_exists(creds_ctx.opaque, ASTARTE_CREDENTIALS_CSR);
+    return astarte_credentials_ctx_has_csr(&creds_ctx);
+}
+
+bool astarte_credentials_ctx_has_csr(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    return funcs->astarte_credentials_exists(ctx->opaque, ASTARTE_CREDENTIALS_CSR);
 }
 
 bool astarte_credentials_has_key()
 {
-    CREDS_STORAGE_FUNCS(funcs);
-    return funcs->astarte_credentials_exists(creds_ctx.opaque, ASTARTE_CREDENTIALS_KEY);
+    return astarte_credentials_ctx_has_key(&creds_ctx);
+}
+
+bool astarte_credentials_ctx_has_key(astarte_credentials_context_t *ctx)
+{
+    ctx = resolve_ctx(ctx);
+    CREDS_STORAGE_FUNCS(funcs, ctx);
+    return funcs->astarte_credentials_exists(ctx->opaque, ASTARTE_CREDENTIALS_KEY);
+}
+
+// Length of a credential read back with a storage fetch function, as it has to be stored again
+static size_t fetched_credential_length(
+    credential_type_t cred_type, const char *buffer, size_t size)
+{
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+    if (cred_type != ASTARTE_CREDENTIALS_CSR) {
+        return stored_credential_length((const unsigned char *) buffer, size);
+    }
+#endif
+    // PEM credentials are stored without the NULL terminator
+    return strnlen(buffer, size);
+}
+
+astarte_err_t astarte_credentials_ctx_migrate(
+    astarte_credentials_context_t *from, astarte_credentials_context_t *to, bool remove_source)
+{
+    const credential_type_t cred_types[]
+        = { ASTARTE_CREDENTIALS_KEY, ASTARTE_CREDENTIALS_CSR, ASTARTE_CREDENTIALS_CERTIFICATE };
+    const size_t cred_types_len = sizeof(cred_types) / sizeof(cred_types[0]);
+    astarte_err_t res = ASTARTE_OK;
+    char *source = NULL;
+    char *readback = NULL;
+    int64_t source_read_us = 0;
+    int64_t destination_read_us = 0;
+
+    from = resolve_ctx(from);
+    to = resolve_ctx(to);
+    if (from == to) {
+        ESP_LOGE(TAG, "Source and destination credentials contexts must be different");
+        return ASTARTE_ERR;
+    }
+
+    // This also mounts the filesystem for the FAT backends
+    if (!astarte_credentials_ctx_is_initialized(from)) {
+        ESP_LOGI(TAG, "No credentials to migrate");
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+    astarte_credentials_ctx_is_initialized(to);
+
+    source = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, PRIVKEY_BUFFER_LENGTH, sizeof(char));
+    readback = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, PRIVKEY_BUFFER_LENGTH, sizeof(char));
+    if (!source || !readback) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        res = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto exit;
+    }
+
+    CREDS_STORAGE_FUNCS(from_funcs, from);
+    CREDS_STORAGE_FUNCS(to_funcs, to);
+    for (size_t i = 0; i < cred_types_len; i++) {
+        credential_type_t cred_type = cred_types[i];
+        // The certificate is missing until the device has been paired
+        if (!from_funcs->astarte_credentials_exists(from->opaque, cred_type)) {
+            continue;
+        }
+
+        // The fetch functions don't terminate what they read, nor return its length: the PEM
+        // lengths are found by the terminators left by zeroing the buffers
+        memset(source, 0, PRIVKEY_BUFFER_LENGTH);
+        memset(readback, 0, PRIVKEY_BUFFER_LENGTH);
+        int64_t start_us = esp_timer_get_time();
+        res = from_funcs->astarte_credentials_fetch(
+            from->opaque, cred_type, source, PRIVKEY_BUFFER_LENGTH);
+        source_read_us += esp_timer_get_time() - start_us;
+        if (res != ASTARTE_OK) {
+            ESP_LOGE(TAG, "Cannot read credential %d from the source storage", cred_type);
+            goto exit;
+        }
+
+        size_t len = fetched_credential_length(cred_type, source, PRIVKEY_BUFFER_LENGTH);
+        res = to_funcs->astarte_credentials_store(to->opaque, cred_type, source, len);
+        if (res != ASTARTE_OK) {
+            ESP_LOGE(TAG, "Cannot store credential %d in the destination storage", cred_type);
+            goto exit;
+        }
+
+        start_us = esp_timer_get_time();
+        res = to_funcs->astarte_credentials_fetch(
+            to->opaque, cred_type, readback, PRIVKEY_BUFFER_LENGTH);
+        destination_read_us += esp_timer_get_time() - start_us;
+        if (res != ASTARTE_OK) {
+            ESP_LOGE(TAG, "Cannot read back credential %d", cred_type);
+            goto exit;
+        }
+        if ((fetched_credential_length(cred_type, readback, PRIVKEY_BUFFER_LENGTH) != len)
+            || (memcmp(source, readback, len) != 0)) {
+            ESP_LOGE(TAG, "Credential %d read back doesn't match the source", cred_type);
+            res = ASTARTE_ERR;
+            goto exit;
+        }
+    }
+
+    ESP_LOGI(TAG, "Credentials migrated, read time: source %lld us, destination %lld us",
+        (long long) source_read_us, (long long) destination_read_us);
+
+    if (remove_source) {
+        for (size_t i = 0; i < cred_types_len; i++) {
+            if (from_funcs->astarte_credentials_exists(from->opaque, cred_types[i])
+                && (from_funcs->astarte_credentials_remove(from->opaque, cred_types[i])
+                    != ASTARTE_OK)) {
+                ESP_LOGW(TAG, "Cannot remove credential %d from the source", cred_types[i]);
+            }
+        }
+    }
+
+exit:
+    // Don't leave key material around in the heap
+    if (source) {
+        memset(source, 0, PRIVKEY_BUFFER_LENGTH);
+        astarte_alloc_free(source);
+    }
+    if (readback) {
+        memset(readback, 0, PRIVKEY_BUFFER_LENGTH);
+        astarte_alloc_free(readback);
+    }
+    return res;
 }
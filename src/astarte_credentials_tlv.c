@@ -0,0 +1,431 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_credentials.h>
+
+#include <astarte_alloc.h>
+#include <astarte_tlv.h>
+
+#include <esp_log.h>
+#include <esp_partition.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+#include <inttypes.h>
+#include <stdlib.h>
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_CREDENTIALS_TLV"
+
+// Each slot starts on an erase sector boundary, so it can be erased without touching the other one
+#define SLOT_ALIGNMENT 4096U
+// Writes to encrypted partitions must be aligned to the AES block size
+#define WRITE_ALIGNMENT 16U
+#define ALIGN_UP(VALUE, ALIGNMENT) (((VALUE) + (ALIGNMENT) -1U) & ~((ALIGNMENT) -1U))
+
+#define SLOTS_NUMBER 2
+
+// DER keys and certificates use their own record types, so that toggling the format regenerates
+// them instead of failing to parse the old ones
+#define DER_RECORD_TYPE_FLAG 0x80U
+#ifdef CONFIG_ASTARTE_CREDENTIALS_USE_DER
+#define DER_CREDENTIALS true
+#else
+#define DER_CREDENTIALS false
+#endif
+
+typedef struct
+{
+    const esp_partition_t *partition;
+    size_t slot_size;
+    int active;
+    astarte_tlv_header_t header;
+    uint8_t *payload;
+} tlv_slot_t;
+
+static StaticSemaphore_t s_tlv_mutex_buffer;
+static SemaphoreHandle_t s_tlv_mutex = NULL;
+static portMUX_TYPE s_tlv_mutex_spinlock = portMUX_INITIALIZER_UNLOCKED;
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void tlv_lock(void);
+static void tlv_unlock(void);
+static astarte_err_t load_active_slot(const char *partition_label, tlv_slot_t *slot);
+static astarte_err_t load_payload(tlv_slot_t *slot, int index, const astarte_tlv_header_t *header);
+static astarte_err_t commit_slot(tlv_slot_t *slot, uint8_t *payload, size_t payload_len);
+static void release_slot(tlv_slot_t *slot);
+static uint8_t record_type(credential_type_t cred_type, bool der);
+static astarte_err_t drop_other_format(
+    credential_type_t cred_type, uint8_t *payload, size_t payload_size, size_t *payload_len);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_credentials_tlv_store(
+    void *opaque, credential_type_t cred_type, const void *credential, size_t length)
+{
+    const char *partition_label = opaque;
+    tlv_slot_t slot;
+    uint8_t *new_payload = NULL;
+    size_t new_payload_size = 0;
+
+    tlv_lock();
+    astarte_err_t res = load_active_slot(partition_label, &slot);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    // Allocate enough space for the worst case, the padding is kept zeroed
+    new_payload_size = ALIGN_UP(
+        slot.header.payload_len + ASTARTE_TLV_RECORD_HEADER_SIZE + length, WRITE_ALIGNMENT);
+    new_payload = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, new_payload_size, sizeof(uint8_t));
+    if (!new_payload) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        res = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto exit;
+    }
+
+    size_t new_payload_len = 0;
+    res = astarte_tlv_update(slot.payload, slot.header.payload_len,
+        record_type(cred_type, DER_CREDENTIALS), credential, length, new_payload,
+        new_payload_size, &new_payload_len);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+    res = drop_other_format(cred_type, new_payload, new_payload_size, &new_payload_len);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    res = commit_slot(&slot, new_payload, new_payload_len);
+
+exit:
+    if (new_payload) {
+        // Don't leave key material around in the heap
+        memset(new_payload, 0, new_payload_size);
+        astarte_alloc_free(new_payload);
+    }
+    release_slot(&slot);
+    tlv_unlock();
+    return res;
+}
+
+astarte_err_t astarte_credentials_tlv_fetch(
+    void *opaque, credential_type_t cred_type, char *out, size_t length)
+{
+    const char *partition_label = opaque;
+    tlv_slot_t slot;
+
+    tlv_lock();
+    astarte_err_t res = load_active_slot(partition_label, &slot);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    const uint8_t *value = NULL;
+    size_t value_len = 0;
+    res = astarte_tlv_find(slot.payload, slot.header.payload_len,
+        record_type(cred_type, DER_CREDENTIALS), &value, &value_len);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    // Leave room for the NULL terminator, since PEM credentials are stored without it
+    if (value_len >= length) {
+        ESP_LOGE(TAG, "Buffer too small for credential %d: %zu", cred_type, value_len);
+        res = ASTARTE_ERR_INVALID_SIZE;
+        goto exit;
+    }
+    memcpy(out, value, value_len);
+    out[value_len] = '\0';
+
+exit:
+    release_slot(&slot);
+    tlv_unlock();
+    return res;
+}
+
+bool astarte_credentials_tlv_exists(void *opaque, credential_type_t cred_type)
+{
+    const char *partition_label = opaque;
+    tlv_slot_t slot;
+
+    tlv_lock();
+    astarte_err_t res = load_active_slot(partition_label, &slot);
+    if (res == ASTARTE_OK) {
+        const uint8_t *value = NULL;
+        size_t value_len = 0;
+        res = astarte_tlv_find(slot.payload, slot.header.payload_len,
+            record_type(cred_type, DER_CREDENTIALS), &value, &value_len);
+    }
+    release_slot(&slot);
+    tlv_unlock();
+
+    return res == ASTARTE_OK;
+}
+
+astarte_err_t astarte_credentials_tlv_remove(void *opaque, credential_type_t cred_type)
+{
+    const char *partition_label = opaque;
+    tlv_slot_t slot;
+    uint8_t *new_payload = NULL;
+    size_t new_payload_size = 0;
+
+    tlv_lock();
+    astarte_err_t res = load_active_slot(partition_label, &slot);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    const uint8_t *value = NULL;
+    size_t value_len = 0;
+    res = astarte_tlv_find(slot.payload, slot.header.payload_len,
+        record_type(cred_type, DER_CREDENTIALS), &value, &value_len);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    new_payload_size = ALIGN_UP(slot.header.payload_len, WRITE_ALIGNMENT);
+    new_payload = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, new_payload_size, sizeof(uint8_t));
+    if (!new_payload) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        res = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto exit;
+    }
+
+    size_t new_payload_len = 0;
+    res = astarte_tlv_update(slot.payload, slot.header.payload_len,
+        record_type(cred_type, DER_CREDENTIALS), NULL, 0, new_payload,
+        new_payload_size, &new_payload_len);
+    if (res != ASTARTE_OK) {
+        goto exit;
+    }
+
+    res = commit_slot(&slot, new_payload, new_payload_len);
+
+exit:
+    if (new_payload) {
+        memset(new_payload, 0, new_payload_size);
+        astarte_alloc_free(new_payload);
+    }
+    release_slot(&slot);
+    tlv_unlock();
+    return res;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void tlv_lock(void)
+{
+    taskENTER_CRITICAL(&s_tlv_mutex_spinlock);
+    if (!s_tlv_mutex) {
+        s_tlv_mutex = xSemaphoreCreateMutexStatic(&s_tlv_mutex_buffer);
+    }
+    taskEXIT_CRITICAL(&s_tlv_mutex_spinlock);
+
+    xSemaphoreTake(s_tlv_mutex, portMAX_DELAY);
+}
+
+static void tlv_unlock(void)
+{
+    xSemaphoreGive(s_tlv_mutex);
+}
+
+static astarte_err_t load_active_slot(const char *partition_label, tlv_slot_t *slot)
+{
+    memset(slot, 0, sizeof(tlv_slot_t));
+    slot->active = -1;
+
+    slot->partition = esp_partition_find_first(
+        ESP_PARTITION_TYPE_DATA, ESP_PARTITION_SUBTYPE_ANY, partition_label);
+    if (!slot->partition) {
+        ESP_LOGE(TAG, "You have to add a partition named %s to your partitions.csv file",
+            partition_label);
+        return ASTARTE_ERR_PARTITION_SCHEME;
+    }
+
+    slot->slot_size = (slot->partition->size / SLOTS_NUMBER) & ~(SLOT_ALIGNMENT - 1U);
+    if (slot->slot_size < SLOT_ALIGNMENT) {
+        ESP_LOGE(TAG, "Partition %s is too small, it must be at least %u bytes", partition_label,
+            SLOTS_NUMBER * SLOT_ALIGNMENT);
+        return ASTARTE_ERR_PARTITION_SCHEME;
+    }
+
+    astarte_tlv_header_t headers[SLOTS_NUMBER];
+    bool valid[SLOTS_NUMBER] = { false };
+    for (int i = 0; i < SLOTS_NUMBER; i++) {
+        uint8_t header_buffer[ASTARTE_TLV_HEADER_SIZE];
+        esp_err_t err = esp_partition_read(
+            slot->partition, i * slot->slot_size, header_buffer, ASTARTE_TLV_HEADER_SIZE);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot read slot %d header: %s", i, esp_err_to_name(err));
+            return ASTARTE_ERR_ESP_SDK;
+        }
+        valid[i] = (astarte_tlv_header_decode(header_buffer, &headers[i]) == ASTARTE_OK)
+            && (headers[i].payload_len <= slot->slot_size - ASTARTE_TLV_HEADER_SIZE);
+    }
+
+    // Try the newest slot first, falling back to the other one if its payload is corrupted
+    int newest = astarte_tlv_select_newest(
+        valid[0] ? &headers[0] : NULL, valid[1] ? &headers[1] : NULL);
+    if (newest < 0) {
+        ESP_LOGD(TAG, "No valid slot in partition %s", partition_label);
+        return ASTARTE_OK;
+    }
+
+    astarte_err_t res = load_payload(slot, newest, &headers[newest]);
+    if ((res == ASTARTE_ERR_NOT_FOUND) && valid[1 - newest]) {
+        ESP_LOGW(TAG, "Slot %d is corrupted, using slot %d", newest, 1 - newest);
+        res = load_payload(slot, 1 - newest, &headers[1 - newest]);
+    }
+    if (res == ASTARTE_ERR_NOT_FOUND) {
+        ESP_LOGW(TAG, "No intact slot in partition %s", partition_label);
+        return ASTARTE_OK;
+    }
+
+    return res;
+}
+
+static astarte_err_t load_payload(tlv_slot_t *slot, int index, const astarte_tlv_header_t *header)
+{
+    uint8_t *payload = NULL;
+    if (header->payload_len > 0) {
+        payload = astarte_alloc_calloc(
+            ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, header->payload_len, sizeof(uint8_t));
+        if (!payload) {
+            ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+            return ASTARTE_ERR_OUT_OF_MEMORY;
+        }
+
+        esp_err_t err = esp_partition_read(slot->partition,
+            index * slot->slot_size + ASTARTE_TLV_HEADER_SIZE, payload, header->payload_len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot read slot %d payload: %s", index, esp_err_to_name(err));
+            astarte_alloc_free(payload);
+            return ASTARTE_ERR_ESP_SDK;
+        }
+    }
+
+    if (!astarte_tlv_payload_is_valid(header, payload)) {
+        astarte_alloc_free(payload);
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+
+    slot->active = index;
+    slot->header = *header;
+    slot->payload = payload;
+    return ASTARTE_OK;
+}
+
+static astarte_err_t commit_slot(tlv_slot_t *slot, uint8_t *payload, size_t payload_len)
+{
+    size_t padded_len = ALIGN_UP(payload_len, WRITE_ALIGNMENT);
+    if (ASTARTE_TLV_HEADER_SIZE + padded_len > slot->slot_size) {
+        ESP_LOGE(TAG, "Credentials don't fit in a %zu bytes slot", slot->slot_size);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+
+    // Always write the slot that is not active, so that the active one stays valid until the new
+    // header is written
+    int target = (slot->active == 0) ? 1 : 0;
+    size_t offset = target * slot->slot_size;
+
+    esp_err_t err = esp_partition_erase_range(slot->partition, offset,
+        ALIGN_UP(ASTARTE_TLV_HEADER_SIZE + padded_len, SLOT_ALIGNMENT));
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot erase slot %d: %s", target, esp_err_to_name(err));
+        return ASTARTE_ERR_ESP_SDK;
+    }
+
+    if (padded_len > 0) {
+        err = esp_partition_write(
+            slot->partition, offset + ASTARTE_TLV_HEADER_SIZE, payload, padded_len);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot write slot %d payload: %s", target, esp_err_to_name(err));
+            return ASTARTE_ERR_ESP_SDK;
+        }
+    }
+
+    astarte_tlv_header_t header = {
+        .sequence = (slot->active < 0) ? 1U : slot->header.sequence + 1U,
+        .payload_len = payload_len,
+        .payload_crc = astarte_tlv_crc32(0, payload, payload_len),
+    };
+    uint8_t header_buffer[ASTARTE_TLV_HEADER_SIZE];
+    astarte_tlv_header_encode(&header, header_buffer);
+
+    err = esp_partition_write(slot->partition, offset, header_buffer, ASTARTE_TLV_HEADER_SIZE);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot write slot %d header: %s", target, esp_err_to_name(err));
+        return ASTARTE_ERR_ESP_SDK;
+    }
+
+    ESP_LOGD(TAG, "Committed slot %d, sequence %" PRIu32, target, header.sequence);
+    return ASTARTE_OK;
+}
+
+static void release_slot(tlv_slot_t *slot)
+{
+    if (slot->payload) {
+        memset(slot->payload, 0, slot->header.payload_len);
+        astarte_alloc_free(slot->payload);
+        slot->payload = NULL;
+    }
+}
+
+static uint8_t record_type(credential_type_t cred_type, bool der)
+{
+    // The CSR is always kept in PEM form, since it's sent as is to Pairing API
+    if (der && (cred_type != ASTARTE_CREDENTIALS_CSR)) {
+        return DER_RECORD_TYPE_FLAG | (uint8_t) cred_type;
+    }
+    return (uint8_t) cred_type;
+}
+
+static astarte_err_t drop_other_format(
+    credential_type_t cred_type, uint8_t *payload, size_t payload_size, size_t *payload_len)
+{
+    uint8_t other_type = record_type(cred_type, !DER_CREDENTIALS);
+    const uint8_t *value = NULL;
+    size_t value_len = 0;
+    if ((other_type == record_type(cred_type, DER_CREDENTIALS))
+        || (astarte_tlv_find(payload, *payload_len, other_type, &value, &value_len)
+            != ASTARTE_OK)) {
+        return ASTARTE_OK;
+    }
+
+    // A credential in the other format can't be parsed anymore, it would only fill the slot
+    uint8_t *pruned
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, payload_size, sizeof(uint8_t));
+    if (!pruned) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    size_t pruned_len = 0;
+    astarte_err_t res = astarte_tlv_update(
+        payload, *payload_len, other_type, NULL, 0, pruned, payload_size, &pruned_len);
+    if (res == ASTARTE_OK) {
+        // The padding after the payload is kept zeroed
+        memcpy(payload, pruned, payload_size);
+        *payload_len = pruned_len;
+    }
+    memset(pruned, 0, payload_size);
+    astarte_alloc_free(pruned);
+    return res;
+}
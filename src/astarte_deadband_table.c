@@ -0,0 +1,220 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_deadband_table.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <math.h>
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEADBAND"
+
+#define FNV_OFFSET_BASIS 2166136261U
+#define FNV_PRIME 16777619U
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static uint32_t hash_endpoint(const char *interface_name, const char *path);
+static uint32_t hash_string(uint32_t hash, const char *str);
+static void configure_filter(
+    astarte_deadband_filter_t *filter, const astarte_deadband_config_t *config);
+static bool heartbeat_expired(const astarte_deadband_filter_t *filter, int64_t now_us);
+static bool integer_delta_exceeds(uint64_t delta, double threshold);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_deadband_table_init(astarte_deadband_table_t *table, size_t capacity)
+{
+    table->filters
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, capacity, sizeof(*table->filters));
+    if (!table->filters) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        table->count = 0;
+        table->capacity = 0;
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    table->count = 0;
+    table->capacity = capacity;
+    return ASTARTE_OK;
+}
+
+void astarte_deadband_table_destroy(astarte_deadband_table_t *table)
+{
+    for (size_t i = 0; i < table->count; i++) {
+        astarte_alloc_free(table->filters[i].interface_name);
+    }
+    astarte_alloc_free(table->filters);
+    table->filters = NULL;
+    table->count = 0;
+    table->capacity = 0;
+}
+
+astarte_err_t astarte_deadband_table_set(astarte_deadband_table_t *table,
+    const char *interface_name, const char *path, const astarte_deadband_config_t *config)
+{
+    astarte_deadband_filter_t *filter = astarte_deadband_table_find(table, interface_name, path);
+    if (!config) {
+        if (!filter) {
+            return ASTARTE_ERR_NOT_FOUND;
+        }
+        astarte_alloc_free(filter->interface_name);
+        // Keep the table packed, the order of the filters does not matter
+        *filter = table->filters[table->count - 1];
+        table->count--;
+        return ASTARTE_OK;
+    }
+    if (filter) {
+        configure_filter(filter, config);
+        return ASTARTE_OK;
+    }
+
+    if (table->count == table->capacity) {
+        ESP_LOGE(TAG, "No room for the filter of %s%s", interface_name, path);
+        return ASTARTE_ERR;
+    }
+    size_t interface_name_size = strlen(interface_name) + 1;
+    size_t path_size = strlen(path) + 1;
+    // Interface name and path share the same allocation
+    char *names
+        = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, interface_name_size + path_size);
+    if (!names) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    memcpy(names, interface_name, interface_name_size);
+    memcpy(names + interface_name_size, path, path_size);
+
+    filter = &table->filters[table->count++];
+    memset(filter, 0, sizeof(astarte_deadband_filter_t));
+    filter->hash = hash_endpoint(interface_name, path);
+    filter->interface_name = names;
+    filter->path = names + interface_name_size;
+    configure_filter(filter, config);
+    return ASTARTE_OK;
+}
+
+astarte_deadband_filter_t *astarte_deadband_table_find(
+    astarte_deadband_table_t *table, const char *interface_name, const char *path)
+{
+    if (table->count == 0) {
+        return NULL;
+    }
+    uint32_t hash = hash_endpoint(interface_name, path);
+    for (size_t i = 0; i < table->count; i++) {
+        astarte_deadband_filter_t *filter = &table->filters[i];
+        if ((filter->hash == hash) && (strcmp(filter->path, path) == 0)
+            && (strcmp(filter->interface_name, interface_name) == 0)) {
+            return filter;
+        }
+    }
+    return NULL;
+}
+
+bool astarte_deadband_filter_passes(
+    const astarte_deadband_filter_t *filter, double value, int64_t now_us)
+{
+    if (!filter->has_value || heartbeat_expired(filter, now_us)) {
+        return true;
+    }
+
+    double delta = fabs(value - filter->last_value);
+    if (isnan(delta)) {
+        // NaN never compares, publish unless both values are NaN
+        return !(isnan(value) && isnan(filter->last_value));
+    }
+    if ((filter->absolute <= 0) && (filter->relative <= 0)) {
+        return delta != 0;
+    }
+    return ((filter->absolute > 0) && (delta > filter->absolute))
+        || ((filter->relative > 0) && (delta > filter->relative * fabs(filter->last_value)));
+}
+
+bool astarte_deadband_filter_passes_integer(
+    const astarte_deadband_filter_t *filter, int64_t value, int64_t now_us)
+{
+    if (!filter->has_value || heartbeat_expired(filter, now_us)) {
+        return true;
+    }
+
+    // The distance between two int64_t always fits an uint64_t
+    uint64_t delta = (value >= filter->last_integer)
+        ? (uint64_t) value - (uint64_t) filter->last_integer
+        : (uint64_t) filter->last_integer - (uint64_t) value;
+    if ((filter->absolute <= 0) && (filter->relative <= 0)) {
+        return delta != 0;
+    }
+    return ((filter->absolute > 0) && integer_delta_exceeds(delta, filter->absolute))
+        || ((filter->relative > 0)
+            && integer_delta_exceeds(
+                delta, filter->relative * fabs((double) filter->last_integer)));
+}
+
+void astarte_deadband_filter_commit(
+    astarte_deadband_filter_t *filter, double value, int64_t now_us)
+{
+    filter->last_value = value;
+    filter->last_sent_us = now_us;
+    filter->has_value = true;
+}
+
+void astarte_deadband_filter_commit_integer(
+    astarte_deadband_filter_t *filter, int64_t value, int64_t now_us)
+{
+    filter->last_integer = value;
+    filter->last_sent_us = now_us;
+    filter->has_value = true;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static uint32_t hash_endpoint(const char *interface_name, const char *path)
+{
+    // FNV-1a of the interface name followed by the path
+    return hash_string(hash_string(FNV_OFFSET_BASIS, interface_name), path);
+}
+
+static uint32_t hash_string(uint32_t hash, const char *str)
+{
+    for (const unsigned char *c = (const unsigned char *) str; *c; c++) {
+        hash = (hash ^ *c) * FNV_PRIME;
+    }
+    return hash;
+}
+
+static void configure_filter(
+    astarte_deadband_filter_t *filter, const astarte_deadband_config_t *config)
+{
+    filter->absolute = config->absolute;
+    filter->relative = config->relative;
+    filter->heartbeat_us = (int64_t) config->heartbeat_s * 1000000;
+}
+
+static bool heartbeat_expired(const astarte_deadband_filter_t *filter, int64_t now_us)
+{
+    return (filter->heartbeat_us > 0) && (now_us - filter->last_sent_us >= filter->heartbeat_us);
+}
+
+static bool integer_delta_exceeds(uint64_t delta, double threshold)
+{
+    // An integer is above a threshold if it is above its integral part, which is exact
+    if (threshold >= 18446744073709551616.0) {
+        return false;
+    }
+    return delta > (uint64_t) threshold;
+}
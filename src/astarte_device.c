@@ -6,25 +6,44 @@
 
 #include <astarte_device.h>
 
+#include <astarte_alloc.h>
+#include <astarte_blob_envelope.h>
+#include <astarte_boot_profile.h>
 #include <astarte_bson.h>
 #include <astarte_bson_serializer.h>
 #include <astarte_credentials.h>
+#include <astarte_device_aggregation.h>
+#include <astarte_device_block.h>
+#include <astarte_device_burst.h>
+#include <astarte_device_coalescing.h>
+#include <astarte_device_deadband.h>
+#include <astarte_device_lanes.h>
+#include <astarte_device_outbox.h>
+#include <astarte_device_private.h>
+#include <astarte_device_rate_limit.h>
+#include <astarte_device_sample_rings.h>
+#include <astarte_device_shadow.h>
+#include <astarte_device_stats.h>
+#include <astarte_device_topic_aliases.h>
+#include <astarte_device_tracking.h>
 #include <astarte_hwid.h>
 #include <astarte_linked_list.h>
 #include <astarte_pairing.h>
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
 #include <astarte_storage.h>
+#include <astarte_trace.h>
+#include <astarte_transport_esp_mqtt.h>
 #include <astarte_zlib.h>
 
-#include <mqtt_client.h>
-
 #include <esp_http_client.h>
-#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-#include <esp_crt_bundle.h>
-#endif
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <freertos/semphr.h>
 #include <freertos/task.h>
 #include <limits.h>
+#include <sys/time.h>
 
 #define TAG "ASTARTE_DEVICE"
 
@@ -33,47 +52,50 @@
 #define CREDENTIALS_SECRET_LENGTH 512
 #define CSR_LENGTH 4096
 #define CERT_LENGTH 4096
-#define CN_LENGTH 512
-#define PRIVKEY_LENGTH 8196
 #define URL_LENGTH 512
 #define TOPIC_LENGTH 512
 #define INTERFACE_LENGTH 512
 #define PATH_LENGTH 512
-#define REINIT_RETRY_INTERVAL_MS (30 * 1000)
-
-#define NOTIFY_TERMINATE (1U << 0U)
-#define NOTIFY_REINIT (1U << 1U)
-
-struct astarte_device
-{
-    char *encoded_hwid;
-    char *credentials_secret;
-    char *device_topic;
-    size_t device_topic_len;
-    char *client_cert_pem;
-    char *key_pem;
-    bool connected;
-    astarte_device_data_event_callback_t data_event_callback;
-    astarte_device_unset_event_callback_t unset_event_callback;
-    astarte_device_connection_event_callback_t connection_event_callback;
-    astarte_device_disconnection_event_callback_t disconnection_event_callback;
-    void *callbacks_user_data;
-    esp_mqtt_client_handle_t mqtt_client;
-    TaskHandle_t reinit_task_handle;
-    SemaphoreHandle_t reinit_mutex;
-    astarte_linked_list_handle_t introspection;
-    char *realm;
+
+#ifdef CONFIG_ASTARTE_BOOT_PROFILING
+#define BOOT_PROFILE_BEGIN(phase) astarte_boot_profile_begin(phase)
+#define BOOT_PROFILE_END(phase) astarte_boot_profile_end(phase)
+#else
+#define BOOT_PROFILE_BEGIN(phase)
+#define BOOT_PROFILE_END(phase)
+#endif
+
+// Before this date, 2020-01-01, the system clock is considered not set
+#define VALID_CLOCK_MIN_EPOCH_S 1577836800
+
+#define STATS_INTERFACE_NAME "org.astarte-platform.esp32.DeviceStats"
+#define STATS_PATH_PREFIX "/stats"
+#define STATS_REPORT_PERCENTILE 95
+
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+static const astarte_interface_t stats_interface = {
+    .name = STATS_INTERFACE_NAME,
+    .major_version = 0,
+    .minor_version = 1,
+    .ownership = OWNERSHIP_DEVICE,
+    .type = TYPE_DATASTREAM,
 };
+#endif
 
 static void astarte_device_reinit_task(void *ctx);
-static astarte_err_t astarte_device_init_connection(
-    astarte_device_handle_t device, const char *encoded_hwid, const char *realm);
-static astarte_err_t retrieve_credentials(astarte_pairing_config_t *pairing_config);
+static void reinit_task_destroy(astarte_device_handle_t device);
+static astarte_err_t create_transport_client(astarte_device_handle_t device,
+    const char *broker_url, const astarte_credentials_parsed_t *credentials);
+static void destroy_transport_client(astarte_device_handle_t device);
+static astarte_err_t retrieve_credentials(
+    astarte_device_handle_t device, astarte_pairing_session_handle_t pairing_session);
 static astarte_err_t check_device(astarte_device_handle_t device);
 static astarte_err_t publish_bson(astarte_device_handle_t device, const char *interface_name,
-    const char *path, astarte_bson_serializer_handle_t bson, int qos);
+    const char *path, astarte_bson_serializer_handle_t bson, int qos, int64_t serialize_start_us);
 static astarte_err_t publish_data(astarte_device_handle_t device, const char *interface_name,
     const char *path, const void *data, int length, int qos);
+static void publish_control(
+    astarte_device_handle_t device, const char *topic, const void *data, int length);
 static void setup_subscriptions(astarte_device_handle_t device);
 static void send_introspection(astarte_device_handle_t device);
 static void send_emptycache(astarte_device_handle_t device);
@@ -94,29 +116,149 @@ static astarte_err_t uncompress_purge_properties(
     char *data, int data_len, char **output, uLongf *output_len);
 #endif
 static void on_certificate_error(astarte_device_handle_t device);
-static void mqtt_event_handler(
-    void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+static void transport_event_handler(void *handler_data, const astarte_transport_event_t *event);
 static int has_connectivity();
-static void maybe_append_timestamp(astarte_bson_serializer_handle_t bson, uint64_t ts_epoch_millis);
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-static astarte_interface_t *get_interface_from_introspection(
-    astarte_device_handle_t device, const char *name);
+static astarte_err_t open_storage(
+    astarte_device_handle_t device, astarte_storage_handle_t *storage_handle);
+static void close_storage(astarte_device_handle_t device, astarte_storage_handle_t storage_handle,
+    astarte_err_t result);
+#endif
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+static void send_stats_report(astarte_device_handle_t device);
 #endif
+static void maybe_append_timestamp(astarte_bson_serializer_handle_t bson, uint64_t ts_epoch_millis);
 
 astarte_device_handle_t astarte_device_init(astarte_device_config_t *cfg)
 {
-    astarte_device_handle_t ret = calloc(1, sizeof(struct astarte_device));
+    astarte_device_handle_t ret
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(struct astarte_device));
     if (!ret) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return NULL;
     }
 
+    ret->transport = cfg->transport ? *cfg->transport : *astarte_transport_esp_mqtt();
+
     ret->reinit_mutex = xSemaphoreCreateMutex();
     if (!ret->reinit_mutex) {
         ESP_LOGE(TAG, "Cannot create reinit_mutex");
         goto init_failed;
     }
 
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    ret->stats_mutex = xSemaphoreCreateMutex();
+    if (!ret->stats_mutex) {
+        ESP_LOGE(TAG, "Cannot create stats_mutex");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    ret->publish_scratch_mutex = xSemaphoreCreateMutex();
+    if (!ret->publish_scratch_mutex) {
+        ESP_LOGE(TAG, "Cannot create publish_scratch_mutex");
+        goto init_failed;
+    }
+    if ((astarte_scratch_init(&ret->publish_scratch, CONFIG_ASTARTE_SCRATCH_PUBLISH_SIZE)
+            != ASTARTE_OK)
+        || (astarte_scratch_init(&ret->receive_scratch, CONFIG_ASTARTE_SCRATCH_RECEIVE_SIZE)
+            != ASTARTE_OK)) {
+        ESP_LOGE(TAG, "Cannot reserve the scratch arenas");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    if (astarte_device_lanes_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the publish lanes");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    if (astarte_device_rate_limit_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the rate limits");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    if (astarte_device_aggregation_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the aggregators");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+    if (astarte_device_deadband_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the dead-band filters");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    if (astarte_device_coalescing_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the property coalescing");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_SHADOW
+    if (astarte_device_shadow_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the shadows");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    if (astarte_device_block_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the block streams");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    if (astarte_device_burst_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the burst mode");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    if (astarte_device_sample_rings_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the sample rings");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    if (astarte_device_tracking_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the publish tracking");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    if (astarte_device_outbox_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the outbox governor");
+        goto init_failed;
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+    if (astarte_device_topic_aliases_init(ret) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot initialize the topic aliases");
+        goto init_failed;
+    }
+#endif
+
+    ret->reinit_task_exited = xSemaphoreCreateBinary();
+    if (!ret->reinit_task_exited) {
+        ESP_LOGE(TAG, "Cannot create reinit_task_exited");
+        goto init_failed;
+    }
+
     const configSTACK_DEPTH_TYPE stack_depth = 6000;
     xTaskCreate(astarte_device_reinit_task, "astarte_device_reinit_task", stack_depth, ret,
         tskIDLE_PRIORITY, &ret->reinit_task_handle);
@@ -147,9 +289,12 @@ astarte_device_handle_t astarte_device_init(astarte_device_config_t *cfg)
     ESP_LOGD(TAG, "hwid is: %s", encoded_hwid);
 
     if (cfg->credentials_secret) {
-        ret->credentials_secret = strdup(cfg->credentials_secret);
+        ret->credentials_secret
+            = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, cfg->credentials_secret);
     }
 
+    ret->credentials_context = cfg->credentials_context;
+
     const char *realm = NULL;
     if (cfg->realm) {
         realm = cfg->realm;
@@ -163,43 +308,116 @@ astarte_device_handle_t astarte_device_init(astarte_device_config_t *cfg)
         goto init_failed;
     }
 
-    ret->encoded_hwid = strdup(encoded_hwid);
+    ret->encoded_hwid = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, encoded_hwid);
     if (!ret->encoded_hwid) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto init_failed;
     }
 
-    ret->realm = strdup(realm);
+    ret->realm = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, realm);
     if (!ret->realm) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto init_failed;
     }
 
     ret->introspection = astarte_linked_list_init();
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+    if (astarte_linked_list_append(&ret->introspection, (void *) &stats_interface) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Can't add the statistics interface to introspection");
+        goto init_failed;
+    }
+#endif
     ret->data_event_callback = cfg->data_event_callback;
     ret->unset_event_callback = cfg->unset_event_callback;
     ret->connection_event_callback = cfg->connection_event_callback;
     ret->disconnection_event_callback = cfg->disconnection_event_callback;
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    ret->publish_event_callback = cfg->publish_event_callback;
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    ret->outbox_event_callback = cfg->outbox_event_callback;
+#endif
     ret->callbacks_user_data = cfg->callbacks_user_data;
 
     return ret;
 
 init_failed:
+    // The device task uses most of the device state, it is stopped before freeing anything
+    reinit_task_destroy(ret);
+
     if (ret->credentials_secret) {
-        free(ret->credentials_secret);
+        astarte_alloc_free(ret->credentials_secret);
     }
 
     if (ret->reinit_mutex) {
         vSemaphoreDelete(ret->reinit_mutex);
     }
 
-    if (ret->reinit_task_handle) {
-        xTaskNotify(ret->reinit_task_handle, NOTIFY_TERMINATE, eSetBits);
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    if (ret->stats_mutex) {
+        vSemaphoreDelete(ret->stats_mutex);
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    if (ret->publish_scratch_mutex) {
+        vSemaphoreDelete(ret->publish_scratch_mutex);
     }
+    astarte_scratch_destroy(&ret->publish_scratch);
+    astarte_scratch_destroy(&ret->receive_scratch);
+#endif
+
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    astarte_device_lanes_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    astarte_device_rate_limit_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    astarte_device_aggregation_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+    astarte_device_deadband_destroy(ret);
+#endif
 
-    free(ret->encoded_hwid);
-    free(ret->realm);
-    free(ret);
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    astarte_device_coalescing_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_SHADOW
+    astarte_device_shadow_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    astarte_device_block_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    astarte_device_burst_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    astarte_device_sample_rings_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_tracking_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    astarte_device_outbox_destroy(ret);
+#endif
+
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+    astarte_device_topic_aliases_destroy(ret);
+#endif
+
+    astarte_alloc_free(ret->encoded_hwid);
+    astarte_alloc_free(ret->realm);
+    astarte_alloc_free(ret);
 
     return NULL;
 }
@@ -213,16 +431,28 @@ static void astarte_device_reinit_task(void *ctx)
 
     astarte_device_handle_t device = (astarte_device_handle_t) ctx;
 
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+    // The statistics are reported by this task when no notification arrives in the interval
+    const TickType_t wait_ticks
+        = pdMS_TO_TICKS(CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S * 1000U);
+#else
+    const TickType_t wait_ticks = portMAX_DELAY;
+#endif
+
     while (1) {
-        uint32_t notification_value = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        uint32_t notification_value = ulTaskNotifyTake(pdTRUE, wait_ticks);
         if (notification_value & NOTIFY_TERMINATE) {
             // Terminate the task
+            xSemaphoreGive(device->reinit_task_exited);
             vTaskDelete(NULL);
         } else if (notification_value & NOTIFY_REINIT) {
             xSemaphoreTake(device->reinit_mutex, portMAX_DELAY);
             ESP_LOGI(TAG, "Reinitializing the device");
+            STATS_COUNT(device, reinits);
+            int64_t reinit_start_us = STATS_TIMESTAMP();
+            ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_REINIT);
             // Delete the old certificate
-            astarte_credentials_delete_certificate();
+            astarte_credentials_ctx_delete_certificate(device->credentials_context);
             // Retry until we succeed
             bool reinitialized = true;
 
@@ -252,24 +482,103 @@ static void astarte_device_reinit_task(void *ctx)
 
             if (reinitialized) {
                 ESP_LOGI(TAG, "Device reinitialized, starting it again");
-                esp_mqtt_client_start(device->mqtt_client);
+                STATS_COUNT(device, certificate_renewals);
+                STATS_RECORD(device, certificate_renewal, reinit_start_us);
+                device->transport.ops->start(device->transport_client);
             }
+            ASTARTE_TRACE_END(ASTARTE_TRACE_REINIT);
 
             xSemaphoreGive(device->reinit_mutex);
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+            astarte_device_tracking_fail_stale(device);
+#endif
+        }
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+        else if ((notification_value == 0) && device->connected) {
+            send_stats_report(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+        if (notification_value & NOTIFY_RATE_LIMIT) {
+            astarte_device_rate_limit_flush(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_AGGREGATION
+        if (notification_value & NOTIFY_AGGREGATE) {
+            astarte_device_aggregation_publish(device);
         }
+#endif
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+        if (notification_value & NOTIFY_PROPERTIES) {
+            astarte_device_coalescing_flush(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_SHADOW
+        if (notification_value & NOTIFY_SHADOW) {
+            astarte_device_shadow_commit_due(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+        if (notification_value & NOTIFY_BURST) {
+            astarte_device_burst_flush(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+        if (notification_value & NOTIFY_SAMPLES) {
+            astarte_device_sample_rings_drain(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+        if (notification_value & NOTIFY_PUBLISHED) {
+            astarte_device_tracking_complete(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+        if (notification_value & NOTIFY_OUTBOX) {
+            astarte_device_outbox_regulate(device);
+        }
+#endif
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+        if (notification_value & NOTIFY_MQTT3_FALLBACK) {
+            astarte_device_topic_aliases_fall_back(device);
+        }
+#endif
+    }
+}
+
+static void reinit_task_destroy(astarte_device_handle_t device)
+{
+    if (device->reinit_task_handle) {
+        xTaskNotify(device->reinit_task_handle, NOTIFY_TERMINATE, eSetBits);
+        // Wait for the task to stop using the device
+        xSemaphoreTake(device->reinit_task_exited, portMAX_DELAY);
+        device->reinit_task_handle = NULL;
+    }
+    if (device->reinit_task_exited) {
+        vSemaphoreDelete(device->reinit_task_exited);
+        device->reinit_task_exited = NULL;
     }
 }
 
 astarte_err_t astarte_device_init_connection(
     astarte_device_handle_t device, const char *encoded_hwid, const char *realm)
 {
-    if (!astarte_credentials_is_initialized()) {
+    if (device->transport.device_topic) {
+        // The transport does not connect to Astarte, the device needs neither registration nor
+        // credentials
+        destroy_transport_client(device);
+        device->device_topic = device->transport.device_topic;
+        device->device_topic_len = strlen(device->device_topic);
+        return create_transport_client(device, NULL, NULL);
+    }
+
+    if (!astarte_credentials_ctx_is_initialized(device->credentials_context)) {
         // TODO: this should be manually called from main before initializing the device,
         // but we just print a warning to maintain backwards compatibility for now
         ESP_LOGW(TAG,
             "You should manually call astarte_credentials_init before calling "
             "astarte_device_init");
-        astarte_err_t err = astarte_credentials_init();
+        astarte_err_t err = astarte_credentials_ctx_init(device->credentials_context);
         if (err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error in astarte_credentials_init");
             return err;
@@ -277,20 +586,13 @@ astarte_err_t astarte_device_init_connection(
     }
 
     // If the device was already initialized, we free some resources first
-    if (device->mqtt_client) {
-        esp_mqtt_client_destroy(device->mqtt_client);
-    }
-
-    if (device->device_topic) {
-        free(device->device_topic);
-    }
-
-    if (device->client_cert_pem) {
-        free(device->client_cert_pem);
-    }
+    destroy_transport_client(device);
 
-    if (device->key_pem) {
-        free(device->key_pem);
+    if (device->credentials) {
+        astarte_credentials_parsed_free(device->credentials);
+        astarte_alloc_free(device->credentials);
+        device->credentials = NULL;
+        device->device_topic = NULL;
     }
 
     astarte_pairing_config_t pairing_config = {
@@ -298,131 +600,132 @@ astarte_err_t astarte_device_init_connection(
         .jwt = CONFIG_ASTARTE_PAIRING_JWT,
         .realm = realm,
         .hw_id = encoded_hwid,
+        .credentials_context = device->credentials_context,
     };
 
     if (device->credentials_secret) {
         pairing_config.credentials_secret = device->credentials_secret;
     }
 
+    // All the pairing requests share a single HTTPS connection and the credentials secret
+    astarte_pairing_session_handle_t pairing_session = astarte_pairing_session_new(&pairing_config);
+    if (!pairing_session) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    astarte_credentials_parsed_t *credentials = NULL;
     char credentials_secret[CREDENTIALS_SECRET_LENGTH] = { 0 };
-    astarte_err_t err = astarte_pairing_get_credentials_secret(
-        &pairing_config, credentials_secret, CREDENTIALS_SECRET_LENGTH);
+    BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_REGISTRATION);
+    astarte_err_t err = astarte_pairing_session_get_credentials_secret(
+        pairing_session, credentials_secret, CREDENTIALS_SECRET_LENGTH);
+    BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_REGISTRATION);
     if (err != ASTARTE_OK) {
         ESP_LOGE(TAG, "Error in get_credentials_secret");
-        return err;
+        goto init_failed;
     }
     ESP_LOGD(TAG, "credentials_secret is: %s", credentials_secret);
 
-    char *client_cert_pem = NULL;
-    char *client_cert_cn = NULL;
-    char *key_pem = NULL;
-
-    if (!astarte_credentials_has_certificate()) {
-        err = retrieve_credentials(&pairing_config);
+    if (!astarte_credentials_ctx_has_certificate(device->credentials_context)) {
+        BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_CERTIFICATE);
+        err = retrieve_credentials(device, pairing_session);
+        BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_CERTIFICATE);
         if (err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Could not retrieve credentials");
             goto init_failed;
         }
     }
 
-    key_pem = calloc(PRIVKEY_LENGTH, sizeof(char));
-    if (!key_pem) {
+    // The credentials are parsed once and handed to the TLS layer in DER form
+    credentials = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(astarte_credentials_parsed_t));
+    if (!credentials) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        err = ASTARTE_ERR_OUT_OF_MEMORY;
         goto init_failed;
     }
-    err = astarte_credentials_get_key(key_pem, PRIVKEY_LENGTH);
+    err = astarte_credentials_ctx_parse(device->credentials_context, credentials);
     if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Error in get_key");
+        ESP_LOGE(TAG, "Error in credentials parse");
+        astarte_alloc_free(credentials);
+        credentials = NULL;
         goto init_failed;
-    } else {
-        ESP_LOGD(TAG, "Key is: %s", key_pem);
     }
+    ESP_LOGD(TAG, "Device topic is: %s", credentials->common_name);
+    ESP_LOGD(TAG, "Certificate valid until: %04d-%02d-%02d", credentials->valid_to.year,
+        credentials->valid_to.mon, credentials->valid_to.day);
 
-    client_cert_pem = calloc(CERT_LENGTH, sizeof(char));
-    if (!client_cert_pem) {
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        goto init_failed;
-    }
-    err = astarte_credentials_get_certificate(client_cert_pem, CERT_LENGTH);
+    char broker_url[URL_LENGTH] = { 0 };
+    BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_BROKER_URL);
+    err = astarte_pairing_session_get_mqtt_v1_broker_url(pairing_session, broker_url, URL_LENGTH);
+    BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_BROKER_URL);
     if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Error in get_certificate");
+        ESP_LOGE(TAG, "Error in get_mqtt_v1_broker_url");
         goto init_failed;
     } else {
-        ESP_LOGD(TAG, "Certificate is: %s", client_cert_pem);
+        ESP_LOGD(TAG, "Broker URL is: %s", broker_url);
     }
 
-    client_cert_cn = calloc(CN_LENGTH, sizeof(char));
-    if (!client_cert_cn) {
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        goto init_failed;
-    }
-    err = astarte_credentials_get_certificate_common_name(
-        client_cert_pem, client_cert_cn, CN_LENGTH);
+    err = create_transport_client(device, broker_url, credentials);
     if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Error in get_certificate_common_name");
         goto init_failed;
-    } else {
-        ESP_LOGD(TAG, "Device topic is: %s", client_cert_cn);
     }
 
-    char broker_url[URL_LENGTH] = { 0 };
-    err = astarte_pairing_get_mqtt_v1_broker_url(&pairing_config, broker_url, URL_LENGTH);
-    if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Error in get_mqtt_v1_broker_url");
-        goto init_failed;
-    } else {
-        ESP_LOGD(TAG, "Broker URL is: %s", broker_url);
+    device->credentials = credentials;
+    device->device_topic = credentials->common_name;
+    device->device_topic_len = strlen(credentials->common_name);
+
+    astarte_pairing_session_destroy(pairing_session);
+    return ASTARTE_OK;
+
+init_failed:
+    if (credentials) {
+        astarte_credentials_parsed_free(credentials);
+        astarte_alloc_free(credentials);
     }
+    astarte_pairing_session_destroy(pairing_session);
 
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-    const esp_mqtt_client_config_t mqtt_cfg
-        = {.broker.address.uri = broker_url,
-#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-              .broker.verification.crt_bundle_attach = esp_crt_bundle_attach,
-#endif
-              .credentials.authentication.certificate = client_cert_pem,
-              .credentials.authentication.key = key_pem,
-#ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-              .session.disable_clean_session = true,
-#endif
-          };
-#else
-    const esp_mqtt_client_config_t mqtt_cfg
-        = {.uri = broker_url,
-#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-              .crt_bundle_attach = esp_crt_bundle_attach,
-#endif
-              .client_cert_pem = client_cert_pem,
-              .client_key_pem = key_pem,
-              .user_context = device,
+    return err;
+}
+
+static astarte_err_t create_transport_client(astarte_device_handle_t device,
+    const char *broker_url, const astarte_credentials_parsed_t *credentials)
+{
+    astarte_transport_config_t transport_config = {
+        .broker_url = broker_url,
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-              .disable_clean_session = true,
+        .persistent_session = true,
 #endif
-          };
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+        .mqtt5 = !device->mqtt5_refused,
 #endif
-
-    esp_mqtt_client_handle_t mqtt_client = esp_mqtt_client_init(&mqtt_cfg);
-    if (!mqtt_client) {
-        ESP_LOGE(TAG, "Error in esp_mqtt_client_init");
-        goto init_failed;
+    };
+    if (credentials) {
+        transport_config.certificate = credentials->certificate_der;
+        transport_config.certificate_len = credentials->certificate_der_len;
+        transport_config.key = credentials->key_der;
+        transport_config.key_len = credentials->key_der_len;
     }
 
-    esp_mqtt_client_register_event(mqtt_client, ESP_EVENT_ANY_ID, mqtt_event_handler, device);
-
-    device->mqtt_client = mqtt_client;
-    device->device_topic = client_cert_cn;
-    device->device_topic_len = strlen(client_cert_cn);
-    device->client_cert_pem = client_cert_pem;
-    device->key_pem = key_pem;
-
+    void *client = device->transport.ops->create(
+        device->transport.transport_data, &transport_config, transport_event_handler, device);
+    if (!client) {
+        ESP_LOGE(TAG, "Cannot create the transport client");
+        return ASTARTE_ERR;
+    }
+    device->transport_client = client;
     return ASTARTE_OK;
+}
 
-init_failed:
-    free(key_pem);
-    free(client_cert_pem);
-    free(client_cert_cn);
-
-    return err;
+static void destroy_transport_client(astarte_device_handle_t device)
+{
+    if (!device->transport_client) {
+        return;
+    }
+    device->transport.ops->destroy(device->transport_client);
+    device->transport_client = NULL;
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_tracking_reset_session(device);
+#endif
 }
 
 void astarte_device_destroy(astarte_device_handle_t device)
@@ -431,20 +734,91 @@ void astarte_device_destroy(astarte_device_handle_t device)
         return;
     }
 
-    // Avoid destroying a device that is being reinitialized
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    // Stop the publish task first, it might be waiting for the reinit mutex
+    astarte_device_lanes_destroy(device);
+#endif
+
+    // Nothing must notify the device task once it has exited: the timers are stopped and the
+    // transport disconnected, waiting for a reinitialization in progress
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    astarte_device_rate_limit_stop(device);
+#endif
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    astarte_device_aggregation_stop(device);
+#endif
+#ifdef CONFIG_ASTARTE_SHADOW
+    astarte_device_shadow_stop(device);
+#endif
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    astarte_device_burst_stop(device);
+#endif
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    astarte_device_sample_rings_stop(device);
+#endif
+    xSemaphoreTake(device->reinit_mutex, portMAX_DELAY);
+    if (device->transport_client) {
+        device->transport.ops->stop(device->transport_client);
+    }
+    xSemaphoreGive(device->reinit_mutex);
+    // The device task uses most of the device state, it is stopped before freeing anything
+    reinit_task_destroy(device);
+
+    // Avoid destroying a device that is being used by the other API calls
     xSemaphoreTake(device->reinit_mutex, portMAX_DELAY);
 
-    esp_mqtt_client_destroy(device->mqtt_client);
-    xTaskNotify(device->reinit_task_handle, NOTIFY_TERMINATE, eSetBits);
+    device->transport.ops->destroy(device->transport_client);
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    astarte_device_rate_limit_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    astarte_device_aggregation_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_SHADOW
+    astarte_device_shadow_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    astarte_device_block_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    astarte_device_burst_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    astarte_device_sample_rings_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_tracking_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    astarte_device_outbox_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+    astarte_device_topic_aliases_destroy(device);
+#endif
     vSemaphoreDelete(device->reinit_mutex);
-    free(device->device_topic);
-    free(device->client_cert_pem);
-    free(device->key_pem);
-    free(device->encoded_hwid);
-    free(device->credentials_secret);
-    free(device->realm);
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    vSemaphoreDelete(device->stats_mutex);
+#endif
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    vSemaphoreDelete(device->publish_scratch_mutex);
+    astarte_scratch_destroy(&device->publish_scratch);
+    astarte_scratch_destroy(&device->receive_scratch);
+#endif
+#ifdef CONFIG_ASTARTE_DEADBAND
+    astarte_device_deadband_destroy(device);
+#endif
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    astarte_device_coalescing_destroy(device);
+#endif
+    if (device->credentials) {
+        astarte_credentials_parsed_free(device->credentials);
+        astarte_alloc_free(device->credentials);
+    }
+    astarte_alloc_free(device->encoded_hwid);
+    astarte_alloc_free(device->credentials_secret);
+    astarte_alloc_free(device->realm);
     astarte_linked_list_destroy(&device->introspection);
-    free(device);
+    astarte_alloc_free(device);
 }
 
 astarte_err_t astarte_device_add_interface(
@@ -529,13 +903,7 @@ astarte_err_t astarte_device_start(astarte_device_handle_t device)
         return ASTARTE_ERR_DEVICE_NOT_READY;
     }
 
-    astarte_err_t ret = ASTARTE_OK;
-
-    esp_err_t err = esp_mqtt_client_start(device->mqtt_client);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to start MQTT client: %s", esp_err_to_name(err));
-        ret = ASTARTE_ERR;
-    }
+    astarte_err_t ret = device->transport.ops->start(device->transport_client);
 
     xSemaphoreGive(device->reinit_mutex);
 
@@ -549,13 +917,7 @@ astarte_err_t astarte_device_stop(astarte_device_handle_t device)
         return ASTARTE_ERR_DEVICE_NOT_READY;
     }
 
-    astarte_err_t ret = ASTARTE_OK;
-
-    esp_err_t err = esp_mqtt_client_stop(device->mqtt_client);
-    if (err != ESP_OK) {
-        ESP_LOGE(TAG, "Failed to stop MQTT client: %s", esp_err_to_name(err));
-        ret = ASTARTE_ERR;
-    }
+    astarte_err_t ret = device->transport.ops->stop(device->transport_client);
 
     xSemaphoreGive(device->reinit_mutex);
 
@@ -569,10 +931,12 @@ astarte_err_t astarte_device_stop(astarte_device_handle_t device)
 }
 
 static astarte_err_t publish_bson(astarte_device_handle_t device, const char *interface_name,
-    const char *path, astarte_bson_serializer_handle_t bson, int qos)
+    const char *path, astarte_bson_serializer_handle_t bson, int qos, int64_t serialize_start_us)
 {
     int len = 0;
     const void *data = astarte_bson_serializer_get_document(bson, &len);
+    STATS_RECORD(device, publish_serialize, serialize_start_us);
+    ASTARTE_TRACE_END(ASTARTE_TRACE_SERIALIZE);
     if (!data) {
         ESP_LOGE(TAG, "Error during BSON serialization");
         return ASTARTE_ERR;
@@ -583,11 +947,11 @@ static astarte_err_t publish_bson(astarte_device_handle_t device, const char *in
         return ASTARTE_ERR;
     }
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-    astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
     if (interface && (interface->type == TYPE_PROPERTIES)) {
         // Open storage
         astarte_storage_handle_t storage_handle;
-        astarte_err_t storage_err = astarte_storage_open(&storage_handle);
+        astarte_err_t storage_err = open_storage(device, &storage_handle);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error opening storage.");
             return ASTARTE_ERR;
@@ -598,12 +962,12 @@ static astarte_err_t publish_bson(astarte_device_handle_t device, const char *in
             interface->major_version, data, len, &is_contained);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error checking if property is in storage.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return ASTARTE_ERR;
         }
         if (is_contained) {
             ESP_LOGW(TAG, "Trying to set a property twice: '%s%s'", interface_name, path);
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return ASTARTE_OK;
         }
         // Store property
@@ -612,11 +976,11 @@ static astarte_err_t publish_bson(astarte_device_handle_t device, const char *in
             storage_handle, interface_name, path, interface->major_version, data, len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error storing property.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return ASTARTE_ERR;
         }
         // Close storage
-        astarte_storage_close(storage_handle);
+        close_storage(device, storage_handle, storage_err);
     }
 #endif
 
@@ -626,6 +990,10 @@ static astarte_err_t publish_bson(astarte_device_handle_t device, const char *in
 static astarte_err_t publish_data(astarte_device_handle_t device, const char *interface_name,
     const char *path, const void *data, int length, int qos)
 {
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_tracking_clear_token();
+#endif
+
     if (path[0] != '/') {
         ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", path);
         return ASTARTE_ERR_INVALID_INTERFACE_PATH;
@@ -644,25 +1012,121 @@ static astarte_err_t publish_data(astarte_device_handle_t device, const char *in
         return ASTARTE_ERR;
     }
 
-    if (xSemaphoreTake(device->reinit_mutex, (TickType_t) 10) == pdFALSE) {
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    return astarte_device_burst_publish(device, interface_name, topic, data, length, qos);
+#else
+    return astarte_device_route_publish(device, interface_name, topic, data, length, qos);
+#endif
+}
+
+astarte_err_t astarte_device_route_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
+    if (interface && (interface->type == TYPE_PROPERTIES)) {
+        return astarte_device_coalescing_publish(device, interface_name, topic, data, length, qos);
+    }
+#endif
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    return astarte_device_rate_limit_publish(device, interface_name, topic, data, length, qos);
+#else
+    return astarte_device_send_publish(device, interface_name, topic, data, length, qos);
+#endif
+}
+
+astarte_err_t astarte_device_send_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    astarte_err_t res = ASTARTE_OK;
+    if (!astarte_device_outbox_admit(device, interface_name, topic, data, length, &qos, &res)) {
+        // Deferred or rejected, the outbox is congested
+        return res;
+    }
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    return astarte_device_lanes_enqueue(
+        device, astarte_device_lanes_select(device, interface_name), topic, data, length, qos);
+#else
+    (void) interface_name;
+    return astarte_device_mqtt_publish(device, topic, data, length, qos, (TickType_t) 10);
+#endif
+}
+
+astarte_err_t astarte_device_mqtt_publish(astarte_device_handle_t device, const char *topic,
+    const void *data, int length, int qos, TickType_t lock_timeout)
+{
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    // Waiting for the in-flight windows comes first, not to keep the device locked. The publish
+    // scratch arena is saved and released while waiting.
+    astarte_publish_token_t token = ASTARTE_PUBLISH_TOKEN_NONE;
+    astarte_err_t track_err = astarte_device_tracking_prepare(device, topic, qos, &token);
+    if (track_err != ASTARTE_OK) {
+        return track_err;
+    }
+#endif
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_PUBLISH);
+    int64_t lock_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_LOCK_WAIT);
+    if (xSemaphoreTake(device->reinit_mutex, lock_timeout) == pdFALSE) {
         ESP_LOGE(TAG, "Trying to publish to a device that is being reinitialized");
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+        astarte_device_tracking_record(device, token, -1);
+#endif
+        STATS_COUNT(device, publish_not_ready);
+        ASTARTE_TRACE_END(ASTARTE_TRACE_LOCK_WAIT);
+        ASTARTE_TRACE_END(ASTARTE_TRACE_PUBLISH);
         return ASTARTE_ERR_DEVICE_NOT_READY;
     }
+    ASTARTE_TRACE_END(ASTARTE_TRACE_LOCK_WAIT);
+    STATS_RECORD(device, publish_lock_wait, lock_start_us);
 
-    esp_mqtt_client_handle_t mqtt = device->mqtt_client;
+    void *client = device->transport_client;
 
     ESP_LOGD(TAG, "Publishing on %s with QoS %d", topic, qos);
-    int ret = esp_mqtt_client_publish(mqtt, topic, data, length, qos, 0);
+    int64_t enqueue_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_ENQUEUE);
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+    int ret = astarte_device_topic_aliases_publish(device, client, topic, data, length, qos);
+#else
+    int ret = device->transport.ops->publish(client, topic, data, length, qos, 0);
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    // Recorded before unlocking, the device task locks the device before matching acknowledgments
+    astarte_device_tracking_record(device, token, ret);
+#endif
     xSemaphoreGive(device->reinit_mutex);
+    ASTARTE_TRACE_END(ASTARTE_TRACE_ENQUEUE);
+    STATS_RECORD(device, publish_enqueue, enqueue_start_us);
+    ASTARTE_TRACE_END(ASTARTE_TRACE_PUBLISH);
     if (ret < 0) {
         ESP_LOGE(TAG, "Publish on %s failed", topic);
+        STATS_COUNT(device, publish_failed);
         return ASTARTE_ERR_PUBLISH;
     }
+    STATS_COUNT(device, publish_ok);
 
     ESP_LOGD(TAG, "Publish succeeded, msg_id: %d", ret);
     return ASTARTE_OK;
 }
 
+static void publish_control(
+    astarte_device_handle_t device, const char *topic, const void *data, int length)
+{
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    astarte_err_t res = astarte_device_lanes_enqueue(
+        device, ASTARTE_PUBLISH_LANE_CONTROL, topic, data, length, 2);
+    if (res != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot queue the control message for %s: %s", topic,
+            astarte_err_to_name(res));
+    }
+#else
+    device->transport.ops->publish(device->transport_client, topic, data, length, 2, 0);
+#endif
+}
+
 static void maybe_append_timestamp(astarte_bson_serializer_handle_t bson, uint64_t ts_epoch_millis)
 {
     if (ts_epoch_millis != ASTARTE_INVALID_TIMESTAMP) {
@@ -673,56 +1137,84 @@ static void maybe_append_timestamp(astarte_bson_serializer_handle_t bson, uint64
 astarte_err_t astarte_device_stream_double_with_timestamp(astarte_device_handle_t device,
     const char *interface_name, const char *path, double value, uint64_t ts_epoch_millis, int qos)
 {
+    DEADBAND_FILTER(device, interface_name, path, value);
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_double(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
+    DEADBAND_COMMIT(device, interface_name, path, value, exit_code);
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
 astarte_err_t astarte_device_stream_integer_with_timestamp(astarte_device_handle_t device,
     const char *interface_name, const char *path, int32_t value, uint64_t ts_epoch_millis, int qos)
 {
+    DEADBAND_FILTER_INTEGER(device, interface_name, path, value);
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_int32(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
+    DEADBAND_COMMIT_INTEGER(device, interface_name, path, value, exit_code);
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
 astarte_err_t astarte_device_stream_longinteger_with_timestamp(astarte_device_handle_t device,
     const char *interface_name, const char *path, int64_t value, uint64_t ts_epoch_millis, int qos)
 {
+    DEADBAND_FILTER_INTEGER(device, interface_name, path, value);
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_int64(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
+    DEADBAND_COMMIT_INTEGER(device, interface_name, path, value, exit_code);
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
 astarte_err_t astarte_device_stream_boolean_with_timestamp(astarte_device_handle_t device,
     const char *interface_name, const char *path, bool value, uint64_t ts_epoch_millis, int qos)
 {
+    DEADBAND_FILTER_INTEGER(device, interface_name, path, value);
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_boolean(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
+    DEADBAND_COMMIT_INTEGER(device, interface_name, path, value, exit_code);
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
@@ -730,14 +1222,19 @@ astarte_err_t astarte_device_stream_string_with_timestamp(astarte_device_handle_
     const char *interface_name, const char *path, const char *value, uint64_t ts_epoch_millis,
     int qos)
 {
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_string(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
@@ -745,28 +1242,55 @@ astarte_err_t astarte_device_stream_binaryblob_with_timestamp(astarte_device_han
     const char *interface_name, const char *path, void *value, size_t size,
     uint64_t ts_epoch_millis, int qos)
 {
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_binary(bson, "v", value, size);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
+astarte_err_t astarte_device_stream_binaryblob_in_place(astarte_device_handle_t device,
+    const char *interface_name, const char *path, void *buffer, size_t blob_size,
+    uint64_t ts_epoch_millis, int qos)
+{
+    if (blob_size > ASTARTE_BLOB_ENVELOPE_MAX_BLOB_SIZE) {
+        ESP_LOGE(TAG, "Blob of %zu bytes is too long for MQTT publish.", blob_size);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    size_t len = astarte_blob_envelope_wrap(
+        buffer, blob_size, ts_epoch_millis != ASTARTE_INVALID_TIMESTAMP, ts_epoch_millis);
+    STATS_RECORD(device, publish_serialize, serialize_start_us);
+
+    return publish_data(device, interface_name, path, buffer, (int) len, qos);
+}
+
 astarte_err_t astarte_device_stream_datetime_with_timestamp(astarte_device_handle_t device,
     const char *interface_name, const char *path, int64_t value, uint64_t ts_epoch_millis, int qos)
 {
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_datetime(bson, "v", value);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
 
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
@@ -775,14 +1299,19 @@ astarte_err_t astarte_device_stream_datetime_with_timestamp(astarte_device_handl
         astarte_device_handle_t device, const char *interface_name, const char *path, TYPE value,  \
         int count, uint64_t ts_epoch_millis, int qos)                                              \
     {                                                                                              \
+        PUBLISH_SCRATCH_BEGIN(device);                                                             \
+        int64_t serialize_start_us = STATS_TIMESTAMP();                                            \
+        ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);                                              \
         astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();                     \
         astarte_bson_serializer_append_##BSON_TYPE_NAME(bson, "v", value, count);                  \
         maybe_append_timestamp(bson, ts_epoch_millis);                                             \
         astarte_bson_serializer_append_end_of_document(bson);                                      \
                                                                                                    \
-        astarte_err_t exit_code = publish_bson(device, interface_name, path, bson, qos);           \
+        astarte_err_t exit_code                                                                    \
+            = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);           \
                                                                                                    \
         astarte_bson_serializer_destroy(bson);                                                     \
+        PUBLISH_SCRATCH_END(device);                                                               \
         return exit_code;                                                                          \
     }
 
@@ -797,6 +1326,9 @@ astarte_err_t astarte_device_stream_binaryblob_array_with_timestamp(astarte_devi
     const char *interface_name, const char *path, const void *const *values, const int *sizes,
     int count, uint64_t ts_epoch_millis, int qos)
 {
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_err_t exit_code
         = astarte_bson_serializer_append_binary_array(bson, "v", values, sizes, count);
@@ -804,10 +1336,11 @@ astarte_err_t astarte_device_stream_binaryblob_array_with_timestamp(astarte_devi
     astarte_bson_serializer_append_end_of_document(bson);
 
     if (exit_code == ASTARTE_OK) {
-        exit_code = publish_bson(device, interface_name, path, bson, qos);
+        exit_code = publish_bson(device, interface_name, path, bson, qos, serialize_start_us);
     }
 
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
@@ -815,14 +1348,19 @@ astarte_err_t astarte_device_stream_aggregate_with_timestamp(astarte_device_hand
     const char *interface_name, const char *path_prefix, const void *bson_document,
     uint64_t ts_epoch_millis, int qos)
 {
+    PUBLISH_SCRATCH_BEGIN(device);
+    int64_t serialize_start_us = STATS_TIMESTAMP();
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_SERIALIZE);
     astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
     astarte_bson_serializer_append_document(bson, "v", bson_document);
     maybe_append_timestamp(bson, ts_epoch_millis);
     astarte_bson_serializer_append_end_of_document(bson);
 
-    astarte_err_t exit_code = publish_bson(device, interface_name, path_prefix, bson, qos);
+    astarte_err_t exit_code
+        = publish_bson(device, interface_name, path_prefix, bson, qos, serialize_start_us);
 
     astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
     return exit_code;
 }
 
@@ -927,34 +1465,44 @@ astarte_err_t astarte_device_set_datetime_property(
 astarte_err_t astarte_device_unset_path(
     astarte_device_handle_t device, const char *interface_name, const char *path)
 {
+    astarte_err_t exit_code = ASTARTE_OK;
+    PUBLISH_SCRATCH_BEGIN(device);
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-    astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
     if (interface && (interface->type == TYPE_PROPERTIES)) {
         // Open storage
         astarte_storage_handle_t storage_handle;
-        astarte_err_t storage_err = astarte_storage_open(&storage_handle);
+        astarte_err_t storage_err = open_storage(device, &storage_handle);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error opening storage.");
-            return ASTARTE_ERR;
+            exit_code = ASTARTE_ERR;
+            goto end;
         }
         // Delete property
         ESP_LOGD(TAG, "Deleting device property '%s%s' from storage", interface_name, path);
         storage_err = astarte_storage_delete_property(storage_handle, interface_name, path);
         if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
             ESP_LOGE(TAG, "Error deleting property from storage.");
-            astarte_storage_close(storage_handle);
-            return ASTARTE_ERR;
+            close_storage(device, storage_handle, storage_err);
+            exit_code = ASTARTE_ERR;
+            goto end;
         }
         if (storage_err == ASTARTE_ERR_NOT_FOUND) {
             ESP_LOGW(TAG, "Trying to unset property already unset: '%s%s'.", interface_name, path);
-            astarte_storage_close(storage_handle);
-            return ASTARTE_OK;
+            close_storage(device, storage_handle, storage_err);
+            goto end;
         }
         // Close storage
-        astarte_storage_close(storage_handle);
+        close_storage(device, storage_handle, storage_err);
     }
 #endif
-    return publish_data(device, interface_name, path, "", 0, 2);
+    exit_code = publish_data(device, interface_name, path, "", 0, 2);
+
+#ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
+end:
+#endif
+    PUBLISH_SCRATCH_END(device);
+    return exit_code;
 }
 
 bool astarte_device_is_connected(astarte_device_handle_t device)
@@ -967,29 +1515,66 @@ char *astarte_device_get_encoded_id(astarte_device_handle_t device)
     return device->encoded_hwid;
 }
 
-static astarte_err_t retrieve_credentials(astarte_pairing_config_t *pairing_config)
+astarte_err_t astarte_device_get_stats(
+    astarte_device_handle_t device, astarte_device_stats_t *stats)
+{
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    xSemaphoreTake(device->stats_mutex, portMAX_DELAY);
+    *stats = device->stats;
+    xSemaphoreGive(device->stats_mutex);
+    stats->mqtt_outbox_size = device->transport_client
+        ? device->transport.ops->get_outbox_size(device->transport_client)
+        : 0;
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    stats->scratch_publish_peak = astarte_scratch_high_water(&device->publish_scratch);
+    stats->scratch_receive_peak = astarte_scratch_high_water(&device->receive_scratch);
+    stats->scratch_failures = astarte_scratch_failures(&device->publish_scratch)
+        + astarte_scratch_failures(&device->receive_scratch);
+#endif
+    return ASTARTE_OK;
+#else
+    (void) device;
+    memset(stats, 0, sizeof(astarte_device_stats_t));
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+void astarte_device_reset_stats(astarte_device_handle_t device)
+{
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+    xSemaphoreTake(device->stats_mutex, portMAX_DELAY);
+    memset(&device->stats, 0, sizeof(astarte_device_stats_t));
+    xSemaphoreGive(device->stats_mutex);
+#else
+    (void) device;
+#endif
+}
+
+static astarte_err_t retrieve_credentials(
+    astarte_device_handle_t device, astarte_pairing_session_handle_t pairing_session)
 {
     astarte_err_t ret = ASTARTE_ERR;
     char *cert_pem = NULL;
-    char *csr = calloc(CSR_LENGTH, sizeof(char));
+    char *csr = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, CSR_LENGTH, sizeof(char));
     if (!csr) {
         ret = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto exit;
     }
-    ret = astarte_credentials_get_csr(csr, CSR_LENGTH);
+    ret = astarte_credentials_ctx_get_csr(device->credentials_context, csr, CSR_LENGTH);
     if (ret != ASTARTE_OK) {
         ESP_LOGE(TAG, "Error in get_csr");
         goto exit;
     }
 
-    cert_pem = calloc(CERT_LENGTH, sizeof(char));
+    cert_pem = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, CERT_LENGTH, sizeof(char));
     if (!cert_pem) {
         ret = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto exit;
     }
-    ret = astarte_pairing_get_mqtt_v1_credentials(pairing_config, csr, cert_pem, CERT_LENGTH);
+    ret = astarte_pairing_session_get_mqtt_v1_credentials(
+        pairing_session, csr, cert_pem, CERT_LENGTH);
     if (ret != ASTARTE_OK) {
         ESP_LOGE(TAG, "Error in get_mqtt_v1_credentials");
         goto exit;
@@ -997,7 +1582,7 @@ static astarte_err_t retrieve_credentials(astarte_pairing_config_t *pairing_conf
         ESP_LOGD(TAG, "Got credentials");
     }
 
-    ret = astarte_credentials_save_certificate(cert_pem);
+    ret = astarte_credentials_ctx_save_certificate(device->credentials_context, cert_pem);
     if (ret != ASTARTE_OK) {
         ESP_LOGE(TAG, "Error in get_mqtt_v1_credentials");
         goto exit;
@@ -1008,15 +1593,15 @@ static astarte_err_t retrieve_credentials(astarte_pairing_config_t *pairing_conf
     ret = ASTARTE_OK;
 
 exit:
-    free(csr);
-    free(cert_pem);
+    astarte_alloc_free(csr);
+    astarte_alloc_free(cert_pem);
     return ret;
 }
 
 static astarte_err_t check_device(astarte_device_handle_t device)
 {
-    if (!device->mqtt_client) {
-        ESP_LOGE(TAG, "NULL mqtt_client");
+    if (!device->transport_client) {
+        ESP_LOGE(TAG, "NULL transport_client");
         return ASTARTE_ERR;
     }
 
@@ -1066,8 +1651,6 @@ static void send_introspection(astarte_device_handle_t device)
         return;
     }
 
-    esp_mqtt_client_handle_t mqtt = device->mqtt_client;
-
     size_t introspection_size = get_introspection_string_size(device);
 
     // if introspection size is > 4KiB print a warning
@@ -1076,7 +1659,8 @@ static void send_introspection(astarte_device_handle_t device)
         ESP_LOGW(TAG, "The introspection size is > 4KiB");
     }
 
-    char *introspection_string = calloc(introspection_size + 1, sizeof(char));
+    char *introspection_string = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, introspection_size + 1, sizeof(char));
     if (!introspection_string) {
         ESP_LOGE(TAG, "Unable to allocate memory for introspection string");
         return;
@@ -1100,8 +1684,8 @@ static void send_introspection(astarte_device_handle_t device)
     len -= 1;
 
     ESP_LOGD(TAG, "Publishing introspection: %s", introspection_string);
-    esp_mqtt_client_publish(mqtt, device->device_topic, introspection_string, len, 2, 0);
-    free(introspection_string);
+    publish_control(device, device->device_topic, introspection_string, len);
+    astarte_alloc_free(introspection_string);
 }
 
 static void setup_subscriptions(astarte_device_handle_t device)
@@ -1112,7 +1696,7 @@ static void setup_subscriptions(astarte_device_handle_t device)
 
     char topic[TOPIC_LENGTH] = { 0 };
 
-    esp_mqtt_client_handle_t mqtt = device->mqtt_client;
+    void *client = device->transport_client;
 
     // Subscribe to control messages
     int ret = snprintf(topic, TOPIC_LENGTH, "%s/control/consumer/properties", device->device_topic);
@@ -1122,7 +1706,7 @@ static void setup_subscriptions(astarte_device_handle_t device)
     }
 
     ESP_LOGD(TAG, "Subscribing to %s", topic);
-    esp_mqtt_client_subscribe(mqtt, topic, 2);
+    device->transport.ops->subscribe(client, topic, 2);
 
     astarte_linked_list_iterator_t list_iter;
     astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->introspection, &list_iter);
@@ -1138,7 +1722,7 @@ static void setup_subscriptions(astarte_device_handle_t device)
                 continue;
             }
             ESP_LOGD(TAG, "Subscribing to %s", topic);
-            esp_mqtt_client_subscribe(mqtt, topic, 2);
+            device->transport.ops->subscribe(client, topic, 2);
         }
 
         iter_err = astarte_linked_list_iterator_advance(&list_iter);
@@ -1151,8 +1735,6 @@ static void send_emptycache(astarte_device_handle_t device)
         return;
     }
 
-    esp_mqtt_client_handle_t mqtt = device->mqtt_client;
-
     char topic[TOPIC_LENGTH] = { 0 };
     int ret = snprintf(topic, TOPIC_LENGTH, "%s/control/emptyCache", device->device_topic);
     if ((ret < 0) || (ret >= TOPIC_LENGTH)) {
@@ -1160,7 +1742,7 @@ static void send_emptycache(astarte_device_handle_t device)
         return;
     }
     ESP_LOGD(TAG, "Sending emptyCache to %s", topic);
-    esp_mqtt_client_publish(mqtt, topic, "1", 1, 2, 0);
+    publish_control(device, topic, "1", 1);
 }
 
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
@@ -1178,7 +1760,7 @@ static void send_device_owned_properties(astarte_device_handle_t device)
 
     // Open storage
     astarte_storage_handle_t storage_handle;
-    astarte_err_t storage_err = astarte_storage_open(&storage_handle);
+    astarte_err_t storage_err = open_storage(device, &storage_handle);
     if (storage_err != ASTARTE_OK) {
         ESP_LOGE(TAG, "Error opening storage.");
         goto end;
@@ -1189,7 +1771,7 @@ static void send_device_owned_properties(astarte_device_handle_t device)
     storage_err = astarte_storage_iterator_create(storage_handle, &storage_iterator);
     if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
         ESP_LOGE(TAG, "Error creating the properties iterator.");
-        astarte_storage_close(storage_handle);
+        close_storage(device, storage_handle, storage_err);
         goto end;
     }
 
@@ -1202,16 +1784,17 @@ static void send_device_owned_properties(astarte_device_handle_t device)
             &storage_iterator, NULL, &interface_name_len, NULL, &path_len, NULL, NULL, &value_len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error preparing to get one of the properties.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
         // Allocate memory for property data
-        interface_name = calloc(interface_name_len, sizeof(char));
-        path = calloc(path_len, sizeof(char));
-        value = calloc(value_len, sizeof(uint8_t));
+        interface_name = astarte_alloc_calloc(
+            ASTARTE_ALLOC_SUBSYSTEM_DEVICE, interface_name_len, sizeof(char));
+        path = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, path_len, sizeof(char));
+        value = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, value_len, sizeof(uint8_t));
         if (!interface_name || !path || !value) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
         // Fetch property content
@@ -1220,12 +1803,12 @@ static void send_device_owned_properties(astarte_device_handle_t device)
             &interface_name_len, path, &path_len, &major, value, &value_len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error getting one of the properties.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
 
         bool advance_iterator = true;
-        astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+        astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
         // If property is not in introspection anymore, delete it from storage
         if ((!interface) || (interface->major_version != major)) {
             // Check if this is the last iterable item
@@ -1233,7 +1816,7 @@ static void send_device_owned_properties(astarte_device_handle_t device)
             storage_err = astarte_storage_iterator_peek(&storage_iterator, &has_next);
             if (storage_err != ASTARTE_OK) {
                 ESP_LOGE(TAG, "Error peaking next property.");
-                astarte_storage_close(storage_handle);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
             // Delete the property
@@ -1241,7 +1824,7 @@ static void send_device_owned_properties(astarte_device_handle_t device)
             storage_err = astarte_storage_delete_property(storage_handle, interface_name, path);
             if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
                 ESP_LOGE(TAG, "Error deleting the property.");
-                astarte_storage_close(storage_handle);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
             // If the deleted iterm was the last one, break the loop here
@@ -1259,7 +1842,8 @@ static void send_device_owned_properties(astarte_device_handle_t device)
 
             // Get the combined interface_name and path for the property
             size_t property_full_path_len = interface_name_len + path_len - 1;
-            char *property_full_path = calloc(property_full_path_len, sizeof(char));
+            char *property_full_path = astarte_alloc_calloc(
+                ASTARTE_ALLOC_SUBSYSTEM_DEVICE, property_full_path_len, sizeof(char));
             strncat(strncpy(property_full_path, interface_name, interface_name_len), path,
                 path_len - 1);
 
@@ -1268,16 +1852,16 @@ static void send_device_owned_properties(astarte_device_handle_t device)
             if (list_err != ASTARTE_OK) {
                 ESP_LOGE(TAG, "Error adding a property name to the set %s.",
                     astarte_err_to_name(list_err));
-                astarte_storage_close(storage_handle);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
         }
         // Free memory of property data
-        free(interface_name);
+        astarte_alloc_free(interface_name);
         interface_name = NULL;
-        free(path);
+        astarte_alloc_free(path);
         path = NULL;
-        free(value);
+        astarte_alloc_free(value);
         value = NULL;
         // Advance the iterator if required
         if (advance_iterator) {
@@ -1289,7 +1873,7 @@ static void send_device_owned_properties(astarte_device_handle_t device)
     }
 
     // Close astarte storage
-    astarte_storage_close(storage_handle);
+    close_storage(device, storage_handle, storage_err);
 
     // Send purge device properties
     send_purge_device_properties(device, &list_handle);
@@ -1299,9 +1883,9 @@ end:
     astarte_linked_list_destroy_and_release(&list_handle);
 
     // Free all data
-    free(interface_name);
-    free(path);
-    free(value);
+    astarte_alloc_free(interface_name);
+    astarte_alloc_free(path);
+    astarte_alloc_free(value);
 }
 
 static void send_purge_device_properties(
@@ -1315,37 +1899,34 @@ static void send_purge_device_properties(
     char *payload = NULL;
     size_t payload_len = 0;
 
-    // Create the uncompressed properties string
-    char *property_path = NULL;
-    while (astarte_linked_list_remove_tail(list_handle, (void **) &property_path)
-        != ASTARTE_ERR_NOT_FOUND) {
-        // Append interface name to the ';' separated string
-        // properties_list_len includes a +1 for the '\0' char
-        // We add 1 since we need an extra char to store the ';'
-        size_t ext_properties_list_len = properties_list_len + strlen(property_path) + 1;
-        char *ext_properties_list = (char *) realloc(properties_list, ext_properties_list_len);
-        if (!ext_properties_list) {
+    // Compute the length of the string, each name is followed by a ';' or by the '\0' char
+    astarte_linked_list_iterator_t iterator;
+    astarte_err_t iterator_err = astarte_linked_list_iterator_init(list_handle, &iterator);
+    while (iterator_err == ASTARTE_OK) {
+        char *property_path = NULL;
+        astarte_linked_list_iterator_get_item(&iterator, (void **) &property_path);
+        properties_list_len += strlen(property_path) + 1;
+        iterator_err = astarte_linked_list_iterator_advance(&iterator);
+    }
+
+    // Create the uncompressed properties string with a single allocation
+    if (properties_list_len > 0) {
+        properties_list = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, properties_list_len);
+        if (!properties_list) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-            free(property_path);
-            // Deallocate everything from the set
-            while (astarte_linked_list_remove_tail(list_handle, (void **) &property_path)
-                != ASTARTE_ERR_NOT_FOUND) {
-                free(property_path);
-            }
             goto end;
         }
-        if (properties_list_len == 0) {
-            // Set the first char to '\0' for the first interface name
-            *ext_properties_list = '\0';
-        } else {
-            // Append a ';' for any subsequent interface name
-            strcat(ext_properties_list, ";");
+        *properties_list = '\0';
+    }
+    char *property_path = NULL;
+    while (astarte_linked_list_remove_tail(list_handle, (void **) &property_path)
+        != ASTARTE_ERR_NOT_FOUND) {
+        // Append a ';' for any subsequent interface name
+        if (*properties_list != '\0') {
+            strcat(properties_list, ";");
         }
-        // Append the new interface name
-        properties_list = strcat(ext_properties_list, property_path);
-        properties_list_len = ext_properties_list_len;
-
-        free(property_path);
+        strcat(properties_list, property_path);
+        astarte_alloc_free(property_path);
     }
 
     // Estimate compression result size and payload size
@@ -1353,7 +1934,7 @@ static void send_purge_device_properties(
     uLongf compressed_len = compressBound(compression_input_len);
     // Allocate enough memory for the payload
     payload_len = 4 + compressed_len;
-    payload = calloc(payload_len, sizeof(char));
+    payload = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, payload_len, sizeof(char));
     if (!payload) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto end;
@@ -1362,8 +1943,10 @@ static void send_purge_device_properties(
     uint32_t *payload_uint32 = (uint32_t *) payload;
     *payload_uint32 = __builtin_bswap32(compression_input_len);
     // Perform the compression and store result in the payload
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_ZLIB);
     int compress_res = astarte_zlib_compress((char unsigned *) &payload[4], &compressed_len,
         (char unsigned *) properties_list, compression_input_len);
+    ASTARTE_TRACE_END(ASTARTE_TRACE_ZLIB);
     if (compress_res != Z_OK) {
         ESP_LOGE(TAG, "Compression error %d.", compress_res);
         goto end;
@@ -1384,21 +1967,21 @@ static void send_purge_device_properties(
         ESP_LOGE(TAG, "Error encoding topic");
         goto end;
     }
-    // Set constant for MQTT QoS
-    const int qos = 2;
     // Publish MQTT message
     ESP_LOGD(TAG, "Sending purge properties to: '%s', with uncompressed content: '%s'", topic,
         (properties_list) ? properties_list : "");
-    esp_mqtt_client_publish(device->mqtt_client, topic, payload, (int) payload_len, qos, 0);
+    publish_control(device, topic, payload, (int) payload_len);
 
 end:
-    free(properties_list);
-    free(payload);
+    astarte_alloc_free(properties_list);
+    astarte_alloc_free(payload);
 }
 #endif
 
 static void on_connected(astarte_device_handle_t device, int session_present)
 {
+    BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_MQTT_CONNECT);
+    STATS_COUNT(device, connections);
     device->connected = true;
 
     if (device->connection_event_callback) {
@@ -1411,21 +1994,38 @@ static void on_connected(astarte_device_handle_t device, int session_present)
         device->connection_event_callback(&event);
     }
 
-    if (session_present) {
-        return;
+    if (!session_present) {
+        BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_SUBSCRIPTIONS);
+        setup_subscriptions(device);
+        BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_SUBSCRIPTIONS);
+        BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_INTROSPECTION);
+        send_introspection(device);
+        BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_INTROSPECTION);
+        BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_PROPERTIES_RESYNC);
+        send_emptycache(device);
+#ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
+        send_device_owned_properties(device);
+#endif
+        BOOT_PROFILE_END(ASTARTE_BOOT_PHASE_PROPERTIES_RESYNC);
     }
 
-    setup_subscriptions(device);
-    send_introspection(device);
-    send_emptycache(device);
-#ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-    send_device_owned_properties(device);
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    // The session is set up, messages queued while offline can now be drained after it
+    astarte_device_lanes_open(device);
+#endif
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+    astarte_device_coalescing_schedule_flush(device);
 #endif
 }
 
 static void on_disconnected(astarte_device_handle_t device)
 {
+    STATS_COUNT(device, disconnections);
     device->connected = false;
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+    astarte_device_lanes_close(device);
+#endif
 
     if (device->disconnection_event_callback) {
         astarte_device_disconnection_event_t event = {
@@ -1498,11 +2098,11 @@ static void on_incoming(
 
     if (!data && data_len == 0) {
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-        astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+        astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
         if (interface && (interface->type == TYPE_PROPERTIES)) {
             // Open storage
             astarte_storage_handle_t storage_handle;
-            astarte_err_t storage_err = astarte_storage_open(&storage_handle);
+            astarte_err_t storage_err = open_storage(device, &storage_handle);
             if (storage_err != ASTARTE_OK) {
                 ESP_LOGE(TAG, "Error opening storage.");
                 return;
@@ -1514,7 +2114,7 @@ static void on_incoming(
                 ESP_LOGE(TAG, "Error deleting property from storage.");
             }
             // Close storage
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             if (storage_err != ASTARTE_OK) {
                 return;
             }
@@ -1541,11 +2141,11 @@ static void on_incoming(
     }
 
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-    astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
     if (interface && (interface->type == TYPE_PROPERTIES)) {
         // Open storage
         astarte_storage_handle_t storage_handle;
-        astarte_err_t storage_err = astarte_storage_open(&storage_handle);
+        astarte_err_t storage_err = open_storage(device, &storage_handle);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error opening storage.");
             return;
@@ -1556,14 +2156,14 @@ static void on_incoming(
             interface->major_version, data, data_len, &is_contained);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error checking if received property is in storage.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return;
         }
         if (is_contained) {
             ESP_LOGD(TAG,
                 "Trying to set a server property already stored with the same value: %s%s.",
                 interface_name, path);
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return;
         }
 
@@ -1573,11 +2173,11 @@ static void on_incoming(
             storage_handle, interface_name, path, interface->major_version, data, data_len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error storing received property.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             return;
         }
         // Close storage
-        astarte_storage_close(storage_handle);
+        close_storage(device, storage_handle, storage_err);
     }
 #endif
 
@@ -1665,7 +2265,7 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
 
     // Open storage
     astarte_storage_handle_t storage_handle;
-    if (ASTARTE_OK != astarte_storage_open(&storage_handle)) {
+    if (ASTARTE_OK != open_storage(device, &storage_handle)) {
         ESP_LOGE(TAG, "Error opening storage.");
         goto end;
     }
@@ -1675,7 +2275,7 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
     astarte_err_t storage_err = astarte_storage_iterator_create(storage_handle, &storage_iterator);
     if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
         ESP_LOGE(TAG, "Error creating the properties iterator.");
-        astarte_storage_close(storage_handle);
+        close_storage(device, storage_handle, storage_err);
         goto end;
     }
 
@@ -1689,17 +2289,18 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
             &storage_iterator, NULL, &interface_name_len, NULL, &path_len, NULL, NULL, &value_len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error fetching property lengths.");
-            astarte_storage_close(storage_handle);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
         // Allocate memory for property data
-        char *interface_name = calloc(interface_name_len, sizeof(char));
-        char *path = calloc(path_len, sizeof(char));
+        char *interface_name = astarte_alloc_calloc(
+            ASTARTE_ALLOC_SUBSYSTEM_DEVICE, interface_name_len, sizeof(char));
+        char *path = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, path_len, sizeof(char));
         if (!interface_name || !path) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-            free(interface_name);
-            free(path);
-            astarte_storage_close(storage_handle);
+            astarte_alloc_free(interface_name);
+            astarte_alloc_free(path);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
         // Fetch property interface name and path
@@ -1708,15 +2309,15 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
             &interface_name_len, path, &path_len, &major, NULL, &value_len);
         if (storage_err != ASTARTE_OK) {
             ESP_LOGE(TAG, "Error fetching property data.");
-            free(interface_name);
-            free(path);
-            astarte_storage_close(storage_handle);
+            astarte_alloc_free(interface_name);
+            astarte_alloc_free(path);
+            close_storage(device, storage_handle, storage_err);
             goto end;
         }
 
         // If interface is in introspection and is server owned, search for it in the purge
         // properties list
-        astarte_interface_t *interface = get_interface_from_introspection(device, interface_name);
+        astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
         bool advance_iterator = true;
         bool interface_in_purge_prop_list = false;
         if (interface && (interface->ownership == OWNERSHIP_SERVER)
@@ -1724,7 +2325,8 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
 
             // Format full property name
             size_t full_prop_len = interface_name_len + path_len - 1;
-            char *full_prop = calloc(full_prop_len, sizeof(char));
+            char *full_prop
+                = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, full_prop_len, sizeof(char));
             full_prop = strncat(strncpy(full_prop, interface_name, full_prop_len), path,
                 full_prop_len - strlen(interface_name) - 1);
             // Iterate over the purge properties list
@@ -1744,7 +2346,7 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
                 err = astarte_linked_list_iterator_advance(&iterator);
             }
             // Free full property name
-            free(full_prop);
+            astarte_alloc_free(full_prop);
         }
 
         // Delete from storage if interface:
@@ -1758,9 +2360,9 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
             storage_err = astarte_storage_iterator_peek(&storage_iterator, &has_next);
             if (storage_err != ASTARTE_OK) {
                 ESP_LOGE(TAG, "Error peaking next property.");
-                free(interface_name);
-                free(path);
-                astarte_storage_close(storage_handle);
+                astarte_alloc_free(interface_name);
+                astarte_alloc_free(path);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
             // Delete property
@@ -1768,45 +2370,45 @@ static void on_purge_properties(astarte_device_handle_t device, char *data, int
             storage_err = astarte_storage_delete_property(storage_handle, interface_name, path);
             if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
                 ESP_LOGE(TAG, "Error deleting the property.");
-                free(interface_name);
-                free(path);
-                astarte_storage_close(storage_handle);
+                astarte_alloc_free(interface_name);
+                astarte_alloc_free(path);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
             // If it was the last property, exit
             if (!has_next) {
-                free(interface_name);
-                free(path);
-                astarte_storage_close(storage_handle);
+                astarte_alloc_free(interface_name);
+                astarte_alloc_free(path);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
             advance_iterator = false; // Iterator has been advanced by the delete function
         }
 
         // Free individual property data
-        free(interface_name);
-        free(path);
+        astarte_alloc_free(interface_name);
+        astarte_alloc_free(path);
 
         // Advance the iterator if required
         if (advance_iterator) {
             storage_err = astarte_storage_iterator_advance(&storage_iterator);
             if ((storage_err != ASTARTE_OK) && (storage_err != ASTARTE_ERR_NOT_FOUND)) {
                 ESP_LOGE(TAG, "Error iterating through the properties.");
-                astarte_storage_close(storage_handle);
+                close_storage(device, storage_handle, storage_err);
                 goto end;
             }
         }
     }
 
     // Close storage
-    astarte_storage_close(storage_handle);
+    close_storage(device, storage_handle, storage_err);
 
 end:
     // Destroy the linked list
     // No need to free the memory as all the data contained in this list is part of uncompressed
     astarte_linked_list_destroy(&list_handle);
     // Free uncompressed payload
-    free(uncompressed);
+    astarte_alloc_free(uncompressed);
 }
 
 static astarte_err_t uncompress_purge_properties(
@@ -1815,7 +2417,8 @@ static astarte_err_t uncompress_purge_properties(
     char *uncompressed = NULL;
     uLongf uncompressed_len = __builtin_bswap32(*(uint32_t *) data);
     if (uncompressed_len != 0) {
-        uncompressed = calloc(uncompressed_len + 1, sizeof(char));
+        uncompressed = astarte_alloc_calloc(
+            ASTARTE_ALLOC_SUBSYSTEM_DEVICE, uncompressed_len + 1, sizeof(char));
         if (!uncompressed) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
             return ASTARTE_ERR_OUT_OF_MEMORY;
@@ -1824,7 +2427,7 @@ static astarte_err_t uncompress_purge_properties(
             (char unsigned *) data + 4, data_len - 4);
         if (uncompress_res != Z_OK) {
             ESP_LOGE(TAG, "Decompression error %d.", uncompress_res);
-            free(uncompressed);
+            astarte_alloc_free(uncompressed);
             return ASTARTE_ERR;
         }
     }
@@ -1867,61 +2470,224 @@ static void on_certificate_error(astarte_device_handle_t device)
     }
 }
 
-static void mqtt_event_handler(
-    void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+static void transport_event_handler(void *handler_data, const astarte_transport_event_t *event)
 {
-    (void) base;
-
-    esp_mqtt_event_handle_t event = event_data;
-    astarte_device_handle_t device = (astarte_device_handle_t) handler_args;
-    switch ((esp_mqtt_event_id_t) event_id) {
-        case MQTT_EVENT_BEFORE_CONNECT:
-            ESP_LOGD(TAG, "MQTT_EVENT_BEFORE_CONNECT");
+    astarte_device_handle_t device = (astarte_device_handle_t) handler_data;
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Only the MQTT task uses the receive arena, no locking is needed
+    astarte_scratch_mark_t scratch_mark = astarte_scratch_begin(&device->receive_scratch);
+#endif
+    switch (event->id) {
+        case ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT");
+            BOOT_PROFILE_BEGIN(ASTARTE_BOOT_PHASE_MQTT_CONNECT);
             break;
 
-        case MQTT_EVENT_CONNECTED:
-            ESP_LOGD(TAG, "MQTT_EVENT_CONNECTED");
+        case ASTARTE_TRANSPORT_EVENT_CONNECTED:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_CONNECTED");
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+            astarte_device_topic_aliases_reset(device);
+#endif
             on_connected(device, event->session_present);
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+            astarte_device_outbox_on_drained(device);
+#endif
             break;
 
-        case MQTT_EVENT_DISCONNECTED:
-            ESP_LOGD(TAG, "MQTT_EVENT_DISCONNECTED");
+        case ASTARTE_TRANSPORT_EVENT_DISCONNECTED:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_DISCONNECTED");
             on_disconnected(device);
             break;
 
-        case MQTT_EVENT_SUBSCRIBED:
-            ESP_LOGD(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", event->msg_id);
-            break;
-
-        case MQTT_EVENT_UNSUBSCRIBED:
-            ESP_LOGD(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", event->msg_id);
+        case ASTARTE_TRANSPORT_EVENT_PUBLISHED:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+            // The acknowledged message might have relieved the outbox
+            astarte_device_coalescing_schedule_flush(device);
+#endif
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+            astarte_device_tracking_on_ack(
+                device, event->msg_id, ASTARTE_PUBLISH_RESULT_DELIVERED);
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+            astarte_device_outbox_on_drained(device);
+#endif
             break;
 
-        case MQTT_EVENT_PUBLISHED:
-            ESP_LOGD(TAG, "MQTT_EVENT_PUBLISHED, msg_id=%d", event->msg_id);
+        case ASTARTE_TRANSPORT_EVENT_DELETED:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_DELETED, msg_id=%d", event->msg_id);
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+            astarte_device_tracking_on_ack(
+                device, event->msg_id, ASTARTE_PUBLISH_RESULT_EXPIRED);
+#endif
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+            astarte_device_outbox_on_drained(device);
+#endif
             break;
 
-        case MQTT_EVENT_DATA:
-            ESP_LOGD(TAG, "MQTT_EVENT_DATA");
-            on_incoming(device, event->topic, event->topic_len, event->data, event->data_len);
+        case ASTARTE_TRANSPORT_EVENT_DATA: {
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_DATA");
+            int64_t dispatch_start_us = STATS_TIMESTAMP();
+            ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_INCOMING);
+            // The incoming message is only read
+            on_incoming(device, (char *) event->topic, event->topic_len, (char *) event->data,
+                event->data_len);
+            ASTARTE_TRACE_END(ASTARTE_TRACE_INCOMING);
+            STATS_COUNT(device, incoming_messages);
+            STATS_RECORD(device, incoming_dispatch, dispatch_start_us);
             break;
+        }
 
-        case MQTT_EVENT_ERROR:
-            ESP_LOGD(TAG, "MQTT_EVENT_ERROR");
-            if (event->error_handle->error_type == MQTT_ERROR_TYPE_ESP_TLS) {
+        case ASTARTE_TRANSPORT_EVENT_ERROR:
+            ESP_LOGD(TAG, "ASTARTE_TRANSPORT_EVENT_ERROR");
+            STATS_COUNT(device, connection_errors);
+            if (event->error == ASTARTE_TRANSPORT_ERROR_TLS) {
                 on_certificate_error(device);
             }
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+            if (event->error == ASTARTE_TRANSPORT_ERROR_CONNECTION_REFUSED) {
+                astarte_device_topic_aliases_on_refused(device, event->connect_return_code);
+            }
+#endif
             break;
 
         default:
-            // Handle MQTT_EVENT_ANY introduced in esp-idf 3.2
             break;
     }
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_end(scratch_mark);
+#endif
 }
 
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
-static astarte_interface_t *get_interface_from_introspection(
-    astarte_device_handle_t device, const char *name)
+static astarte_err_t open_storage(
+    astarte_device_handle_t device, astarte_storage_handle_t *storage_handle)
+{
+    ASTARTE_TRACE_BEGIN(ASTARTE_TRACE_STORAGE);
+    astarte_err_t res = astarte_storage_open(storage_handle);
+    if (res != ASTARTE_OK) {
+        ASTARTE_TRACE_END(ASTARTE_TRACE_STORAGE);
+        STATS_COUNT(device, storage_ops);
+        STATS_COUNT(device, storage_errors);
+    }
+    return res;
+}
+
+// NOLINTNEXTLINE(misc-unused-parameters)
+static void close_storage(astarte_device_handle_t device, astarte_storage_handle_t storage_handle,
+    astarte_err_t result)
+{
+    astarte_storage_close(storage_handle);
+    ASTARTE_TRACE_END(ASTARTE_TRACE_STORAGE);
+    STATS_COUNT(device, storage_ops);
+    if ((result != ASTARTE_OK) && (result != ASTARTE_ERR_NOT_FOUND)) {
+        STATS_COUNT(device, storage_errors);
+    }
+    STATS_RECORD(device, storage_op, storage_handle.open_time_us);
+}
+#endif
+
+#ifdef CONFIG_ASTARTE_DEVICE_STATS
+void astarte_device_stats_count(astarte_device_handle_t device, uint32_t *counter)
+{
+    xSemaphoreTake(device->stats_mutex, portMAX_DELAY);
+    (*counter)++;
+    xSemaphoreGive(device->stats_mutex);
+}
+
+void astarte_device_stats_record(
+    astarte_device_handle_t device, astarte_latency_histogram_t *histogram, int64_t start_us)
+{
+    int64_t latency_us = esp_timer_get_time() - start_us;
+    xSemaphoreTake(device->stats_mutex, portMAX_DELAY);
+    astarte_latency_histogram_record(histogram, latency_us);
+    xSemaphoreGive(device->stats_mutex);
+}
+#endif
+
+#if CONFIG_ASTARTE_DEVICE_STATS_REPORT_INTERVAL_S > 0
+static void send_stats_report(astarte_device_handle_t device)
+{
+    astarte_device_stats_t stats;
+    astarte_device_get_stats(device, &stats);
+
+    PUBLISH_SCRATCH_BEGIN(device);
+    astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
+    if (!bson) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        PUBLISH_SCRATCH_END(device);
+        return;
+    }
+    astarte_bson_serializer_append_int64(bson, "publishOk", stats.publish_ok);
+    astarte_bson_serializer_append_int64(bson, "publishFailed", stats.publish_failed);
+    astarte_bson_serializer_append_int64(bson, "publishNotReady", stats.publish_not_ready);
+    astarte_bson_serializer_append_int64(bson, "publishEnqueueP95Us",
+        astarte_latency_histogram_percentile(&stats.publish_enqueue, STATS_REPORT_PERCENTILE));
+    astarte_bson_serializer_append_int64(bson, "mqttOutboxSize", stats.mqtt_outbox_size);
+    astarte_bson_serializer_append_int64(bson, "incomingMessages", stats.incoming_messages);
+    astarte_bson_serializer_append_int64(bson, "incomingDispatchP95Us",
+        astarte_latency_histogram_percentile(&stats.incoming_dispatch, STATS_REPORT_PERCENTILE));
+    astarte_bson_serializer_append_int64(bson, "storageOps", stats.storage_ops);
+    astarte_bson_serializer_append_int64(bson, "storageErrors", stats.storage_errors);
+    astarte_bson_serializer_append_int64(bson, "storageOpP95Us",
+        astarte_latency_histogram_percentile(&stats.storage_op, STATS_REPORT_PERCENTILE));
+    astarte_bson_serializer_append_int64(bson, "connections", stats.connections);
+    astarte_bson_serializer_append_int64(bson, "disconnections", stats.disconnections);
+    astarte_bson_serializer_append_int64(bson, "connectionErrors", stats.connection_errors);
+    astarte_bson_serializer_append_int64(bson, "reinits", stats.reinits);
+    astarte_bson_serializer_append_int64(bson, "certificateRenewals", stats.certificate_renewals);
+    astarte_bson_serializer_append_end_of_document(bson);
+
+    int size = 0;
+    const void *document = astarte_bson_serializer_get_document(bson, &size);
+    if (document) {
+        astarte_err_t res = astarte_device_stream_aggregate(
+            device, STATS_INTERFACE_NAME, STATS_PATH_PREFIX, document, 0);
+        if (res != ASTARTE_OK) {
+            ESP_LOGW(TAG, "Cannot send the statistics report: %s", astarte_err_to_name(res));
+        }
+    }
+    astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
+}
+#endif
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+astarte_scratch_mark_t astarte_device_publish_scratch_begin(astarte_device_handle_t device)
+{
+    // Publishes nested in another operation, as the ones done from the data callbacks, keep using
+    // the arena already active on the task and must not wait for the publish one
+    if (!astarte_scratch_is_active()) {
+        xSemaphoreTake(device->publish_scratch_mutex, portMAX_DELAY);
+        device->publish_scratch_holder = xTaskGetCurrentTaskHandle();
+    }
+    return astarte_scratch_begin(&device->publish_scratch);
+}
+
+void astarte_device_publish_scratch_end(
+    astarte_device_handle_t device, astarte_scratch_mark_t mark)
+{
+    astarte_scratch_end(mark);
+    if (mark.activated) {
+        device->publish_scratch_holder = NULL;
+        xSemaphoreGive(device->publish_scratch_mutex);
+    }
+}
+#endif
+
+uint64_t astarte_device_get_epoch_timestamp(int64_t monotonic_us)
+{
+    struct timeval now;
+    gettimeofday(&now, NULL);
+    if (now.tv_sec < VALID_CLOCK_MIN_EPOCH_S) {
+        // Without a valid clock Astarte uses the reception time
+        return ASTARTE_INVALID_TIMESTAMP;
+    }
+    int64_t now_ms = (int64_t) now.tv_sec * 1000 + now.tv_usec / 1000;
+    return (uint64_t) (now_ms - (esp_timer_get_time() - monotonic_us) / 1000);
+}
+
+astarte_interface_t *astarte_device_get_interface(astarte_device_handle_t device, const char *name)
 {
     astarte_linked_list_iterator_t list_iter;
     astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->introspection, &list_iter);
@@ -1935,4 +2701,3 @@ static astarte_interface_t *get_interface_from_introspection(
     }
     return NULL;
 }
-#endif
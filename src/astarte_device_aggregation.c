@@ -0,0 +1,263 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_aggregation.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_AGGREGATION
+#include <astarte_sample_window.h>
+#endif
+
+#include <esp_log.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_AGGREGATION"
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+#define AGGREGATOR_REDUCERS_MASK                                                                   \
+    (ASTARTE_REDUCER_MIN | ASTARTE_REDUCER_MAX | ASTARTE_REDUCER_MEAN | ASTARTE_REDUCER_LAST       \
+        | ASTARTE_REDUCER_COUNT)
+
+struct astarte_aggregator
+{
+    astarte_sample_window_t window;
+    astarte_device_handle_t device;
+    char *interface_name;
+    char *path;
+    uint32_t reducers;
+    int qos;
+    esp_timer_handle_t timer;
+};
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+static void aggregator_timer_callback(void *arg);
+static void publish_window(
+    astarte_aggregator_handle_t aggregator, const astarte_window_summary_t *summary);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_add_aggregator(astarte_device_handle_t device,
+    const astarte_aggregator_config_t *config, astarte_aggregator_handle_t *aggregator)
+{
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    *aggregator = NULL;
+    if (config->path[0] != '/') {
+        ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", config->path);
+        return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+    }
+    if (config->qos < 0 || config->qos > 2) {
+        ESP_LOGE(TAG, "Invalid QoS: %d (must be 0, 1 or 2)", config->qos);
+        return ASTARTE_ERR_INVALID_QOS;
+    }
+    if (config->window_ms == 0) {
+        ESP_LOGE(TAG, "Invalid aggregation window of 0 ms");
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    if ((config->reducers == 0) || (config->reducers & ~AGGREGATOR_REDUCERS_MASK)) {
+        ESP_LOGE(TAG, "Invalid reducers: 0x%" PRIx32, config->reducers);
+        return ASTARTE_ERR;
+    }
+
+    size_t interface_name_size = strlen(config->interface_name) + 1;
+    size_t path_size = strlen(config->path) + 1;
+    astarte_aggregator_handle_t new_aggregator
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1,
+            sizeof(struct astarte_aggregator) + interface_name_size + path_size);
+    if (!new_aggregator) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    new_aggregator->device = device;
+    new_aggregator->interface_name = (char *) (new_aggregator + 1);
+    memcpy(new_aggregator->interface_name, config->interface_name, interface_name_size);
+    new_aggregator->path = new_aggregator->interface_name + interface_name_size;
+    memcpy(new_aggregator->path, config->path, path_size);
+    new_aggregator->reducers = config->reducers;
+    new_aggregator->qos = config->qos;
+    astarte_sample_window_init(&new_aggregator->window, esp_timer_get_time());
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = aggregator_timer_callback,
+        .arg = new_aggregator,
+        .name = "astarte_aggregator",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &new_aggregator->timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create the aggregator timer: %s", esp_err_to_name(err));
+        astarte_alloc_free(new_aggregator);
+        return ASTARTE_ERR_ESP_SDK;
+    }
+
+    xSemaphoreTake(device->aggregators_mutex, portMAX_DELAY);
+    astarte_err_t res = astarte_linked_list_append(&device->aggregators, new_aggregator);
+    if (res == ASTARTE_OK) {
+        err = esp_timer_start_periodic(new_aggregator->timer, config->window_ms * 1000ULL);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot start the aggregator timer: %s", esp_err_to_name(err));
+            void *removed = NULL;
+            astarte_linked_list_remove_tail(&device->aggregators, &removed);
+            res = ASTARTE_ERR_ESP_SDK;
+        }
+    }
+    xSemaphoreGive(device->aggregators_mutex);
+
+    if (res != ASTARTE_OK) {
+        esp_timer_delete(new_aggregator->timer);
+        astarte_alloc_free(new_aggregator);
+        return res;
+    }
+    *aggregator = new_aggregator;
+    return ASTARTE_OK;
+#else
+    (void) device;
+    (void) config;
+    *aggregator = NULL;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+void astarte_aggregator_push(astarte_aggregator_handle_t aggregator, double sample)
+{
+#ifdef CONFIG_ASTARTE_AGGREGATION
+    astarte_sample_window_push(&aggregator->window, sample);
+#else
+    (void) aggregator;
+    (void) sample;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+astarte_err_t astarte_device_aggregation_init(astarte_device_handle_t device)
+{
+    device->aggregators = astarte_linked_list_init();
+    device->aggregators_mutex = xSemaphoreCreateMutex();
+    if (!device->aggregators_mutex) {
+        ESP_LOGE(TAG, "Cannot create aggregators_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_aggregation_stop(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->aggregators, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_aggregator_handle_t aggregator = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &aggregator);
+        esp_timer_stop(aggregator->timer);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+}
+
+void astarte_device_aggregation_destroy(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->aggregators, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_aggregator_handle_t aggregator = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &aggregator);
+        esp_timer_stop(aggregator->timer);
+        esp_timer_delete(aggregator->timer);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    astarte_linked_list_destroy_and_release(&device->aggregators);
+    if (device->aggregators_mutex) {
+        vSemaphoreDelete(device->aggregators_mutex);
+        device->aggregators_mutex = NULL;
+    }
+}
+
+void astarte_device_aggregation_publish(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->aggregators_mutex, portMAX_DELAY);
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->aggregators, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_aggregator_handle_t aggregator = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &aggregator);
+        astarte_window_summary_t summary;
+        if (astarte_sample_window_collect(&aggregator->window, &summary) && (summary.count > 0)) {
+            publish_window(aggregator, &summary);
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    xSemaphoreGive(device->aggregators_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_AGGREGATION
+static void aggregator_timer_callback(void *arg)
+{
+    // Runs in the esp_timer task, only the window is swapped here and the aggregate is published
+    // by the reinit task. If the previous aggregate is still pending the window gets longer.
+    astarte_aggregator_handle_t aggregator = (astarte_aggregator_handle_t) arg;
+    if (astarte_sample_window_close(&aggregator->window, esp_timer_get_time())) {
+        xTaskNotify(aggregator->device->reinit_task_handle, NOTIFY_AGGREGATE, eSetBits);
+    }
+}
+
+static void publish_window(
+    astarte_aggregator_handle_t aggregator, const astarte_window_summary_t *summary)
+{
+    astarte_device_handle_t device = aggregator->device;
+    PUBLISH_SCRATCH_BEGIN(device);
+    astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
+    if (!bson) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        PUBLISH_SCRATCH_END(device);
+        return;
+    }
+    if (aggregator->reducers & ASTARTE_REDUCER_MIN) {
+        astarte_bson_serializer_append_double(bson, "min", summary->min);
+    }
+    if (aggregator->reducers & ASTARTE_REDUCER_MAX) {
+        astarte_bson_serializer_append_double(bson, "max", summary->max);
+    }
+    if (aggregator->reducers & ASTARTE_REDUCER_MEAN) {
+        astarte_bson_serializer_append_double(bson, "mean", summary->sum / summary->count);
+    }
+    if (aggregator->reducers & ASTARTE_REDUCER_LAST) {
+        astarte_bson_serializer_append_double(bson, "last", summary->last);
+    }
+    if (aggregator->reducers & ASTARTE_REDUCER_COUNT) {
+        astarte_bson_serializer_append_int64(bson, "count", summary->count);
+    }
+    astarte_bson_serializer_append_end_of_document(bson);
+
+    int size = 0;
+    const void *document = astarte_bson_serializer_get_document(bson, &size);
+    if (document) {
+        astarte_err_t res = astarte_device_stream_aggregate_with_timestamp(device,
+            aggregator->interface_name, aggregator->path, document,
+            astarte_device_get_epoch_timestamp(summary->end_us), aggregator->qos);
+        if (res != ASTARTE_OK) {
+            ESP_LOGW(TAG, "Cannot send the aggregate of %s%s: %s", aggregator->interface_name,
+                aggregator->path, astarte_err_to_name(res));
+        }
+    }
+    astarte_bson_serializer_destroy(bson);
+    PUBLISH_SCRATCH_END(device);
+}
+#endif
@@ -0,0 +1,252 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_block.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+#include <astarte_block_encoder.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_BLOCK"
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+struct astarte_block_stream
+{
+    astarte_block_encoder_t encoder;
+    astarte_device_handle_t device;
+    char *interface_name;
+    char *path;
+    uint16_t samples_per_block;
+    int qos;
+    SemaphoreHandle_t mutex;
+};
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+static astarte_err_t block_stream_push(astarte_block_stream_handle_t stream,
+    astarte_block_type_t type, int64_t ts_epoch_millis, double double_value,
+    int64_t longinteger_value);
+static astarte_err_t block_stream_add(astarte_block_stream_handle_t stream, int64_t ts_epoch_millis,
+    double double_value, int64_t longinteger_value);
+static astarte_err_t publish_block(astarte_block_stream_handle_t stream);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_add_block_stream(astarte_device_handle_t device,
+    const astarte_block_config_t *config, astarte_block_stream_handle_t *stream)
+{
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    *stream = NULL;
+    if (config->path[0] != '/') {
+        ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", config->path);
+        return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+    }
+    if (config->qos < 0 || config->qos > 2) {
+        ESP_LOGE(TAG, "Invalid QoS: %d (must be 0, 1 or 2)", config->qos);
+        return ASTARTE_ERR_INVALID_QOS;
+    }
+    if (config->samples_per_block == 0) {
+        ESP_LOGE(TAG, "Invalid block of 0 samples");
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    if ((config->type != ASTARTE_BLOCK_TYPE_DOUBLE)
+        && (config->type != ASTARTE_BLOCK_TYPE_LONGINTEGER)) {
+        ESP_LOGE(TAG, "Invalid block type: %d", config->type);
+        return ASTARTE_ERR;
+    }
+
+    // Names and block buffer share the allocation of the stream
+    size_t interface_name_size = strlen(config->interface_name) + 1;
+    size_t path_size = strlen(config->path) + 1;
+    size_t stream_size = sizeof(struct astarte_block_stream) + interface_name_size + path_size
+        + CONFIG_ASTARTE_BLOCK_MAX_SIZE;
+    astarte_block_stream_handle_t new_stream
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, stream_size);
+    if (!new_stream) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    new_stream->device = device;
+    new_stream->interface_name = (char *) (new_stream + 1);
+    memcpy(new_stream->interface_name, config->interface_name, interface_name_size);
+    new_stream->path = new_stream->interface_name + interface_name_size;
+    memcpy(new_stream->path, config->path, path_size);
+    new_stream->samples_per_block = config->samples_per_block;
+    new_stream->qos = config->qos;
+    astarte_block_encoder_init(&new_stream->encoder, config->type,
+        (uint8_t *) new_stream->path + path_size, CONFIG_ASTARTE_BLOCK_MAX_SIZE);
+
+    new_stream->mutex = xSemaphoreCreateMutex();
+    if (!new_stream->mutex) {
+        ESP_LOGE(TAG, "Cannot create the block stream mutex");
+        astarte_alloc_free(new_stream);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    xSemaphoreTake(device->block_streams_mutex, portMAX_DELAY);
+    astarte_err_t res = astarte_linked_list_append(&device->block_streams, new_stream);
+    xSemaphoreGive(device->block_streams_mutex);
+    if (res != ASTARTE_OK) {
+        vSemaphoreDelete(new_stream->mutex);
+        astarte_alloc_free(new_stream);
+        return res;
+    }
+
+    *stream = new_stream;
+    return ASTARTE_OK;
+#else
+    (void) device;
+    (void) config;
+    *stream = NULL;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_block_stream_push_double(
+    astarte_block_stream_handle_t stream, int64_t ts_epoch_millis, double value)
+{
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    return block_stream_push(stream, ASTARTE_BLOCK_TYPE_DOUBLE, ts_epoch_millis, value, 0);
+#else
+    (void) stream;
+    (void) ts_epoch_millis;
+    (void) value;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_block_stream_push_longinteger(
+    astarte_block_stream_handle_t stream, int64_t ts_epoch_millis, int64_t value)
+{
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    return block_stream_push(stream, ASTARTE_BLOCK_TYPE_LONGINTEGER, ts_epoch_millis, 0, value);
+#else
+    (void) stream;
+    (void) ts_epoch_millis;
+    (void) value;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_block_stream_flush(astarte_block_stream_handle_t stream)
+{
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+    xSemaphoreTake(stream->mutex, portMAX_DELAY);
+    astarte_err_t res = publish_block(stream);
+    xSemaphoreGive(stream->mutex);
+    return res;
+#else
+    (void) stream;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+astarte_err_t astarte_device_block_init(astarte_device_handle_t device)
+{
+    device->block_streams = astarte_linked_list_init();
+    device->block_streams_mutex = xSemaphoreCreateMutex();
+    if (!device->block_streams_mutex) {
+        ESP_LOGE(TAG, "Cannot create block_streams_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_block_destroy(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->block_streams, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_block_stream_handle_t stream = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &stream);
+        vSemaphoreDelete(stream->mutex);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    astarte_linked_list_destroy_and_release(&device->block_streams);
+    if (device->block_streams_mutex) {
+        vSemaphoreDelete(device->block_streams_mutex);
+        device->block_streams_mutex = NULL;
+    }
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_BLOCK_ENCODING
+static astarte_err_t block_stream_push(astarte_block_stream_handle_t stream,
+    astarte_block_type_t type, int64_t ts_epoch_millis, double double_value,
+    int64_t longinteger_value)
+{
+    if (stream->encoder.type != type) {
+        ESP_LOGE(TAG, "Wrong sample type for the blocks of %s%s", stream->interface_name,
+            stream->path);
+        return ASTARTE_ERR;
+    }
+
+    astarte_err_t res = ASTARTE_OK;
+    xSemaphoreTake(stream->mutex, portMAX_DELAY);
+    if (block_stream_add(stream, ts_epoch_millis, double_value, longinteger_value) != ASTARTE_OK) {
+        // The block is full, the sample starts the next one
+        res = publish_block(stream);
+        block_stream_add(stream, ts_epoch_millis, double_value, longinteger_value);
+    }
+    if (astarte_block_encoder_count(&stream->encoder) >= stream->samples_per_block) {
+        astarte_err_t publish_res = publish_block(stream);
+        if (res == ASTARTE_OK) {
+            res = publish_res;
+        }
+    }
+    xSemaphoreGive(stream->mutex);
+    return res;
+}
+
+static astarte_err_t block_stream_add(astarte_block_stream_handle_t stream, int64_t ts_epoch_millis,
+    double double_value, int64_t longinteger_value)
+{
+    if (stream->encoder.type == ASTARTE_BLOCK_TYPE_DOUBLE) {
+        return astarte_block_encoder_add_double(&stream->encoder, ts_epoch_millis, double_value);
+    }
+    return astarte_block_encoder_add_longinteger(
+        &stream->encoder, ts_epoch_millis, longinteger_value);
+}
+
+static astarte_err_t publish_block(astarte_block_stream_handle_t stream)
+{
+    if (astarte_block_encoder_count(&stream->encoder) == 0) {
+        return ASTARTE_OK;
+    }
+    size_t length = 0;
+    const uint8_t *block = astarte_block_encoder_finish(&stream->encoder, &length);
+    astarte_err_t res = astarte_device_stream_binaryblob_with_timestamp(stream->device,
+        stream->interface_name, stream->path, (void *) block, length,
+        (uint64_t) astarte_block_encoder_first_timestamp(&stream->encoder), stream->qos);
+    if (res != ASTARTE_OK) {
+        ESP_LOGW(TAG, "Cannot publish the block of %s%s: %s", stream->interface_name,
+            stream->path, astarte_err_to_name(res));
+    }
+    astarte_block_encoder_reset(&stream->encoder);
+    return res;
+}
+#endif
@@ -0,0 +1,246 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_burst.h>
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_BURST"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+static bool burst_is_urgent(astarte_device_handle_t device, const char *interface_name);
+static void burst_timer_callback(void *arg);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_flush_burst(astarte_device_handle_t device)
+{
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    astarte_device_burst_flush(device);
+    return ASTARTE_OK;
+#else
+    (void) device;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_device_get_burst_stats(
+    astarte_device_handle_t device, astarte_burst_stats_t *stats)
+{
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+    xSemaphoreTake(device->burst_mutex, portMAX_DELAY);
+    *stats = device->burst_stats;
+    xSemaphoreGive(device->burst_mutex);
+    return ASTARTE_OK;
+#else
+    (void) device;
+    memset(stats, 0, sizeof(astarte_burst_stats_t));
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+astarte_err_t astarte_device_burst_init(astarte_device_handle_t device)
+{
+    astarte_burst_buffer_init(&device->burst_buffer, CONFIG_ASTARTE_BURST_MAX_BYTES,
+        (int64_t) CONFIG_ASTARTE_BURST_MAX_AGE_MS * 1000);
+
+    device->burst_mutex = xSemaphoreCreateMutex();
+    device->burst_flush_mutex = xSemaphoreCreateMutex();
+    if (!device->burst_mutex || !device->burst_flush_mutex) {
+        ESP_LOGE(TAG, "Cannot create the burst mutexes");
+        return ASTARTE_ERR;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = burst_timer_callback,
+        .arg = device,
+        .name = "astarte_burst",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &device->burst_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create the burst timer: %s", esp_err_to_name(err));
+        device->burst_timer = NULL;
+        return ASTARTE_ERR_ESP_SDK;
+    }
+
+#ifdef CONFIG_PM_ENABLE
+    err = esp_pm_lock_create(ESP_PM_NO_LIGHT_SLEEP, 0, "astarte_burst", &device->burst_pm_lock);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create the burst power lock: %s", esp_err_to_name(err));
+        device->burst_pm_lock = NULL;
+        return ASTARTE_ERR_ESP_SDK;
+    }
+#endif
+    return ASTARTE_OK;
+}
+
+void astarte_device_burst_stop(astarte_device_handle_t device)
+{
+    if (device->burst_timer) {
+        esp_timer_stop(device->burst_timer);
+    }
+}
+
+void astarte_device_burst_destroy(astarte_device_handle_t device)
+{
+    if (device->burst_timer) {
+        esp_timer_stop(device->burst_timer);
+        esp_timer_delete(device->burst_timer);
+        device->burst_timer = NULL;
+    }
+#ifdef CONFIG_PM_ENABLE
+    if (device->burst_pm_lock) {
+        esp_pm_lock_delete(device->burst_pm_lock);
+        device->burst_pm_lock = NULL;
+    }
+#endif
+    if (device->burst_mutex) {
+        vSemaphoreDelete(device->burst_mutex);
+        device->burst_mutex = NULL;
+    }
+    if (device->burst_flush_mutex) {
+        vSemaphoreDelete(device->burst_flush_mutex);
+        device->burst_flush_mutex = NULL;
+    }
+    astarte_burst_buffer_destroy(&device->burst_buffer);
+}
+
+astarte_err_t astarte_device_burst_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+    if (burst_is_urgent(device, interface_name)) {
+        // The held datastreams follow in the same radio wakeup. They are flushed by the reinit
+        // task, this might run in the MQTT event handler that must not wait for a flush
+        xSemaphoreTake(device->burst_mutex, portMAX_DELAY);
+        bool held = astarte_burst_buffer_count(&device->burst_buffer) > 0;
+        xSemaphoreGive(device->burst_mutex);
+        if (held) {
+            xTaskNotify(device->reinit_task_handle, NOTIFY_BURST, eSetBits);
+        }
+        return astarte_device_route_publish(device, interface_name, topic, data, length, qos);
+    }
+
+    int64_t now_us = esp_timer_get_time();
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Held messages outlive the publish call, keep them out of the scratch arenas
+    astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+    xSemaphoreTake(device->burst_mutex, portMAX_DELAY);
+    astarte_err_t res = astarte_burst_buffer_push(
+        &device->burst_buffer, interface_name, topic, data, length, qos, now_us);
+    bool due = (res == ASTARTE_OK) && astarte_burst_buffer_due(&device->burst_buffer, now_us);
+    if ((res == ASTARTE_OK) && !due && !device->burst_timer_armed) {
+        int64_t wait_us = astarte_burst_buffer_wait_us(&device->burst_buffer, now_us);
+        esp_err_t err = esp_timer_start_once(device->burst_timer, (uint64_t) wait_us);
+        if (err == ESP_OK) {
+            device->burst_timer_armed = true;
+        } else {
+            ESP_LOGE(TAG, "Cannot start the burst timer: %s", esp_err_to_name(err));
+        }
+    }
+    xSemaphoreGive(device->burst_mutex);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_resume(scratch);
+#endif
+
+    if (due) {
+        astarte_device_burst_flush(device);
+    }
+    return res;
+}
+
+void astarte_device_burst_flush(astarte_device_handle_t device)
+{
+    // Flushes are serialized to keep the order of the held datastreams
+    xSemaphoreTake(device->burst_flush_mutex, portMAX_DELAY);
+
+    xSemaphoreTake(device->burst_mutex, portMAX_DELAY);
+    astarte_burst_msg_t *msg = astarte_burst_buffer_take_all(&device->burst_buffer);
+    if (device->burst_timer_armed) {
+        esp_timer_stop(device->burst_timer);
+        device->burst_timer_armed = false;
+    }
+    xSemaphoreGive(device->burst_mutex);
+    if (!msg) {
+        xSemaphoreGive(device->burst_flush_mutex);
+        return;
+    }
+
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_acquire(device->burst_pm_lock);
+#endif
+    int64_t flush_start_us = esp_timer_get_time();
+    uint32_t messages = 0;
+    uint32_t failed = 0;
+    uint64_t bytes = 0;
+    while (msg) {
+        astarte_burst_msg_t *next = msg->next;
+        astarte_err_t res = astarte_device_route_publish(
+            device, msg->interface_name, msg->topic, msg->data, msg->length, msg->qos);
+        if (res != ASTARTE_OK) {
+            ESP_LOGW(TAG, "Cannot publish the held message for %s: %s", msg->topic,
+                astarte_err_to_name(res));
+            failed++;
+        }
+        messages++;
+        bytes += strlen(msg->topic) + (size_t) msg->length;
+        astarte_burst_buffer_msg_free(msg);
+        msg = next;
+    }
+    int64_t flush_us = esp_timer_get_time() - flush_start_us;
+#ifdef CONFIG_PM_ENABLE
+    esp_pm_lock_release(device->burst_pm_lock);
+#endif
+
+    xSemaphoreTake(device->burst_mutex, portMAX_DELAY);
+    device->burst_stats.bursts++;
+    device->burst_stats.messages += messages;
+    device->burst_stats.bytes += bytes;
+    device->burst_stats.failed += failed;
+    device->burst_stats.flush_us += (uint64_t) flush_us;
+    xSemaphoreGive(device->burst_mutex);
+
+    xSemaphoreGive(device->burst_flush_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_BURST_FLUSH
+static bool burst_is_urgent(astarte_device_handle_t device, const char *interface_name)
+{
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
+    return interface
+        && ((interface->type == TYPE_PROPERTIES) || (interface->priority == PRIORITY_ALARM));
+}
+
+static void burst_timer_callback(void *arg)
+{
+    // Runs in the esp_timer task, the burst is published by the reinit task
+    astarte_device_handle_t device = (astarte_device_handle_t) arg;
+    xTaskNotify(device->reinit_task_handle, NOTIFY_BURST, eSetBits);
+}
+#endif
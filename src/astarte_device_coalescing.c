@@ -0,0 +1,142 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_coalescing.h>
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_COALESCING"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+static bool properties_congested(astarte_device_handle_t device);
+static void send_pending_properties(astarte_device_handle_t device);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+astarte_err_t astarte_device_coalescing_init(astarte_device_handle_t device)
+{
+    astarte_property_coalescer_init(
+        &device->pending_properties, CONFIG_ASTARTE_PROPERTY_COALESCING_MAX_PENDING);
+    device->pending_properties_mutex = xSemaphoreCreateMutex();
+    if (!device->pending_properties_mutex) {
+        ESP_LOGE(TAG, "Cannot create pending_properties_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_coalescing_destroy(astarte_device_handle_t device)
+{
+    if (device->pending_properties_mutex) {
+        vSemaphoreDelete(device->pending_properties_mutex);
+        device->pending_properties_mutex = NULL;
+    }
+    astarte_property_coalescer_destroy(&device->pending_properties);
+}
+
+astarte_err_t astarte_device_coalescing_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+    astarte_err_t res = ASTARTE_OK;
+    xSemaphoreTake(device->pending_properties_mutex, portMAX_DELAY);
+    // Pending values go first, otherwise they would later overwrite the new ones
+    send_pending_properties(device);
+    if (!device->properties_pending && !properties_congested(device)) {
+        res = astarte_device_send_publish(device, interface_name, topic, data, length, qos);
+        goto end;
+    }
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Pending values outlive the publish call, keep them out of the scratch arenas
+    astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+    bool replaced = false;
+    res = astarte_property_coalescer_put(
+        &device->pending_properties, interface_name, topic, data, length, qos, &replaced);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_resume(scratch);
+#endif
+    if (res == ASTARTE_ERR_PUBLISH_QUEUE_FULL) {
+        // The property is not pending, the MQTT outbox can hold it instead
+        ESP_LOGW(TAG, "Too many pending properties, publishing %s", topic);
+        res = astarte_device_send_publish(device, interface_name, topic, data, length, qos);
+    } else if (replaced) {
+        STATS_COUNT(device, properties_coalesced);
+    }
+    device->properties_pending = astarte_property_coalescer_count(&device->pending_properties) > 0;
+
+end:
+    xSemaphoreGive(device->pending_properties_mutex);
+    return res;
+}
+
+void astarte_device_coalescing_schedule_flush(astarte_device_handle_t device)
+{
+    if (device->properties_pending) {
+        xTaskNotify(device->reinit_task_handle, NOTIFY_PROPERTIES, eSetBits);
+    }
+}
+
+void astarte_device_coalescing_flush(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->pending_properties_mutex, portMAX_DELAY);
+    send_pending_properties(device);
+    xSemaphoreGive(device->pending_properties_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_PROPERTY_COALESCING
+static bool properties_congested(astarte_device_handle_t device)
+{
+    if (!device->connected) {
+        return true;
+    }
+#if CONFIG_ASTARTE_PROPERTY_COALESCING_OUTBOX_LIMIT > 0
+    return device->transport.ops->get_outbox_size(device->transport_client)
+        > CONFIG_ASTARTE_PROPERTY_COALESCING_OUTBOX_LIMIT;
+#else
+    return false;
+#endif
+}
+
+static void send_pending_properties(astarte_device_handle_t device)
+{
+    const astarte_pending_property_t *property = NULL;
+    while ((property = astarte_property_coalescer_front(&device->pending_properties))
+        && !properties_congested(device)) {
+        astarte_err_t res = astarte_device_send_publish(device, property->interface_name,
+            property->topic, property->data, property->length, property->qos);
+        if (res != ASTARTE_OK) {
+            // Kept pending, it is retried on the next property set or acknowledgement
+            ESP_LOGW(TAG, "Cannot publish the pending property %s: %s", property->topic,
+                astarte_err_to_name(res));
+            break;
+        }
+        astarte_property_coalescer_remove_front(&device->pending_properties);
+    }
+    device->properties_pending = astarte_property_coalescer_count(&device->pending_properties) > 0;
+}
+#endif
@@ -0,0 +1,154 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_deadband.h>
+#include <astarte_device_tracking.h>
+
+#include <esp_log.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_DEADBAND"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+static void deadband_suppressed(astarte_device_handle_t device);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_set_deadband(astarte_device_handle_t device,
+    const char *interface_name, const char *path, const astarte_deadband_config_t *config)
+{
+#ifdef CONFIG_ASTARTE_DEADBAND
+    if (path[0] != '/') {
+        ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", path);
+        return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+    }
+    if (config && ((config->absolute < 0) || (config->relative < 0))) {
+        ESP_LOGE(TAG, "Invalid dead-band of %s%s: thresholds must not be negative",
+            interface_name, path);
+        return ASTARTE_ERR;
+    }
+
+    xSemaphoreTake(device->deadband_mutex, portMAX_DELAY);
+    astarte_err_t res
+        = astarte_deadband_table_set(&device->deadband_table, interface_name, path, config);
+    xSemaphoreGive(device->deadband_mutex);
+    return res;
+#else
+    (void) device;
+    (void) interface_name;
+    (void) path;
+    (void) config;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+astarte_err_t astarte_device_deadband_init(astarte_device_handle_t device)
+{
+    device->deadband_mutex = xSemaphoreCreateMutex();
+    if (!device->deadband_mutex) {
+        ESP_LOGE(TAG, "Cannot create deadband_mutex");
+        return ASTARTE_ERR;
+    }
+    if (astarte_deadband_table_init(&device->deadband_table, CONFIG_ASTARTE_DEADBAND_MAX_FILTERS)
+        != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot allocate the dead-band filters");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_deadband_destroy(astarte_device_handle_t device)
+{
+    if (device->deadband_mutex) {
+        vSemaphoreDelete(device->deadband_mutex);
+        device->deadband_mutex = NULL;
+    }
+    astarte_deadband_table_destroy(&device->deadband_table);
+}
+
+bool astarte_device_deadband_suppresses(
+    astarte_device_handle_t device, const char *interface_name, const char *path, double value)
+{
+    xSemaphoreTake(device->deadband_mutex, portMAX_DELAY);
+    astarte_deadband_filter_t *filter
+        = astarte_deadband_table_find(&device->deadband_table, interface_name, path);
+    bool suppress
+        = filter && !astarte_deadband_filter_passes(filter, value, esp_timer_get_time());
+    xSemaphoreGive(device->deadband_mutex);
+
+    if (suppress) {
+        deadband_suppressed(device);
+    }
+    return suppress;
+}
+
+void astarte_device_deadband_commit(
+    astarte_device_handle_t device, const char *interface_name, const char *path, double value)
+{
+    // The filter is looked up again, it could have been changed while publishing
+    xSemaphoreTake(device->deadband_mutex, portMAX_DELAY);
+    astarte_deadband_filter_t *filter
+        = astarte_deadband_table_find(&device->deadband_table, interface_name, path);
+    if (filter) {
+        astarte_deadband_filter_commit(filter, value, esp_timer_get_time());
+    }
+    xSemaphoreGive(device->deadband_mutex);
+}
+
+bool astarte_device_deadband_suppresses_integer(
+    astarte_device_handle_t device, const char *interface_name, const char *path, int64_t value)
+{
+    xSemaphoreTake(device->deadband_mutex, portMAX_DELAY);
+    astarte_deadband_filter_t *filter
+        = astarte_deadband_table_find(&device->deadband_table, interface_name, path);
+    bool suppress
+        = filter && !astarte_deadband_filter_passes_integer(filter, value, esp_timer_get_time());
+    xSemaphoreGive(device->deadband_mutex);
+
+    if (suppress) {
+        deadband_suppressed(device);
+    }
+    return suppress;
+}
+
+void astarte_device_deadband_commit_integer(
+    astarte_device_handle_t device, const char *interface_name, const char *path, int64_t value)
+{
+    xSemaphoreTake(device->deadband_mutex, portMAX_DELAY);
+    astarte_deadband_filter_t *filter
+        = astarte_deadband_table_find(&device->deadband_table, interface_name, path);
+    if (filter) {
+        astarte_deadband_filter_commit_integer(filter, value, esp_timer_get_time());
+    }
+    xSemaphoreGive(device->deadband_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_DEADBAND
+static void deadband_suppressed(astarte_device_handle_t device)
+{
+    STATS_COUNT(device, publish_suppressed);
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    // The suppressed value is never sent, no token from a previous publish must be returned
+    astarte_device_tracking_clear_token();
+#endif
+}
+#endif
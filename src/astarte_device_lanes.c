@@ -0,0 +1,201 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_lanes.h>
+
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_LANES"
+
+#ifdef CONFIG_ASTARTE_PUBLISH_LANES_DRAIN_WEIGHTED
+#define PUBLISH_LANES_WEIGHTED true
+#define PUBLISH_LANE_PROPERTIES_WEIGHT CONFIG_ASTARTE_PUBLISH_LANE_PROPERTIES_WEIGHT
+#define PUBLISH_LANE_ALARM_WEIGHT CONFIG_ASTARTE_PUBLISH_LANE_ALARM_WEIGHT
+#define PUBLISH_LANE_BULK_WEIGHT CONFIG_ASTARTE_PUBLISH_LANE_BULK_WEIGHT
+#else
+#define PUBLISH_LANES_WEIGHTED false
+#define PUBLISH_LANE_PROPERTIES_WEIGHT 0
+#define PUBLISH_LANE_ALARM_WEIGHT 0
+#define PUBLISH_LANE_BULK_WEIGHT 0
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void astarte_device_publish_task(void *ctx);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_lanes_init(astarte_device_handle_t device)
+{
+    const astarte_publish_lane_config_t config[ASTARTE_PUBLISH_LANE_COUNT] = {
+        [ASTARTE_PUBLISH_LANE_CONTROL] = {
+            .capacity = CONFIG_ASTARTE_PUBLISH_LANE_CONTROL_SIZE,
+            .weight = 0,
+        },
+        [ASTARTE_PUBLISH_LANE_PROPERTIES] = {
+            .capacity = CONFIG_ASTARTE_PUBLISH_LANE_PROPERTIES_SIZE,
+            .weight = PUBLISH_LANE_PROPERTIES_WEIGHT,
+        },
+        [ASTARTE_PUBLISH_LANE_ALARM] = {
+            .capacity = CONFIG_ASTARTE_PUBLISH_LANE_ALARM_SIZE,
+            .weight = PUBLISH_LANE_ALARM_WEIGHT,
+        },
+        [ASTARTE_PUBLISH_LANE_BULK] = {
+            .capacity = CONFIG_ASTARTE_PUBLISH_LANE_BULK_SIZE,
+            .weight = PUBLISH_LANE_BULK_WEIGHT,
+        },
+    };
+    astarte_err_t res
+        = astarte_publish_queue_init(&device->publish_queue, config, PUBLISH_LANES_WEIGHTED);
+    if (res != ASTARTE_OK) {
+        return res;
+    }
+
+    device->publish_queue_mutex = xSemaphoreCreateMutex();
+    if (!device->publish_queue_mutex) {
+        ESP_LOGE(TAG, "Cannot create publish_queue_mutex");
+        return ASTARTE_ERR;
+    }
+
+    device->publish_task_exited = xSemaphoreCreateBinary();
+    if (!device->publish_task_exited) {
+        ESP_LOGE(TAG, "Cannot create publish_task_exited");
+        return ASTARTE_ERR;
+    }
+
+    const configSTACK_DEPTH_TYPE stack_depth = 4096;
+    xTaskCreate(astarte_device_publish_task, "astarte_device_publish_task", stack_depth, device,
+        CONFIG_ASTARTE_PUBLISH_TASK_PRIORITY, &device->publish_task_handle);
+    if (!device->publish_task_handle) {
+        ESP_LOGE(TAG, "Cannot start astarte_device_publish_task");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_lanes_destroy(astarte_device_handle_t device)
+{
+    if (device->publish_task_handle) {
+        device->publish_lanes_open = false;
+        xTaskNotify(device->publish_task_handle, NOTIFY_TERMINATE, eSetBits);
+        // Wait for the task to stop using the device
+        xSemaphoreTake(device->publish_task_exited, portMAX_DELAY);
+        device->publish_task_handle = NULL;
+    }
+    if (device->publish_task_exited) {
+        vSemaphoreDelete(device->publish_task_exited);
+        device->publish_task_exited = NULL;
+    }
+    if (device->publish_queue_mutex) {
+        vSemaphoreDelete(device->publish_queue_mutex);
+        device->publish_queue_mutex = NULL;
+    }
+    astarte_publish_queue_destroy(&device->publish_queue);
+}
+
+void astarte_device_lanes_open(astarte_device_handle_t device)
+{
+    device->publish_lanes_open = true;
+    xTaskNotify(device->publish_task_handle, NOTIFY_PUBLISH, eSetBits);
+}
+
+void astarte_device_lanes_close(astarte_device_handle_t device)
+{
+    device->publish_lanes_open = false;
+}
+
+astarte_publish_lane_t astarte_device_lanes_select(
+    astarte_device_handle_t device, const char *interface_name)
+{
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
+    if (!interface) {
+        return ASTARTE_PUBLISH_LANE_BULK;
+    }
+    switch (interface->priority) {
+        case PRIORITY_PROPERTIES:
+            return ASTARTE_PUBLISH_LANE_PROPERTIES;
+        case PRIORITY_ALARM:
+            return ASTARTE_PUBLISH_LANE_ALARM;
+        case PRIORITY_BULK:
+            return ASTARTE_PUBLISH_LANE_BULK;
+        default:
+            return (interface->type == TYPE_PROPERTIES) ? ASTARTE_PUBLISH_LANE_PROPERTIES
+                                                        : ASTARTE_PUBLISH_LANE_BULK;
+    }
+}
+
+astarte_err_t astarte_device_lanes_enqueue(astarte_device_handle_t device,
+    astarte_publish_lane_t lane, const char *topic, const void *data, int length, int qos)
+{
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Queued messages outlive the publish call, keep them out of the scratch arenas
+    astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+    xSemaphoreTake(device->publish_queue_mutex, portMAX_DELAY);
+    astarte_err_t res
+        = astarte_publish_queue_push(&device->publish_queue, lane, topic, data, length, qos);
+    xSemaphoreGive(device->publish_queue_mutex);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_resume(scratch);
+#endif
+
+    if (res == ASTARTE_ERR_PUBLISH_QUEUE_FULL) {
+        ESP_LOGW(TAG, "Publish lane %d is full, dropping message for %s", lane, topic);
+        STATS_COUNT(device, publish_queue_full);
+    } else if ((res == ASTARTE_OK) && device->publish_lanes_open) {
+        xTaskNotify(device->publish_task_handle, NOTIFY_PUBLISH, eSetBits);
+    }
+    return res;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void astarte_device_publish_task(void *ctx)
+{
+    // This task drains the priority lanes into the MQTT client. It is notified when a message is
+    // queued and when the device gets connected, draining stops while the device is offline.
+
+    astarte_device_handle_t device = (astarte_device_handle_t) ctx;
+
+    while (1) {
+        uint32_t notification_value = ulTaskNotifyTake(pdTRUE, portMAX_DELAY);
+        if (notification_value & NOTIFY_TERMINATE) {
+            xSemaphoreGive(device->publish_task_exited);
+            vTaskDelete(NULL);
+        }
+
+        while (device->publish_lanes_open) {
+            astarte_publish_queue_msg_t *msg = NULL;
+            xSemaphoreTake(device->publish_queue_mutex, portMAX_DELAY);
+            astarte_err_t res = astarte_publish_queue_pop(&device->publish_queue, &msg);
+            xSemaphoreGive(device->publish_queue_mutex);
+            if (res != ASTARTE_OK) {
+                break;
+            }
+            astarte_device_mqtt_publish(
+                device, msg->topic, msg->data, msg->length, msg->qos, portMAX_DELAY);
+            astarte_publish_queue_msg_free(msg);
+        }
+    }
+}
+
+#endif
@@ -0,0 +1,312 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_outbox.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_OUTBOX"
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+typedef struct
+{
+    astarte_outbox_policy_t policy;
+    char *interface_name;
+} interface_outbox_policy_t;
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+static void release_deferred_publishes(astarte_device_handle_t device);
+static astarte_outbox_policy_t *get_interface_outbox_policy(
+    astarte_device_handle_t device, const char *interface_name);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_set_outbox_policy(
+    astarte_device_handle_t device, const char *interface_name, astarte_outbox_policy_t policy)
+{
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    if ((policy != ASTARTE_OUTBOX_POLICY_REJECT) && (policy != ASTARTE_OUTBOX_POLICY_DEFER)
+        && (policy != ASTARTE_OUTBOX_POLICY_DOWNGRADE)) {
+        ESP_LOGE(TAG, "Invalid outbox policy: %d", policy);
+        return ASTARTE_ERR;
+    }
+
+    astarte_err_t result = ASTARTE_OK;
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+
+    astarte_outbox_policy_t *current = &device->device_outbox_policy;
+    if (interface_name) {
+        current = get_interface_outbox_policy(device, interface_name);
+    }
+    if (current) {
+        *current = policy;
+        goto end;
+    }
+
+    size_t interface_name_size = strlen(interface_name) + 1;
+    interface_outbox_policy_t *interface_policy = astarte_alloc_malloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, sizeof(interface_outbox_policy_t) + interface_name_size);
+    if (!interface_policy) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        result = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto end;
+    }
+    interface_policy->policy = policy;
+    interface_policy->interface_name = (char *) (interface_policy + 1);
+    memcpy(interface_policy->interface_name, interface_name, interface_name_size);
+    result = astarte_linked_list_append(&device->interface_outbox_policies, interface_policy);
+    if (result != ASTARTE_OK) {
+        astarte_alloc_free(interface_policy);
+    }
+
+end:
+    xSemaphoreGive(device->outbox_mutex);
+    return result;
+#else
+    (void) device;
+    (void) interface_name;
+    (void) policy;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_device_get_outbox_stats(
+    astarte_device_handle_t device, astarte_outbox_stats_t *stats)
+{
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+    *stats = device->outbox_stats;
+    xSemaphoreGive(device->outbox_mutex);
+    return ASTARTE_OK;
+#else
+    (void) device;
+    memset(stats, 0, sizeof(astarte_outbox_stats_t));
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+astarte_err_t astarte_device_outbox_init(astarte_device_handle_t device)
+{
+    astarte_outbox_governor_init(&device->outbox_governor, CONFIG_ASTARTE_OUTBOX_HIGH_WATER_BYTES,
+        CONFIG_ASTARTE_OUTBOX_LOW_WATER_BYTES);
+    // Only the storage of the burst buffer is used, deferred datastreams are never due
+    astarte_burst_buffer_init(&device->outbox_deferred, CONFIG_ASTARTE_OUTBOX_DEFER_MAX_BYTES, 0);
+    device->device_outbox_policy = ASTARTE_OUTBOX_POLICY_REJECT;
+    device->interface_outbox_policies = astarte_linked_list_init();
+    device->outbox_mutex = xSemaphoreCreateMutex();
+    if (!device->outbox_mutex) {
+        ESP_LOGE(TAG, "Cannot create outbox_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_outbox_destroy(astarte_device_handle_t device)
+{
+    if (device->outbox_mutex) {
+        vSemaphoreDelete(device->outbox_mutex);
+        device->outbox_mutex = NULL;
+    }
+    // Deferred datastreams are discarded
+    astarte_burst_buffer_destroy(&device->outbox_deferred);
+    astarte_linked_list_destroy_and_release(&device->interface_outbox_policies);
+}
+
+bool astarte_device_outbox_admit(astarte_device_handle_t device, const char *interface_name,
+    const char *topic, const void *data, int length, int *qos, astarte_err_t *res)
+{
+    // QoS 0 messages do not stay in the outbox, properties can be published by the MQTT event
+    // handler and must never be held back
+    if (*qos == 0) {
+        return true;
+    }
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
+    if (!interface || (interface->type == TYPE_PROPERTIES)) {
+        return true;
+    }
+    size_t outbox_size
+        = (size_t) device->transport.ops->get_outbox_size(device->transport_client);
+
+    bool admitted = true;
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+    astarte_outbox_crossing_t crossing
+        = astarte_outbox_governor_update(&device->outbox_governor, outbox_size);
+    if (crossing == ASTARTE_OUTBOX_CROSSING_HIGH) {
+        device->outbox_stats.congestions++;
+    }
+    astarte_outbox_policy_t policy = device->device_outbox_policy;
+    astarte_outbox_policy_t *interface_policy = get_interface_outbox_policy(device, interface_name);
+    if (interface_policy) {
+        policy = *interface_policy;
+    }
+    // Deferred datastreams keep their order, new ones queue behind them until they are released
+    bool congested = astarte_outbox_governor_congested(&device->outbox_governor)
+        || ((policy == ASTARTE_OUTBOX_POLICY_DEFER)
+            && (astarte_burst_buffer_count(&device->outbox_deferred) > 0));
+    if (!congested) {
+        goto end;
+    }
+
+    if (policy == ASTARTE_OUTBOX_POLICY_DOWNGRADE) {
+        *qos = 0;
+        device->outbox_stats.downgraded++;
+        goto end;
+    }
+    admitted = false;
+    size_t msg_bytes = strlen(topic) + (size_t) length;
+    if ((policy == ASTARTE_OUTBOX_POLICY_DEFER)
+        && (astarte_burst_buffer_bytes(&device->outbox_deferred) + msg_bytes
+            <= CONFIG_ASTARTE_OUTBOX_DEFER_MAX_BYTES)) {
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+        // Deferred messages outlive the publish call, keep them out of the scratch arenas
+        astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+        *res = astarte_burst_buffer_push(
+            &device->outbox_deferred, interface_name, topic, data, length, *qos, 0);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+        astarte_scratch_resume(scratch);
+#endif
+        if (*res == ASTARTE_OK) {
+            device->outbox_stats.deferred++;
+        }
+        goto end;
+    }
+    ESP_LOGW(TAG, "Outbox congested, rejecting message for %s", topic);
+    device->outbox_stats.rejected++;
+    *res = ASTARTE_ERR_OUTBOX_FULL;
+
+end:
+    xSemaphoreGive(device->outbox_mutex);
+    if (crossing != ASTARTE_OUTBOX_CROSSING_NONE) {
+        xTaskNotify(device->reinit_task_handle, NOTIFY_OUTBOX, eSetBits);
+    }
+    return admitted;
+}
+
+void astarte_device_outbox_on_drained(astarte_device_handle_t device)
+{
+    // Runs in the MQTT task, the outbox is checked and the deferred datastreams are released by
+    // the reinit task
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+    bool waiting = astarte_outbox_governor_congested(&device->outbox_governor)
+        || (astarte_burst_buffer_count(&device->outbox_deferred) > 0)
+        || device->outbox_congestion_reported;
+    xSemaphoreGive(device->outbox_mutex);
+    if (waiting) {
+        xTaskNotify(device->reinit_task_handle, NOTIFY_OUTBOX, eSetBits);
+    }
+}
+
+void astarte_device_outbox_regulate(astarte_device_handle_t device)
+{
+    size_t outbox_size
+        = (size_t) device->transport.ops->get_outbox_size(device->transport_client);
+
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+    if (astarte_outbox_governor_update(&device->outbox_governor, outbox_size)
+        == ASTARTE_OUTBOX_CROSSING_HIGH) {
+        device->outbox_stats.congestions++;
+    }
+    bool congested = astarte_outbox_governor_congested(&device->outbox_governor);
+    // Crossings closer than the task can report them are collapsed
+    bool crossed = congested != device->outbox_congestion_reported;
+    device->outbox_congestion_reported = congested;
+    xSemaphoreGive(device->outbox_mutex);
+
+    if (crossed) {
+        if (congested) {
+            ESP_LOGW(TAG, "MQTT outbox congested: %zu bytes", outbox_size);
+        } else {
+            ESP_LOGI(TAG, "MQTT outbox drained: %zu bytes", outbox_size);
+        }
+        if (device->outbox_event_callback) {
+            astarte_device_outbox_event_t event = {
+                .device = device,
+                .congested = congested,
+                .outbox_size = outbox_size,
+                .user_data = device->callbacks_user_data,
+            };
+            device->outbox_event_callback(&event);
+        }
+    }
+    if (!congested) {
+        release_deferred_publishes(device);
+    }
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_OUTBOX_GOVERNOR
+static void release_deferred_publishes(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+    astarte_burst_msg_t *msg = astarte_burst_buffer_take_all(&device->outbox_deferred);
+    xSemaphoreGive(device->outbox_mutex);
+
+    uint32_t released = 0;
+    while (msg) {
+        astarte_burst_msg_t *next = msg->next;
+        // Released datastreams go through the governor again, they are deferred back if the
+        // outbox fills up while releasing them
+        astarte_err_t res = astarte_device_send_publish(
+            device, msg->interface_name, msg->topic, msg->data, msg->length, msg->qos);
+        if (res == ASTARTE_OK) {
+            released++;
+        } else {
+            ESP_LOGW(TAG, "Cannot publish the deferred message for %s: %s", msg->topic,
+                astarte_err_to_name(res));
+        }
+        astarte_burst_buffer_msg_free(msg);
+        msg = next;
+    }
+
+    if (released > 0) {
+        xSemaphoreTake(device->outbox_mutex, portMAX_DELAY);
+        device->outbox_stats.released += released;
+        xSemaphoreGive(device->outbox_mutex);
+    }
+}
+
+static astarte_outbox_policy_t *get_interface_outbox_policy(
+    astarte_device_handle_t device, const char *interface_name)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err
+        = astarte_linked_list_iterator_init(&device->interface_outbox_policies, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        interface_outbox_policy_t *interface_policy = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &interface_policy);
+        if (strcmp(interface_policy->interface_name, interface_name) == 0) {
+            return &interface_policy->policy;
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    return NULL;
+}
+#endif
@@ -0,0 +1,349 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_rate_limit.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_RATE_LIMIT"
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+#define RATE_LIMIT_COUNT(interface_limiter, device_limiter, counter)                               \
+    do {                                                                                           \
+        if (interface_limiter) {                                                                   \
+            (interface_limiter)->counters.counter++;                                               \
+        }                                                                                          \
+        (device_limiter)->counters.counter++;                                                      \
+    } while (0)
+// Shortest delay of the backlog timer, to batch the messages released by a refill
+#define RATE_LIMIT_MIN_WAIT_US 1000
+
+typedef struct
+{
+    astarte_rate_limiter_t limiter;
+    char *interface_name;
+} interface_rate_limiter_t;
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+static astarte_err_t defer_publish(astarte_device_handle_t device,
+    astarte_rate_limiter_t *interface_limiter, const char *interface_name, const char *topic,
+    const void *data, int length, int qos, bool replace);
+static void schedule_rate_limit_flush(astarte_device_handle_t device);
+static void rate_limit_timer_callback(void *arg);
+static astarte_rate_limiter_t *get_interface_limiter(
+    astarte_device_handle_t device, const char *interface_name);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_set_rate_limit(astarte_device_handle_t device,
+    const char *interface_name, const astarte_rate_limit_config_t *config)
+{
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    const astarte_rate_limit_config_t no_limits = { 0 };
+    if (!config) {
+        config = &no_limits;
+    }
+
+    astarte_err_t result = ASTARTE_OK;
+    int64_t now_us = esp_timer_get_time();
+    xSemaphoreTake(device->rate_limit_mutex, portMAX_DELAY);
+
+    astarte_rate_limiter_t *limiter = &device->device_limiter;
+    if (interface_name) {
+        limiter = get_interface_limiter(device, interface_name);
+    }
+    if (limiter) {
+        // Messages in the backlog keep pointing to the limiter, it is updated in place
+        astarte_rate_limit_counters_t counters = limiter->counters;
+        astarte_rate_limiter_init(limiter, config, now_us);
+        limiter->counters = counters;
+        goto end;
+    }
+
+    size_t interface_name_size = strlen(interface_name) + 1;
+    interface_rate_limiter_t *interface_limiter = astarte_alloc_malloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, sizeof(interface_rate_limiter_t) + interface_name_size);
+    if (!interface_limiter) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        result = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto end;
+    }
+    astarte_rate_limiter_init(&interface_limiter->limiter, config, now_us);
+    interface_limiter->interface_name = (char *) (interface_limiter + 1);
+    memcpy(interface_limiter->interface_name, interface_name, interface_name_size);
+    result = astarte_linked_list_append(&device->interface_limiters, interface_limiter);
+    if (result != ASTARTE_OK) {
+        astarte_alloc_free(interface_limiter);
+    }
+
+end:
+    xSemaphoreGive(device->rate_limit_mutex);
+    return result;
+#else
+    (void) device;
+    (void) interface_name;
+    (void) config;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_device_get_rate_limit_counters(astarte_device_handle_t device,
+    const char *interface_name, astarte_rate_limit_counters_t *counters)
+{
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+    astarte_err_t result = ASTARTE_OK;
+    xSemaphoreTake(device->rate_limit_mutex, portMAX_DELAY);
+    astarte_rate_limiter_t *limiter = &device->device_limiter;
+    if (interface_name) {
+        limiter = get_interface_limiter(device, interface_name);
+    }
+    if (limiter) {
+        *counters = limiter->counters;
+    } else {
+        memset(counters, 0, sizeof(astarte_rate_limit_counters_t));
+        result = ASTARTE_ERR_NOT_FOUND;
+    }
+    xSemaphoreGive(device->rate_limit_mutex);
+    return result;
+#else
+    (void) device;
+    (void) interface_name;
+    memset(counters, 0, sizeof(astarte_rate_limit_counters_t));
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+astarte_err_t astarte_device_rate_limit_init(astarte_device_handle_t device)
+{
+    const astarte_rate_limit_config_t no_limits = { 0 };
+    astarte_rate_limiter_init(&device->device_limiter, &no_limits, esp_timer_get_time());
+    device->interface_limiters = astarte_linked_list_init();
+    astarte_rate_limit_backlog_init(
+        &device->rate_limit_backlog, CONFIG_ASTARTE_RATE_LIMIT_BACKLOG_SIZE);
+
+    device->rate_limit_mutex = xSemaphoreCreateMutex();
+    if (!device->rate_limit_mutex) {
+        ESP_LOGE(TAG, "Cannot create rate_limit_mutex");
+        return ASTARTE_ERR;
+    }
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = rate_limit_timer_callback,
+        .arg = device,
+        .name = "astarte_rate_limit",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &device->rate_limit_timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create the rate limit timer: %s", esp_err_to_name(err));
+        device->rate_limit_timer = NULL;
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_rate_limit_stop(astarte_device_handle_t device)
+{
+    if (device->rate_limit_timer) {
+        esp_timer_stop(device->rate_limit_timer);
+    }
+}
+
+void astarte_device_rate_limit_destroy(astarte_device_handle_t device)
+{
+    if (device->rate_limit_timer) {
+        esp_timer_stop(device->rate_limit_timer);
+        esp_timer_delete(device->rate_limit_timer);
+        device->rate_limit_timer = NULL;
+    }
+    if (device->rate_limit_mutex) {
+        vSemaphoreDelete(device->rate_limit_mutex);
+        device->rate_limit_mutex = NULL;
+    }
+    astarte_rate_limit_backlog_destroy(&device->rate_limit_backlog);
+    astarte_linked_list_destroy_and_release(&device->interface_limiters);
+}
+
+astarte_err_t astarte_device_rate_limit_publish(astarte_device_handle_t device,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+    astarte_interface_t *interface = astarte_device_get_interface(device, interface_name);
+    if (interface && (interface->type == TYPE_PROPERTIES)) {
+        // Properties are stored before being published, skipping one would desync Astarte
+        return astarte_device_send_publish(device, interface_name, topic, data, length, qos);
+    }
+
+    xSemaphoreTake(device->rate_limit_mutex, portMAX_DELAY);
+    astarte_rate_limiter_t *interface_limiter = get_interface_limiter(device, interface_name);
+    astarte_rate_limiter_t *device_limiter = &device->device_limiter;
+    astarte_rate_limit_policy_t policy
+        = interface_limiter ? interface_limiter->policy : device_limiter->policy;
+    // With a backlog, new messages wait behind the ones already there to keep their order
+    bool keep_order = ((policy == ASTARTE_RATE_LIMIT_POLICY_LATEST)
+                          || (policy == ASTARTE_RATE_LIMIT_POLICY_QUEUE))
+        && (astarte_rate_limit_backlog_count(&device->rate_limit_backlog) > 0);
+    if (!keep_order
+        && astarte_rate_limiter_try_acquire(
+            interface_limiter, device_limiter, length, esp_timer_get_time())) {
+        RATE_LIMIT_COUNT(interface_limiter, device_limiter, passed);
+        xSemaphoreGive(device->rate_limit_mutex);
+        return astarte_device_send_publish(device, interface_name, topic, data, length, qos);
+    }
+
+    astarte_err_t res = ASTARTE_OK;
+    switch (policy) {
+        case ASTARTE_RATE_LIMIT_POLICY_DROP:
+            ESP_LOGD(TAG, "Rate limit exceeded, dropping message for %s", topic);
+            RATE_LIMIT_COUNT(interface_limiter, device_limiter, dropped);
+            break;
+        case ASTARTE_RATE_LIMIT_POLICY_LATEST:
+        case ASTARTE_RATE_LIMIT_POLICY_QUEUE:
+            res = defer_publish(device, interface_limiter, interface_name, topic, data, length,
+                qos, policy == ASTARTE_RATE_LIMIT_POLICY_LATEST);
+            break;
+        default:
+            ESP_LOGW(TAG, "Rate limit exceeded, rejecting message for %s", topic);
+            RATE_LIMIT_COUNT(interface_limiter, device_limiter, rejected);
+            res = ASTARTE_ERR_RATE_LIMITED;
+            break;
+    }
+    xSemaphoreGive(device->rate_limit_mutex);
+    return res;
+}
+
+void astarte_device_rate_limit_flush(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->rate_limit_mutex, portMAX_DELAY);
+    device->rate_limit_timer_armed = false;
+    xSemaphoreGive(device->rate_limit_mutex);
+
+    while (1) {
+        // The lock is released while publishing, that can block on the device lock
+        astarte_rate_limit_msg_t *msg = NULL;
+        xSemaphoreTake(device->rate_limit_mutex, portMAX_DELAY);
+        astarte_err_t res = astarte_rate_limit_backlog_pop(
+            &device->rate_limit_backlog, &device->device_limiter, esp_timer_get_time(), &msg);
+        if (res == ASTARTE_OK) {
+            RATE_LIMIT_COUNT(msg->limiter, &device->device_limiter, released);
+        } else {
+            schedule_rate_limit_flush(device);
+        }
+        xSemaphoreGive(device->rate_limit_mutex);
+        if (res != ASTARTE_OK) {
+            break;
+        }
+
+        res = astarte_device_send_publish(
+            device, msg->interface_name, msg->topic, msg->data, msg->length, msg->qos);
+        if (res != ASTARTE_OK) {
+            ESP_LOGW(TAG, "Cannot publish the deferred message for %s: %s", msg->topic,
+                astarte_err_to_name(res));
+        }
+        astarte_rate_limit_backlog_msg_free(msg);
+    }
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_RATE_LIMIT
+static astarte_err_t defer_publish(astarte_device_handle_t device,
+    astarte_rate_limiter_t *interface_limiter, const char *interface_name, const char *topic,
+    const void *data, int length, int qos, bool replace)
+{
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Deferred messages outlive the publish call, keep them out of the scratch arenas
+    astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+    bool replaced = false;
+    astarte_err_t res = astarte_rate_limit_backlog_push(&device->rate_limit_backlog,
+        interface_limiter, interface_name, topic, data, length, qos, replace, &replaced);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_resume(scratch);
+#endif
+
+    astarte_rate_limiter_t *device_limiter = &device->device_limiter;
+    if (res != ASTARTE_OK) {
+        ESP_LOGW(TAG, "Cannot defer the message for %s: %s", topic, astarte_err_to_name(res));
+        RATE_LIMIT_COUNT(interface_limiter, device_limiter, dropped);
+        return res;
+    }
+    if (replaced) {
+        RATE_LIMIT_COUNT(interface_limiter, device_limiter, replaced);
+    } else {
+        RATE_LIMIT_COUNT(interface_limiter, device_limiter, queued);
+    }
+    schedule_rate_limit_flush(device);
+    return ASTARTE_OK;
+}
+
+static void schedule_rate_limit_flush(astarte_device_handle_t device)
+{
+    // Called with rate_limit_mutex held
+    if (device->rate_limit_timer_armed) {
+        return;
+    }
+    int64_t wait_us = astarte_rate_limit_backlog_wait_us(
+        &device->rate_limit_backlog, &device->device_limiter, esp_timer_get_time());
+    if (wait_us < 0) {
+        return;
+    }
+    if (wait_us < RATE_LIMIT_MIN_WAIT_US) {
+        wait_us = RATE_LIMIT_MIN_WAIT_US;
+    }
+    esp_err_t err = esp_timer_start_once(device->rate_limit_timer, (uint64_t) wait_us);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot start the rate limit timer: %s", esp_err_to_name(err));
+        return;
+    }
+    device->rate_limit_timer_armed = true;
+}
+
+static void rate_limit_timer_callback(void *arg)
+{
+    // Runs in the esp_timer task, the backlog is published by the reinit task
+    astarte_device_handle_t device = (astarte_device_handle_t) arg;
+    xTaskNotify(device->reinit_task_handle, NOTIFY_RATE_LIMIT, eSetBits);
+}
+
+static astarte_rate_limiter_t *get_interface_limiter(
+    astarte_device_handle_t device, const char *interface_name)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err
+        = astarte_linked_list_iterator_init(&device->interface_limiters, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        interface_rate_limiter_t *interface_limiter = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &interface_limiter);
+        if (strcmp(interface_limiter->interface_name, interface_name) == 0) {
+            return &interface_limiter->limiter;
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    return NULL;
+}
+#endif
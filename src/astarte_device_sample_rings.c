@@ -0,0 +1,329 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_sample_rings.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+#include <astarte_spsc_ring.h>
+#endif
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+#include <esp_attr.h>
+#endif
+#include <esp_log.h>
+
+#include <inttypes.h>
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_SAMPLE_RINGS"
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+// Samples moved from a ring at once by the device task, on its stack
+#define SAMPLE_RING_DRAIN_BATCH 32
+
+struct astarte_sample_ring
+{
+    astarte_spsc_ring_t ring;
+    astarte_ring_sample_t *samples;
+    uint32_t capacity;
+    astarte_device_handle_t device;
+    char *interface_name;
+    char *path;
+    astarte_sample_ring_type_t type;
+    int qos;
+    uint32_t reported_dropped;
+    esp_timer_handle_t timer;
+};
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+static void sample_ring_timer_callback(void *arg);
+static void drain_sample_ring(astarte_sample_ring_handle_t ring);
+static bool sample_ring_push(
+    astarte_sample_ring_handle_t ring, astarte_sample_ring_type_t type, astarte_ring_value_t value);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_add_sample_ring(astarte_device_handle_t device,
+    const astarte_sample_ring_config_t *config, astarte_sample_ring_handle_t *ring)
+{
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    *ring = NULL;
+    if (config->path[0] != '/') {
+        ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", config->path);
+        return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+    }
+    if (config->qos < 0 || config->qos > 2) {
+        ESP_LOGE(TAG, "Invalid QoS: %d (must be 0, 1 or 2)", config->qos);
+        return ASTARTE_ERR_INVALID_QOS;
+    }
+    if ((config->capacity < 2) || (config->capacity & (config->capacity - 1))) {
+        ESP_LOGE(TAG, "Invalid ring capacity: %" PRIu32 " (must be a power of two)",
+            config->capacity);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    if (config->drain_period_ms == 0) {
+        ESP_LOGE(TAG, "Invalid drain period of 0 ms");
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+    if ((config->type != ASTARTE_SAMPLE_RING_TYPE_DOUBLE)
+        && (config->type != ASTARTE_SAMPLE_RING_TYPE_LONGINTEGER)) {
+        ESP_LOGE(TAG, "Invalid sample type: %d", config->type);
+        return ASTARTE_ERR;
+    }
+
+    size_t interface_name_size = strlen(config->interface_name) + 1;
+    size_t path_size = strlen(config->path) + 1;
+    astarte_sample_ring_handle_t new_ring = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1,
+        sizeof(struct astarte_sample_ring) + interface_name_size + path_size);
+    // The samples get their own allocation, to be aligned for 64 bits values
+    astarte_ring_sample_t *samples = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, config->capacity, sizeof(astarte_ring_sample_t));
+    if (!new_ring || !samples) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        astarte_alloc_free(new_ring);
+        astarte_alloc_free(samples);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    astarte_spsc_ring_init(&new_ring->ring, samples, config->capacity);
+    new_ring->samples = samples;
+    new_ring->capacity = config->capacity;
+    new_ring->device = device;
+    new_ring->interface_name = (char *) (new_ring + 1);
+    memcpy(new_ring->interface_name, config->interface_name, interface_name_size);
+    new_ring->path = new_ring->interface_name + interface_name_size;
+    memcpy(new_ring->path, config->path, path_size);
+    new_ring->type = config->type;
+    new_ring->qos = config->qos;
+
+    const esp_timer_create_args_t timer_args = {
+        .callback = sample_ring_timer_callback,
+        .arg = new_ring,
+        .name = "astarte_sample_ring",
+    };
+    esp_err_t err = esp_timer_create(&timer_args, &new_ring->timer);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Cannot create the sample ring timer: %s", esp_err_to_name(err));
+        astarte_alloc_free(samples);
+        astarte_alloc_free(new_ring);
+        return ASTARTE_ERR_ESP_SDK;
+    }
+
+    xSemaphoreTake(device->sample_rings_mutex, portMAX_DELAY);
+    astarte_err_t res = astarte_linked_list_append(&device->sample_rings, new_ring);
+    if (res == ASTARTE_OK) {
+        err = esp_timer_start_periodic(new_ring->timer, config->drain_period_ms * 1000ULL);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot start the sample ring timer: %s", esp_err_to_name(err));
+            void *removed = NULL;
+            astarte_linked_list_remove_tail(&device->sample_rings, &removed);
+            res = ASTARTE_ERR_ESP_SDK;
+        }
+    }
+    xSemaphoreGive(device->sample_rings_mutex);
+
+    if (res != ASTARTE_OK) {
+        esp_timer_delete(new_ring->timer);
+        astarte_alloc_free(samples);
+        astarte_alloc_free(new_ring);
+        return res;
+    }
+    *ring = new_ring;
+    return ASTARTE_OK;
+#else
+    (void) device;
+    (void) config;
+    *ring = NULL;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+bool IRAM_ATTR astarte_device_push_sample_from_isr(astarte_sample_ring_handle_t ring, double value)
+{
+    astarte_ring_value_t ring_value = { .double_value = value };
+    return sample_ring_push(ring, ASTARTE_SAMPLE_RING_TYPE_DOUBLE, ring_value);
+}
+
+bool IRAM_ATTR astarte_device_push_longinteger_sample_from_isr(
+    astarte_sample_ring_handle_t ring, int64_t value)
+{
+    astarte_ring_value_t ring_value = { .longinteger_value = value };
+    return sample_ring_push(ring, ASTARTE_SAMPLE_RING_TYPE_LONGINTEGER, ring_value);
+}
+#else
+bool astarte_device_push_sample_from_isr(astarte_sample_ring_handle_t ring, double value)
+{
+    (void) ring;
+    (void) value;
+    return false;
+}
+
+bool astarte_device_push_longinteger_sample_from_isr(
+    astarte_sample_ring_handle_t ring, int64_t value)
+{
+    (void) ring;
+    (void) value;
+    return false;
+}
+#endif
+
+uint32_t astarte_sample_ring_dropped(astarte_sample_ring_handle_t ring)
+{
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+    return astarte_spsc_ring_dropped(&ring->ring);
+#else
+    (void) ring;
+    return 0;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+astarte_err_t astarte_device_sample_rings_init(astarte_device_handle_t device)
+{
+    device->sample_rings = astarte_linked_list_init();
+    device->sample_rings_mutex = xSemaphoreCreateMutex();
+    if (!device->sample_rings_mutex) {
+        ESP_LOGE(TAG, "Cannot create sample_rings_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_sample_rings_stop(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->sample_rings, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_sample_ring_handle_t ring = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &ring);
+        esp_timer_stop(ring->timer);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+}
+
+void astarte_device_sample_rings_destroy(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->sample_rings, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_sample_ring_handle_t ring = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &ring);
+        esp_timer_stop(ring->timer);
+        esp_timer_delete(ring->timer);
+        astarte_alloc_free(ring->samples);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    astarte_linked_list_destroy_and_release(&device->sample_rings);
+    if (device->sample_rings_mutex) {
+        vSemaphoreDelete(device->sample_rings_mutex);
+        device->sample_rings_mutex = NULL;
+    }
+}
+
+void astarte_device_sample_rings_drain(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->sample_rings_mutex, portMAX_DELAY);
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->sample_rings, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_sample_ring_handle_t ring = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &ring);
+        drain_sample_ring(ring);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    xSemaphoreGive(device->sample_rings_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_SAMPLE_RINGS
+static void sample_ring_timer_callback(void *arg)
+{
+    // Runs in the esp_timer task, the samples are published by the reinit task
+    astarte_sample_ring_handle_t ring = (astarte_sample_ring_handle_t) arg;
+    xTaskNotify(ring->device->reinit_task_handle, NOTIFY_SAMPLES, eSetBits);
+}
+
+static void drain_sample_ring(astarte_sample_ring_handle_t ring)
+{
+    astarte_ring_sample_t batch[SAMPLE_RING_DRAIN_BATCH];
+    // Bounded to the ring size, a producer faster than the publish would keep this task busy
+    uint32_t budget = ring->capacity;
+    while (budget > 0) {
+        uint32_t count = astarte_spsc_ring_pop(&ring->ring, batch,
+            (budget < SAMPLE_RING_DRAIN_BATCH) ? budget : SAMPLE_RING_DRAIN_BATCH);
+        if (count == 0) {
+            break;
+        }
+        budget -= count;
+
+        for (uint32_t i = 0; i < count; i++) {
+            uint64_t ts_epoch_millis = astarte_device_get_epoch_timestamp(batch[i].timestamp_us);
+            astarte_err_t res = ASTARTE_OK;
+            if (ring->type == ASTARTE_SAMPLE_RING_TYPE_DOUBLE) {
+                res = astarte_device_stream_double_with_timestamp(ring->device,
+                    ring->interface_name, ring->path, batch[i].value.double_value,
+                    ts_epoch_millis, ring->qos);
+            } else {
+                res = astarte_device_stream_longinteger_with_timestamp(ring->device,
+                    ring->interface_name, ring->path, batch[i].value.longinteger_value,
+                    ts_epoch_millis, ring->qos);
+            }
+            if (res != ASTARTE_OK) {
+                ESP_LOGW(TAG, "Cannot publish the sample of %s%s: %s", ring->interface_name,
+                    ring->path, astarte_err_to_name(res));
+            }
+        }
+    }
+
+    uint32_t dropped = astarte_spsc_ring_dropped(&ring->ring);
+    if (dropped != ring->reported_dropped) {
+        ESP_LOGW(TAG, "%" PRIu32 " samples of %s%s dropped, the ring is full",
+            dropped - ring->reported_dropped, ring->interface_name, ring->path);
+        ring->reported_dropped = dropped;
+    }
+}
+
+static bool IRAM_ATTR sample_ring_push(
+    astarte_sample_ring_handle_t ring, astarte_sample_ring_type_t type, astarte_ring_value_t value)
+{
+    if (ring->type != type) {
+        return false;
+    }
+    if (!astarte_spsc_ring_push(&ring->ring, esp_timer_get_time(), value)) {
+        return false;
+    }
+
+    // Drain early once half full, only notifying when the threshold is crossed
+    if (astarte_spsc_ring_count(&ring->ring) == ring->capacity / 2) {
+        if (xPortInIsrContext()) {
+            BaseType_t higher_priority_task_woken = pdFALSE;
+            xTaskNotifyFromISR(ring->device->reinit_task_handle, NOTIFY_SAMPLES, eSetBits,
+                &higher_priority_task_woken);
+            portYIELD_FROM_ISR(higher_priority_task_woken);
+        } else {
+            xTaskNotify(ring->device->reinit_task_handle, NOTIFY_SAMPLES, eSetBits);
+        }
+    }
+    return true;
+}
+#endif
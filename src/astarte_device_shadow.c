@@ -0,0 +1,290 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_shadow.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_SHADOW
+#include <astarte_shadow_state.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_SHADOW"
+
+#ifdef CONFIG_ASTARTE_SHADOW
+struct astarte_shadow
+{
+    astarte_shadow_state_t state;
+    astarte_device_handle_t device;
+    char *interface_name;
+    const void *data;
+    SemaphoreHandle_t mutex;
+    esp_timer_handle_t timer;
+    bool commit_due;
+};
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_SHADOW
+static void shadow_free(astarte_shadow_handle_t shadow);
+static void shadow_timer_callback(void *arg);
+static astarte_err_t publish_shadow_field(
+    astarte_shadow_handle_t shadow, const astarte_shadow_field_t *field);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_device_add_shadow(astarte_device_handle_t device,
+    const astarte_shadow_config_t *config, astarte_shadow_handle_t *shadow)
+{
+#ifdef CONFIG_ASTARTE_SHADOW
+    *shadow = NULL;
+    size_t interface_name_size = strlen(config->interface_name) + 1;
+    astarte_shadow_handle_t new_shadow = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(struct astarte_shadow) + interface_name_size);
+    if (!new_shadow) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    new_shadow->device = device;
+    new_shadow->data = config->data;
+    new_shadow->interface_name = (char *) (new_shadow + 1);
+    memcpy(new_shadow->interface_name, config->interface_name, interface_name_size);
+
+    astarte_err_t res
+        = astarte_shadow_state_init(&new_shadow->state, config->fields, config->fields_count);
+    if (res != ASTARTE_OK) {
+        goto error;
+    }
+    new_shadow->mutex = xSemaphoreCreateMutex();
+    if (!new_shadow->mutex) {
+        ESP_LOGE(TAG, "Cannot create the shadow mutex");
+        res = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto error;
+    }
+    if (config->period_ms > 0) {
+        const esp_timer_create_args_t timer_args = {
+            .callback = shadow_timer_callback,
+            .arg = new_shadow,
+            .name = "astarte_shadow",
+        };
+        esp_err_t err = esp_timer_create(&timer_args, &new_shadow->timer);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot create the shadow timer: %s", esp_err_to_name(err));
+            res = ASTARTE_ERR_ESP_SDK;
+            goto error;
+        }
+    }
+
+    xSemaphoreTake(device->shadows_mutex, portMAX_DELAY);
+    res = astarte_linked_list_append(&device->shadows, new_shadow);
+    if ((res == ASTARTE_OK) && new_shadow->timer) {
+        esp_err_t err = esp_timer_start_periodic(new_shadow->timer, config->period_ms * 1000ULL);
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Cannot start the shadow timer: %s", esp_err_to_name(err));
+            void *removed = NULL;
+            astarte_linked_list_remove_tail(&device->shadows, &removed);
+            res = ASTARTE_ERR_ESP_SDK;
+        }
+    }
+    xSemaphoreGive(device->shadows_mutex);
+    if (res != ASTARTE_OK) {
+        goto error;
+    }
+
+    *shadow = new_shadow;
+    return ASTARTE_OK;
+
+error:
+    shadow_free(new_shadow);
+    return res;
+#else
+    (void) device;
+    (void) config;
+    *shadow = NULL;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_shadow_commit(astarte_shadow_handle_t shadow)
+{
+#ifdef CONFIG_ASTARTE_SHADOW
+    astarte_err_t exit_code = ASTARTE_OK;
+    xSemaphoreTake(shadow->mutex, portMAX_DELAY);
+    for (size_t i = 0; i < shadow->state.fields_count; i++) {
+        if (!astarte_shadow_state_changed(&shadow->state, shadow->data, i)) {
+            continue;
+        }
+        astarte_err_t res = publish_shadow_field(shadow, &shadow->state.fields[i]);
+        if (res != ASTARTE_OK) {
+            ESP_LOGW(TAG, "Cannot publish %s%s: %s", shadow->interface_name,
+                shadow->state.fields[i].path, astarte_err_to_name(res));
+            if (exit_code == ASTARTE_OK) {
+                exit_code = res;
+            }
+            continue;
+        }
+        astarte_shadow_state_update(&shadow->state, shadow->data, i);
+    }
+    xSemaphoreGive(shadow->mutex);
+    return exit_code;
+#else
+    (void) shadow;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+void astarte_shadow_lock(astarte_shadow_handle_t shadow)
+{
+#ifdef CONFIG_ASTARTE_SHADOW
+    xSemaphoreTake(shadow->mutex, portMAX_DELAY);
+#else
+    (void) shadow;
+#endif
+}
+
+void astarte_shadow_unlock(astarte_shadow_handle_t shadow)
+{
+#ifdef CONFIG_ASTARTE_SHADOW
+    xSemaphoreGive(shadow->mutex);
+#else
+    (void) shadow;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_SHADOW
+astarte_err_t astarte_device_shadow_init(astarte_device_handle_t device)
+{
+    device->shadows = astarte_linked_list_init();
+    device->shadows_mutex = xSemaphoreCreateMutex();
+    if (!device->shadows_mutex) {
+        ESP_LOGE(TAG, "Cannot create shadows_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_shadow_stop(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->shadows, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_shadow_handle_t shadow = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &shadow);
+        if (shadow->timer) {
+            esp_timer_stop(shadow->timer);
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+}
+
+void astarte_device_shadow_destroy(astarte_device_handle_t device)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->shadows, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_shadow_handle_t shadow = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &shadow);
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+        shadow_free(shadow);
+    }
+    // The shadows have already been freed, only the list nodes are left
+    astarte_linked_list_destroy(&device->shadows);
+    if (device->shadows_mutex) {
+        vSemaphoreDelete(device->shadows_mutex);
+        device->shadows_mutex = NULL;
+    }
+}
+
+void astarte_device_shadow_commit_due(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->shadows_mutex, portMAX_DELAY);
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err = astarte_linked_list_iterator_init(&device->shadows, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        astarte_shadow_handle_t shadow = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &shadow);
+        if (shadow->commit_due) {
+            shadow->commit_due = false;
+            astarte_shadow_commit(shadow);
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    xSemaphoreGive(device->shadows_mutex);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_SHADOW
+static void shadow_free(astarte_shadow_handle_t shadow)
+{
+    if (shadow->timer) {
+        esp_timer_stop(shadow->timer);
+        esp_timer_delete(shadow->timer);
+    }
+    if (shadow->mutex) {
+        vSemaphoreDelete(shadow->mutex);
+    }
+    astarte_shadow_state_destroy(&shadow->state);
+    astarte_alloc_free(shadow);
+}
+
+static void shadow_timer_callback(void *arg)
+{
+    // Runs in the esp_timer task, the commit is done by the reinit task
+    astarte_shadow_handle_t shadow = (astarte_shadow_handle_t) arg;
+    shadow->commit_due = true;
+    xTaskNotify(shadow->device->reinit_task_handle, NOTIFY_SHADOW, eSetBits);
+}
+
+static astarte_err_t publish_shadow_field(
+    astarte_shadow_handle_t shadow, const astarte_shadow_field_t *field)
+{
+    astarte_device_handle_t device = shadow->device;
+    const char *interface_name = shadow->interface_name;
+    const void *value = (const uint8_t *) shadow->data + field->offset;
+    switch (field->type) {
+        case ASTARTE_SHADOW_TYPE_DOUBLE:
+            return astarte_device_set_double_property(
+                device, interface_name, field->path, *(const double *) value);
+        case ASTARTE_SHADOW_TYPE_INTEGER:
+            return astarte_device_set_integer_property(
+                device, interface_name, field->path, *(const int32_t *) value);
+        case ASTARTE_SHADOW_TYPE_LONGINTEGER:
+            return astarte_device_set_longinteger_property(
+                device, interface_name, field->path, *(const int64_t *) value);
+        case ASTARTE_SHADOW_TYPE_BOOLEAN:
+            return astarte_device_set_boolean_property(
+                device, interface_name, field->path, *(const bool *) value);
+        case ASTARTE_SHADOW_TYPE_DATETIME:
+            return astarte_device_set_datetime_property(
+                device, interface_name, field->path, *(const int64_t *) value);
+        case ASTARTE_SHADOW_TYPE_STRING:
+            if (strnlen(value, field->size) == field->size) {
+                ESP_LOGE(TAG, "String %s%s is not terminated", interface_name, field->path);
+                return ASTARTE_ERR;
+            }
+            return astarte_device_set_string_property(device, interface_name, field->path, value);
+        default:
+            return ASTARTE_ERR;
+    }
+}
+#endif
@@ -0,0 +1,94 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_stats.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define PERCENTILE_MAX 100U
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static uint32_t bucket_index(uint32_t latency_us);
+static uint32_t bucket_upper_bound(uint32_t index);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_latency_histogram_record(astarte_latency_histogram_t *histogram, int64_t latency_us)
+{
+    uint32_t sample = 0;
+    if (latency_us > UINT32_MAX) {
+        sample = UINT32_MAX;
+    } else if (latency_us > 0) {
+        sample = (uint32_t) latency_us;
+    }
+
+    histogram->count++;
+    histogram->total_us += sample;
+    if (sample > histogram->max_us) {
+        histogram->max_us = sample;
+    }
+    histogram->buckets[bucket_index(sample)]++;
+}
+
+uint32_t astarte_latency_histogram_percentile(
+    const astarte_latency_histogram_t *histogram, uint32_t percentile)
+{
+    if (histogram->count == 0) {
+        return 0;
+    }
+    if (percentile > PERCENTILE_MAX) {
+        percentile = PERCENTILE_MAX;
+    }
+
+    // Rank of the sample at the requested percentile, rounded up and at least the first one
+    uint64_t rank
+        = (((uint64_t) histogram->count * percentile) + PERCENTILE_MAX - 1) / PERCENTILE_MAX;
+    if (rank == 0) {
+        rank = 1;
+    }
+
+    uint64_t cumulative = 0;
+    for (uint32_t i = 0; i < ASTARTE_LATENCY_HISTOGRAM_BUCKETS; i++) {
+        cumulative += histogram->buckets[i];
+        if (cumulative >= rank) {
+            uint32_t upper_bound = bucket_upper_bound(i);
+            return (upper_bound < histogram->max_us) ? upper_bound : histogram->max_us;
+        }
+    }
+
+    return histogram->max_us;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static uint32_t bucket_index(uint32_t latency_us)
+{
+    // The index is the number of significant bits of the sample
+    uint32_t index = 0;
+    while (latency_us > 0) {
+        index++;
+        latency_us >>= 1;
+    }
+    return (index < ASTARTE_LATENCY_HISTOGRAM_BUCKETS) ? index
+                                                       : ASTARTE_LATENCY_HISTOGRAM_BUCKETS - 1;
+}
+
+static uint32_t bucket_upper_bound(uint32_t index)
+{
+    if (index == ASTARTE_LATENCY_HISTOGRAM_BUCKETS - 1) {
+        return UINT32_MAX;
+    }
+    return (1U << index) - 1;
+}
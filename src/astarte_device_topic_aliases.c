@@ -0,0 +1,135 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_topic_aliases.h>
+#include <astarte_device_tracking.h>
+
+#include <esp_log.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_TOPIC_ALIASES"
+
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+// CONNACK codes of a broker refusing the protocol version, with MQTT 3.1.1 and with MQTT 5
+#define MQTT3_RETURN_CODE_UNACCEPTABLE_PROTOCOL 0x01
+#define MQTT5_REASON_UNSUPPORTED_PROTOCOL_VERSION 0x84
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_MQTT5_TOPIC_ALIASES
+astarte_err_t astarte_device_topic_aliases_init(astarte_device_handle_t device)
+{
+    uint16_t capacity = CONFIG_ASTARTE_MQTT5_TOPIC_ALIAS_MAX;
+    if (astarte_topic_alias_table_init(&device->topic_aliases, capacity) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot allocate the topic aliases");
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    device->topic_aliases_mutex = xSemaphoreCreateMutex();
+    if (!device->topic_aliases_mutex) {
+        ESP_LOGE(TAG, "Cannot create topic_aliases_mutex");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_topic_aliases_destroy(astarte_device_handle_t device)
+{
+    if (device->topic_aliases_mutex) {
+        vSemaphoreDelete(device->topic_aliases_mutex);
+        device->topic_aliases_mutex = NULL;
+    }
+    astarte_topic_alias_table_destroy(&device->topic_aliases);
+}
+
+int astarte_device_topic_aliases_publish(astarte_device_handle_t device, void *client,
+    const char *topic, const void *data, int length, int qos)
+{
+    const astarte_transport_ops_t *ops = device->transport.ops;
+    // Called with the device locked, publishes are serialized and an alias cannot be reassigned
+    // between its lookup and its publish. The MQTT client can send QoS 1 and QoS 2 messages again
+    // on a new connection, where their alias would be unknown, so only QoS 0 messages use aliases.
+    // The alias is passed to every publish, also when 0, so that none is left over from the
+    // previous message.
+    if ((qos != 0) || device->mqtt5_refused) {
+        return ops->publish(client, topic, data, length, qos, 0);
+    }
+
+    astarte_topic_alias_t alias;
+    xSemaphoreTake(device->topic_aliases_mutex, portMAX_DELAY);
+    astarte_err_t res = astarte_topic_alias_table_get(&device->topic_aliases, topic, &alias);
+    xSemaphoreGive(device->topic_aliases_mutex);
+    if ((res != ASTARTE_OK) || (alias.alias == 0)) {
+        return ops->publish(client, topic, data, length, qos, 0);
+    }
+
+    // Once the broker knows the alias the topic is sent empty. A message racing a reconnection
+    // might reach the new session with an unknown alias, the broker then drops the connection and
+    // the message is lost, as QoS 0 messages can be.
+    int ret = ops->publish(client, alias.confirmed ? "" : topic, data, length, qos, alias.alias);
+    if (ret == ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED) {
+        // Above the Topic Alias Maximum of the broker, smaller aliases are used until reconnection
+        ESP_LOGD(TAG, "Topic alias %u refused", alias.alias);
+        xSemaphoreTake(device->topic_aliases_mutex, portMAX_DELAY);
+        astarte_topic_alias_table_refuse(&device->topic_aliases, &alias);
+        xSemaphoreGive(device->topic_aliases_mutex);
+        return ops->publish(client, topic, data, length, qos, 0);
+    }
+    if ((ret >= 0) && !alias.confirmed) {
+        xSemaphoreTake(device->topic_aliases_mutex, portMAX_DELAY);
+        astarte_topic_alias_table_confirm(&device->topic_aliases, &alias);
+        xSemaphoreGive(device->topic_aliases_mutex);
+    }
+    return ret;
+}
+
+void astarte_device_topic_aliases_reset(astarte_device_handle_t device)
+{
+    // Runs in the MQTT task, the mutex is never held while publishing
+    xSemaphoreTake(device->topic_aliases_mutex, portMAX_DELAY);
+    astarte_topic_alias_table_reset(&device->topic_aliases);
+    xSemaphoreGive(device->topic_aliases_mutex);
+}
+
+void astarte_device_topic_aliases_on_refused(astarte_device_handle_t device, int return_code)
+{
+    if (device->mqtt5_refused
+        || ((return_code != MQTT3_RETURN_CODE_UNACCEPTABLE_PROTOCOL)
+            && (return_code != MQTT5_REASON_UNSUPPORTED_PROTOCOL_VERSION))) {
+        return;
+    }
+    ESP_LOGW(TAG, "The broker refused MQTT 5, notifying the reinit task");
+    device->mqtt5_refused = true;
+    // The MQTT client cannot be replaced from its own task
+    xTaskNotify(device->reinit_task_handle, NOTIFY_MQTT3_FALLBACK, eSetBits);
+}
+
+void astarte_device_topic_aliases_fall_back(astarte_device_handle_t device)
+{
+    xSemaphoreTake(device->reinit_mutex, portMAX_DELAY);
+    ESP_LOGI(TAG, "Connecting again with MQTT 3.1.1");
+    while (1) {
+        astarte_err_t res
+            = astarte_device_init_connection(device, device->encoded_hwid, device->realm);
+        if (res == ASTARTE_OK) {
+            break;
+        }
+        ESP_LOGE(TAG, "Cannot recreate the MQTT client: %d, trying again in %d milliseconds", res,
+            REINIT_RETRY_INTERVAL_MS);
+        vTaskDelay(REINIT_RETRY_INTERVAL_MS / portTICK_PERIOD_MS);
+    }
+    device->transport.ops->start(device->transport_client);
+    xSemaphoreGive(device->reinit_mutex);
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    astarte_device_tracking_fail_stale(device);
+#endif
+}
+#endif
@@ -0,0 +1,449 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_device_tracking.h>
+
+#include <astarte_alloc.h>
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+#include <astarte_inflight_table.h>
+#endif
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+#include <astarte_scratch.h>
+#endif
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_DEVICE_TRACKING"
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+// Acknowledgments waiting for the device task, the ones of untracked messages are queued as well
+#define PUBLISH_ACKS_QUEUE_LENGTH (2 * CONFIG_ASTARTE_PUBLISH_MAX_IN_FLIGHT)
+
+typedef struct
+{
+    int msg_id;
+    astarte_publish_result_t result;
+} publish_ack_t;
+
+typedef struct
+{
+    astarte_publish_window_config_t config;
+    char *interface_name;
+} interface_publish_window_t;
+
+// Last message tracked for each task, see astarte_device_get_last_publish_token()
+static __thread astarte_device_handle_t last_publish_device;
+static __thread astarte_publish_token_t last_publish_token;
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+static const astarte_publish_window_config_t *exceeded_publish_window(
+    astarte_device_handle_t device, const char *interface_name);
+static bool wait_publish_window(astarte_device_handle_t device, TickType_t wait_ticks);
+static void complete_publish(astarte_device_handle_t device, const publish_ack_t *ack);
+static void report_publish(astarte_device_handle_t device, astarte_inflight_entry_t *entry,
+    astarte_publish_result_t result);
+static astarte_publish_window_config_t *get_interface_window(
+    astarte_device_handle_t device, const char *interface_name);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_publish_token_t astarte_device_get_last_publish_token(astarte_device_handle_t device)
+{
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    if (last_publish_device != device) {
+        return ASTARTE_PUBLISH_TOKEN_NONE;
+    }
+    return last_publish_token;
+#else
+    (void) device;
+    return ASTARTE_PUBLISH_TOKEN_NONE;
+#endif
+}
+
+astarte_err_t astarte_device_set_publish_window(astarte_device_handle_t device,
+    const char *interface_name, const astarte_publish_window_config_t *config)
+{
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    const astarte_publish_window_config_t no_window = { 0 };
+    if (!config) {
+        config = &no_window;
+    }
+    if (config->max_in_flight > CONFIG_ASTARTE_PUBLISH_MAX_IN_FLIGHT) {
+        ESP_LOGE(
+            TAG, "Invalid window: larger than %d messages", CONFIG_ASTARTE_PUBLISH_MAX_IN_FLIGHT);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+
+    astarte_err_t result = ASTARTE_OK;
+    xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+
+    astarte_publish_window_config_t *window = &device->device_window;
+    if (interface_name) {
+        window = get_interface_window(device, interface_name);
+    }
+    if (window) {
+        *window = *config;
+        goto end;
+    }
+
+    size_t interface_name_size = strlen(interface_name) + 1;
+    interface_publish_window_t *interface_window = astarte_alloc_malloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, sizeof(interface_publish_window_t) + interface_name_size);
+    if (!interface_window) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        result = ASTARTE_ERR_OUT_OF_MEMORY;
+        goto end;
+    }
+    interface_window->config = *config;
+    interface_window->interface_name = (char *) (interface_window + 1);
+    memcpy(interface_window->interface_name, interface_name, interface_name_size);
+    result = astarte_linked_list_append(&device->interface_windows, interface_window);
+    if (result != ASTARTE_OK) {
+        astarte_alloc_free(interface_window);
+    }
+
+end:
+    xSemaphoreGive(device->inflight_mutex);
+    // Publishes waiting for the previous window check the new one
+    xSemaphoreGive(device->inflight_released);
+    return result;
+#else
+    (void) device;
+    (void) interface_name;
+    (void) config;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+astarte_err_t astarte_device_get_publish_in_flight(
+    astarte_device_handle_t device, const char *interface_name, uint32_t *in_flight)
+{
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+    xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+    *in_flight = (uint32_t) astarte_inflight_table_count(&device->inflight, interface_name);
+    xSemaphoreGive(device->inflight_mutex);
+    return ASTARTE_OK;
+#else
+    (void) device;
+    (void) interface_name;
+    *in_flight = 0;
+    return ASTARTE_ERR_NOT_FOUND;
+#endif
+}
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+astarte_err_t astarte_device_tracking_init(astarte_device_handle_t device)
+{
+    device->interface_windows = astarte_linked_list_init();
+    if (astarte_inflight_table_init(&device->inflight, CONFIG_ASTARTE_PUBLISH_MAX_IN_FLIGHT)
+        != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Cannot allocate the in-flight table");
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    device->inflight_mutex = xSemaphoreCreateMutex();
+    if (!device->inflight_mutex) {
+        ESP_LOGE(TAG, "Cannot create inflight_mutex");
+        return ASTARTE_ERR;
+    }
+    device->inflight_released = xSemaphoreCreateBinary();
+    if (!device->inflight_released) {
+        ESP_LOGE(TAG, "Cannot create inflight_released");
+        return ASTARTE_ERR;
+    }
+    device->publish_acks = xQueueCreate(PUBLISH_ACKS_QUEUE_LENGTH, sizeof(publish_ack_t));
+    if (!device->publish_acks) {
+        ESP_LOGE(TAG, "Cannot create the acknowledgments queue");
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_device_tracking_destroy(astarte_device_handle_t device)
+{
+    if (device->publish_acks) {
+        vQueueDelete(device->publish_acks);
+        device->publish_acks = NULL;
+    }
+    if (device->inflight_released) {
+        vSemaphoreDelete(device->inflight_released);
+        device->inflight_released = NULL;
+    }
+    if (device->inflight_mutex) {
+        vSemaphoreDelete(device->inflight_mutex);
+        device->inflight_mutex = NULL;
+    }
+    // Messages still in flight are discarded without being reported
+    astarte_inflight_table_destroy(&device->inflight);
+    astarte_linked_list_destroy_and_release(&device->interface_windows);
+}
+
+astarte_err_t astarte_device_tracking_prepare(
+    astarte_device_handle_t device, const char *topic, int qos, astarte_publish_token_t *token)
+{
+    *token = ASTARTE_PUBLISH_TOKEN_NONE;
+    // Only the acknowledgments of QoS 1 and QoS 2 messages of the interfaces are reported
+    size_t device_topic_len = device->device_topic_len;
+    if ((qos == 0) || (strncmp(topic, device->device_topic, device_topic_len) != 0)
+        || (topic[device_topic_len] != '/')) {
+        return ASTARTE_OK;
+    }
+    const char *endpoint = topic + device_topic_len + 1;
+    if (strncmp(endpoint, "control/", strlen("control/")) == 0) {
+        return ASTARTE_OK;
+    }
+
+    astarte_inflight_entry_t entry;
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    // Tracked messages outlive the publish call, keep them out of the scratch arenas
+    astarte_scratch_t *scratch = astarte_scratch_suspend();
+#endif
+    astarte_err_t res = astarte_inflight_entry_prepare(&entry, endpoint);
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+    astarte_scratch_resume(scratch);
+#endif
+    if (res != ASTARTE_OK) {
+        // The message is still published, untracked
+        return ASTARTE_OK;
+    }
+    astarte_interface_t *interface = astarte_device_get_interface(device, entry.interface_name);
+    entry.windowed = interface && (interface->type == TYPE_DATASTREAM);
+
+    TickType_t start_ticks = xTaskGetTickCount();
+    xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+    const astarte_publish_window_config_t *window = NULL;
+    while (entry.windowed && (window = exceeded_publish_window(device, entry.interface_name))) {
+        astarte_publish_window_config_t exceeded = *window;
+        xSemaphoreGive(device->inflight_mutex);
+
+        TickType_t timeout_ticks = pdMS_TO_TICKS(exceeded.block_timeout_ms);
+        TickType_t waited_ticks = xTaskGetTickCount() - start_ticks;
+        if ((exceeded.policy == ASTARTE_PUBLISH_WINDOW_POLICY_REJECT)
+            || (waited_ticks >= timeout_ticks)
+            || !wait_publish_window(device, timeout_ticks - waited_ticks)) {
+            ESP_LOGW(TAG, "In-flight window full, rejecting message for %s", topic);
+            astarte_inflight_entry_free(&entry);
+            return ASTARTE_ERR_PUBLISH_WINDOW_FULL;
+        }
+        xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+    }
+    res = astarte_inflight_table_insert(&device->inflight, &entry);
+    xSemaphoreGive(device->inflight_mutex);
+
+    if (res != ASTARTE_OK) {
+        ESP_LOGD(TAG, "Too many tracked messages, publishing %s untracked", topic);
+        astarte_inflight_entry_free(&entry);
+        return ASTARTE_OK;
+    }
+    *token = entry.token;
+    return ASTARTE_OK;
+}
+
+void astarte_device_tracking_record(
+    astarte_device_handle_t device, astarte_publish_token_t token, int msg_id)
+{
+    if (token == ASTARTE_PUBLISH_TOKEN_NONE) {
+        return;
+    }
+
+    astarte_inflight_entry_t entry;
+    bool failed = false;
+    xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+    if (msg_id > 0) {
+        astarte_inflight_table_assign(&device->inflight, token, msg_id, device->mqtt_generation);
+    } else {
+        // A failed publish is reported by its return value, not by the callback
+        failed = astarte_inflight_table_take(&device->inflight, token, &entry);
+    }
+    xSemaphoreGive(device->inflight_mutex);
+
+    if (failed) {
+        astarte_inflight_entry_free(&entry);
+        xSemaphoreGive(device->inflight_released);
+        return;
+    }
+    last_publish_device = device;
+    last_publish_token = token;
+}
+
+void astarte_device_tracking_clear_token(void)
+{
+    last_publish_token = ASTARTE_PUBLISH_TOKEN_NONE;
+}
+
+void astarte_device_tracking_on_ack(
+    astarte_device_handle_t device, int msg_id, astarte_publish_result_t result)
+{
+    // Matching requires the publishers to have recorded the message id, the device task does it
+    // so that the MQTT task never waits for them
+    publish_ack_t ack = { .msg_id = msg_id, .result = result };
+    if (xQueueSend(device->publish_acks, &ack, 0) != pdTRUE) {
+        ESP_LOGW(TAG, "Acknowledgment of msg_id %d dropped, the queue is full", msg_id);
+        return;
+    }
+    xTaskNotify(device->reinit_task_handle, NOTIFY_PUBLISHED, eSetBits);
+}
+
+void astarte_device_tracking_complete(astarte_device_handle_t device)
+{
+    publish_ack_t ack;
+    while (xQueueReceive(device->publish_acks, &ack, 0) == pdTRUE) {
+        complete_publish(device, &ack);
+    }
+}
+
+void astarte_device_tracking_fail_stale(astarte_device_handle_t device)
+{
+    while (1) {
+        astarte_inflight_entry_t entry;
+        xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+        bool found = astarte_inflight_table_take_stale(
+            &device->inflight, device->mqtt_generation, &entry);
+        xSemaphoreGive(device->inflight_mutex);
+        if (!found) {
+            return;
+        }
+        report_publish(device, &entry, ASTARTE_PUBLISH_RESULT_LOST);
+    }
+}
+
+void astarte_device_tracking_reset_session(astarte_device_handle_t device)
+{
+    // The next client restarts the message ids, queued acknowledgments cannot be matched
+    device->mqtt_generation++;
+    xQueueReset(device->publish_acks);
+}
+#endif
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#ifdef CONFIG_ASTARTE_PUBLISH_TRACKING
+static const astarte_publish_window_config_t *exceeded_publish_window(
+    astarte_device_handle_t device, const char *interface_name)
+{
+    const astarte_publish_window_config_t *window = get_interface_window(device, interface_name);
+    if (window && (window->max_in_flight > 0)
+        && (astarte_inflight_table_count(&device->inflight, interface_name)
+            >= window->max_in_flight)) {
+        return window;
+    }
+    window = &device->device_window;
+    if ((window->max_in_flight > 0)
+        && (astarte_inflight_table_count(&device->inflight, NULL) >= window->max_in_flight)) {
+        return window;
+    }
+    return NULL;
+}
+
+static bool wait_publish_window(astarte_device_handle_t device, TickType_t wait_ticks)
+{
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+    if (task != device->reinit_task_handle) {
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+        // The device task, which matches the acknowledgments, might be waiting for the publish
+        // scratch arena: it is released while waiting. The blocks of this task are moved out of
+        // the arena meanwhile, since the other tasks publish from it starting from its beginning.
+        astarte_scratch_saved_t saved_scratch;
+        bool scratch_saved = (device->publish_scratch_holder == task)
+            && (astarte_scratch_save(&device->publish_scratch, &saved_scratch) == ASTARTE_OK);
+        if (scratch_saved) {
+            device->publish_scratch_holder = NULL;
+            xSemaphoreGive(device->publish_scratch_mutex);
+        }
+#endif
+        bool released = xSemaphoreTake(device->inflight_released, wait_ticks) == pdTRUE;
+#ifdef CONFIG_ASTARTE_STATIC_MEMORY
+        if (scratch_saved) {
+            xSemaphoreTake(device->publish_scratch_mutex, portMAX_DELAY);
+            device->publish_scratch_holder = task;
+            astarte_scratch_restore(&saved_scratch);
+        }
+#endif
+        return released;
+    }
+
+    // The device task matches the acknowledgments, it waits for them itself. It cannot while a
+    // publish is being reported, the callback would be reentered.
+    if (device->reporting_publish) {
+        return false;
+    }
+    publish_ack_t ack;
+    if (xQueueReceive(device->publish_acks, &ack, wait_ticks) == pdFALSE) {
+        return false;
+    }
+    complete_publish(device, &ack);
+    return true;
+}
+
+static void complete_publish(astarte_device_handle_t device, const publish_ack_t *ack)
+{
+    astarte_inflight_entry_t entry;
+    // Publishers record the message id before unlocking the device, once locked the entry of an
+    // acknowledged message is complete
+    xSemaphoreTake(device->reinit_mutex, portMAX_DELAY);
+    xSemaphoreTake(device->inflight_mutex, portMAX_DELAY);
+    bool found = astarte_inflight_table_take_acked(
+        &device->inflight, ack->msg_id, device->mqtt_generation, &entry);
+    xSemaphoreGive(device->inflight_mutex);
+    xSemaphoreGive(device->reinit_mutex);
+
+    if (found) {
+        report_publish(device, &entry, ack->result);
+    }
+}
+
+static void report_publish(astarte_device_handle_t device, astarte_inflight_entry_t *entry,
+    astarte_publish_result_t result)
+{
+    xSemaphoreGive(device->inflight_released);
+    if (device->publish_event_callback) {
+        astarte_device_publish_event_t event = {
+            .device = device,
+            .token = entry->token,
+            .interface_name = entry->interface_name,
+            .path = entry->path,
+            .result = result,
+            .user_data = device->callbacks_user_data,
+        };
+        device->reporting_publish = true;
+        device->publish_event_callback(&event);
+        device->reporting_publish = false;
+    }
+    astarte_inflight_entry_free(entry);
+}
+
+static astarte_publish_window_config_t *get_interface_window(
+    astarte_device_handle_t device, const char *interface_name)
+{
+    astarte_linked_list_iterator_t list_iter;
+    astarte_err_t iter_err
+        = astarte_linked_list_iterator_init(&device->interface_windows, &list_iter);
+    while (iter_err != ASTARTE_ERR_NOT_FOUND) {
+        interface_publish_window_t *interface_window = NULL;
+        astarte_linked_list_iterator_get_item(&list_iter, (void **) &interface_window);
+        if (strcmp(interface_window->interface_name, interface_name) == 0) {
+            return &interface_window->config;
+        }
+        iter_err = astarte_linked_list_iterator_advance(&list_iter);
+    }
+    return NULL;
+}
+#endif
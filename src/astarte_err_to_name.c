@@ -42,6 +42,10 @@ static const astarte_err_msg_t astarte_err_msg_table[] = {
     ERR_TBL_IT(ASTARTE_ERR_INVALID_INTERFACE_VERSION),
     ERR_TBL_IT(ASTARTE_ERR_CONFLICTING_INTERFACE),
     ERR_TBL_IT(ASTARTE_ERR_INVALID_SIZE),
+    ERR_TBL_IT(ASTARTE_ERR_PUBLISH_QUEUE_FULL),
+    ERR_TBL_IT(ASTARTE_ERR_RATE_LIMITED),
+    ERR_TBL_IT(ASTARTE_ERR_PUBLISH_WINDOW_FULL),
+    ERR_TBL_IT(ASTARTE_ERR_OUTBOX_FULL),
 };
 
 static const char astarte_unknown_msg[] = "ERROR";
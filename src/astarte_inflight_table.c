@@ -0,0 +1,194 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_inflight_table.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_INFLIGHT_TABLE"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static bool take_slot(
+    astarte_inflight_table_t *table, size_t index, astarte_inflight_entry_t *entry);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_inflight_table_init(astarte_inflight_table_t *table, size_t capacity)
+{
+    memset(table, 0, sizeof(astarte_inflight_table_t));
+    table->entries = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, capacity, sizeof(astarte_inflight_entry_t));
+    if (!table->entries) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    table->capacity = capacity;
+    return ASTARTE_OK;
+}
+
+void astarte_inflight_table_destroy(astarte_inflight_table_t *table)
+{
+    for (size_t i = 0; i < table->capacity; i++) {
+        astarte_inflight_entry_t entry;
+        if (take_slot(table, i, &entry)) {
+            astarte_inflight_entry_free(&entry);
+        }
+    }
+    astarte_alloc_free(table->entries);
+    table->entries = NULL;
+    table->capacity = 0;
+}
+
+astarte_err_t astarte_inflight_entry_prepare(
+    astarte_inflight_entry_t *entry, const char *endpoint)
+{
+    memset(entry, 0, sizeof(astarte_inflight_entry_t));
+    const char *path = strchr(endpoint, '/');
+    if (!path) {
+        ESP_LOGE(TAG, "Invalid endpoint: %s", endpoint);
+        return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+    }
+    size_t interface_name_len = (size_t) (path - endpoint);
+    size_t path_size = strlen(path) + 1;
+    entry->interface_name
+        = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, interface_name_len + 1 + path_size);
+    if (!entry->interface_name) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    memcpy(entry->interface_name, endpoint, interface_name_len);
+    entry->interface_name[interface_name_len] = '\0';
+    entry->path = entry->interface_name + interface_name_len + 1;
+    memcpy(entry->path, path, path_size);
+    entry->msg_id = -1;
+    return ASTARTE_OK;
+}
+
+void astarte_inflight_entry_free(astarte_inflight_entry_t *entry)
+{
+    astarte_alloc_free(entry->interface_name);
+    entry->interface_name = NULL;
+    entry->path = NULL;
+}
+
+astarte_err_t astarte_inflight_table_insert(
+    astarte_inflight_table_t *table, astarte_inflight_entry_t *entry)
+{
+    if (table->count >= table->capacity) {
+        return ASTARTE_ERR_PUBLISH_WINDOW_FULL;
+    }
+    for (size_t i = 0; i < table->capacity; i++) {
+        if (table->entries[i].token != ASTARTE_PUBLISH_TOKEN_NONE) {
+            continue;
+        }
+        // Tokens wrap around after four billion messages, skipping the invalid one
+        table->last_token++;
+        if (table->last_token == ASTARTE_PUBLISH_TOKEN_NONE) {
+            table->last_token++;
+        }
+        entry->token = table->last_token;
+        table->entries[i] = *entry;
+        table->count++;
+        return ASTARTE_OK;
+    }
+    return ASTARTE_ERR_PUBLISH_WINDOW_FULL;
+}
+
+void astarte_inflight_table_assign(astarte_inflight_table_t *table, astarte_publish_token_t token,
+    int msg_id, uint32_t generation)
+{
+    for (size_t i = 0; i < table->capacity; i++) {
+        astarte_inflight_entry_t *slot = &table->entries[i];
+        if ((token != ASTARTE_PUBLISH_TOKEN_NONE) && (slot->token == token)) {
+            slot->msg_id = msg_id;
+            slot->generation = generation;
+            return;
+        }
+    }
+}
+
+bool astarte_inflight_table_take(
+    astarte_inflight_table_t *table, astarte_publish_token_t token, astarte_inflight_entry_t *entry)
+{
+    for (size_t i = 0; i < table->capacity; i++) {
+        if ((token != ASTARTE_PUBLISH_TOKEN_NONE) && (table->entries[i].token == token)) {
+            return take_slot(table, i, entry);
+        }
+    }
+    return false;
+}
+
+bool astarte_inflight_table_take_acked(astarte_inflight_table_t *table, int msg_id,
+    uint32_t generation, astarte_inflight_entry_t *entry)
+{
+    for (size_t i = 0; i < table->capacity; i++) {
+        const astarte_inflight_entry_t *slot = &table->entries[i];
+        if ((slot->token != ASTARTE_PUBLISH_TOKEN_NONE) && (slot->msg_id >= 0)
+            && (slot->msg_id == msg_id) && (slot->generation == generation)) {
+            return take_slot(table, i, entry);
+        }
+    }
+    return false;
+}
+
+bool astarte_inflight_table_take_stale(
+    astarte_inflight_table_t *table, uint32_t generation, astarte_inflight_entry_t *entry)
+{
+    for (size_t i = 0; i < table->capacity; i++) {
+        const astarte_inflight_entry_t *slot = &table->entries[i];
+        if ((slot->token != ASTARTE_PUBLISH_TOKEN_NONE) && (slot->msg_id >= 0)
+            && (slot->generation != generation)) {
+            return take_slot(table, i, entry);
+        }
+    }
+    return false;
+}
+
+size_t astarte_inflight_table_count(
+    const astarte_inflight_table_t *table, const char *interface_name)
+{
+    size_t count = 0;
+    for (size_t i = 0; i < table->capacity; i++) {
+        const astarte_inflight_entry_t *slot = &table->entries[i];
+        if ((slot->token == ASTARTE_PUBLISH_TOKEN_NONE) || !slot->windowed) {
+            continue;
+        }
+        if (!interface_name || (strcmp(slot->interface_name, interface_name) == 0)) {
+            count++;
+        }
+    }
+    return count;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static bool take_slot(
+    astarte_inflight_table_t *table, size_t index, astarte_inflight_entry_t *entry)
+{
+    astarte_inflight_entry_t *slot = &table->entries[index];
+    if (slot->token == ASTARTE_PUBLISH_TOKEN_NONE) {
+        return false;
+    }
+    *entry = *slot;
+    memset(slot, 0, sizeof(astarte_inflight_entry_t));
+    table->count--;
+    return true;
+}
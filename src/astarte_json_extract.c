@@ -0,0 +1,417 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_json_extract.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_JSON_EXTRACT"
+
+enum
+{
+    STATE_VALUE = 0,
+    STATE_ARRAY_FIRST,
+    STATE_OBJECT_FIRST,
+    STATE_OBJECT_KEY,
+    STATE_COLON,
+    STATE_STRING,
+    STATE_ESCAPE,
+    STATE_UNICODE,
+    STATE_LITERAL,
+    STATE_AFTER_VALUE,
+    STATE_END,
+    STATE_DONE,
+    STATE_ERROR,
+};
+
+enum
+{
+    MODE_KEY = 0,
+    MODE_SKIP,
+    MODE_CAPTURE,
+};
+
+#define UNICODE_ESCAPE_DIGITS 4
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static astarte_err_t process_char(astarte_json_extract_t *extract, char c);
+static astarte_err_t start_value(astarte_json_extract_t *extract, char c);
+static void start_key(astarte_json_extract_t *extract);
+static astarte_err_t end_string(astarte_json_extract_t *extract);
+static astarte_err_t emit_char(astarte_json_extract_t *extract, char c);
+static astarte_err_t emit_code_point(astarte_json_extract_t *extract, uint32_t code_point);
+static astarte_err_t push_container(astarte_json_extract_t *extract, bool is_object);
+static astarte_err_t pop_container(astarte_json_extract_t *extract, bool is_object);
+static bool top_is_object(const astarte_json_extract_t *extract);
+static bool is_whitespace(char c);
+static bool is_literal_char(char c);
+static int hex_value(char c);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_json_extract_init(astarte_json_extract_t *extract, const char *const *path,
+    size_t path_len, char *out, size_t out_size)
+{
+    memset(extract, 0, sizeof(astarte_json_extract_t));
+    extract->path = path;
+    extract->path_len = path_len;
+    extract->out = out;
+    extract->out_size = out_size;
+    extract->state = STATE_VALUE;
+    if (out_size > 0) {
+        out[0] = '\0';
+    }
+}
+
+astarte_err_t astarte_json_extract_feed(
+    astarte_json_extract_t *extract, const char *data, size_t len)
+{
+    if (extract->state == STATE_ERROR) {
+        return ASTARTE_ERR;
+    }
+
+    for (size_t i = 0; (i < len) && (extract->state != STATE_DONE); i++) {
+        astarte_err_t res = process_char(extract, data[i]);
+        if (res != ASTARTE_OK) {
+            extract->state = STATE_ERROR;
+            return res;
+        }
+    }
+
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_json_extract_finish(const astarte_json_extract_t *extract)
+{
+    return extract->found ? ASTARTE_OK : ASTARTE_ERR_NOT_FOUND;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static astarte_err_t process_char(astarte_json_extract_t *extract, char c)
+{
+    switch (extract->state) {
+        case STATE_VALUE:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            return start_value(extract, c);
+
+        case STATE_ARRAY_FIRST:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            if (c == ']') {
+                return pop_container(extract, false);
+            }
+            return start_value(extract, c);
+
+        case STATE_OBJECT_FIRST:
+        case STATE_OBJECT_KEY:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            if (c == '"') {
+                start_key(extract);
+                return ASTARTE_OK;
+            }
+            // An object can be closed right after being opened, not after a comma
+            if ((c == '}') && (extract->state == STATE_OBJECT_FIRST)) {
+                return pop_container(extract, true);
+            }
+            break;
+
+        case STATE_COLON:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            if (c == ':') {
+                extract->state = STATE_VALUE;
+                return ASTARTE_OK;
+            }
+            break;
+
+        case STATE_STRING:
+            if (c == '"') {
+                return end_string(extract);
+            }
+            if (c == '\\') {
+                extract->state = STATE_ESCAPE;
+                return ASTARTE_OK;
+            }
+            if ((unsigned char) c < 0x20U) {
+                break;
+            }
+            return emit_char(extract, c);
+
+        case STATE_ESCAPE:
+            extract->state = STATE_STRING;
+            switch (c) {
+                case '"':
+                case '\\':
+                case '/':
+                    return emit_char(extract, c);
+                case 'b':
+                    return emit_char(extract, '\b');
+                case 'f':
+                    return emit_char(extract, '\f');
+                case 'n':
+                    return emit_char(extract, '\n');
+                case 'r':
+                    return emit_char(extract, '\r');
+                case 't':
+                    return emit_char(extract, '\t');
+                case 'u':
+                    extract->unicode = 0;
+                    extract->unicode_digits = 0;
+                    extract->state = STATE_UNICODE;
+                    return ASTARTE_OK;
+                default:
+                    break;
+            }
+            break;
+
+        case STATE_UNICODE: {
+            int value = hex_value(c);
+            if (value < 0) {
+                break;
+            }
+            extract->unicode = (extract->unicode << 4) | (uint32_t) value;
+            if (++extract->unicode_digits < UNICODE_ESCAPE_DIGITS) {
+                return ASTARTE_OK;
+            }
+            extract->state = STATE_STRING;
+            return emit_code_point(extract, extract->unicode);
+        }
+
+        case STATE_LITERAL:
+            if (is_literal_char(c)) {
+                return ASTARTE_OK;
+            }
+            // The character ending the literal belongs to what follows the value
+            extract->state = STATE_AFTER_VALUE;
+            return process_char(extract, c);
+
+        case STATE_AFTER_VALUE:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            if ((c == ',') && (extract->depth > 0)) {
+                extract->state = top_is_object(extract) ? STATE_OBJECT_KEY : STATE_VALUE;
+                return ASTARTE_OK;
+            }
+            if ((c == '}') || (c == ']')) {
+                return pop_container(extract, c == '}');
+            }
+            break;
+
+        case STATE_END:
+            if (is_whitespace(c)) {
+                return ASTARTE_OK;
+            }
+            break;
+
+        default:
+            break;
+    }
+
+    ESP_LOGD(TAG, "Unexpected character 0x%02x in state %d", (unsigned char) c, extract->state);
+    return ASTARTE_ERR;
+}
+
+static astarte_err_t start_value(astarte_json_extract_t *extract, char c)
+{
+    // The key preceding this value matched the path, only meaningful for this value
+    bool key_match = extract->key_match;
+    extract->key_match = false;
+
+    switch (c) {
+        case '{':
+            if (key_match && (extract->depth < extract->path_len)) {
+                extract->matched = extract->depth;
+            }
+            return push_container(extract, true);
+
+        case '[':
+            return push_container(extract, false);
+
+        case '"':
+            extract->string_mode
+                = (key_match && (extract->depth == extract->path_len)) ? MODE_CAPTURE : MODE_SKIP;
+            extract->state = STATE_STRING;
+            return ASTARTE_OK;
+
+        default:
+            if ((c == '-') || (c >= '0' && c <= '9') || (c == 't') || (c == 'f') || (c == 'n')) {
+                extract->state = STATE_LITERAL;
+                return ASTARTE_OK;
+            }
+            ESP_LOGD(TAG, "Unexpected character 0x%02x at value start", (unsigned char) c);
+            return ASTARTE_ERR;
+    }
+}
+
+static void start_key(astarte_json_extract_t *extract)
+{
+    extract->string_mode = MODE_KEY;
+    extract->key_pos = 0;
+    // Keys are compared only when all the enclosing objects are on the path
+    extract->key_compare
+        = (extract->matched == extract->depth - 1) && (extract->depth <= extract->path_len);
+    extract->state = STATE_STRING;
+}
+
+static astarte_err_t end_string(astarte_json_extract_t *extract)
+{
+    switch (extract->string_mode) {
+        case MODE_KEY:
+            extract->key_match = extract->key_compare
+                && (extract->path[extract->depth - 1][extract->key_pos] == '\0');
+            extract->state = STATE_COLON;
+            break;
+
+        case MODE_CAPTURE:
+            extract->out[extract->out_len] = '\0';
+            extract->found = true;
+            extract->state = STATE_DONE;
+            break;
+
+        default:
+            extract->state = (extract->depth == 0) ? STATE_END : STATE_AFTER_VALUE;
+            break;
+    }
+
+    return ASTARTE_OK;
+}
+
+static astarte_err_t emit_char(astarte_json_extract_t *extract, char c)
+{
+    switch (extract->string_mode) {
+        case MODE_KEY:
+            if (extract->key_compare) {
+                const char *key = extract->path[extract->depth - 1];
+                if ((key[extract->key_pos] != '\0') && (key[extract->key_pos] == c)) {
+                    extract->key_pos++;
+                } else {
+                    extract->key_compare = false;
+                }
+            }
+            return ASTARTE_OK;
+
+        case MODE_CAPTURE:
+            // Leave room for the NULL terminator
+            if (extract->out_len + 1 >= extract->out_size) {
+                ESP_LOGE(TAG, "Value doesn't fit in %zu bytes", extract->out_size);
+                return ASTARTE_ERR_INVALID_SIZE;
+            }
+            extract->out[extract->out_len++] = c;
+            return ASTARTE_OK;
+
+        default:
+            return ASTARTE_OK;
+    }
+}
+
+static astarte_err_t emit_code_point(astarte_json_extract_t *extract, uint32_t code_point)
+{
+    // UTF-8 encoding of a code point of the basic multilingual plane
+    astarte_err_t res = ASTARTE_OK;
+    if (code_point < 0x80U) {
+        res = emit_char(extract, (char) code_point);
+    } else if (code_point < 0x800U) {
+        res = emit_char(extract, (char) (0xC0U | (code_point >> 6)));
+        if (res == ASTARTE_OK) {
+            res = emit_char(extract, (char) (0x80U | (code_point & 0x3FU)));
+        }
+    } else {
+        res = emit_char(extract, (char) (0xE0U | (code_point >> 12)));
+        if (res == ASTARTE_OK) {
+            res = emit_char(extract, (char) (0x80U | ((code_point >> 6) & 0x3FU)));
+        }
+        if (res == ASTARTE_OK) {
+            res = emit_char(extract, (char) (0x80U | (code_point & 0x3FU)));
+        }
+    }
+    return res;
+}
+
+static astarte_err_t push_container(astarte_json_extract_t *extract, bool is_object)
+{
+    if (extract->depth >= ASTARTE_JSON_EXTRACT_MAX_DEPTH) {
+        ESP_LOGE(TAG, "JSON document nested too deeply");
+        return ASTARTE_ERR;
+    }
+
+    if (is_object) {
+        extract->containers |= (1U << extract->depth);
+    } else {
+        extract->containers &= ~(1U << extract->depth);
+    }
+    extract->depth++;
+    extract->state = is_object ? STATE_OBJECT_FIRST : STATE_ARRAY_FIRST;
+
+    return ASTARTE_OK;
+}
+
+static astarte_err_t pop_container(astarte_json_extract_t *extract, bool is_object)
+{
+    if ((extract->depth == 0) || (top_is_object(extract) != is_object)) {
+        ESP_LOGD(TAG, "Mismatched container end");
+        return ASTARTE_ERR;
+    }
+
+    extract->depth--;
+    // Closing an object on the path moves the match back to its parent
+    if ((extract->matched > 0) && (extract->matched >= extract->depth)) {
+        extract->matched = extract->depth - 1;
+    }
+    extract->state = (extract->depth == 0) ? STATE_END : STATE_AFTER_VALUE;
+
+    return ASTARTE_OK;
+}
+
+static bool top_is_object(const astarte_json_extract_t *extract)
+{
+    return (extract->containers >> (extract->depth - 1)) & 1U;
+}
+
+static bool is_whitespace(char c)
+{
+    return (c == ' ') || (c == '\t') || (c == '\n') || (c == '\r');
+}
+
+static bool is_literal_char(char c)
+{
+    return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c == '.')
+        || (c == '+') || (c == '-');
+}
+
+static int hex_value(char c)
+{
+    if (c >= '0' && c <= '9') {
+        return c - '0';
+    }
+    if (c >= 'a' && c <= 'f') {
+        return c - 'a' + 10;
+    }
+    if (c >= 'A' && c <= 'F') {
+        return c - 'A' + 10;
+    }
+    return -1;
+}
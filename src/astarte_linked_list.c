@@ -6,6 +6,8 @@
 
 #include <astarte_linked_list.h>
 
+#include <astarte_alloc.h>
+
 #include <string.h>
 
 #include <esp_log.h>
@@ -41,7 +43,8 @@ bool astarte_linked_list_is_empty(astarte_linked_list_handle_t *handle)
 astarte_err_t astarte_linked_list_append(astarte_linked_list_handle_t *handle, void *value)
 {
     // Allocate a new node for the struct
-    struct astarte_linked_list_node *node = calloc(1, sizeof(struct astarte_linked_list_node));
+    struct astarte_linked_list_node *node = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(struct astarte_linked_list_node));
     if (!node) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return ASTARTE_ERR_OUT_OF_MEMORY;
@@ -77,7 +80,7 @@ astarte_err_t astarte_linked_list_remove_tail(astarte_linked_list_handle_t *hand
         handle->tail = last_node->prev;
     }
     *value = last_node->value;
-    free(last_node);
+    astarte_alloc_free(last_node);
     return ASTARTE_OK;
 }
 
@@ -87,12 +90,12 @@ void astarte_linked_list_destroy(astarte_linked_list_handle_t *handle)
         struct astarte_linked_list_node *node = handle->head;
         struct astarte_linked_list_node *next_node = node->next;
         while (next_node) {
-            free(node);
+            astarte_alloc_free(node);
             node = next_node;
             next_node = node->next;
         }
         // Free the last node
-        free(node);
+        astarte_alloc_free(node);
         handle->head = NULL;
         handle->tail = NULL;
     }
@@ -104,14 +107,14 @@ void astarte_linked_list_destroy_and_release(astarte_linked_list_handle_t *handl
         struct astarte_linked_list_node *node = handle->head;
         struct astarte_linked_list_node *next_node = node->next;
         while (next_node) {
-            free(node->value);
-            free(node);
+            astarte_alloc_free(node->value);
+            astarte_alloc_free(node);
             node = next_node;
             next_node = node->next;
         }
         // Free the last node
-        free(node->value);
-        free(node);
+        astarte_alloc_free(node->value);
+        astarte_alloc_free(node);
         handle->head = NULL;
         handle->tail = NULL;
     }
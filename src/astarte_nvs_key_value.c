@@ -22,6 +22,8 @@
 
 #include "astarte_nvs_key_value.h"
 
+#include "astarte_alloc.h"
+
 #include <inttypes.h>
 #include <string.h>
 
@@ -189,7 +191,8 @@ esp_err_t astarte_nvs_key_value_erase_key(nvs_handle_t handle, const char *key)
             ESP_LOGE(TAG, "Error fetching key from nvs during erase operation.");
             return esp_err;
         }
-        char *tmp_key = calloc(tmp_key_len, sizeof(char));
+        char *tmp_key
+            = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, tmp_key_len, sizeof(char));
         if (!tmp_key) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
             return ESP_FAIL;
@@ -199,62 +202,63 @@ esp_err_t astarte_nvs_key_value_erase_key(nvs_handle_t handle, const char *key)
         esp_err = nvs_get_str(handle, tmp_key_entry_name, tmp_key, &tmp_key_len);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error fetching key from nvs during erase operation.");
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return esp_err;
         }
         // Get the value to shift using the store index
         char tmp_value_entry_name[NVS_KEY_NAME_MAX_SIZE] = { 0 };
         esp_err = get_entry_name(i + 1, tmp_value_entry_name);
         if (esp_err != ESP_OK) {
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return ESP_FAIL;
         }
         size_t tmp_value_len = 0;
         esp_err = nvs_get_blob(handle, tmp_value_entry_name, NULL, &tmp_value_len);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error fetching value from nvs during erase operation.");
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return esp_err;
         }
-        char *tmp_value = calloc(tmp_value_len, sizeof(char));
+        char *tmp_value
+            = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, tmp_value_len, sizeof(char));
         if (!tmp_value) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return ESP_FAIL;
         }
         esp_err = nvs_get_blob(handle, tmp_value_entry_name, tmp_value, &tmp_value_len);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error fetching value from nvs during erase operation.");
-            free(tmp_key);
-            free(tmp_value);
+            astarte_alloc_free(tmp_key);
+            astarte_alloc_free(tmp_value);
             return esp_err;
         }
         // Store the key in the new position
         char new_key_entry_name[NVS_KEY_NAME_MAX_SIZE] = { 0 };
         esp_err = get_entry_name(i - 2, new_key_entry_name);
         if (esp_err != ESP_OK) {
-            free(tmp_key);
-            free(tmp_value);
+            astarte_alloc_free(tmp_key);
+            astarte_alloc_free(tmp_value);
             return ESP_FAIL;
         }
         // Confusing for clang-tidy as second parameter is called 'key'
         // NOLINTNEXTLINE(readability-suspicious-call-argument)
         esp_err = nvs_set_str(handle, new_key_entry_name, tmp_key);
-        free(tmp_key);
+        astarte_alloc_free(tmp_key);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error storing the key.");
-            free(tmp_value);
+            astarte_alloc_free(tmp_value);
             return esp_err;
         }
         // Store the value in the new position
         char new_value_entry_name[NVS_KEY_NAME_MAX_SIZE] = { 0 };
         esp_err = get_entry_name(i - 1, new_value_entry_name);
         if (esp_err != ESP_OK) {
-            free(tmp_value);
+            astarte_alloc_free(tmp_value);
             return ESP_FAIL;
         }
         esp_err = nvs_set_blob(handle, new_value_entry_name, tmp_value, tmp_value_len);
-        free(tmp_value);
+        astarte_alloc_free(tmp_value);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error storing the value.");
             return esp_err;
@@ -468,7 +472,8 @@ static esp_err_t lookup_key_position(nvs_handle_t handle, const char *key, uint6
             ESP_LOGE(TAG, "Error getting the key length for %s", tmp_key_entry_name);
             return ESP_FAIL;
         }
-        char *tmp_key = calloc(tmp_key_len, sizeof(char));
+        char *tmp_key
+            = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, tmp_key_len, sizeof(char));
         if (!tmp_key) {
             ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
             return ESP_FAIL;
@@ -478,15 +483,15 @@ static esp_err_t lookup_key_position(nvs_handle_t handle, const char *key, uint6
         esp_err = nvs_get_str(handle, tmp_key_entry_name, tmp_key, &tmp_key_len);
         if (esp_err != ESP_OK) {
             ESP_LOGE(TAG, "Error getting the key for %s", tmp_key_entry_name);
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return ESP_FAIL;
         }
         if (strcmp(key, tmp_key) == 0) {
             *store_index = i;
-            free(tmp_key);
+            astarte_alloc_free(tmp_key);
             return ESP_OK;
         }
-        free(tmp_key);
+        astarte_alloc_free(tmp_key);
     }
     return ESP_ERR_NVS_NOT_FOUND;
 }
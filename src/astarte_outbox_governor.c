@@ -0,0 +1,38 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_outbox_governor.h>
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_outbox_governor_init(
+    astarte_outbox_governor_t *governor, size_t high_water, size_t low_water)
+{
+    governor->high_water = high_water;
+    governor->low_water = (low_water < high_water) ? low_water : high_water;
+    governor->congested = false;
+}
+
+astarte_outbox_crossing_t astarte_outbox_governor_update(
+    astarte_outbox_governor_t *governor, size_t outbox_size)
+{
+    if (!governor->congested && (outbox_size >= governor->high_water)) {
+        governor->congested = true;
+        return ASTARTE_OUTBOX_CROSSING_HIGH;
+    }
+    if (governor->congested && (outbox_size <= governor->low_water)) {
+        governor->congested = false;
+        return ASTARTE_OUTBOX_CROSSING_LOW;
+    }
+    return ASTARTE_OUTBOX_CROSSING_NONE;
+}
+
+bool astarte_outbox_governor_congested(const astarte_outbox_governor_t *governor)
+{
+    return governor->congested;
+}
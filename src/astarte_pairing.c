@@ -6,7 +6,9 @@
 
 #include "astarte_pairing.h"
 
+#include "astarte_alloc.h"
 #include "astarte_credentials.h"
+#include "astarte_json_extract.h"
 
 #include <esp_http_client.h>
 #if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
@@ -38,12 +40,42 @@ static_assert(sizeof(CONFIG_ASTARTE_PAIRING_JWT) <= CONFIG_ASTARTE_PAIRING_JWT_M
 #define HTTP_BUFFER_SIZE 2048
 #define HTTP_BUFFER_SIZE_TX 2048
 
+// Beginning of the response body kept for logging failed requests
+#define ERROR_BODY_LENGTH 128
+
 #define TAG "ASTARTE_PAIRING"
 
+struct astarte_pairing_session
+{
+    astarte_pairing_config_t config;
+    // Created on the first request and kept alive until the session is destroyed
+    esp_http_client_handle_t client;
+    // Extractor of the wanted field of the current response, fed by the HTTP event handler
+    astarte_json_extract_t *extract;
+    astarte_err_t extract_result;
+    char error_body[ERROR_BODY_LENGTH];
+    size_t error_body_len;
+    char credentials_secret[CRED_SECRET_LENGTH];
+    bool has_credentials_secret;
+};
+
+static const char *const broker_url_path[]
+    = { "data", "protocols", "astarte_mqtt_v1", "broker_url" };
+static const char *const credentials_secret_path[] = { "data", "credentials_secret" };
+static const char *const client_crt_path[] = { "data", "client_crt" };
+
 static esp_err_t http_event_handler(esp_http_client_event_t *evt);
-static const char *extract_broker_url(cJSON *response);
-static const char *extract_credentials_secret(cJSON *response);
-static const char *extract_client_crt(cJSON *response);
+static astarte_err_t session_perform(astarte_pairing_session_handle_t session,
+    esp_http_client_method_t method, const char *url, const char *auth_header,
+    const char *payload, astarte_json_extract_t *extract, int *status_code);
+static void session_on_data(astarte_pairing_session_handle_t session, const char *data, int len);
+static astarte_err_t session_extract_result(astarte_pairing_session_handle_t session,
+    const astarte_json_extract_t *extract, const char *field);
+static astarte_err_t load_credentials_secret(astarte_pairing_session_handle_t session);
+static char *new_bearer_header(const char *token, size_t max_length);
+static void log_failed_request(
+    astarte_pairing_session_handle_t session, const char *request, int status_code);
+static astarte_err_t status_code_to_astarte(int status_code);
 
 static esp_err_t http_event_handler(esp_http_client_event_t *evt)
 {
@@ -63,12 +95,8 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
             break;
         case HTTP_EVENT_ON_DATA: {
             ESP_LOGD(TAG, "HTTP_EVENT_ON_DATA, len=%d", evt->data_len);
-            if (!esp_http_client_is_chunked_response(evt->client)) {
-                ESP_LOGD(TAG, "Got response: %.*s", evt->data_len, (char *) evt->data);
-                cJSON **resp_json = (cJSON **) evt->user_data;
-                *resp_json = (void *) cJSON_Parse(evt->data);
-            }
-
+            // Chunked responses and responses split in several events are parsed incrementally
+            session_on_data(evt->user_data, evt->data, evt->data_len);
             break;
         }
         case HTTP_EVENT_ON_FINISH:
@@ -87,72 +115,151 @@ static esp_err_t http_event_handler(esp_http_client_event_t *evt)
     return ESP_OK;
 }
 
-astarte_err_t astarte_pairing_get_credentials_secret(
-    const astarte_pairing_config_t *config, char *out, size_t length)
+astarte_pairing_session_handle_t astarte_pairing_session_new(const astarte_pairing_config_t *config)
 {
-    if (config->credentials_secret) {
-        // We have an explicit credentials_secret in the config, we're done
-        strncpy(out, config->credentials_secret, length);
-        return ASTARTE_OK;
+    astarte_pairing_session_handle_t session = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_PAIRING, 1, sizeof(struct astarte_pairing_session));
+    if (!session) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
     }
+    session->config = *config;
 
-    astarte_err_t err = astarte_credentials_get_stored_credentials_secret(out, length);
-    switch (err) {
-        case ASTARTE_OK:
-            return ASTARTE_OK;
-
-        case ASTARTE_ERR_NOT_FOUND:
-            ESP_LOGD(TAG, "credentials_secret not found, registering device");
-            break;
+    return session;
+}
 
-        default:
-            // Some other error happened, bail out
-            return err;
+void astarte_pairing_session_destroy(astarte_pairing_session_handle_t session)
+{
+    if (!session) {
+        return;
     }
 
-    err = astarte_pairing_register_device(config);
-    if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Device registration failed: %d", err);
-        return err;
+    if (session->client) {
+        esp_http_client_cleanup(session->client);
     }
+    // Don't leave the credentials secret around in the heap
+    memset(session->credentials_secret, 0, sizeof(session->credentials_secret));
+    astarte_alloc_free(session);
+}
 
-    // Now we should have credentials_secret in NVS
-    err = astarte_credentials_get_stored_credentials_secret(out, length);
-    if (err != ASTARTE_OK) {
-        ESP_LOGE(TAG, "Can't retrieve credentials_secret after registration");
-        return err;
+astarte_err_t astarte_pairing_session_get_credentials_secret(
+    astarte_pairing_session_handle_t session, char *out, size_t length)
+{
+    if (!session->has_credentials_secret) {
+        astarte_err_t err = load_credentials_secret(session);
+        if (err != ASTARTE_OK) {
+            return err;
+        }
     }
 
+    strncpy(out, session->credentials_secret, length);
     return ASTARTE_OK;
 }
 
-astarte_err_t astarte_pairing_get_mqtt_v1_credentials(
-    const astarte_pairing_config_t *config, const char *csr, char *out, size_t length)
+astarte_err_t astarte_pairing_session_register_device(astarte_pairing_session_handle_t session)
 {
+    const astarte_pairing_config_t *config = &session->config;
+    if (!config->jwt || strlen(config->jwt) == 0) {
+        ESP_LOGE(TAG,
+            "ASTARTE_PAIRING_JWT is not configured, device can't be registered. "
+            "Configure it using make menuconfig");
+        return ASTARTE_ERR_NO_JWT;
+    }
+
     astarte_err_t ret = ASTARTE_ERR;
-    char *cred_secret = NULL;
     char *url = NULL;
     char *auth_header = NULL;
-    cJSON *resp = NULL;
     char *payload = NULL;
-    esp_http_client_handle_t client = NULL;
 
-    cred_secret = calloc(CRED_SECRET_LENGTH, sizeof(char));
-    if (!cred_secret) {
+    url = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_PAIRING, MAX_URL_LENGTH, sizeof(char));
+    if (!url) {
         ret = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         goto exit;
     }
 
-    astarte_err_t err
-        = astarte_pairing_get_credentials_secret(config, cred_secret, CRED_SECRET_LENGTH);
-    if (err != ASTARTE_OK) {
-        ret = err;
-        ESP_LOGE(TAG, "Can't retrieve credentials_secret");
+    int print_ret
+        = snprintf(url, MAX_URL_LENGTH, "%s/v1/%s/agent/devices", config->base_url, config->realm);
+    if ((print_ret < 0) || (print_ret >= MAX_URL_LENGTH)) {
+        ESP_LOGE(TAG, "Error encoding HTTPS request URL");
+        ret = ASTARTE_ERR;
+        goto exit;
+    }
+
+    cJSON *root = cJSON_CreateObject();
+    cJSON *data = cJSON_CreateObject();
+    cJSON_AddItemToObject(root, "data", data);
+    cJSON_AddStringToObject(data, "hw_id", config->hw_id);
+    payload = cJSON_PrintUnformatted(root);
+    cJSON_Delete(root);
+
+    auth_header = new_bearer_header(config->jwt, CONFIG_ASTARTE_PAIRING_JWT_MAX_LEN);
+    if (!auth_header) {
+        ret = ASTARTE_ERR;
+        goto exit;
+    }
+
+    // The credentials secret reaches the session only once the registration succeeded
+    char credentials_secret[CRED_SECRET_LENGTH] = { 0 };
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(
+        &extract, credentials_secret_path, 2, credentials_secret, CRED_SECRET_LENGTH);
+    int status_code = 0;
+    ret = session_perform(
+        session, HTTP_METHOD_POST, url, auth_header, payload, &extract, &status_code);
+    if (ret != ASTARTE_OK) {
         goto exit;
     }
 
-    url = calloc(MAX_URL_LENGTH, sizeof(char));
+    if (status_code != HTTP_RESP_CODE_CREATED) {
+        log_failed_request(session, "Device registration", status_code);
+        ret = (status_code == HTTP_RESP_CODE_UNPROCESSABLE_CONTENT)
+            ? ASTARTE_ERR_ALREADY_EXISTS
+            : status_code_to_astarte(status_code);
+        goto exit;
+    }
+
+    ret = session_extract_result(session, &extract, "credentials_secret");
+    if (ret != ASTARTE_OK) {
+        goto exit;
+    }
+    ESP_LOGD(TAG, "Device registered, credentials_secret is %s", credentials_secret);
+    ret = astarte_credentials_ctx_set_stored_credentials_secret(
+        config->credentials_context, credentials_secret);
+    if (ret != ASTARTE_OK) {
+        ret = ASTARTE_ERR;
+        goto exit;
+    }
+    // Keep the secret for the following requests of the session
+    memcpy(session->credentials_secret, credentials_secret, CRED_SECRET_LENGTH);
+    session->has_credentials_secret = true;
+
+exit:
+    astarte_alloc_free(url);
+    astarte_alloc_free(auth_header);
+    cJSON_free(payload);
+
+    return ret;
+}
+
+astarte_err_t astarte_pairing_session_get_mqtt_v1_credentials(
+    astarte_pairing_session_handle_t session, const char *csr, char *out, size_t length)
+{
+    const astarte_pairing_config_t *config = &session->config;
+    astarte_err_t ret = ASTARTE_ERR;
+    char *url = NULL;
+    char *auth_header = NULL;
+    char *payload = NULL;
+
+    if (!session->has_credentials_secret) {
+        ret = load_credentials_secret(session);
+        if (ret != ASTARTE_OK) {
+            ESP_LOGE(TAG, "Can't retrieve credentials_secret");
+            goto exit;
+        }
+    }
+
+    url = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_PAIRING, MAX_URL_LENGTH, sizeof(char));
     if (!url) {
         ret = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
@@ -168,25 +275,6 @@ astarte_err_t astarte_pairing_get_mqtt_v1_credentials(
         goto exit;
     }
 
-    esp_http_client_config_t http_config
-        = {.url = url,
-              .event_handler = http_event_handler,
-#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-              .crt_bundle_attach = esp_crt_bundle_attach,
-#endif
-              .method = HTTP_METHOD_POST,
-              .buffer_size = HTTP_BUFFER_SIZE,
-              .buffer_size_tx = HTTP_BUFFER_SIZE_TX,
-              .user_data = &resp,
-          };
-
-    client = esp_http_client_init(&http_config);
-    if (!client) {
-        ret = ASTARTE_ERR_ESP_SDK;
-        ESP_LOGE(TAG, "Could not initialize http client");
-        goto exit;
-    }
-
     cJSON *root = cJSON_CreateObject();
     cJSON *data = cJSON_CreateObject();
     cJSON_AddItemToObject(root, "data", data);
@@ -194,109 +282,59 @@ astarte_err_t astarte_pairing_get_mqtt_v1_credentials(
     payload = cJSON_PrintUnformatted(root);
     cJSON_Delete(root);
 
-    ESP_ERROR_CHECK(esp_http_client_set_post_field(client, payload, strlen(payload)));
-
-    auth_header = calloc(MAX_CRED_SECR_HEADER_LENGTH, sizeof(char));
+    auth_header = new_bearer_header(session->credentials_secret, MAX_CRED_SECR_HEADER_LENGTH);
     if (!auth_header) {
-        ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        ret = ASTARTE_ERR;
         goto exit;
     }
 
-    print_ret = snprintf(auth_header, MAX_CRED_SECR_HEADER_LENGTH, "Bearer %s", cred_secret);
-    if ((print_ret < 0) || (print_ret >= MAX_CRED_SECR_HEADER_LENGTH)) {
-        ESP_LOGE(TAG, "Error encoding authorization header");
-        ret = ASTARTE_ERR;
+    // The certificate is extracted directly in the caller buffer
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, length);
+    int status_code = 0;
+    ret = session_perform(
+        session, HTTP_METHOD_POST, url, auth_header, payload, &extract, &status_code);
+    if (ret != ASTARTE_OK) {
         goto exit;
     }
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Authorization", auth_header));
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Content-Type", "application/json"));
-
-    err = esp_http_client_perform(client);
-
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-        ESP_LOGD(TAG, "HTTP POST Status = %d, content_length = %" PRIi64, status_code,
-            esp_http_client_get_content_length(client));
-#else
-        ESP_LOGD(TAG, "HTTP POST Status = %d, content_length = %d", status_code,
-            esp_http_client_get_content_length(client));
-#endif
 
-        const char *client_crt = NULL;
-        if (status_code == HTTP_RESP_CODE_CREATED) {
-            client_crt = extract_client_crt(resp);
-            ESP_LOGD(TAG, "Got credentials, client_crt is %s", client_crt);
-        } else {
-            char *json_error = cJSON_Print(resp);
-            if (json_error) {
-                ESP_LOGE(TAG, "Device credentials request failed with code %d: %s", status_code,
-                    json_error);
-                free(json_error);
-            } else {
-                ESP_LOGE(TAG, "Device credentials request failed with code %d", status_code);
-            }
-
-            // Set ret to the right error
-            if (status_code == HTTP_RESP_CODE_UNAUTHORIZED
-                || status_code == HTTP_RESP_CODE_FORBIDDEN) {
-                ret = ASTARTE_ERR_AUTH;
-            } else {
-                ret = ASTARTE_ERR_API;
-            }
-        }
+    if (status_code != HTTP_RESP_CODE_CREATED) {
+        log_failed_request(session, "Device credentials request", status_code);
+        ret = status_code_to_astarte(status_code);
+        goto exit;
+    }
 
-        if (client_crt) {
-            strncpy(out, client_crt, length);
-            ret = ASTARTE_OK;
-        }
-    } else {
-        ret = ASTARTE_ERR_HTTP;
-        ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+    ret = session_extract_result(session, &extract, "client_crt");
+    if (ret != ASTARTE_OK) {
+        goto exit;
     }
+    ESP_LOGD(TAG, "Got credentials, client_crt is %s", out);
 
 exit:
-    free(cred_secret);
-    free(url);
-    free(auth_header);
-    free(payload);
-    if (resp) {
-        cJSON_Delete(resp);
-    }
-    if (client) {
-        esp_http_client_cleanup(client);
-    }
+    astarte_alloc_free(url);
+    astarte_alloc_free(auth_header);
+    cJSON_free(payload);
 
     return ret;
 }
 
-astarte_err_t astarte_pairing_get_mqtt_v1_broker_url(
-    const astarte_pairing_config_t *config, char *out, size_t length)
+astarte_err_t astarte_pairing_session_get_mqtt_v1_broker_url(
+    astarte_pairing_session_handle_t session, char *out, size_t length)
 {
+    const astarte_pairing_config_t *config = &session->config;
     astarte_err_t ret = ASTARTE_ERR;
-    char *cred_secret = NULL;
     char *url = NULL;
     char *auth_header = NULL;
-    cJSON *resp = NULL;
-    esp_http_client_handle_t client = NULL;
-
-    cred_secret = calloc(CRED_SECRET_LENGTH, sizeof(char));
-    if (!cred_secret) {
-        ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        goto exit;
-    }
 
-    astarte_err_t err
-        = astarte_pairing_get_credentials_secret(config, cred_secret, CRED_SECRET_LENGTH);
-    if (err != ASTARTE_OK) {
-        ret = err;
-        ESP_LOGE(TAG, "Can't retrieve credentials_secret");
-        goto exit;
+    if (!session->has_credentials_secret) {
+        ret = load_credentials_secret(session);
+        if (ret != ASTARTE_OK) {
+            ESP_LOGE(TAG, "Can't retrieve credentials_secret");
+            goto exit;
+        }
     }
 
-    url = calloc(MAX_URL_LENGTH, sizeof(char));
+    url = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_PAIRING, MAX_URL_LENGTH, sizeof(char));
     if (!url) {
         ret = ASTARTE_ERR_OUT_OF_MEMORY;
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
@@ -311,267 +349,257 @@ astarte_err_t astarte_pairing_get_mqtt_v1_broker_url(
         goto exit;
     }
 
-    esp_http_client_config_t http_config
-        = {.url = url,
-              .event_handler = http_event_handler,
-#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-              .crt_bundle_attach = esp_crt_bundle_attach,
-#endif
-              .method = HTTP_METHOD_GET,
-              .buffer_size = HTTP_BUFFER_SIZE,
-              .buffer_size_tx = HTTP_BUFFER_SIZE_TX,
-              .user_data = &resp,
-          };
-
-    client = esp_http_client_init(&http_config);
-    if (!client) {
-        ret = ASTARTE_ERR_ESP_SDK;
-        ESP_LOGE(TAG, "Could not initialize http client");
+    auth_header = new_bearer_header(session->credentials_secret, MAX_CRED_SECR_HEADER_LENGTH);
+    if (!auth_header) {
+        ret = ASTARTE_ERR;
         goto exit;
     }
 
-    auth_header = calloc(MAX_CRED_SECR_HEADER_LENGTH, sizeof(char));
-    if (!auth_header) {
-        ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, broker_url_path, 4, out, length);
+    int status_code = 0;
+    ret = session_perform(session, HTTP_METHOD_GET, url, auth_header, NULL, &extract, &status_code);
+    if (ret != ASTARTE_OK) {
         goto exit;
     }
 
-    print_ret = snprintf(auth_header, MAX_CRED_SECR_HEADER_LENGTH, "Bearer %s", cred_secret);
-    if ((print_ret < 0) || (print_ret >= MAX_CRED_SECR_HEADER_LENGTH)) {
-        ESP_LOGE(TAG, "Error encoding authorization header");
-        ret = ASTARTE_ERR;
+    if (status_code != HTTP_RESP_CODE_OK) {
+        log_failed_request(session, "Device info", status_code);
+        ret = status_code_to_astarte(status_code);
         goto exit;
     }
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Authorization", auth_header));
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Content-Type", "application/json"));
 
-    err = esp_http_client_perform(client);
+    ret = session_extract_result(session, &extract, "broker_url");
+    if (ret != ASTARTE_OK) {
+        goto exit;
+    }
+    ESP_LOGD(TAG, "Got info, broker_url is %s", out);
 
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
-#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-        ESP_LOGD(TAG, "HTTP GET Status = %d, content_length = %" PRIi64, status_code,
-            esp_http_client_get_content_length(client));
-#else
-        ESP_LOGD(TAG, "HTTP GET Status = %d, content_length = %d", status_code,
-            esp_http_client_get_content_length(client));
-#endif
+exit:
+    astarte_alloc_free(url);
+    astarte_alloc_free(auth_header);
 
-        const char *broker_url = NULL;
-        if (status_code == HTTP_RESP_CODE_OK) {
-            broker_url = extract_broker_url(resp);
-            ESP_LOGD(TAG, "Got info, broker_url is %s", broker_url);
-        } else {
-            char *json_error = cJSON_Print(resp);
-            if (json_error) {
-                ESP_LOGE(TAG, "Device info failed with code %d: %s", status_code, json_error);
-                free(json_error);
-            } else {
-                ESP_LOGE(TAG, "Device info failed with code %d", status_code);
-            }
-
-            // Set ret to the right error
-            if (status_code == HTTP_RESP_CODE_UNAUTHORIZED
-                || status_code == HTTP_RESP_CODE_FORBIDDEN) {
-                ret = ASTARTE_ERR_AUTH;
-            } else {
-                ret = ASTARTE_ERR_API;
-            }
-        }
+    return ret;
+}
 
-        if (broker_url) {
-            strncpy(out, broker_url, length);
-            ret = ASTARTE_OK;
-        }
-    } else {
-        ret = ASTARTE_ERR_HTTP;
-        ESP_LOGE(TAG, "HTTP GET request failed: %s", esp_err_to_name(err));
+astarte_err_t astarte_pairing_get_credentials_secret(
+    const astarte_pairing_config_t *config, char *out, size_t length)
+{
+    astarte_pairing_session_handle_t session = astarte_pairing_session_new(config);
+    if (!session) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
     }
+    astarte_err_t ret = astarte_pairing_session_get_credentials_secret(session, out, length);
+    astarte_pairing_session_destroy(session);
 
-exit:
-    free(cred_secret);
-    free(url);
-    free(auth_header);
-    if (resp) {
-        cJSON_Delete(resp);
+    return ret;
+}
+
+astarte_err_t astarte_pairing_get_mqtt_v1_credentials(
+    const astarte_pairing_config_t *config, const char *csr, char *out, size_t length)
+{
+    astarte_pairing_session_handle_t session = astarte_pairing_session_new(config);
+    if (!session) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
     }
-    if (client) {
-        esp_http_client_cleanup(client);
+    astarte_err_t ret = astarte_pairing_session_get_mqtt_v1_credentials(session, csr, out, length);
+    astarte_pairing_session_destroy(session);
+
+    return ret;
+}
+
+astarte_err_t astarte_pairing_get_mqtt_v1_broker_url(
+    const astarte_pairing_config_t *config, char *out, size_t length)
+{
+    astarte_pairing_session_handle_t session = astarte_pairing_session_new(config);
+    if (!session) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
     }
+    astarte_err_t ret = astarte_pairing_session_get_mqtt_v1_broker_url(session, out, length);
+    astarte_pairing_session_destroy(session);
 
     return ret;
 }
 
 astarte_err_t astarte_pairing_register_device(const astarte_pairing_config_t *config)
 {
-    if (!config->jwt || strlen(config->jwt) == 0) {
-        ESP_LOGE(TAG,
-            "ASTARTE_PAIRING_JWT is not configured, device can't be registered. "
-            "Configure it using make menuconfig");
-        return ASTARTE_ERR_NO_JWT;
+    astarte_pairing_session_handle_t session = astarte_pairing_session_new(config);
+    if (!session) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
     }
+    astarte_err_t ret = astarte_pairing_session_register_device(session);
+    astarte_pairing_session_destroy(session);
 
-    astarte_err_t ret = ASTARTE_ERR;
-    char *url = NULL;
-    char *auth_header = NULL;
-    cJSON *resp = NULL;
-    char *payload = NULL;
-    esp_http_client_handle_t client = NULL;
+    return ret;
+}
 
-    url = calloc(MAX_URL_LENGTH, sizeof(char));
-    if (!url) {
-        ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        goto exit;
-    }
+static astarte_err_t session_perform(astarte_pairing_session_handle_t session,
+    esp_http_client_method_t method, const char *url, const char *auth_header,
+    const char *payload, astarte_json_extract_t *extract, int *status_code)
+{
+    const char *method_name = (method == HTTP_METHOD_POST) ? "POST" : "GET";
 
-    int print_ret
-        = snprintf(url, MAX_URL_LENGTH, "%s/v1/%s/agent/devices", config->base_url, config->realm);
-    if ((print_ret < 0) || (print_ret >= MAX_URL_LENGTH)) {
-        ESP_LOGE(TAG, "Error encoding HTTPS request URL");
-        ret = ASTARTE_ERR;
-        goto exit;
-    }
+    session->extract = extract;
+    session->extract_result = ASTARTE_OK;
+    session->error_body_len = 0;
 
-    esp_http_client_config_t http_config
-        = {.url = url,
-              .event_handler = http_event_handler,
+    if (!session->client) {
+        esp_http_client_config_t http_config
+            = {.url = url,
+                  .event_handler = http_event_handler,
 #if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
-              .crt_bundle_attach = esp_crt_bundle_attach,
+                  .crt_bundle_attach = esp_crt_bundle_attach,
 #endif
-              .method = HTTP_METHOD_POST,
-              .buffer_size = HTTP_BUFFER_SIZE,
-              .buffer_size_tx = HTTP_BUFFER_SIZE_TX,
-              .user_data = &resp,
-          };
-
-    client = esp_http_client_init(&http_config);
-    if (!client) {
-        ret = ASTARTE_ERR_ESP_SDK;
-        ESP_LOGE(TAG, "Could not initialize http client");
-        goto exit;
+                  .method = method,
+                  .buffer_size = HTTP_BUFFER_SIZE,
+                  .buffer_size_tx = HTTP_BUFFER_SIZE_TX,
+                  .user_data = session,
+              };
+
+        session->client = esp_http_client_init(&http_config);
+        if (!session->client) {
+            ESP_LOGE(TAG, "Could not initialize http client");
+            return ASTARTE_ERR_ESP_SDK;
+        }
+    } else {
+        // The client keeps the HTTP/1.1 connection open between requests, requests to the same
+        // host go through the connection already open
+        esp_err_t err = esp_http_client_set_url(session->client, url);
+        if (err == ESP_OK) {
+            err = esp_http_client_set_method(session->client, method);
+        }
+        if (err != ESP_OK) {
+            ESP_LOGE(TAG, "Could not set up the HTTP %s request: %s", method_name,
+                esp_err_to_name(err));
+            return ASTARTE_ERR_ESP_SDK;
+        }
     }
 
-    cJSON *root = cJSON_CreateObject();
-    cJSON *data = cJSON_CreateObject();
-    cJSON_AddItemToObject(root, "data", data);
-    cJSON_AddStringToObject(data, "hw_id", config->hw_id);
-    payload = cJSON_PrintUnformatted(root);
-    cJSON_Delete(root);
-
-    ESP_ERROR_CHECK(esp_http_client_set_post_field(client, payload, strlen(payload)));
-
-    auth_header = calloc(CONFIG_ASTARTE_PAIRING_JWT_MAX_LEN, sizeof(char));
-    if (!auth_header) {
-        ret = ASTARTE_ERR_OUT_OF_MEMORY;
-        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        goto exit;
-    }
+    ESP_ERROR_CHECK(
+        esp_http_client_set_post_field(session->client, payload, payload ? strlen(payload) : 0));
+    ESP_ERROR_CHECK(esp_http_client_set_header(session->client, "Authorization", auth_header));
+    ESP_ERROR_CHECK(
+        esp_http_client_set_header(session->client, "Content-Type", "application/json"));
 
-    print_ret = snprintf(auth_header, CONFIG_ASTARTE_PAIRING_JWT_MAX_LEN, "Bearer %s", config->jwt);
-    if ((print_ret < 0) || (print_ret >= CONFIG_ASTARTE_PAIRING_JWT_MAX_LEN)) {
-        ESP_LOGE(TAG, "Error encoding authorization header");
-        ret = ASTARTE_ERR;
-        goto exit;
+    esp_err_t err = esp_http_client_perform(session->client);
+    // The extractor lives on the stack of the caller
+    session->extract = NULL;
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "HTTP %s request failed: %s", method_name, esp_err_to_name(err));
+        // Start from a new connection on the next request
+        esp_http_client_close(session->client);
+        return ASTARTE_ERR_HTTP;
     }
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Authorization", auth_header));
-    ESP_ERROR_CHECK(esp_http_client_set_header(client, "Content-Type", "application/json"));
 
-    esp_err_t err = esp_http_client_perform(client);
-
-    if (err == ESP_OK) {
-        int status_code = esp_http_client_get_status_code(client);
+    *status_code = esp_http_client_get_status_code(session->client);
 #if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
-        ESP_LOGD(TAG, "HTTP POST Status = %d, content_length = %" PRIi64, status_code,
-            esp_http_client_get_content_length(client));
+    ESP_LOGD(TAG, "HTTP %s Status = %d, content_length = %" PRIi64, method_name, *status_code,
+        esp_http_client_get_content_length(session->client));
 #else
-        ESP_LOGD(TAG, "HTTP POST Status = %d, content_length = %d", status_code,
-            esp_http_client_get_content_length(client));
+    ESP_LOGD(TAG, "HTTP %s Status = %d, content_length = %d", method_name, *status_code,
+        esp_http_client_get_content_length(session->client));
 #endif
 
-        const char *credentials_secret = NULL;
-        if (status_code == HTTP_RESP_CODE_CREATED) {
-            credentials_secret = extract_credentials_secret(resp);
-            ESP_LOGD(TAG, "Device registered, credentials_secret is %s", credentials_secret);
-        } else {
-            char *json_error = cJSON_Print(resp);
-            if (json_error) {
-                ESP_LOGE(
-                    TAG, "Device registration failed with code %d: %s", status_code, json_error);
-                free(json_error);
-            } else {
-                ESP_LOGE(TAG, "Device registration failed with code %d", status_code);
-            }
-
-            // Set ret to the right error
-            if (status_code == HTTP_RESP_CODE_UNAUTHORIZED
-                || status_code == HTTP_RESP_CODE_FORBIDDEN) {
-                ret = ASTARTE_ERR_AUTH;
-            } else if (status_code == HTTP_RESP_CODE_UNPROCESSABLE_CONTENT) {
-                ret = ASTARTE_ERR_ALREADY_EXISTS;
-            } else {
-                ret = ASTARTE_ERR_API;
-            }
-        }
-        if (credentials_secret
-            && astarte_credentials_set_stored_credentials_secret(credentials_secret)
-                == ASTARTE_OK) {
-            ret = ASTARTE_OK;
-        }
-    } else {
-        ret = ASTARTE_ERR_HTTP;
-        ESP_LOGE(TAG, "HTTP POST request failed: %s", esp_err_to_name(err));
+    return ASTARTE_OK;
+}
+
+static void session_on_data(astarte_pairing_session_handle_t session, const char *data, int len)
+{
+    size_t error_body_free = ERROR_BODY_LENGTH - 1 - session->error_body_len;
+    size_t error_body_copy = ((size_t) len < error_body_free) ? (size_t) len : error_body_free;
+    memcpy(session->error_body + session->error_body_len, data, error_body_copy);
+    session->error_body_len += error_body_copy;
+    session->error_body[session->error_body_len] = '\0';
+
+    if (session->extract && (session->extract_result == ASTARTE_OK)) {
+        session->extract_result = astarte_json_extract_feed(session->extract, data, len);
     }
+}
 
-exit:
-    free(url);
-    free(auth_header);
-    free(payload);
-    if (resp) {
-        cJSON_Delete(resp);
+static astarte_err_t session_extract_result(astarte_pairing_session_handle_t session,
+    const astarte_json_extract_t *extract, const char *field)
+{
+    astarte_err_t res = session->extract_result;
+    if (res == ASTARTE_OK) {
+        res = astarte_json_extract_finish(extract);
     }
-    if (client) {
-        esp_http_client_cleanup(client);
+    if (res != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Error parsing %s: %s", field, session->error_body);
+        return (res == ASTARTE_ERR_INVALID_SIZE) ? ASTARTE_ERR_INVALID_SIZE : ASTARTE_ERR;
     }
 
-    return ret;
+    return ASTARTE_OK;
 }
 
-static const char *extract_broker_url(cJSON *response)
+static astarte_err_t load_credentials_secret(astarte_pairing_session_handle_t session)
 {
-    const cJSON *data = cJSON_GetObjectItemCaseSensitive(response, "data");
-    const cJSON *protocols = cJSON_GetObjectItemCaseSensitive(data, "protocols");
-    const cJSON *astarte_mqtt_v1 = cJSON_GetObjectItemCaseSensitive(protocols, "astarte_mqtt_v1");
-    const cJSON *broker_url = cJSON_GetObjectItemCaseSensitive(astarte_mqtt_v1, "broker_url");
+    const astarte_pairing_config_t *config = &session->config;
+    if (config->credentials_secret) {
+        // We have an explicit credentials_secret in the config, we're done
+        strncpy(session->credentials_secret, config->credentials_secret, CRED_SECRET_LENGTH - 1);
+        session->has_credentials_secret = true;
+        return ASTARTE_OK;
+    }
+
+    astarte_err_t err = astarte_credentials_ctx_get_stored_credentials_secret(
+        config->credentials_context, session->credentials_secret, CRED_SECRET_LENGTH);
+    switch (err) {
+        case ASTARTE_OK:
+            session->has_credentials_secret = true;
+            return ASTARTE_OK;
+
+        case ASTARTE_ERR_NOT_FOUND:
+            ESP_LOGD(TAG, "credentials_secret not found, registering device");
+            break;
+
+        default:
+            // Some other error happened, bail out
+            return err;
+    }
 
-    if (cJSON_IsString(broker_url)) {
-        return broker_url->valuestring;
+    // A successful registration stores the credentials secret in the session
+    err = astarte_pairing_session_register_device(session);
+    if (err != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Device registration failed: %d", err);
+        return err;
     }
-    ESP_LOGE(TAG, "Error parsing broker_url");
-    return NULL;
+
+    return ASTARTE_OK;
 }
 
-static const char *extract_credentials_secret(cJSON *response)
+static char *new_bearer_header(const char *token, size_t max_length)
 {
-    const cJSON *data = cJSON_GetObjectItemCaseSensitive(response, "data");
-    const cJSON *credentials_secret = cJSON_GetObjectItemCaseSensitive(data, "credentials_secret");
+    char *auth_header
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_PAIRING, max_length, sizeof(char));
+    if (!auth_header) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
 
-    if (cJSON_IsString(credentials_secret)) {
-        return credentials_secret->valuestring;
+    int print_ret = snprintf(auth_header, max_length, "Bearer %s", token);
+    if ((print_ret < 0) || ((size_t) print_ret >= max_length)) {
+        ESP_LOGE(TAG, "Error encoding authorization header");
+        astarte_alloc_free(auth_header);
+        return NULL;
     }
-    ESP_LOGE(TAG, "Error parsing credentials_secret");
-    return NULL;
+
+    return auth_header;
 }
 
-static const char *extract_client_crt(cJSON *response)
+static void log_failed_request(
+    astarte_pairing_session_handle_t session, const char *request, int status_code)
 {
-    const cJSON *data = cJSON_GetObjectItemCaseSensitive(response, "data");
-    const cJSON *client_crt = cJSON_GetObjectItemCaseSensitive(data, "client_crt");
+    if (session->error_body_len > 0) {
+        ESP_LOGE(TAG, "%s failed with code %d: %s", request, status_code, session->error_body);
+    } else {
+        ESP_LOGE(TAG, "%s failed with code %d", request, status_code);
+    }
+}
 
-    if (cJSON_IsString(client_crt)) {
-        return client_crt->valuestring;
+static astarte_err_t status_code_to_astarte(int status_code)
+{
+    if (status_code == HTTP_RESP_CODE_UNAUTHORIZED || status_code == HTTP_RESP_CODE_FORBIDDEN) {
+        return ASTARTE_ERR_AUTH;
     }
-    ESP_LOGE(TAG, "Error parsing client_crt");
-    return NULL;
+    return ASTARTE_ERR_API;
 }
@@ -0,0 +1,144 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_property_coalescer.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_PROPERTY_COALESCER"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static astarte_pending_property_t *property_new(
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_property_coalescer_init(astarte_property_coalescer_t *coalescer, size_t capacity)
+{
+    memset(coalescer, 0, sizeof(astarte_property_coalescer_t));
+    coalescer->capacity = capacity;
+}
+
+void astarte_property_coalescer_destroy(astarte_property_coalescer_t *coalescer)
+{
+    while (coalescer->head) {
+        astarte_property_coalescer_remove_front(coalescer);
+    }
+}
+
+astarte_err_t astarte_property_coalescer_put(astarte_property_coalescer_t *coalescer,
+    const char *interface_name, const char *topic, const void *data, int length, int qos,
+    bool *replaced)
+{
+    *replaced = false;
+
+    astarte_pending_property_t *prev = NULL;
+    astarte_pending_property_t *old = coalescer->head;
+    for (; old; prev = old, old = old->next) {
+        if (strcmp(old->topic, topic) == 0) {
+            break;
+        }
+    }
+    if (!old && (coalescer->count == coalescer->capacity)) {
+        return ASTARTE_ERR_PUBLISH_QUEUE_FULL;
+    }
+
+    astarte_pending_property_t *property = property_new(interface_name, topic, data, length, qos);
+    if (!property) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    if (old) {
+        property->next = old->next;
+        if (prev) {
+            prev->next = property;
+        } else {
+            coalescer->head = property;
+        }
+        if (coalescer->tail == old) {
+            coalescer->tail = property;
+        }
+        astarte_alloc_free(old);
+        *replaced = true;
+        return ASTARTE_OK;
+    }
+
+    if (coalescer->tail) {
+        coalescer->tail->next = property;
+    } else {
+        coalescer->head = property;
+    }
+    coalescer->tail = property;
+    coalescer->count++;
+    return ASTARTE_OK;
+}
+
+const astarte_pending_property_t *astarte_property_coalescer_front(
+    const astarte_property_coalescer_t *coalescer)
+{
+    return coalescer->head;
+}
+
+void astarte_property_coalescer_remove_front(astarte_property_coalescer_t *coalescer)
+{
+    astarte_pending_property_t *property = coalescer->head;
+    if (!property) {
+        return;
+    }
+    coalescer->head = property->next;
+    if (!coalescer->head) {
+        coalescer->tail = NULL;
+    }
+    coalescer->count--;
+    astarte_alloc_free(property);
+}
+
+size_t astarte_property_coalescer_count(const astarte_property_coalescer_t *coalescer)
+{
+    return coalescer->count;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static astarte_pending_property_t *property_new(
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+    size_t interface_name_size = strlen(interface_name) + 1;
+    size_t topic_size = strlen(topic) + 1;
+    astarte_pending_property_t *property = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE,
+        sizeof(astarte_pending_property_t) + interface_name_size + topic_size + (size_t) length);
+    if (!property) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
+    property->next = NULL;
+    property->interface_name = (char *) (property + 1);
+    memcpy(property->interface_name, interface_name, interface_name_size);
+    property->topic = property->interface_name + interface_name_size;
+    memcpy(property->topic, topic, topic_size);
+    property->data = property->topic + topic_size;
+    if (length > 0) {
+        memcpy(property->data, data, (size_t) length);
+    }
+    property->length = length;
+    property->qos = qos;
+    return property;
+}
@@ -0,0 +1,164 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_publish_queue.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_PUBLISH_QUEUE"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static astarte_publish_lane_ring_t *select_strict(astarte_publish_queue_t *queue);
+static astarte_publish_lane_ring_t *select_weighted(astarte_publish_queue_t *queue);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_publish_queue_init(astarte_publish_queue_t *queue,
+    const astarte_publish_lane_config_t config[ASTARTE_PUBLISH_LANE_COUNT], bool weighted)
+{
+    memset(queue, 0, sizeof(astarte_publish_queue_t));
+    queue->weighted = weighted;
+    for (size_t i = 0; i < ASTARTE_PUBLISH_LANE_COUNT; i++) {
+        astarte_publish_lane_ring_t *ring = &queue->lanes[i];
+        ring->msgs = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, config[i].capacity,
+            sizeof(astarte_publish_queue_msg_t *));
+        if (!ring->msgs) {
+            ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+            astarte_publish_queue_destroy(queue);
+            return ASTARTE_ERR_OUT_OF_MEMORY;
+        }
+        ring->capacity = config[i].capacity;
+        ring->weight = config[i].weight;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_publish_queue_destroy(astarte_publish_queue_t *queue)
+{
+    astarte_publish_queue_msg_t *msg = NULL;
+    while (astarte_publish_queue_pop(queue, &msg) == ASTARTE_OK) {
+        astarte_publish_queue_msg_free(msg);
+    }
+    for (size_t i = 0; i < ASTARTE_PUBLISH_LANE_COUNT; i++) {
+        astarte_alloc_free(queue->lanes[i].msgs);
+        queue->lanes[i].msgs = NULL;
+        queue->lanes[i].capacity = 0;
+    }
+}
+
+astarte_err_t astarte_publish_queue_push(astarte_publish_queue_t *queue,
+    astarte_publish_lane_t lane, const char *topic, const void *data, int length, int qos)
+{
+    astarte_publish_lane_ring_t *ring = &queue->lanes[lane];
+    if (ring->count == ring->capacity) {
+        return ASTARTE_ERR_PUBLISH_QUEUE_FULL;
+    }
+
+    size_t topic_size = strlen(topic) + 1;
+    astarte_publish_queue_msg_t *msg = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE,
+        sizeof(astarte_publish_queue_msg_t) + topic_size + (size_t) length);
+    if (!msg) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    msg->topic = (char *) (msg + 1);
+    memcpy(msg->topic, topic, topic_size);
+    msg->data = msg->topic + topic_size;
+    memcpy(msg->data, data, (size_t) length);
+    msg->length = length;
+    msg->qos = qos;
+
+    ring->msgs[(ring->head + ring->count) % ring->capacity] = msg;
+    ring->count++;
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_publish_queue_pop(
+    astarte_publish_queue_t *queue, astarte_publish_queue_msg_t **msg)
+{
+    astarte_publish_lane_ring_t *ring = NULL;
+    // Control messages always go first, whatever the draining policy
+    if (queue->lanes[ASTARTE_PUBLISH_LANE_CONTROL].count > 0) {
+        ring = &queue->lanes[ASTARTE_PUBLISH_LANE_CONTROL];
+    } else if (queue->weighted) {
+        ring = select_weighted(queue);
+    } else {
+        ring = select_strict(queue);
+    }
+    if (!ring) {
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+
+    *msg = ring->msgs[ring->head];
+    ring->msgs[ring->head] = NULL;
+    ring->head = (ring->head + 1) % ring->capacity;
+    ring->count--;
+    return ASTARTE_OK;
+}
+
+size_t astarte_publish_queue_count(
+    const astarte_publish_queue_t *queue, astarte_publish_lane_t lane)
+{
+    return queue->lanes[lane].count;
+}
+
+void astarte_publish_queue_msg_free(astarte_publish_queue_msg_t *msg)
+{
+    astarte_alloc_free(msg);
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static astarte_publish_lane_ring_t *select_strict(astarte_publish_queue_t *queue)
+{
+    for (size_t i = 0; i < ASTARTE_PUBLISH_LANE_COUNT; i++) {
+        if (queue->lanes[i].count > 0) {
+            return &queue->lanes[i];
+        }
+    }
+    return NULL;
+}
+
+static astarte_publish_lane_ring_t *select_weighted(astarte_publish_queue_t *queue)
+{
+    // Smooth weighted round robin: every non empty lane earns its weight, the richest one is
+    // selected and pays back the total. Lanes are served proportionally to their weight without
+    // bursts, ties go to the higher priority lane.
+    astarte_publish_lane_ring_t *selected = NULL;
+    int32_t total_weight = 0;
+    for (size_t i = ASTARTE_PUBLISH_LANE_CONTROL + 1; i < ASTARTE_PUBLISH_LANE_COUNT; i++) {
+        astarte_publish_lane_ring_t *ring = &queue->lanes[i];
+        if (ring->count == 0) {
+            // Idle lanes do not accumulate credit
+            ring->current_weight = 0;
+            continue;
+        }
+        ring->current_weight += ring->weight;
+        total_weight += ring->weight;
+        if (!selected || (ring->current_weight > selected->current_weight)) {
+            selected = ring;
+        }
+    }
+    if (selected) {
+        selected->current_weight -= total_weight;
+    }
+    return selected;
+}
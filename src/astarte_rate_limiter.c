@@ -0,0 +1,310 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_rate_limiter.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_RATE_LIMITER"
+
+// Bucket levels are stored in millionths of token, one token per second refills one each us
+#define TOKEN_UNITS 1000000ULL
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void bucket_init(astarte_token_bucket_t *bucket, uint32_t rate, uint32_t burst, int64_t now);
+static void bucket_refill(astarte_token_bucket_t *bucket, int64_t now_us);
+static uint64_t bucket_cost(const astarte_token_bucket_t *bucket, uint32_t amount);
+static int64_t bucket_wait_us(const astarte_token_bucket_t *bucket, uint32_t amount);
+static int64_t limiter_wait_us(astarte_rate_limiter_t *limiter, int length, int64_t now_us);
+static void limiter_take(astarte_rate_limiter_t *limiter, int length);
+static astarte_rate_limit_msg_t *msg_new(astarte_rate_limiter_t *limiter,
+    const char *interface_name, const char *topic, const void *data, int length, int qos);
+static bool is_interface_blocked(const astarte_rate_limit_backlog_t *backlog,
+    const astarte_rate_limit_msg_t *msg);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_rate_limiter_init(
+    astarte_rate_limiter_t *limiter, const astarte_rate_limit_config_t *config, int64_t now_us)
+{
+    memset(limiter, 0, sizeof(astarte_rate_limiter_t));
+    limiter->policy = config->policy;
+    bucket_init(&limiter->messages, config->messages_per_s, config->messages_burst, now_us);
+    bucket_init(&limiter->bytes, config->bytes_per_s, config->bytes_burst, now_us);
+}
+
+bool astarte_rate_limiter_try_acquire(astarte_rate_limiter_t *interface_limiter,
+    astarte_rate_limiter_t *device_limiter, int length, int64_t now_us)
+{
+    if ((interface_limiter && (limiter_wait_us(interface_limiter, length, now_us) > 0))
+        || (device_limiter && (limiter_wait_us(device_limiter, length, now_us) > 0))) {
+        return false;
+    }
+    if (interface_limiter) {
+        limiter_take(interface_limiter, length);
+    }
+    if (device_limiter) {
+        limiter_take(device_limiter, length);
+    }
+    return true;
+}
+
+void astarte_rate_limit_backlog_init(astarte_rate_limit_backlog_t *backlog, size_t capacity)
+{
+    memset(backlog, 0, sizeof(astarte_rate_limit_backlog_t));
+    backlog->capacity = capacity;
+}
+
+void astarte_rate_limit_backlog_destroy(astarte_rate_limit_backlog_t *backlog)
+{
+    astarte_rate_limit_msg_t *msg = backlog->head;
+    while (msg) {
+        astarte_rate_limit_msg_t *next = msg->next;
+        astarte_rate_limit_backlog_msg_free(msg);
+        msg = next;
+    }
+    backlog->head = NULL;
+    backlog->tail = NULL;
+    backlog->count = 0;
+}
+
+astarte_err_t astarte_rate_limit_backlog_push(astarte_rate_limit_backlog_t *backlog,
+    astarte_rate_limiter_t *limiter, const char *interface_name, const char *topic,
+    const void *data, int length, int qos, bool replace, bool *replaced)
+{
+    *replaced = false;
+
+    astarte_rate_limit_msg_t *prev = NULL;
+    astarte_rate_limit_msg_t *old = NULL;
+    if (replace) {
+        for (old = backlog->head; old; prev = old, old = old->next) {
+            if (strcmp(old->topic, topic) == 0) {
+                break;
+            }
+        }
+    }
+    if (!old && (backlog->count == backlog->capacity)) {
+        return ASTARTE_ERR_PUBLISH_QUEUE_FULL;
+    }
+
+    astarte_rate_limit_msg_t *msg = msg_new(limiter, interface_name, topic, data, length, qos);
+    if (!msg) {
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+
+    if (old) {
+        // The new value takes the place of the old one, to keep the order of the interface
+        msg->next = old->next;
+        if (prev) {
+            prev->next = msg;
+        } else {
+            backlog->head = msg;
+        }
+        if (backlog->tail == old) {
+            backlog->tail = msg;
+        }
+        astarte_rate_limit_backlog_msg_free(old);
+        *replaced = true;
+        return ASTARTE_OK;
+    }
+
+    if (backlog->tail) {
+        backlog->tail->next = msg;
+    } else {
+        backlog->head = msg;
+    }
+    backlog->tail = msg;
+    backlog->count++;
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_rate_limit_backlog_pop(astarte_rate_limit_backlog_t *backlog,
+    astarte_rate_limiter_t *device_limiter, int64_t now_us, astarte_rate_limit_msg_t **msg)
+{
+    astarte_rate_limit_msg_t *prev = NULL;
+    for (astarte_rate_limit_msg_t *cur = backlog->head; cur; prev = cur, cur = cur->next) {
+        if (device_limiter && (limiter_wait_us(device_limiter, cur->length, now_us) > 0)) {
+            // Younger messages must not overtake one held back by the device limits
+            break;
+        }
+        if (is_interface_blocked(backlog, cur)
+            || !astarte_rate_limiter_try_acquire(
+                cur->limiter, device_limiter, cur->length, now_us)) {
+            continue;
+        }
+
+        if (prev) {
+            prev->next = cur->next;
+        } else {
+            backlog->head = cur->next;
+        }
+        if (backlog->tail == cur) {
+            backlog->tail = prev;
+        }
+        backlog->count--;
+        cur->next = NULL;
+        *msg = cur;
+        return ASTARTE_OK;
+    }
+    return ASTARTE_ERR_NOT_FOUND;
+}
+
+int64_t astarte_rate_limit_backlog_wait_us(
+    astarte_rate_limit_backlog_t *backlog, astarte_rate_limiter_t *device_limiter, int64_t now_us)
+{
+    if (!backlog->head) {
+        return -1;
+    }
+
+    // The device limits are checked against the oldest message, the interface ones against the
+    // oldest message of each interface
+    int64_t device_wait_us = 0;
+    if (device_limiter) {
+        device_wait_us = limiter_wait_us(device_limiter, backlog->head->length, now_us);
+    }
+    int64_t wait_us = INT64_MAX;
+    for (astarte_rate_limit_msg_t *cur = backlog->head; cur; cur = cur->next) {
+        if (is_interface_blocked(backlog, cur)) {
+            continue;
+        }
+        int64_t interface_wait_us
+            = cur->limiter ? limiter_wait_us(cur->limiter, cur->length, now_us) : 0;
+        if (interface_wait_us < wait_us) {
+            wait_us = interface_wait_us;
+        }
+    }
+    return (device_wait_us > wait_us) ? device_wait_us : wait_us;
+}
+
+size_t astarte_rate_limit_backlog_count(const astarte_rate_limit_backlog_t *backlog)
+{
+    return backlog->count;
+}
+
+void astarte_rate_limit_backlog_msg_free(astarte_rate_limit_msg_t *msg)
+{
+    astarte_alloc_free(msg);
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void bucket_init(astarte_token_bucket_t *bucket, uint32_t rate, uint32_t burst, int64_t now)
+{
+    bucket->rate = rate;
+    bucket->burst = (burst < rate) ? rate : burst;
+    bucket->level = bucket->burst * TOKEN_UNITS;
+    bucket->last_refill_us = now;
+}
+
+static void bucket_refill(astarte_token_bucket_t *bucket, int64_t now_us)
+{
+    if ((bucket->rate == 0) || (now_us <= bucket->last_refill_us)) {
+        return;
+    }
+    uint64_t elapsed_us = (uint64_t) (now_us - bucket->last_refill_us);
+    bucket->last_refill_us = now_us;
+
+    // Checked with a division first, a long idle time times the rate could overflow
+    uint64_t missing = bucket->burst * TOKEN_UNITS - bucket->level;
+    if (elapsed_us >= missing / bucket->rate + 1) {
+        bucket->level = bucket->burst * TOKEN_UNITS;
+    } else {
+        bucket->level += elapsed_us * bucket->rate;
+        if (bucket->level > bucket->burst * TOKEN_UNITS) {
+            bucket->level = bucket->burst * TOKEN_UNITS;
+        }
+    }
+}
+
+static uint64_t bucket_cost(const astarte_token_bucket_t *bucket, uint32_t amount)
+{
+    // Amounts above the burst would never fit, they are charged a full bucket instead
+    return ((amount < bucket->burst) ? amount : bucket->burst) * TOKEN_UNITS;
+}
+
+static int64_t bucket_wait_us(const astarte_token_bucket_t *bucket, uint32_t amount)
+{
+    uint64_t cost = bucket_cost(bucket, amount);
+    if ((bucket->rate == 0) || (bucket->level >= cost)) {
+        return 0;
+    }
+    return (int64_t) ((cost - bucket->level + bucket->rate - 1) / bucket->rate);
+}
+
+static int64_t limiter_wait_us(astarte_rate_limiter_t *limiter, int length, int64_t now_us)
+{
+    bucket_refill(&limiter->messages, now_us);
+    bucket_refill(&limiter->bytes, now_us);
+    int64_t messages_wait_us = bucket_wait_us(&limiter->messages, 1);
+    int64_t bytes_wait_us = bucket_wait_us(&limiter->bytes, (uint32_t) length);
+    return (messages_wait_us > bytes_wait_us) ? messages_wait_us : bytes_wait_us;
+}
+
+static void limiter_take(astarte_rate_limiter_t *limiter, int length)
+{
+    if (limiter->messages.rate != 0) {
+        limiter->messages.level -= bucket_cost(&limiter->messages, 1);
+    }
+    if (limiter->bytes.rate != 0) {
+        limiter->bytes.level -= bucket_cost(&limiter->bytes, (uint32_t) length);
+    }
+}
+
+static astarte_rate_limit_msg_t *msg_new(astarte_rate_limiter_t *limiter,
+    const char *interface_name, const char *topic, const void *data, int length, int qos)
+{
+    size_t interface_name_size = strlen(interface_name) + 1;
+    size_t topic_size = strlen(topic) + 1;
+    astarte_rate_limit_msg_t *msg = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE,
+        sizeof(astarte_rate_limit_msg_t) + interface_name_size + topic_size + (size_t) length);
+    if (!msg) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
+    msg->next = NULL;
+    msg->limiter = limiter;
+    msg->interface_name = (char *) (msg + 1);
+    memcpy(msg->interface_name, interface_name, interface_name_size);
+    msg->topic = msg->interface_name + interface_name_size;
+    memcpy(msg->topic, topic, topic_size);
+    msg->data = msg->topic + topic_size;
+    if (length > 0) {
+        memcpy(msg->data, data, (size_t) length);
+    }
+    msg->length = length;
+    msg->qos = qos;
+    return msg;
+}
+
+static bool is_interface_blocked(
+    const astarte_rate_limit_backlog_t *backlog, const astarte_rate_limit_msg_t *msg)
+{
+    // An older message of the same interface is still waiting
+    if (!msg->limiter) {
+        return false;
+    }
+    for (const astarte_rate_limit_msg_t *cur = backlog->head; cur != msg; cur = cur->next) {
+        if (cur->limiter == msg->limiter) {
+            return true;
+        }
+    }
+    return false;
+}
@@ -0,0 +1,100 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_sample_window.h>
+
+#include <string.h>
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void reset_summary(astarte_window_summary_t *summary, int64_t start_us);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_sample_window_init(astarte_sample_window_t *window, int64_t now_us)
+{
+    for (size_t i = 0; i < 2; i++) {
+        reset_summary(&window->slots[i].summary, now_us);
+        atomic_init(&window->slots[i].writers, 0);
+        atomic_init(&window->slots[i].closed, false);
+    }
+    atomic_init(&window->active, 0);
+}
+
+void astarte_sample_window_push(astarte_sample_window_t *window, double sample)
+{
+    astarte_sample_window_slot_t *slot = NULL;
+    while (1) {
+        unsigned int index = atomic_load(&window->active);
+        slot = &window->slots[index];
+        atomic_fetch_add(&slot->writers, 1);
+        // The window might have been closed before the slot was marked as written
+        if (atomic_load(&window->active) == index) {
+            break;
+        }
+        atomic_fetch_sub(&slot->writers, 1);
+    }
+
+    astarte_window_summary_t *summary = &slot->summary;
+    if ((summary->count == 0) || (sample < summary->min)) {
+        summary->min = sample;
+    }
+    if ((summary->count == 0) || (sample > summary->max)) {
+        summary->max = sample;
+    }
+    summary->sum += sample;
+    summary->last = sample;
+    summary->count++;
+
+    atomic_fetch_sub(&slot->writers, 1);
+}
+
+bool astarte_sample_window_close(astarte_sample_window_t *window, int64_t now_us)
+{
+    unsigned int index = atomic_load(&window->active);
+    astarte_sample_window_slot_t *next = &window->slots[index ^ 1U];
+    if (atomic_load(&next->closed)) {
+        return false;
+    }
+
+    next->summary.start_us = now_us;
+    window->slots[index].summary.end_us = now_us;
+    atomic_store(&window->slots[index].closed, true);
+    atomic_store(&window->active, index ^ 1U);
+    return true;
+}
+
+bool astarte_sample_window_collect(
+    astarte_sample_window_t *window, astarte_window_summary_t *summary)
+{
+    astarte_sample_window_slot_t *slot = &window->slots[atomic_load(&window->active) ^ 1U];
+    if (!atomic_load(&slot->closed)) {
+        return false;
+    }
+
+    // A push is a handful of instructions, the producer is never blocked in it
+    while (atomic_load(&slot->writers) != 0) {
+    }
+
+    *summary = slot->summary;
+    reset_summary(&slot->summary, 0);
+    atomic_store(&slot->closed, false);
+    return true;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void reset_summary(astarte_window_summary_t *summary, int64_t start_us)
+{
+    memset(summary, 0, sizeof(astarte_window_summary_t));
+    summary->start_us = start_us;
+}
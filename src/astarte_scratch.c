@@ -0,0 +1,177 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_scratch.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <stdalign.h>
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_SCRATCH"
+
+// Blocks are aligned as the ones returned by malloc
+#define SCRATCH_ALIGNMENT alignof(max_align_t)
+
+// Arena active on the calling task, each task has its own copy
+static __thread astarte_scratch_t *active_scratch = NULL;
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_scratch_init(astarte_scratch_t *scratch, size_t size)
+{
+    scratch->buffer = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, size);
+    if (!scratch->buffer) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    scratch->size = size;
+    scratch->used = 0;
+    scratch->high_water = 0;
+    scratch->failures = 0;
+    return ASTARTE_OK;
+}
+
+void astarte_scratch_destroy(astarte_scratch_t *scratch)
+{
+    astarte_alloc_free(scratch->buffer);
+    scratch->buffer = NULL;
+    scratch->size = 0;
+    scratch->used = 0;
+}
+
+bool astarte_scratch_is_active(void)
+{
+    return active_scratch != NULL;
+}
+
+astarte_scratch_mark_t astarte_scratch_begin(astarte_scratch_t *scratch)
+{
+    astarte_scratch_mark_t mark = { .activated = false };
+    if (!active_scratch) {
+        active_scratch = scratch;
+        mark.activated = true;
+    }
+    mark.scratch = active_scratch;
+    mark.used = active_scratch->used;
+    return mark;
+}
+
+void astarte_scratch_end(astarte_scratch_mark_t mark)
+{
+    mark.scratch->used = mark.used;
+    if (mark.activated) {
+        active_scratch = NULL;
+    }
+}
+
+astarte_scratch_t *astarte_scratch_suspend(void)
+{
+    astarte_scratch_t *scratch = active_scratch;
+    active_scratch = NULL;
+    return scratch;
+}
+
+void astarte_scratch_resume(astarte_scratch_t *scratch)
+{
+    active_scratch = scratch;
+}
+
+astarte_err_t astarte_scratch_save(astarte_scratch_t *scratch, astarte_scratch_saved_t *saved)
+{
+    saved->scratch = scratch;
+    saved->blocks = NULL;
+    saved->used = scratch->used;
+    saved->active = (active_scratch == scratch);
+
+    if (saved->used > 0) {
+        // The copy must not come from the arena being saved
+        astarte_scratch_t *active = astarte_scratch_suspend();
+        saved->blocks = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, saved->used);
+        astarte_scratch_resume(active);
+        if (!saved->blocks) {
+            ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+            return ASTARTE_ERR_OUT_OF_MEMORY;
+        }
+        memcpy(saved->blocks, scratch->buffer, saved->used);
+    }
+
+    scratch->used = 0;
+    if (saved->active) {
+        active_scratch = NULL;
+    }
+    return ASTARTE_OK;
+}
+
+void astarte_scratch_restore(astarte_scratch_saved_t *saved)
+{
+    astarte_scratch_t *scratch = saved->scratch;
+    if (saved->blocks) {
+        memcpy(scratch->buffer, saved->blocks, saved->used);
+        astarte_alloc_free(saved->blocks);
+        saved->blocks = NULL;
+    }
+    scratch->used = saved->used;
+    if (saved->active) {
+        active_scratch = scratch;
+    }
+}
+
+bool astarte_scratch_alloc(size_t size, void **ptr)
+{
+    astarte_scratch_t *scratch = active_scratch;
+    if (!scratch) {
+        return false;
+    }
+
+    // Zero sized blocks still take a byte, to be recognized when released
+    if (size == 0) {
+        size = 1;
+    }
+    size_t start = (scratch->used + SCRATCH_ALIGNMENT - 1) & ~(SCRATCH_ALIGNMENT - 1);
+    if ((start > scratch->size) || (size > scratch->size - start)) {
+        ESP_LOGE(TAG, "Scratch arena exhausted, %zu bytes requested with %zu of %zu in use", size,
+            scratch->used, scratch->size);
+        scratch->failures++;
+        *ptr = NULL;
+        return true;
+    }
+
+    scratch->used = start + size;
+    if (scratch->used > scratch->high_water) {
+        scratch->high_water = scratch->used;
+    }
+    *ptr = scratch->buffer + start;
+    return true;
+}
+
+bool astarte_scratch_owns(const void *ptr)
+{
+    astarte_scratch_t *scratch = active_scratch;
+    if (!scratch) {
+        return false;
+    }
+    const uint8_t *byte_ptr = (const uint8_t *) ptr;
+    return (byte_ptr >= scratch->buffer) && (byte_ptr < scratch->buffer + scratch->size);
+}
+
+size_t astarte_scratch_high_water(const astarte_scratch_t *scratch)
+{
+    return scratch->high_water;
+}
+
+uint32_t astarte_scratch_failures(const astarte_scratch_t *scratch)
+{
+    return scratch->failures;
+}
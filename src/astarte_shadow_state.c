@@ -0,0 +1,118 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_shadow_state.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_SHADOW"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static bool is_size_valid(const astarte_shadow_field_t *field);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_shadow_state_init(
+    astarte_shadow_state_t *state, const astarte_shadow_field_t *fields, size_t fields_count)
+{
+    memset(state, 0, sizeof(astarte_shadow_state_t));
+    if (fields_count == 0) {
+        ESP_LOGE(TAG, "Shadow without fields");
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+
+    size_t snapshot_size = 0;
+    for (size_t i = 0; i < fields_count; i++) {
+        if (fields[i].path[0] != '/') {
+            ESP_LOGE(TAG, "Invalid path: %s (must be start with /)", fields[i].path);
+            return ASTARTE_ERR_INVALID_INTERFACE_PATH;
+        }
+        if (!is_size_valid(&fields[i])) {
+            ESP_LOGE(TAG, "Invalid size %zu of the field %s", fields[i].size, fields[i].path);
+            return ASTARTE_ERR_INVALID_SIZE;
+        }
+        if (fields[i].offset + fields[i].size > snapshot_size) {
+            snapshot_size = fields[i].offset + fields[i].size;
+        }
+    }
+
+    // The published flags follow the snapshot in the same allocation
+    state->snapshot = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, snapshot_size + fields_count * sizeof(bool));
+    if (!state->snapshot) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    state->published = (bool *) (state->snapshot + snapshot_size);
+    state->fields = fields;
+    state->fields_count = fields_count;
+    return ASTARTE_OK;
+}
+
+void astarte_shadow_state_destroy(astarte_shadow_state_t *state)
+{
+    astarte_alloc_free(state->snapshot);
+    memset(state, 0, sizeof(astarte_shadow_state_t));
+}
+
+bool astarte_shadow_state_changed(
+    const astarte_shadow_state_t *state, const void *data, size_t index)
+{
+    if (!state->published[index]) {
+        return true;
+    }
+    const astarte_shadow_field_t *field = &state->fields[index];
+    const uint8_t *value = (const uint8_t *) data + field->offset;
+    const uint8_t *published = state->snapshot + field->offset;
+    if (field->type == ASTARTE_SHADOW_TYPE_STRING) {
+        // Bytes after the terminator are not part of the value
+        return strncmp((const char *) value, (const char *) published, field->size) != 0;
+    }
+    return memcmp(value, published, field->size) != 0;
+}
+
+void astarte_shadow_state_update(astarte_shadow_state_t *state, const void *data, size_t index)
+{
+    const astarte_shadow_field_t *field = &state->fields[index];
+    memcpy(state->snapshot + field->offset, (const uint8_t *) data + field->offset, field->size);
+    state->published[index] = true;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static bool is_size_valid(const astarte_shadow_field_t *field)
+{
+    switch (field->type) {
+        case ASTARTE_SHADOW_TYPE_DOUBLE:
+            return field->size == sizeof(double);
+        case ASTARTE_SHADOW_TYPE_INTEGER:
+            return field->size == sizeof(int32_t);
+        case ASTARTE_SHADOW_TYPE_LONGINTEGER:
+        case ASTARTE_SHADOW_TYPE_DATETIME:
+            return field->size == sizeof(int64_t);
+        case ASTARTE_SHADOW_TYPE_BOOLEAN:
+            return field->size == sizeof(bool);
+        case ASTARTE_SHADOW_TYPE_STRING:
+            return field->size > 0;
+        default:
+            return false;
+    }
+}
@@ -0,0 +1,70 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_spsc_ring.h>
+
+#include <esp_attr.h>
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_spsc_ring_init(
+    astarte_spsc_ring_t *ring, astarte_ring_sample_t *samples, uint32_t capacity)
+{
+    ring->samples = samples;
+    ring->mask = capacity - 1;
+    atomic_init(&ring->head, 0);
+    atomic_init(&ring->tail, 0);
+    atomic_init(&ring->dropped, 0);
+}
+
+bool IRAM_ATTR astarte_spsc_ring_push(
+    astarte_spsc_ring_t *ring, int64_t timestamp_us, astarte_ring_value_t value)
+{
+    // Only the producer writes the head, the tail is read to see the slots freed by the consumer
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_relaxed);
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    if (head - tail > ring->mask) {
+        atomic_fetch_add_explicit(&ring->dropped, 1, memory_order_relaxed);
+        return false;
+    }
+
+    astarte_ring_sample_t *sample = &ring->samples[head & ring->mask];
+    sample->timestamp_us = timestamp_us;
+    sample->value = value;
+    atomic_store_explicit(&ring->head, head + 1, memory_order_release);
+    return true;
+}
+
+uint32_t astarte_spsc_ring_pop(
+    astarte_spsc_ring_t *ring, astarte_ring_sample_t *samples, uint32_t max_samples)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_relaxed);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    uint32_t count = head - tail;
+    if (count > max_samples) {
+        count = max_samples;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        samples[i] = ring->samples[(tail + i) & ring->mask];
+    }
+    // The slots are handed back to the producer only once copied
+    atomic_store_explicit(&ring->tail, tail + count, memory_order_release);
+    return count;
+}
+
+uint32_t IRAM_ATTR astarte_spsc_ring_count(astarte_spsc_ring_t *ring)
+{
+    unsigned int tail = atomic_load_explicit(&ring->tail, memory_order_acquire);
+    unsigned int head = atomic_load_explicit(&ring->head, memory_order_acquire);
+    return head - tail;
+}
+
+uint32_t astarte_spsc_ring_dropped(astarte_spsc_ring_t *ring)
+{
+    return atomic_load_explicit(&ring->dropped, memory_order_relaxed);
+}
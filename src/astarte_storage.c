@@ -6,7 +6,10 @@
 
 #include "astarte_storage.h"
 
+#include "astarte_alloc.h"
+
 #include <esp_log.h>
+#include <esp_timer.h>
 #include <nvs.h>
 #include <stdlib.h>
 #include <string.h>
@@ -23,9 +26,9 @@
  *         Global functions definitions         *
  ***********************************************/
 
-// NOLINTNEXTLINE(misc-unused-parameters)
 astarte_err_t astarte_storage_open(astarte_storage_handle_t *handle)
 {
+    handle->open_time_us = esp_timer_get_time();
 #ifdef CONFIG_ASTARTE_USE_PROPERTY_PERSISTENCY
     esp_err_t esp_err
         = nvs_open_from_partition(CONFIG_ASTARTE_PROPERTY_PERSISTENCY_NVS_PARTITION_LABEL,
@@ -47,7 +50,7 @@ astarte_err_t astarte_storage_store_property(astarte_storage_handle_t handle,
 {
     // Get the full key interface_name + path
     size_t key_len = strlen(interface_name) + strlen(path) + 1;
-    char *key = calloc(key_len, sizeof(char));
+    char *key = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, key_len, sizeof(char));
     if (!key) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return ASTARTE_ERR;
@@ -56,10 +59,10 @@ astarte_err_t astarte_storage_store_property(astarte_storage_handle_t handle,
 
     // Allocate memory for major version + data
     size_t value_len = sizeof(int32_t) + data_len;
-    void *value = malloc(value_len);
+    void *value = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, value_len);
     if (!value) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR;
     }
     memcpy(value, &major, sizeof(int32_t));
@@ -68,12 +71,12 @@ astarte_err_t astarte_storage_store_property(astarte_storage_handle_t handle,
     // Set the property value in NVS
     esp_err_t esp_err = astarte_nvs_key_value_set(handle.nvs_handle, key, value, value_len);
     if (esp_err != ESP_OK) {
-        free(key);
-        free(value);
+        astarte_alloc_free(key);
+        astarte_alloc_free(value);
         return ASTARTE_ERR;
     }
-    free(key);
-    free(value);
+    astarte_alloc_free(key);
+    astarte_alloc_free(value);
 
     // Commit the changes
     esp_err = nvs_commit(handle.nvs_handle);
@@ -93,7 +96,7 @@ astarte_err_t astarte_storage_contains_property(astarte_storage_handle_t handle,
 
     // Get the full key interface_name + path
     size_t key_len = strlen(interface_name) + strlen(path) + 1;
-    char *key = calloc(key_len, sizeof(char));
+    char *key = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, key_len, sizeof(char));
     if (!key) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return ASTARTE_ERR;
@@ -104,33 +107,33 @@ astarte_err_t astarte_storage_contains_property(astarte_storage_handle_t handle,
     size_t value_len = 0;
     esp_err_t esp_err = astarte_nvs_key_value_get(handle.nvs_handle, key, NULL, &value_len);
     if ((esp_err != ESP_ERR_NVS_NOT_FOUND) && (esp_err != ESP_OK)) {
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR;
     }
     if ((esp_err == ESP_ERR_NVS_NOT_FOUND) || (value_len != (sizeof(int32_t) + data_len))) {
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_OK;
     }
 
     // Allocate temporary data
-    char *value = calloc(value_len, sizeof(char));
+    char *value = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, value_len, sizeof(char));
     if (!value) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR;
     }
 
     // Get stored data
     astarte_nvs_key_value_get(handle.nvs_handle, key, value, &value_len);
-    free(key);
+    astarte_alloc_free(key);
     if (esp_err != ESP_OK) {
-        free(value);
+        astarte_alloc_free(value);
         return ASTARTE_ERR;
     }
 
     // Check version
     if ((*(int32_t *) value) != major) {
-        free(value);
+        astarte_alloc_free(value);
         esp_err = astarte_storage_delete_property(handle, interface_name, path);
         if (esp_err != ESP_OK) {
             return ASTARTE_ERR;
@@ -143,7 +146,7 @@ astarte_err_t astarte_storage_contains_property(astarte_storage_handle_t handle,
         *res = true;
     }
 
-    free(value);
+    astarte_alloc_free(value);
     return ASTARTE_OK;
 }
 
@@ -153,7 +156,7 @@ astarte_err_t astarte_storage_load_property(astarte_storage_handle_t handle,
 {
     // Get the full key interface_name + path
     size_t key_len = strlen(interface_name) + strlen(path) + 1;
-    char *key = calloc(key_len, sizeof(char));
+    char *key = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, key_len, sizeof(char));
     if (!key) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return ASTARTE_ERR;
@@ -164,11 +167,11 @@ astarte_err_t astarte_storage_load_property(astarte_storage_handle_t handle,
     size_t value_len = 0;
     esp_err_t esp_err = astarte_nvs_key_value_get(handle.nvs_handle, key, NULL, &value_len);
     if (esp_err == ESP_ERR_NVS_NOT_FOUND) {
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR_NOT_FOUND;
     }
     if (esp_err != ESP_OK) {
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR;
     }
 
@@ -176,23 +179,23 @@ astarte_err_t astarte_storage_load_property(astarte_storage_handle_t handle,
     size_t data_len = value_len - sizeof(int32_t);
     if (!out_data && !out_major) {
         *out_data_len = data_len;
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_OK;
     }
 
     // Allocate memory for major version + data
-    void *value = malloc(value_len);
+    void *value = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, value_len);
     if (!value) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
-        free(key);
+        astarte_alloc_free(key);
         return ASTARTE_ERR;
     }
 
     // Get the data from NVS
     astarte_nvs_key_value_get(handle.nvs_handle, key, value, &value_len);
-    free(key);
+    astarte_alloc_free(key);
     if (esp_err != ESP_OK) {
-        free(value);
+        astarte_alloc_free(value);
         return ASTARTE_ERR;
     }
 
@@ -205,14 +208,14 @@ astarte_err_t astarte_storage_load_property(astarte_storage_handle_t handle,
     if (out_data) {
         // Check if out data has sufficient length
         if (data_len > *out_data_len) {
-            free(value);
+            astarte_alloc_free(value);
             return ASTARTE_ERR_INVALID_SIZE;
         }
         memcpy(out_data, value + sizeof(int32_t), data_len);
     }
     *out_data_len = data_len;
 
-    free(value);
+    astarte_alloc_free(value);
     return ASTARTE_OK;
 }
 
@@ -221,7 +224,7 @@ astarte_err_t astarte_storage_delete_property(
 {
     // Get the full key interface_name + path
     size_t key_len = strlen(interface_name) + strlen(path) + 1;
-    char *key = calloc(key_len, sizeof(char));
+    char *key = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, key_len, sizeof(char));
     if (!key) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         return ASTARTE_ERR;
@@ -230,7 +233,7 @@ astarte_err_t astarte_storage_delete_property(
 
     // Erase the property value using the full key
     esp_err_t esp_err = astarte_nvs_key_value_erase_key(handle.nvs_handle, key);
-    free(key);
+    astarte_alloc_free(key);
     if (esp_err == ESP_ERR_NVS_NOT_FOUND) {
         return ASTARTE_ERR_NOT_FOUND;
     }
@@ -319,13 +322,13 @@ astarte_err_t astarte_storage_iterator_get_property(astarte_storage_iterator_t *
         goto end;
     }
     // Allocate required space
-    key = calloc(key_len, sizeof(char));
+    key = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, key_len, sizeof(char));
     if (!key) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         astarte_storage_err = ASTARTE_ERR;
         goto end;
     }
-    value = calloc(value_len, sizeof(char));
+    value = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, value_len, sizeof(char));
     if (!value) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         astarte_storage_err = ASTARTE_ERR;
@@ -342,7 +345,8 @@ astarte_err_t astarte_storage_iterator_get_property(astarte_storage_iterator_t *
     // Split interface name and path
     char *interface_name_p = strtok(key, "/");
     size_t interface_name_len = strlen(interface_name_p) + 1; // Including the \0 terminating char
-    interface_name = calloc(interface_name_len, sizeof(char));
+    interface_name
+        = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, interface_name_len, sizeof(char));
     if (!interface_name) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         astarte_storage_err = ASTARTE_ERR;
@@ -352,7 +356,7 @@ astarte_err_t astarte_storage_iterator_get_property(astarte_storage_iterator_t *
 
     char *path_p = strtok(NULL, "\0");
     size_t path_len = strlen(path_p) + 2; // +1 because the '/' char is removed by strtok, +1 for \0
-    path = calloc(path_len, sizeof(char));
+    path = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, path_len, sizeof(char));
     if (!path) {
         ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
         astarte_storage_err = ASTARTE_ERR;
@@ -361,7 +365,7 @@ astarte_err_t astarte_storage_iterator_get_property(astarte_storage_iterator_t *
     strncat(strncpy(path, "/", path_len), path_p, path_len - strlen("/") - 1);
 
     // Free as content has already been stored in interface_name and path
-    free(key);
+    astarte_alloc_free(key);
     key = NULL;
 
     // Copy property information in the outputs
@@ -405,10 +409,10 @@ astarte_err_t astarte_storage_iterator_get_property(astarte_storage_iterator_t *
 
 end:
     // Free all data
-    free(key);
-    free(value);
-    free(interface_name);
-    free(path);
+    astarte_alloc_free(key);
+    astarte_alloc_free(value);
+    astarte_alloc_free(interface_name);
+    astarte_alloc_free(path);
 
     return astarte_storage_err;
 }
@@ -0,0 +1,192 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_tlv.h>
+
+#include <string.h>
+
+#include <esp_log.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_TLV"
+
+#define HEADER_MAGIC 0x564c5441U // "ATLV" in little endian
+#define HEADER_VERSION 1U
+
+// Offsets of the header fields, the remaining bytes are reserved and set to zero
+#define HEADER_MAGIC_OFFSET 0
+#define HEADER_VERSION_OFFSET 4
+#define HEADER_SEQUENCE_OFFSET 8
+#define HEADER_PAYLOAD_LEN_OFFSET 12
+#define HEADER_PAYLOAD_CRC_OFFSET 16
+#define HEADER_CRC_OFFSET (ASTARTE_TLV_HEADER_SIZE - 4)
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void write_u32(uint8_t *buf, uint32_t value);
+static uint32_t read_u32(const uint8_t *buf);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+uint32_t astarte_tlv_crc32(uint32_t crc, const uint8_t *buf, size_t len)
+{
+    // Bitwise implementation, the amount of data handled does not justify a lookup table
+    crc = ~crc;
+    for (size_t i = 0; i < len; i++) {
+        crc ^= buf[i];
+        for (int bit = 0; bit < 8; bit++) {
+            crc = (crc >> 1) ^ (0xEDB88320U & (0U - (crc & 1U)));
+        }
+    }
+    return ~crc;
+}
+
+void astarte_tlv_header_encode(const astarte_tlv_header_t *header, uint8_t *out)
+{
+    memset(out, 0, ASTARTE_TLV_HEADER_SIZE);
+    write_u32(out + HEADER_MAGIC_OFFSET, HEADER_MAGIC);
+    write_u32(out + HEADER_VERSION_OFFSET, HEADER_VERSION);
+    write_u32(out + HEADER_SEQUENCE_OFFSET, header->sequence);
+    write_u32(out + HEADER_PAYLOAD_LEN_OFFSET, header->payload_len);
+    write_u32(out + HEADER_PAYLOAD_CRC_OFFSET, header->payload_crc);
+    write_u32(out + HEADER_CRC_OFFSET, astarte_tlv_crc32(0, out, HEADER_CRC_OFFSET));
+}
+
+astarte_err_t astarte_tlv_header_decode(const uint8_t *buf, astarte_tlv_header_t *header)
+{
+    if ((read_u32(buf + HEADER_MAGIC_OFFSET) != HEADER_MAGIC)
+        || (read_u32(buf + HEADER_VERSION_OFFSET) != HEADER_VERSION)) {
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+
+    if (read_u32(buf + HEADER_CRC_OFFSET) != astarte_tlv_crc32(0, buf, HEADER_CRC_OFFSET)) {
+        ESP_LOGW(TAG, "Corrupted TLV header");
+        return ASTARTE_ERR_NOT_FOUND;
+    }
+
+    header->sequence = read_u32(buf + HEADER_SEQUENCE_OFFSET);
+    header->payload_len = read_u32(buf + HEADER_PAYLOAD_LEN_OFFSET);
+    header->payload_crc = read_u32(buf + HEADER_PAYLOAD_CRC_OFFSET);
+    return ASTARTE_OK;
+}
+
+bool astarte_tlv_payload_is_valid(const astarte_tlv_header_t *header, const uint8_t *payload)
+{
+    return astarte_tlv_crc32(0, payload, header->payload_len) == header->payload_crc;
+}
+
+int astarte_tlv_select_newest(const astarte_tlv_header_t *a, const astarte_tlv_header_t *b)
+{
+    if (!a && !b) {
+        return -1;
+    }
+    if (!b) {
+        return 0;
+    }
+    if (!a) {
+        return 1;
+    }
+    // Serial number arithmetic, a is newer if it's ahead of b by less than half the range
+    return ((int32_t) (a->sequence - b->sequence) >= 0) ? 0 : 1;
+}
+
+astarte_err_t astarte_tlv_find(const uint8_t *payload, size_t payload_len, uint8_t type,
+    const uint8_t **value, size_t *value_len)
+{
+    size_t offset = 0;
+    while (offset < payload_len) {
+        if (payload_len - offset < ASTARTE_TLV_RECORD_HEADER_SIZE) {
+            ESP_LOGE(TAG, "Truncated TLV record header at offset %zu", offset);
+            return ASTARTE_ERR;
+        }
+        uint8_t record_type = payload[offset];
+        size_t record_len = payload[offset + 1] | (payload[offset + 2] << 8);
+        offset += ASTARTE_TLV_RECORD_HEADER_SIZE;
+        if (payload_len - offset < record_len) {
+            ESP_LOGE(TAG, "Truncated TLV record value at offset %zu", offset);
+            return ASTARTE_ERR;
+        }
+        if (record_type == type) {
+            *value = payload + offset;
+            *value_len = record_len;
+            return ASTARTE_OK;
+        }
+        offset += record_len;
+    }
+
+    return ASTARTE_ERR_NOT_FOUND;
+}
+
+astarte_err_t astarte_tlv_update(const uint8_t *payload, size_t payload_len, uint8_t type,
+    const void *value, size_t value_len, uint8_t *out, size_t out_size, size_t *out_len)
+{
+    if (value && (value_len > ASTARTE_TLV_VALUE_MAX_LEN)) {
+        ESP_LOGE(TAG, "TLV value too big: %zu", value_len);
+        return ASTARTE_ERR_INVALID_SIZE;
+    }
+
+    size_t in_offset = 0;
+    size_t out_offset = 0;
+    while (in_offset < payload_len) {
+        if (payload_len - in_offset < ASTARTE_TLV_RECORD_HEADER_SIZE) {
+            ESP_LOGE(TAG, "Truncated TLV record header at offset %zu", in_offset);
+            return ASTARTE_ERR;
+        }
+        size_t record_size = ASTARTE_TLV_RECORD_HEADER_SIZE
+            + (payload[in_offset + 1] | (payload[in_offset + 2] << 8));
+        if (payload_len - in_offset < record_size) {
+            ESP_LOGE(TAG, "Truncated TLV record value at offset %zu", in_offset);
+            return ASTARTE_ERR;
+        }
+        // Copy all the records except the one being replaced
+        if (payload[in_offset] != type) {
+            if (out_size - out_offset < record_size) {
+                return ASTARTE_ERR_INVALID_SIZE;
+            }
+            memcpy(out + out_offset, payload + in_offset, record_size);
+            out_offset += record_size;
+        }
+        in_offset += record_size;
+    }
+
+    if (value) {
+        if (out_size - out_offset < ASTARTE_TLV_RECORD_HEADER_SIZE + value_len) {
+            return ASTARTE_ERR_INVALID_SIZE;
+        }
+        out[out_offset] = type;
+        out[out_offset + 1] = value_len & 0xFFU;
+        out[out_offset + 2] = (value_len >> 8) & 0xFFU;
+        memcpy(out + out_offset + ASTARTE_TLV_RECORD_HEADER_SIZE, value, value_len);
+        out_offset += ASTARTE_TLV_RECORD_HEADER_SIZE + value_len;
+    }
+
+    *out_len = out_offset;
+    return ASTARTE_OK;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void write_u32(uint8_t *buf, uint32_t value)
+{
+    buf[0] = value & 0xFFU;
+    buf[1] = (value >> 8) & 0xFFU;
+    buf[2] = (value >> 16) & 0xFFU;
+    buf[3] = (value >> 24) & 0xFFU;
+}
+
+static uint32_t read_u32(const uint8_t *buf)
+{
+    return buf[0] | (buf[1] << 8) | (buf[2] << 16) | ((uint32_t) buf[3] << 24);
+}
@@ -0,0 +1,134 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_topic_alias_table.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_TOPIC_ALIAS_TABLE"
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void free_slots(astarte_topic_alias_table_t *table, uint16_t first);
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_err_t astarte_topic_alias_table_init(astarte_topic_alias_table_t *table, uint16_t capacity)
+{
+    memset(table, 0, sizeof(astarte_topic_alias_table_t));
+    table->slots = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, capacity, sizeof(astarte_topic_alias_slot_t));
+    if (!table->slots) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    table->capacity = capacity;
+    table->limit = capacity;
+    return ASTARTE_OK;
+}
+
+void astarte_topic_alias_table_destroy(astarte_topic_alias_table_t *table)
+{
+    free_slots(table, 0);
+    astarte_alloc_free(table->slots);
+    table->slots = NULL;
+    table->capacity = 0;
+    table->limit = 0;
+}
+
+void astarte_topic_alias_table_reset(astarte_topic_alias_table_t *table)
+{
+    free_slots(table, 0);
+    table->limit = table->capacity;
+    table->generation++;
+}
+
+astarte_err_t astarte_topic_alias_table_get(
+    astarte_topic_alias_table_t *table, const char *topic, astarte_topic_alias_t *alias)
+{
+    memset(alias, 0, sizeof(astarte_topic_alias_t));
+    alias->generation = table->generation;
+    if (table->limit == 0) {
+        return ASTARTE_OK;
+    }
+
+    uint16_t victim = 0;
+    for (uint16_t i = 0; i < table->limit; i++) {
+        astarte_topic_alias_slot_t *slot = &table->slots[i];
+        if (slot->topic && (strcmp(slot->topic, topic) == 0)) {
+            slot->last_use = ++table->uses;
+            alias->alias = i + 1;
+            alias->confirmed = slot->confirmed;
+            return ASTARTE_OK;
+        }
+        // Free aliases come first, then the least recently used one
+        astarte_topic_alias_slot_t *victim_slot = &table->slots[victim];
+        if (victim_slot->topic && (!slot->topic || (slot->last_use < victim_slot->last_use))) {
+            victim = i;
+        }
+    }
+
+    char *topic_copy = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, topic);
+    if (!topic_copy) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return ASTARTE_ERR_OUT_OF_MEMORY;
+    }
+    astarte_topic_alias_slot_t *slot = &table->slots[victim];
+    astarte_alloc_free(slot->topic);
+    slot->topic = topic_copy;
+    slot->confirmed = false;
+    slot->last_use = ++table->uses;
+    alias->alias = victim + 1;
+    return ASTARTE_OK;
+}
+
+void astarte_topic_alias_table_confirm(
+    astarte_topic_alias_table_t *table, const astarte_topic_alias_t *alias)
+{
+    if ((alias->alias == 0) || (alias->alias > table->limit)
+        || (alias->generation != table->generation)) {
+        return;
+    }
+    astarte_topic_alias_slot_t *slot = &table->slots[alias->alias - 1];
+    if (slot->topic) {
+        slot->confirmed = true;
+    }
+}
+
+void astarte_topic_alias_table_refuse(
+    astarte_topic_alias_table_t *table, const astarte_topic_alias_t *alias)
+{
+    if ((alias->alias == 0) || (alias->alias > table->limit)
+        || (alias->generation != table->generation)) {
+        return;
+    }
+    table->limit = alias->alias - 1;
+    free_slots(table, table->limit);
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void free_slots(astarte_topic_alias_table_t *table, uint16_t first)
+{
+    for (uint16_t i = first; i < table->capacity; i++) {
+        astarte_alloc_free(table->slots[i].topic);
+        memset(&table->slots[i], 0, sizeof(astarte_topic_alias_slot_t));
+    }
+}
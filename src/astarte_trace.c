@@ -0,0 +1,140 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_trace.h>
+
+#ifdef CONFIG_ASTARTE_TRACE
+
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_SYSVIEW)
+#include <SEGGER_SYSVIEW.h>
+#elif defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/task.h>
+#include <inttypes.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#endif
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_TRACE"
+
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+// Size of the stdio buffer of the trace file, to keep file writes out of the traced paths
+#define TRACE_FILE_BUFFER_SIZE (64 * 1024)
+
+static const char *const trace_event_names[ASTARTE_TRACE_EVENT_COUNT] = {
+    [ASTARTE_TRACE_SERIALIZE] = "serialize",
+    [ASTARTE_TRACE_PUBLISH] = "publish",
+    [ASTARTE_TRACE_LOCK_WAIT] = "lock_wait",
+    [ASTARTE_TRACE_ENQUEUE] = "enqueue",
+    [ASTARTE_TRACE_INCOMING] = "incoming",
+    [ASTARTE_TRACE_STORAGE] = "storage",
+    [ASTARTE_TRACE_ZLIB] = "zlib",
+    [ASTARTE_TRACE_REINIT] = "reinit",
+};
+
+static pthread_mutex_t trace_file_mutex = PTHREAD_MUTEX_INITIALIZER;
+static FILE *trace_file = NULL;
+// The file is opened at most once, events after it has been closed at exit are dropped
+static bool trace_file_opened = false;
+static char trace_file_buffer[TRACE_FILE_BUFFER_SIZE];
+#endif
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+static void write_event(astarte_trace_event_t event, char phase);
+static void close_trace_file(void);
+#endif
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+void astarte_trace_begin(astarte_trace_event_t event)
+{
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_SYSVIEW)
+    SEGGER_SYSVIEW_OnUserStart(CONFIG_ASTARTE_TRACE_SYSVIEW_ID_BASE + (unsigned) event);
+#elif defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+    write_event(event, 'B');
+#else
+    (void) event;
+#endif
+}
+
+void astarte_trace_end(astarte_trace_event_t event)
+{
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_SYSVIEW)
+    SEGGER_SYSVIEW_OnUserStop(CONFIG_ASTARTE_TRACE_SYSVIEW_ID_BASE + (unsigned) event);
+#elif defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+    write_event(event, 'E');
+#else
+    (void) event;
+#endif
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+#if defined(CONFIG_ASTARTE_TRACE_BACKEND_PERFETTO)
+static void write_event(astarte_trace_event_t event, char phase)
+{
+    // Take the timestamp first, waiting for the file lock is not part of the event
+    int64_t timestamp_us = esp_timer_get_time();
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    pthread_mutex_lock(&trace_file_mutex);
+    if (!trace_file_opened) {
+        trace_file_opened = true;
+        trace_file = fopen(CONFIG_ASTARTE_TRACE_FILE, "w");
+        if (!trace_file) {
+            ESP_LOGE(TAG, "Cannot open the trace file %s", CONFIG_ASTARTE_TRACE_FILE);
+            goto exit;
+        }
+        setvbuf(trace_file, trace_file_buffer, _IOFBF, sizeof(trace_file_buffer));
+        // JSON array format, the closing bracket is written at exit but it is optional
+        fputs("[\n", trace_file);
+        atexit(close_trace_file);
+    } else if (trace_file) {
+        fputs(",\n", trace_file);
+    }
+    if (!trace_file) {
+        goto exit;
+    }
+
+    fprintf(trace_file,
+        "{\"name\":\"%s\",\"cat\":\"astarte\",\"ph\":\"%c\",\"ts\":%" PRId64
+        ",\"pid\":1,\"tid\":%" PRIu32 ",\"args\":{\"task\":\"%s\"}}",
+        trace_event_names[event], phase, timestamp_us, (uint32_t) (uintptr_t) task,
+        pcTaskGetName(task));
+
+exit:
+    pthread_mutex_unlock(&trace_file_mutex);
+}
+
+static void close_trace_file(void)
+{
+    pthread_mutex_lock(&trace_file_mutex);
+    if (trace_file) {
+        fputs("\n]\n", trace_file);
+        fclose(trace_file);
+        trace_file = NULL;
+    }
+    pthread_mutex_unlock(&trace_file_mutex);
+}
+#endif
+
+#endif /* CONFIG_ASTARTE_TRACE */
@@ -0,0 +1,344 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_transport_esp_mqtt.h>
+
+#include <astarte_alloc.h>
+
+#include <mqtt_client.h>
+
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+#include <esp_crt_bundle.h>
+#endif
+#include <esp_idf_version.h>
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+#include <freertos/task.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_TRANSPORT_ESP_MQTT"
+
+typedef struct
+{
+    esp_mqtt_client_handle_t mqtt;
+    astarte_transport_event_handler_t handler;
+    void *handler_data;
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    bool mqtt5;
+    // esp-mqtt keeps a pointer to the publish property and reads it in the following publishes, so
+    // the property outlives the call setting it and every publish sets it again. The task of the
+    // client publishes from its events with its own property.
+    esp_mqtt5_publish_property_config_t publish_property;
+    esp_mqtt5_publish_property_config_t event_publish_property;
+    SemaphoreHandle_t publish_mutex;
+    TaskHandle_t event_task;
+#endif
+} esp_mqtt_transport_client_t;
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void *client_create(void *transport_data, const astarte_transport_config_t *config,
+    astarte_transport_event_handler_t handler, void *handler_data);
+static void client_destroy(void *client);
+static astarte_err_t client_start(void *client);
+static astarte_err_t client_stop(void *client);
+static int client_publish(void *client, const char *topic, const void *data, int length, int qos,
+    uint16_t topic_alias);
+#ifdef CONFIG_MQTT_PROTOCOL_5
+static int mqtt5_publish(esp_mqtt_transport_client_t *client, const char *topic, const void *data,
+    int length, int qos, uint16_t topic_alias);
+#endif
+static int client_subscribe(void *client, const char *topic, int qos);
+static int client_get_outbox_size(void *client);
+static void mqtt_event_handler(
+    void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data);
+
+/************************************************
+ *       Global variables definitions           *
+ ***********************************************/
+
+static const astarte_transport_ops_t esp_mqtt_ops = {
+    .create = client_create,
+    .destroy = client_destroy,
+    .start = client_start,
+    .stop = client_stop,
+    .publish = client_publish,
+    .subscribe = client_subscribe,
+    .get_outbox_size = client_get_outbox_size,
+};
+
+static const astarte_transport_t esp_mqtt_transport = {
+    .ops = &esp_mqtt_ops,
+};
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+const astarte_transport_t *astarte_transport_esp_mqtt(void)
+{
+    return &esp_mqtt_transport;
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void *client_create(void *transport_data, const astarte_transport_config_t *config,
+    astarte_transport_event_handler_t handler, void *handler_data)
+{
+    (void) transport_data;
+
+    esp_mqtt_transport_client_t *client = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(esp_mqtt_transport_client_t));
+    if (!client) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
+    client->handler = handler;
+    client->handler_data = handler_data;
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+    const esp_mqtt_client_config_t mqtt_cfg
+        = {.broker.address.uri = config->broker_url,
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+              .broker.verification.crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+              .credentials.authentication.certificate = config->certificate,
+              .credentials.authentication.certificate_len = config->certificate_len,
+              .credentials.authentication.key = config->key,
+              .credentials.authentication.key_len = config->key_len,
+              .session.disable_clean_session = config->persistent_session,
+#ifdef CONFIG_MQTT_PROTOCOL_5
+              .session.protocol_ver = config->mqtt5 ? MQTT_PROTOCOL_V_5 : MQTT_PROTOCOL_UNDEFINED,
+#endif
+          };
+#else
+    const esp_mqtt_client_config_t mqtt_cfg
+        = {.uri = config->broker_url,
+#if CONFIG_MBEDTLS_CERTIFICATE_BUNDLE
+              .crt_bundle_attach = esp_crt_bundle_attach,
+#endif
+              .client_cert_pem = config->certificate,
+              .client_cert_len = config->certificate_len,
+              .client_key_pem = config->key,
+              .client_key_len = config->key_len,
+              .disable_clean_session = config->persistent_session,
+          };
+#endif
+
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    client->mqtt5 = config->mqtt5;
+    client->publish_mutex = xSemaphoreCreateMutex();
+    if (!client->publish_mutex) {
+        ESP_LOGE(TAG, "Cannot create publish_mutex");
+        astarte_alloc_free(client);
+        return NULL;
+    }
+#endif
+
+    client->mqtt = esp_mqtt_client_init(&mqtt_cfg);
+    if (!client->mqtt) {
+        ESP_LOGE(TAG, "Error in esp_mqtt_client_init");
+        client_destroy(client);
+        return NULL;
+    }
+
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    if (config->mqtt5 && config->persistent_session) {
+        // MQTT 5 ends the session on disconnection unless it has an expiry, a persistent session
+        // has to last as with MQTT 3.1.1
+        const esp_mqtt5_connection_property_config_t connect_property = {
+            .session_expiry_interval = UINT32_MAX,
+        };
+        if (esp_mqtt5_client_set_connect_property(client->mqtt, &connect_property) != ESP_OK) {
+            ESP_LOGW(TAG, "Cannot set the session expiry interval");
+        }
+    }
+#endif
+
+    esp_mqtt_client_register_event(client->mqtt, ESP_EVENT_ANY_ID, mqtt_event_handler, client);
+    return client;
+}
+
+static void client_destroy(void *client)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+    if (!esp_client) {
+        return;
+    }
+    if (esp_client->mqtt) {
+        esp_mqtt_client_destroy(esp_client->mqtt);
+    }
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    if (esp_client->publish_mutex) {
+        vSemaphoreDelete(esp_client->publish_mutex);
+    }
+#endif
+    astarte_alloc_free(esp_client);
+}
+
+static astarte_err_t client_start(void *client)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+    esp_err_t err = esp_mqtt_client_start(esp_client->mqtt);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to start MQTT client: %s", esp_err_to_name(err));
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+static astarte_err_t client_stop(void *client)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+    esp_err_t err = esp_mqtt_client_stop(esp_client->mqtt);
+    if (err != ESP_OK) {
+        ESP_LOGE(TAG, "Failed to stop MQTT client: %s", esp_err_to_name(err));
+        return ASTARTE_ERR;
+    }
+    return ASTARTE_OK;
+}
+
+static int client_publish(void *client, const char *topic, const void *data, int length, int qos,
+    uint16_t topic_alias)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    if (esp_client->mqtt5) {
+        return mqtt5_publish(esp_client, topic, data, length, qos, topic_alias);
+    }
+#endif
+    if (topic_alias != 0) {
+        return ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED;
+    }
+    return esp_mqtt_client_publish(esp_client->mqtt, topic, data, length, qos, 0);
+}
+
+static int client_subscribe(void *client, const char *topic, int qos)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+    return esp_mqtt_client_subscribe(esp_client->mqtt, topic, qos);
+}
+
+static int client_get_outbox_size(void *client)
+{
+    esp_mqtt_transport_client_t *esp_client = client;
+    return esp_mqtt_client_get_outbox_size(esp_client->mqtt);
+}
+
+#ifdef CONFIG_MQTT_PROTOCOL_5
+static int mqtt5_publish(esp_mqtt_transport_client_t *client, const char *topic, const void *data,
+    int length, int qos, uint16_t topic_alias)
+{
+    if (xTaskGetCurrentTaskHandle() == client->event_task) {
+        // The task of the client runs the events holding the lock of esp-mqtt, the publish cannot
+        // interleave with the ones of the other tasks. One of them might have set its property and
+        // be waiting for that lock to publish, its property is set again afterwards.
+        client->event_publish_property.topic_alias = topic_alias;
+        if (esp_mqtt5_client_set_publish_property(client->mqtt, &client->event_publish_property)
+            != ESP_OK) {
+            return (topic_alias != 0) ? ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED : -1;
+        }
+        int ret = esp_mqtt_client_publish(client->mqtt, topic, data, length, qos, 0);
+        esp_mqtt5_client_set_publish_property(client->mqtt, &client->publish_property);
+        return ret;
+    }
+
+    // Waiting for the lock of esp-mqtt with the mutex held is safe, the task of the client never
+    // takes the mutex
+    int ret = -1;
+    xSemaphoreTake(client->publish_mutex, portMAX_DELAY);
+    client->publish_property.topic_alias = topic_alias;
+    if (esp_mqtt5_client_set_publish_property(client->mqtt, &client->publish_property) != ESP_OK) {
+        // Above the Topic Alias Maximum of the broker
+        ret = (topic_alias != 0) ? ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED : -1;
+        goto end;
+    }
+    ret = esp_mqtt_client_publish(client->mqtt, topic, data, length, qos, 0);
+
+end:
+    xSemaphoreGive(client->publish_mutex);
+    return ret;
+}
+#endif
+
+static void mqtt_event_handler(
+    void *handler_args, esp_event_base_t base, int32_t event_id, void *event_data)
+{
+    (void) base;
+
+    esp_mqtt_transport_client_t *client = handler_args;
+#ifdef CONFIG_MQTT_PROTOCOL_5
+    client->event_task = xTaskGetCurrentTaskHandle();
+#endif
+    esp_mqtt_event_handle_t mqtt_event = event_data;
+    astarte_transport_event_t event = { 0 };
+    switch ((esp_mqtt_event_id_t) event_id) {
+        case MQTT_EVENT_BEFORE_CONNECT:
+            event.id = ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT;
+            break;
+
+        case MQTT_EVENT_CONNECTED:
+            event.id = ASTARTE_TRANSPORT_EVENT_CONNECTED;
+            event.session_present = mqtt_event->session_present;
+            break;
+
+        case MQTT_EVENT_DISCONNECTED:
+            event.id = ASTARTE_TRANSPORT_EVENT_DISCONNECTED;
+            break;
+
+        case MQTT_EVENT_SUBSCRIBED:
+            ESP_LOGD(TAG, "MQTT_EVENT_SUBSCRIBED, msg_id=%d", mqtt_event->msg_id);
+            return;
+
+        case MQTT_EVENT_UNSUBSCRIBED:
+            ESP_LOGD(TAG, "MQTT_EVENT_UNSUBSCRIBED, msg_id=%d", mqtt_event->msg_id);
+            return;
+
+        case MQTT_EVENT_PUBLISHED:
+            event.id = ASTARTE_TRANSPORT_EVENT_PUBLISHED;
+            event.msg_id = mqtt_event->msg_id;
+            break;
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+        case MQTT_EVENT_DELETED:
+            event.id = ASTARTE_TRANSPORT_EVENT_DELETED;
+            event.msg_id = mqtt_event->msg_id;
+            break;
+#endif
+
+        case MQTT_EVENT_DATA:
+            event.id = ASTARTE_TRANSPORT_EVENT_DATA;
+            event.topic = mqtt_event->topic;
+            event.topic_len = mqtt_event->topic_len;
+            event.data = mqtt_event->data;
+            event.data_len = mqtt_event->data_len;
+            break;
+
+        case MQTT_EVENT_ERROR:
+            event.id = ASTARTE_TRANSPORT_EVENT_ERROR;
+            if (mqtt_event->error_handle->error_type == MQTT_ERROR_TYPE_ESP_TLS) {
+                event.error = ASTARTE_TRANSPORT_ERROR_TLS;
+            } else if (mqtt_event->error_handle->error_type
+                == MQTT_ERROR_TYPE_CONNECTION_REFUSED) {
+                event.error = ASTARTE_TRANSPORT_ERROR_CONNECTION_REFUSED;
+                event.connect_return_code = (int) mqtt_event->error_handle->connect_return_code;
+            }
+            break;
+
+        default:
+            // Handle MQTT_EVENT_ANY introduced in esp-idf 3.2
+            return;
+    }
+    client->handler(client->handler_data, &event);
+}
@@ -0,0 +1,399 @@
+/*
+ * (C) Copyright 2024, SECO Mind Srl
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ */
+
+#include <astarte_transport_loopback.h>
+
+#include <astarte_alloc.h>
+
+#include <esp_log.h>
+#include <freertos/FreeRTOS.h>
+#include <freertos/semphr.h>
+
+#include <string.h>
+
+/************************************************
+ *        Defines, constants and typedef        *
+ ***********************************************/
+
+#define TAG "ASTARTE_TRANSPORT_LOOPBACK"
+
+// MQTT packet identifiers go from 1 to 65535
+#define MSG_ID_MAX 65535
+
+struct astarte_transport_loopback
+{
+    astarte_transport_t transport;
+    char *device_topic;
+    astarte_transport_loopback_publish_callback_t publish_callback;
+    void *callback_user_data;
+    SemaphoreHandle_t mutex;
+    astarte_transport_loopback_stats_t stats;
+    // The client of the device, a single one at a time
+    bool has_client;
+    bool mqtt5;
+    bool started;
+    bool connected;
+    astarte_transport_event_handler_t handler;
+    void *handler_data;
+    int next_msg_id;
+    int first_pending_msg_id;
+    uint32_t pending;
+    // Topics of the aliases on the current connection, as known by a broker
+    char **alias_topics;
+    uint16_t topic_alias_maximum;
+};
+
+/************************************************
+ *         Static functions declaration         *
+ ***********************************************/
+
+static void *client_create(void *transport_data, const astarte_transport_config_t *config,
+    astarte_transport_event_handler_t handler, void *handler_data);
+static void client_destroy(void *client);
+static astarte_err_t client_start(void *client);
+static astarte_err_t client_stop(void *client);
+static int client_publish(void *client, const char *topic, const void *data, int length, int qos,
+    uint16_t topic_alias);
+static int client_subscribe(void *client, const char *topic, int qos);
+static int client_get_outbox_size(void *client);
+static void forget_alias_topics(astarte_transport_loopback_handle_t loopback);
+static void deliver(
+    astarte_transport_loopback_handle_t loopback, const astarte_transport_event_t *event);
+
+/************************************************
+ *       Global variables definitions           *
+ ***********************************************/
+
+static const astarte_transport_ops_t loopback_ops = {
+    .create = client_create,
+    .destroy = client_destroy,
+    .start = client_start,
+    .stop = client_stop,
+    .publish = client_publish,
+    .subscribe = client_subscribe,
+    .get_outbox_size = client_get_outbox_size,
+};
+
+/************************************************
+ *         Global functions definitions         *
+ ***********************************************/
+
+astarte_transport_loopback_handle_t astarte_transport_loopback_new(
+    const astarte_transport_loopback_config_t *config)
+{
+    astarte_transport_loopback_handle_t loopback = astarte_alloc_calloc(
+        ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 1, sizeof(struct astarte_transport_loopback));
+    if (!loopback) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        return NULL;
+    }
+
+    loopback->device_topic
+        = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, config->device_topic);
+    if (!loopback->device_topic) {
+        ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+        goto failure;
+    }
+    if (config->topic_alias_maximum > 0) {
+        loopback->alias_topics = astarte_alloc_calloc(
+            ASTARTE_ALLOC_SUBSYSTEM_DEVICE, config->topic_alias_maximum, sizeof(char *));
+        if (!loopback->alias_topics) {
+            ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+            goto failure;
+        }
+    }
+    loopback->mutex = xSemaphoreCreateMutex();
+    if (!loopback->mutex) {
+        ESP_LOGE(TAG, "Cannot create the loopback mutex");
+        goto failure;
+    }
+
+    loopback->transport.ops = &loopback_ops;
+    loopback->transport.transport_data = loopback;
+    loopback->transport.device_topic = loopback->device_topic;
+    loopback->publish_callback = config->publish_callback;
+    loopback->callback_user_data = config->callback_user_data;
+    loopback->topic_alias_maximum = config->topic_alias_maximum;
+    loopback->next_msg_id = 1;
+    return loopback;
+
+failure:
+    astarte_transport_loopback_destroy(loopback);
+    return NULL;
+}
+
+void astarte_transport_loopback_destroy(astarte_transport_loopback_handle_t loopback)
+{
+    if (!loopback) {
+        return;
+    }
+    forget_alias_topics(loopback);
+    astarte_alloc_free(loopback->alias_topics);
+    astarte_alloc_free(loopback->device_topic);
+    if (loopback->mutex) {
+        vSemaphoreDelete(loopback->mutex);
+    }
+    astarte_alloc_free(loopback);
+}
+
+const astarte_transport_t *astarte_transport_loopback_get_transport(
+    astarte_transport_loopback_handle_t loopback)
+{
+    return &loopback->transport;
+}
+
+astarte_err_t astarte_transport_loopback_connect(
+    astarte_transport_loopback_handle_t loopback, bool session_present)
+{
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    if (!loopback->started) {
+        xSemaphoreGive(loopback->mutex);
+        return ASTARTE_ERR_DEVICE_NOT_READY;
+    }
+    // Aliases only last as long as the connection
+    forget_alias_topics(loopback);
+    loopback->connected = true;
+    xSemaphoreGive(loopback->mutex);
+
+    astarte_transport_event_t event = { .id = ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT };
+    deliver(loopback, &event);
+    event.id = ASTARTE_TRANSPORT_EVENT_CONNECTED;
+    event.session_present = session_present;
+    deliver(loopback, &event);
+    return ASTARTE_OK;
+}
+
+astarte_err_t astarte_transport_loopback_disconnect(astarte_transport_loopback_handle_t loopback)
+{
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    if (!loopback->connected) {
+        xSemaphoreGive(loopback->mutex);
+        return ASTARTE_ERR_DEVICE_NOT_READY;
+    }
+    loopback->connected = false;
+    xSemaphoreGive(loopback->mutex);
+
+    const astarte_transport_event_t event = { .id = ASTARTE_TRANSPORT_EVENT_DISCONNECTED };
+    deliver(loopback, &event);
+    return ASTARTE_OK;
+}
+
+uint32_t astarte_transport_loopback_acknowledge(astarte_transport_loopback_handle_t loopback)
+{
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    uint32_t count = loopback->pending;
+    int msg_id = loopback->first_pending_msg_id;
+    loopback->pending = 0;
+    loopback->stats.outbox_size = 0;
+    loopback->stats.acknowledged += count;
+    xSemaphoreGive(loopback->mutex);
+
+    // Pending messages have consecutive ids, QoS 0 messages take none
+    astarte_transport_event_t event = { .id = ASTARTE_TRANSPORT_EVENT_PUBLISHED };
+    for (uint32_t i = 0; i < count; i++) {
+        event.msg_id = msg_id;
+        deliver(loopback, &event);
+        msg_id = (msg_id % MSG_ID_MAX) + 1;
+    }
+    return count;
+}
+
+astarte_err_t astarte_transport_loopback_inject(astarte_transport_loopback_handle_t loopback,
+    const char *topic, const void *data, int length)
+{
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    if (!loopback->connected) {
+        xSemaphoreGive(loopback->mutex);
+        return ASTARTE_ERR_DEVICE_NOT_READY;
+    }
+    loopback->stats.injected++;
+    xSemaphoreGive(loopback->mutex);
+
+    const astarte_transport_event_t event = {
+        .id = ASTARTE_TRANSPORT_EVENT_DATA,
+        .topic = topic,
+        .topic_len = (int) strlen(topic),
+        .data = data,
+        .data_len = length,
+    };
+    deliver(loopback, &event);
+    return ASTARTE_OK;
+}
+
+void astarte_transport_loopback_get_stats(
+    astarte_transport_loopback_handle_t loopback, astarte_transport_loopback_stats_t *stats)
+{
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    *stats = loopback->stats;
+    xSemaphoreGive(loopback->mutex);
+}
+
+/************************************************
+ *         Static functions definitions         *
+ ***********************************************/
+
+static void *client_create(void *transport_data, const astarte_transport_config_t *config,
+    astarte_transport_event_handler_t handler, void *handler_data)
+{
+    astarte_transport_loopback_handle_t loopback = transport_data;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    if (loopback->has_client) {
+        xSemaphoreGive(loopback->mutex);
+        ESP_LOGE(TAG, "The loopback already serves a device");
+        return NULL;
+    }
+    loopback->has_client = true;
+    loopback->mqtt5 = config->mqtt5;
+    loopback->handler = handler;
+    loopback->handler_data = handler_data;
+    xSemaphoreGive(loopback->mutex);
+    return loopback;
+}
+
+static void client_destroy(void *client)
+{
+    astarte_transport_loopback_handle_t loopback = client;
+    if (!loopback) {
+        return;
+    }
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    // The outbox goes with the client
+    loopback->has_client = false;
+    loopback->started = false;
+    loopback->connected = false;
+    loopback->handler = NULL;
+    loopback->handler_data = NULL;
+    loopback->pending = 0;
+    loopback->stats.outbox_size = 0;
+    forget_alias_topics(loopback);
+    xSemaphoreGive(loopback->mutex);
+}
+
+static astarte_err_t client_start(void *client)
+{
+    astarte_transport_loopback_handle_t loopback = client;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    loopback->started = true;
+    xSemaphoreGive(loopback->mutex);
+    return ASTARTE_OK;
+}
+
+static astarte_err_t client_stop(void *client)
+{
+    astarte_transport_loopback_handle_t loopback = client;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    loopback->started = false;
+    loopback->connected = false;
+    xSemaphoreGive(loopback->mutex);
+    return ASTARTE_OK;
+}
+
+static int client_publish(void *client, const char *topic, const void *data, int length, int qos,
+    uint16_t topic_alias)
+{
+    astarte_transport_loopback_handle_t loopback = client;
+    int ret = -1;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    if ((topic_alias != 0) && (!loopback->mqtt5 || (topic_alias > loopback->topic_alias_maximum))) {
+        ret = ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED;
+        goto end;
+    }
+
+    // QoS 0 messages are dropped while disconnected, the others wait in the outbox
+    if ((qos == 0) && !loopback->connected) {
+        goto end;
+    }
+
+    const char *resolved_topic = topic;
+    if (topic_alias != 0) {
+        char **alias_topic = &loopback->alias_topics[topic_alias - 1];
+        if (topic[0] != '\0') {
+            char *topic_copy = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, topic);
+            if (!topic_copy) {
+                ESP_LOGE(TAG, "Out of memory %s: %d", __FILE__, __LINE__);
+                goto end;
+            }
+            astarte_alloc_free(*alias_topic);
+            *alias_topic = topic_copy;
+        } else if (!*alias_topic) {
+            ESP_LOGE(TAG, "Topic alias %u used before being set", topic_alias);
+            goto end;
+        }
+        resolved_topic = *alias_topic;
+    }
+
+    ret = 0;
+    if (qos > 0) {
+        ret = loopback->next_msg_id;
+        loopback->next_msg_id = (ret % MSG_ID_MAX) + 1;
+        if (loopback->pending == 0) {
+            loopback->first_pending_msg_id = ret;
+        }
+        loopback->pending++;
+        loopback->stats.outbox_size += length;
+    }
+    loopback->stats.published++;
+    loopback->stats.published_bytes += length;
+
+    if (loopback->publish_callback) {
+        const astarte_transport_loopback_message_t message = {
+            .topic = resolved_topic,
+            .data = data,
+            .length = length,
+            .qos = qos,
+            .msg_id = ret,
+            .topic_alias = topic_alias,
+        };
+        loopback->publish_callback(&message, loopback->callback_user_data);
+    }
+
+end:
+    xSemaphoreGive(loopback->mutex);
+    return ret;
+}
+
+static int client_subscribe(void *client, const char *topic, int qos)
+{
+    (void) topic;
+    (void) qos;
+
+    astarte_transport_loopback_handle_t loopback = client;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    // Subscriptions are numbered apart, the ids of the pending messages stay consecutive
+    int msg_id = (int) (++loopback->stats.subscriptions % MSG_ID_MAX) + 1;
+    xSemaphoreGive(loopback->mutex);
+    return msg_id;
+}
+
+static int client_get_outbox_size(void *client)
+{
+    astarte_transport_loopback_handle_t loopback = client;
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    int outbox_size = (int) loopback->stats.outbox_size;
+    xSemaphoreGive(loopback->mutex);
+    return outbox_size;
+}
+
+static void forget_alias_topics(astarte_transport_loopback_handle_t loopback)
+{
+    for (uint16_t i = 0; i < loopback->topic_alias_maximum; i++) {
+        astarte_alloc_free(loopback->alias_topics[i]);
+        loopback->alias_topics[i] = NULL;
+    }
+}
+
+static void deliver(
+    astarte_transport_loopback_handle_t loopback, const astarte_transport_event_t *event)
+{
+    // The client is only replaced by the device, which does not run concurrently with the caller
+    xSemaphoreTake(loopback->mutex, portMAX_DELAY);
+    astarte_transport_event_handler_t handler = loopback->handler;
+    void *handler_data = loopback->handler_data;
+    xSemaphoreGive(loopback->mutex);
+    if (handler) {
+        handler(handler_data, event);
+    }
+}
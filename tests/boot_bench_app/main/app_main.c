@@ -0,0 +1,314 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+/**
+ * @file app_main.c
+ * @brief Boot-to-connected benchmark for the Linux target.
+ *
+ * @details Runs a cold boot, with empty storage, followed by a number of warm boots, reusing the
+ * stored credentials. Each boot is split in phases, the duration and the heap high-water of each
+ * phase are printed at the end of the boot. The device talks to the local stand-in started by
+ * python_scripts/pairing_stand_in.py.
+ *
+ * The boot profiling hooks are defined here, next to app_main(), so that they are always linked
+ * in place of the weak definitions provided by the SDK.
+ */
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <esp_log.h>
+#include <esp_timer.h>
+#include <nvs_flash.h>
+
+#include "freertos/FreeRTOS.h"
+#include "freertos/event_groups.h"
+#include "freertos/task.h"
+
+#include <astarte_allocator.h>
+#include <astarte_boot_profile.h>
+#include <astarte_credentials.h>
+#include <astarte_device.h>
+
+#include "bench_heap.h"
+
+/************************************************
+ * Constants/Defines
+ ***********************************************/
+
+#define TAG "BOOT_BENCH"
+
+// Valid base64 url encoded 128 bits device ID, the Linux target has no MAC address to derive it
+#define BENCH_DEVICE_ID "2TBn-jNESuuHamE2Zo1anA"
+#define BENCH_CREDENTIALS_NAMESPACE "bench"
+
+#define CONNECTED_BIT (1U << 0U)
+#define RESYNC_DONE_BIT (1U << 1U)
+
+// Phases measured by the benchmark itself are appended after the SDK ones
+#define BENCH_PHASE_CREDENTIALS_INIT ASTARTE_BOOT_PHASE_COUNT
+#define BENCH_PHASE_COUNT (ASTARTE_BOOT_PHASE_COUNT + 1)
+
+typedef struct
+{
+    bool ran;
+    int64_t start_us;
+    int64_t duration_us;
+    size_t heap_start;
+    size_t heap_peak;
+} phase_record_t;
+
+static const astarte_interface_t device_properties_interface = {
+    .name = "org.astarteplatform.esp32.bench.DeviceProperties",
+    .major_version = 0,
+    .minor_version = 1,
+    .ownership = OWNERSHIP_DEVICE,
+    .type = TYPE_PROPERTIES,
+};
+
+static const astarte_interface_t server_properties_interface = {
+    .name = "org.astarteplatform.esp32.bench.ServerProperties",
+    .major_version = 0,
+    .minor_version = 1,
+    .ownership = OWNERSHIP_SERVER,
+    .type = TYPE_PROPERTIES,
+};
+
+static const astarte_interface_t device_datastream_interface = {
+    .name = "org.astarteplatform.esp32.bench.DeviceDatastream",
+    .major_version = 0,
+    .minor_version = 1,
+    .ownership = OWNERSHIP_DEVICE,
+    .type = TYPE_DATASTREAM,
+};
+
+static phase_record_t phase_records[BENCH_PHASE_COUNT];
+static EventGroupHandle_t boot_event_group;
+static int session_present;
+
+/************************************************
+ * Static functions declaration
+ ***********************************************/
+
+static bool run_boot(const char *label, bool cold);
+static void phase_begin(int phase);
+static void phase_end(int phase);
+static const char *phase_name(int phase);
+static void print_report(const char *label, int64_t total_us);
+static void connection_callback(astarte_device_connection_event_t *event);
+
+/************************************************
+ * Main function definition
+ ***********************************************/
+
+void app_main()
+{
+    esp_log_level_set("*", ESP_LOG_WARN);
+
+    boot_event_group = xEventGroupCreate();
+    if (!boot_event_group) {
+        ESP_LOGE(TAG, "Cannot create the event group");
+        exit(EXIT_FAILURE);
+    }
+
+    bool success = run_boot("cold", true);
+    for (int i = 0; success && (i < CONFIG_BOOT_BENCH_WARM_BOOTS); i++) {
+        char label[16];
+        snprintf(label, sizeof(label), "warm %d", i + 1);
+        success = run_boot(label, false);
+    }
+
+    // On the Linux target returning from app_main does not terminate the process
+    exit(success ? EXIT_SUCCESS : EXIT_FAILURE);
+}
+
+/************************************************
+ * Boot profiling hooks definition
+ ***********************************************/
+
+void astarte_boot_profile_begin(astarte_boot_phase_t phase)
+{
+    phase_begin(phase);
+}
+
+void astarte_boot_profile_end(astarte_boot_phase_t phase)
+{
+    phase_end(phase);
+    if (phase == ASTARTE_BOOT_PHASE_PROPERTIES_RESYNC) {
+        xEventGroupSetBits(boot_event_group, RESYNC_DONE_BIT);
+    }
+}
+
+/************************************************
+ * Static functions definition
+ ***********************************************/
+
+static bool run_boot(const char *label, bool cold)
+{
+    bool success = false;
+    astarte_device_handle_t device = NULL;
+    astarte_credentials_context_t credentials_context = { 0 };
+
+    if (cold) {
+        ESP_ERROR_CHECK(nvs_flash_erase());
+    }
+    ESP_ERROR_CHECK(nvs_flash_init());
+
+    memset(phase_records, 0, sizeof(phase_records));
+    session_present = 0;
+    xEventGroupClearBits(boot_event_group, CONNECTED_BIT | RESYNC_DONE_BIT);
+    int64_t boot_start_us = esp_timer_get_time();
+
+    phase_begin(BENCH_PHASE_CREDENTIALS_INIT);
+    astarte_err_t err = astarte_credentials_ctx_use_nvs_storage(&credentials_context,
+        ASTARTE_CREDENTIALS_DEFAULT_NVS_PARTITION, BENCH_CREDENTIALS_NAMESPACE);
+    if (err == ASTARTE_OK) {
+        err = astarte_credentials_ctx_init(&credentials_context);
+    }
+    phase_end(BENCH_PHASE_CREDENTIALS_INIT);
+    if (err != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Credentials initialization failed: %s", astarte_err_to_name(err));
+        goto exit;
+    }
+
+    astarte_device_config_t cfg = {
+        .connection_event_callback = connection_callback,
+        .hwid = BENCH_DEVICE_ID,
+        .credentials_context = &credentials_context,
+    };
+    device = astarte_device_init(&cfg);
+    if (!device) {
+        ESP_LOGE(TAG, "Device initialization failed");
+        goto exit;
+    }
+
+    astarte_device_add_interface(device, &device_properties_interface);
+    astarte_device_add_interface(device, &server_properties_interface);
+    astarte_device_add_interface(device, &device_datastream_interface);
+
+    if (astarte_device_start(device) != ASTARTE_OK) {
+        ESP_LOGE(TAG, "Device start failed");
+        goto exit;
+    }
+
+    const TickType_t timeout = pdMS_TO_TICKS(CONFIG_BOOT_BENCH_TIMEOUT_MS);
+    EventBits_t bits
+        = xEventGroupWaitBits(boot_event_group, CONNECTED_BIT, pdFALSE, pdTRUE, timeout);
+    if (!(bits & CONNECTED_BIT)) {
+        ESP_LOGE(TAG, "Timeout waiting for the MQTT connection");
+        goto exit;
+    }
+    // With a session present the device skips subscriptions, introspection and resync
+    if (!session_present) {
+        bits = xEventGroupWaitBits(boot_event_group, RESYNC_DONE_BIT, pdFALSE, pdTRUE, timeout);
+        if (!(bits & RESYNC_DONE_BIT)) {
+            ESP_LOGE(TAG, "Timeout waiting for the properties resync");
+            goto exit;
+        }
+    }
+    int64_t total_us = esp_timer_get_time() - boot_start_us;
+
+    // Give the next boots a device owned property to resync
+    astarte_device_set_integer_property(
+        device, device_properties_interface.name, "/boot/count", cold ? 1 : 2);
+
+    print_report(label, total_us);
+    success = true;
+
+exit:
+    if (device) {
+        astarte_device_stop(device);
+        astarte_device_destroy(device);
+    }
+    astarte_credentials_ctx_release(&credentials_context);
+    nvs_flash_deinit();
+
+    return success;
+}
+
+static void phase_begin(int phase)
+{
+    phase_record_t *record = &phase_records[phase];
+    record->ran = true;
+    record->heap_start = bench_heap_get_current();
+    bench_heap_reset_peak();
+    record->start_us = esp_timer_get_time();
+}
+
+static void phase_end(int phase)
+{
+    phase_record_t *record = &phase_records[phase];
+    record->duration_us = esp_timer_get_time() - record->start_us;
+    record->heap_peak = bench_heap_get_peak();
+}
+
+static const char *phase_name(int phase)
+{
+    if (phase == BENCH_PHASE_CREDENTIALS_INIT) {
+        return "credentials_init";
+    }
+    return astarte_boot_phase_to_name((astarte_boot_phase_t) phase);
+}
+
+static void print_report(const char *label, int64_t total_us)
+{
+    printf("\n%s boot%s\n", label, session_present ? " (session present)" : "");
+    printf("%-20s %12s %14s %14s\n", "phase", "time [us]", "heap peak [B]", "heap delta [B]");
+
+    // Credentials initialization first, it happens before any of the SDK phases
+    int order[BENCH_PHASE_COUNT];
+    order[0] = BENCH_PHASE_CREDENTIALS_INIT;
+    for (int i = 0; i < ASTARTE_BOOT_PHASE_COUNT; i++) {
+        order[i + 1] = i;
+    }
+
+    for (int i = 0; i < BENCH_PHASE_COUNT; i++) {
+        const phase_record_t *record = &phase_records[order[i]];
+        if (!record->ran) {
+            printf("%-20s %12s %14s %14s\n", phase_name(order[i]), "skipped", "-", "-");
+            continue;
+        }
+        printf("%-20s %12" PRId64 " %14zu %14zu\n", phase_name(order[i]), record->duration_us,
+            record->heap_peak, record->heap_peak - record->heap_start);
+    }
+    printf("%-20s %12" PRId64 "\n", "total", total_us);
+
+    // Allocations made directly by the SDK, ESP-IDF components excluded
+    astarte_allocator_stats_t stats;
+    if (astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, &stats) == ASTARTE_OK) {
+        printf("%-20s %14s %14s %14s\n", "sdk subsystem", "current [B]", "peak [B]", "allocations");
+        for (int i = 0; i < ASTARTE_ALLOC_SUBSYSTEM_COUNT; i++) {
+            astarte_allocator_get_stats((astarte_alloc_subsystem_t) i, &stats);
+            printf("%-20s %14zu %14zu %14" PRIu32 "\n",
+                astarte_alloc_subsystem_to_name((astarte_alloc_subsystem_t) i), stats.current_bytes,
+                stats.peak_bytes, stats.total_allocations);
+        }
+    }
+}
+
+static void connection_callback(astarte_device_connection_event_t *event)
+{
+    session_present = event->session_present;
+    xEventGroupSetBits(boot_event_group, CONNECTED_BIT);
+}
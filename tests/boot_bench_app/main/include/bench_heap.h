@@ -0,0 +1,46 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#ifndef BENCH_HEAP_H
+#define BENCH_HEAP_H
+
+#include <stddef.h>
+
+/**
+ * @brief Get the number of heap bytes currently allocated by the process.
+ *
+ * @return The allocated bytes, as reported by malloc_usable_size().
+ */
+size_t bench_heap_get_current(void);
+
+/**
+ * @brief Get the highest number of heap bytes allocated since the last reset.
+ *
+ * @return The high-water mark of the allocated bytes.
+ */
+size_t bench_heap_get_peak(void);
+
+/**
+ * @brief Reset the high-water mark to the number of bytes currently allocated.
+ */
+void bench_heap_reset_peak(void);
+
+#endif /* BENCH_HEAP_H */
@@ -0,0 +1,155 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+/**
+ * @file bench_heap.c
+ * @brief Heap usage tracking for the Linux target.
+ *
+ * @details The standard allocation functions are overridden to account for every allocation of the
+ * process, including the ones performed by the SDK, mbedtls and the FreeRTOS port. The real
+ * allocations are delegated to the glibc internal entry points.
+ */
+
+#include "bench_heap.h"
+
+#include <errno.h>
+#include <malloc.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+/************************************************
+ * Constants/Defines
+ ***********************************************/
+
+extern void *__libc_malloc(size_t size);
+extern void *__libc_calloc(size_t nmemb, size_t size);
+extern void *__libc_realloc(void *ptr, size_t size);
+extern void *__libc_memalign(size_t alignment, size_t size);
+extern void __libc_free(void *ptr);
+
+static size_t heap_current;
+static size_t heap_peak;
+
+/************************************************
+ * Static functions declaration
+ ***********************************************/
+
+static void *account_allocation(void *ptr);
+static void account_free(void *ptr);
+
+/************************************************
+ * Global functions definition
+ ***********************************************/
+
+size_t bench_heap_get_current(void)
+{
+    return __atomic_load_n(&heap_current, __ATOMIC_RELAXED);
+}
+
+size_t bench_heap_get_peak(void)
+{
+    return __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+}
+
+void bench_heap_reset_peak(void)
+{
+    __atomic_store_n(&heap_peak, bench_heap_get_current(), __ATOMIC_RELAXED);
+}
+
+void *malloc(size_t size)
+{
+    return account_allocation(__libc_malloc(size));
+}
+
+void *calloc(size_t nmemb, size_t size)
+{
+    return account_allocation(__libc_calloc(nmemb, size));
+}
+
+void *realloc(void *ptr, size_t size)
+{
+    // On failure the old block is left untouched and stays accounted
+    size_t old_size = ptr ? malloc_usable_size(ptr) : 0;
+    void *new_ptr = __libc_realloc(ptr, size);
+    if (!new_ptr && (size > 0)) {
+        return NULL;
+    }
+    __atomic_sub_fetch(&heap_current, old_size, __ATOMIC_RELAXED);
+    return account_allocation(new_ptr);
+}
+
+void *memalign(size_t alignment, size_t size)
+{
+    return account_allocation(__libc_memalign(alignment, size));
+}
+
+void *aligned_alloc(size_t alignment, size_t size)
+{
+    return account_allocation(__libc_memalign(alignment, size));
+}
+
+int posix_memalign(void **memptr, size_t alignment, size_t size)
+{
+    if ((alignment < sizeof(void *)) || (alignment & (alignment - 1))) {
+        return EINVAL;
+    }
+    void *ptr = account_allocation(__libc_memalign(alignment, size));
+    if (!ptr) {
+        return ENOMEM;
+    }
+    *memptr = ptr;
+    return 0;
+}
+
+void free(void *ptr)
+{
+    account_free(ptr);
+    __libc_free(ptr);
+}
+
+/************************************************
+ * Static functions definition
+ ***********************************************/
+
+static void *account_allocation(void *ptr)
+{
+    if (!ptr) {
+        return NULL;
+    }
+
+    size_t current
+        = __atomic_add_fetch(&heap_current, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    size_t peak = __atomic_load_n(&heap_peak, __ATOMIC_RELAXED);
+    while ((current > peak)
+        && !__atomic_compare_exchange_n(
+            &heap_peak, &peak, current, true, __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+        // peak has been reloaded by the failed exchange
+    }
+    return ptr;
+}
+
+static void account_free(void *ptr)
+{
+    if (ptr) {
+        __atomic_sub_fetch(&heap_current, malloc_usable_size(ptr), __ATOMIC_RELAXED);
+    }
+}
@@ -0,0 +1,136 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_alloc.h"
+#include "test_astarte_allocator.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+typedef struct
+{
+    uint32_t mallocs[ASTARTE_ALLOC_SUBSYSTEM_COUNT];
+    uint32_t frees;
+} counting_allocator_t;
+
+static void *counting_malloc(size_t size, astarte_alloc_subsystem_t subsystem, void *user_data)
+{
+    counting_allocator_t *counters = (counting_allocator_t *) user_data;
+    counters->mallocs[subsystem]++;
+    return malloc(size);
+}
+
+static void counting_free(void *ptr, void *user_data)
+{
+    counting_allocator_t *counters = (counting_allocator_t *) user_data;
+    counters->frees++;
+    free(ptr);
+}
+
+void test_astarte_allocator_accounting(void)
+{
+    astarte_allocator_stats_t before;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, &before));
+
+    void *first = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, 100);
+    void *second = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, 10, 5);
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+
+    astarte_allocator_stats_t stats;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, &stats));
+    TEST_ASSERT_EQUAL(before.current_bytes + 150, stats.current_bytes);
+    TEST_ASSERT_EQUAL(before.current_allocations + 2, stats.current_allocations);
+    TEST_ASSERT_EQUAL(before.total_allocations + 2, stats.total_allocations);
+    TEST_ASSERT_GREATER_OR_EQUAL(before.current_bytes + 150, stats.peak_bytes);
+
+    astarte_alloc_free(first);
+    astarte_alloc_free(second);
+    astarte_alloc_free(NULL);
+
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_STORAGE, &stats));
+    TEST_ASSERT_EQUAL(before.current_bytes, stats.current_bytes);
+    TEST_ASSERT_EQUAL(before.current_allocations, stats.current_allocations);
+    TEST_ASSERT_EQUAL(before.total_allocations + 2, stats.total_allocations);
+    TEST_ASSERT_GREATER_OR_EQUAL(before.current_bytes + 150, stats.peak_bytes);
+
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND,
+        astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_COUNT, &stats));
+}
+
+void test_astarte_allocator_calloc_overflow(void)
+{
+    TEST_ASSERT_NULL(astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, SIZE_MAX / 2, 4));
+    TEST_ASSERT_NULL(astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, SIZE_MAX));
+
+    uint8_t *zeroed = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 16, sizeof(uint8_t));
+    TEST_ASSERT_NOT_NULL(zeroed);
+    uint8_t expected[16] = { 0 };
+    TEST_ASSERT_EQUAL_UINT8_ARRAY(expected, zeroed, sizeof(expected));
+    astarte_alloc_free(zeroed);
+}
+
+void test_astarte_allocator_strdup(void)
+{
+    char *copy = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_PAIRING, "astarte");
+    TEST_ASSERT_NOT_NULL(copy);
+    TEST_ASSERT_EQUAL_STRING("astarte", copy);
+    astarte_alloc_free(copy);
+}
+
+void test_astarte_allocator_custom(void)
+{
+    counting_allocator_t counters;
+    memset(&counters, 0, sizeof(counters));
+    astarte_allocator_t allocator = {
+        .malloc_fn = counting_malloc,
+        .free_fn = counting_free,
+        .user_data = &counters,
+    };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_allocator_set(&allocator));
+
+    void *bson = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_BSON, 32);
+    char *label = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS, "label");
+    astarte_alloc_free(bson);
+    astarte_alloc_free(label);
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_allocator_set(NULL));
+
+    TEST_ASSERT_EQUAL_UINT32(1, counters.mallocs[ASTARTE_ALLOC_SUBSYSTEM_BSON]);
+    TEST_ASSERT_EQUAL_UINT32(1, counters.mallocs[ASTARTE_ALLOC_SUBSYSTEM_CREDENTIALS]);
+    TEST_ASSERT_EQUAL_UINT32(0, counters.mallocs[ASTARTE_ALLOC_SUBSYSTEM_DEVICE]);
+    TEST_ASSERT_EQUAL_UINT32(2, counters.frees);
+}
+
+void test_astarte_allocator_set_with_live_allocations(void)
+{
+    void *live = astarte_alloc_malloc(ASTARTE_ALLOC_SUBSYSTEM_DEVICE, 8);
+    TEST_ASSERT_NOT_NULL(live);
+    TEST_ASSERT_EQUAL(ASTARTE_ERR, astarte_allocator_set(NULL));
+    astarte_alloc_free(live);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_allocator_set(NULL));
+}
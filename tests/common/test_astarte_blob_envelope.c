@@ -0,0 +1,71 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+
+#include "unity.h"
+
+#include <string.h>
+
+#include "astarte_blob_envelope.h"
+#include "astarte_bson_serializer.h"
+#include "test_astarte_blob_envelope.h"
+
+static void check_envelope(bool has_timestamp)
+{
+    const uint8_t blob[] = { 0xde, 0xad, 0x00, 0xbe, 0xef };
+    const uint64_t ts_epoch_millis = 1700000000123ULL;
+
+    astarte_bson_serializer_handle_t bson = astarte_bson_serializer_new();
+    astarte_bson_serializer_append_binary(bson, "v", blob, sizeof(blob));
+    if (has_timestamp) {
+        astarte_bson_serializer_append_datetime(bson, "t", ts_epoch_millis);
+    }
+    astarte_bson_serializer_append_end_of_document(bson);
+    int expected_len = 0;
+    const void *expected = astarte_bson_serializer_get_document(bson, &expected_len);
+
+    uint8_t buffer[ASTARTE_BLOB_HEADROOM + sizeof(blob) + ASTARTE_BLOB_TAILROOM];
+    memset(buffer, 0xaa, sizeof(buffer));
+    memcpy(&buffer[ASTARTE_BLOB_HEADROOM], blob, sizeof(blob));
+    size_t len = astarte_blob_envelope_wrap(buffer, sizeof(blob), has_timestamp, ts_epoch_millis);
+
+    TEST_ASSERT_EQUAL(expected_len, len);
+    TEST_ASSERT_EQUAL_MEMORY(expected, buffer, len);
+    astarte_bson_serializer_destroy(bson);
+}
+
+void test_astarte_blob_envelope_matches_serializer(void)
+{
+    check_envelope(false);
+    check_envelope(true);
+}
+
+void test_astarte_blob_envelope_empty_blob(void)
+{
+    uint8_t buffer[ASTARTE_BLOB_HEADROOM + ASTARTE_BLOB_TAILROOM];
+    size_t len = astarte_blob_envelope_wrap(buffer, 0, false, 0);
+    TEST_ASSERT_EQUAL(ASTARTE_BLOB_HEADROOM + 1, len);
+    TEST_ASSERT_EQUAL_HEX8(ASTARTE_BLOB_HEADROOM + 1, buffer[0]);
+    TEST_ASSERT_EQUAL_HEX8(0, buffer[ASTARTE_BLOB_HEADROOM]);
+    // The full tailroom is used when the timestamp is appended
+    len = astarte_blob_envelope_wrap(buffer, 0, true, 1);
+    TEST_ASSERT_EQUAL(ASTARTE_BLOB_HEADROOM + ASTARTE_BLOB_TAILROOM, len);
+}
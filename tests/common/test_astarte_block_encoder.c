@@ -0,0 +1,104 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include <string.h>
+
+#include "astarte_block_encoder.h"
+#include "test_astarte_block_encoder.h"
+
+void test_astarte_block_encoder_double(void)
+{
+    uint8_t buffer[64];
+    astarte_block_encoder_t encoder;
+    astarte_block_encoder_init(&encoder, ASTARTE_BLOCK_TYPE_DOUBLE, buffer, sizeof(buffer));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_double(&encoder, 1000, 1.0));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_double(&encoder, 1010, 1.0));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_double(&encoder, 1020, 1.0));
+    TEST_ASSERT_EQUAL(3, astarte_block_encoder_count(&encoder));
+
+    // 1.0 in 64 bits, then '10' with a delta of delta of 10 and '0' for the same value, then '0'
+    // for the same delta and '0' for the same value
+    const uint8_t expected[] = { 0x01, 0x00, 0x03, 0x00, 0xE8, 0x03, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x3F, 0xF0, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x85, 0x00 };
+    size_t length = 0;
+    const uint8_t *block = astarte_block_encoder_finish(&encoder, &length);
+    TEST_ASSERT_EQUAL(sizeof(expected), length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, block, sizeof(expected));
+}
+
+void test_astarte_block_encoder_longinteger(void)
+{
+    uint8_t buffer[64];
+    astarte_block_encoder_t encoder;
+    astarte_block_encoder_init(&encoder, ASTARTE_BLOCK_TYPE_LONGINTEGER, buffer, sizeof(buffer));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_longinteger(&encoder, 7, 5));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_longinteger(&encoder, 8, 3));
+
+    // Zig-zag 5, then '10' with a delta of delta of 1 and zig-zag -2
+    const uint8_t expected[] = { 0x01, 0x01, 0x02, 0x00, 0x07, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,
+        0x00, 0x0A, 0x80, 0x81, 0x80 };
+    size_t length = 0;
+    const uint8_t *block = astarte_block_encoder_finish(&encoder, &length);
+    TEST_ASSERT_EQUAL(sizeof(expected), length);
+    TEST_ASSERT_EQUAL_MEMORY(expected, block, sizeof(expected));
+
+    astarte_block_encoder_reset(&encoder);
+    TEST_ASSERT_EQUAL(0, astarte_block_encoder_count(&encoder));
+    astarte_block_encoder_finish(&encoder, &length);
+    TEST_ASSERT_EQUAL(ASTARTE_BLOCK_HEADER_SIZE, length);
+}
+
+void test_astarte_block_encoder_full(void)
+{
+    uint8_t buffer[ASTARTE_BLOCK_MIN_SIZE];
+    astarte_block_encoder_t encoder;
+    astarte_block_encoder_init(&encoder, ASTARTE_BLOCK_TYPE_DOUBLE, buffer, sizeof(buffer));
+
+    uint8_t previous[ASTARTE_BLOCK_MIN_SIZE];
+    size_t previous_length = 0;
+    int64_t timestamp = 0;
+    double value = 1.0;
+    while (1) {
+        const uint8_t *block = astarte_block_encoder_finish(&encoder, &previous_length);
+        memcpy(previous, block, previous_length);
+        timestamp += 3 * timestamp + 1;
+        value = value * -3.7 + 0.1;
+        if (astarte_block_encoder_add_double(&encoder, timestamp, value) != ASTARTE_OK) {
+            break;
+        }
+    }
+    TEST_ASSERT_GREATER_THAN(0, astarte_block_encoder_count(&encoder));
+
+    // The sample that did not fit left the block untouched
+    size_t length = 0;
+    const uint8_t *block = astarte_block_encoder_finish(&encoder, &length);
+    TEST_ASSERT_EQUAL(previous_length, length);
+    TEST_ASSERT_EQUAL_MEMORY(previous, block, length);
+    TEST_ASSERT_EACH_EQUAL_UINT8(0, block + length, sizeof(buffer) - length);
+
+    // Any sample fits an empty block
+    astarte_block_encoder_reset(&encoder);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_block_encoder_add_double(&encoder, timestamp, value));
+}
@@ -0,0 +1,93 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_burst_buffer.h"
+#include "test_astarte_burst_buffer.h"
+
+void test_astarte_burst_buffer_thresholds(void)
+{
+    astarte_burst_buffer_t buffer;
+    astarte_burst_buffer_init(&buffer, 32, 1000);
+
+    TEST_ASSERT_EQUAL(-1, astarte_burst_buffer_wait_us(&buffer, 0));
+    TEST_ASSERT_FALSE(astarte_burst_buffer_due(&buffer, 5000));
+
+    // The age is counted from the oldest held message
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_burst_buffer_push(&buffer, "a", "dev/a/x", "1234", 4, 0, 100));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_burst_buffer_push(&buffer, "a", "dev/a/x", "1234", 4, 0, 600));
+    TEST_ASSERT_EQUAL(2, astarte_burst_buffer_count(&buffer));
+    TEST_ASSERT_EQUAL(22, astarte_burst_buffer_bytes(&buffer));
+    TEST_ASSERT_EQUAL(400, astarte_burst_buffer_wait_us(&buffer, 700));
+    TEST_ASSERT_FALSE(astarte_burst_buffer_due(&buffer, 1099));
+    TEST_ASSERT_TRUE(astarte_burst_buffer_due(&buffer, 1100));
+
+    // Reaching the size makes the burst due right away
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_burst_buffer_push(&buffer, "a", "dev/a/y", "1234", 4, 0, 700));
+    TEST_ASSERT_EQUAL(33, astarte_burst_buffer_bytes(&buffer));
+    TEST_ASSERT_TRUE(astarte_burst_buffer_due(&buffer, 700));
+
+    astarte_burst_buffer_destroy(&buffer);
+    TEST_ASSERT_EQUAL(0, astarte_burst_buffer_count(&buffer));
+    TEST_ASSERT_EQUAL(0, astarte_burst_buffer_bytes(&buffer));
+}
+
+void test_astarte_burst_buffer_take_all(void)
+{
+    astarte_burst_buffer_t buffer;
+    astarte_burst_buffer_init(&buffer, 1024, 1000);
+
+    TEST_ASSERT_NULL(astarte_burst_buffer_take_all(&buffer));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_burst_buffer_push(&buffer, "a", "dev/a/x", "1", 1, 0, 0));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_burst_buffer_push(&buffer, "b", "dev/b/y", "22", 2, 1, 10));
+
+    // Messages are detached oldest first
+    astarte_burst_msg_t *msg = astarte_burst_buffer_take_all(&buffer);
+    TEST_ASSERT_EQUAL(0, astarte_burst_buffer_count(&buffer));
+    TEST_ASSERT_EQUAL(-1, astarte_burst_buffer_wait_us(&buffer, 10));
+    TEST_ASSERT_NOT_NULL(msg);
+    TEST_ASSERT_EQUAL_STRING("a", msg->interface_name);
+    TEST_ASSERT_EQUAL_STRING("dev/a/x", msg->topic);
+    TEST_ASSERT_EQUAL(1, msg->length);
+    TEST_ASSERT_EQUAL_MEMORY("1", msg->data, 1);
+    TEST_ASSERT_EQUAL(0, msg->qos);
+    astarte_burst_msg_t *next = msg->next;
+    astarte_burst_buffer_msg_free(msg);
+
+    TEST_ASSERT_NOT_NULL(next);
+    TEST_ASSERT_EQUAL_STRING("b", next->interface_name);
+    TEST_ASSERT_EQUAL_STRING("dev/b/y", next->topic);
+    TEST_ASSERT_EQUAL_MEMORY("22", next->data, 2);
+    TEST_ASSERT_EQUAL(1, next->qos);
+    TEST_ASSERT_NULL(next->next);
+    astarte_burst_buffer_msg_free(next);
+
+    // The age of the next burst starts from its first message
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_burst_buffer_push(&buffer, "a", "dev/a/x", "1", 1, 0, 50));
+    TEST_ASSERT_EQUAL(1000, astarte_burst_buffer_wait_us(&buffer, 50));
+    astarte_burst_buffer_destroy(&buffer);
+}
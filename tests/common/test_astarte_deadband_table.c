@@ -0,0 +1,143 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_deadband_table.h"
+#include "test_astarte_deadband_table.h"
+
+void test_astarte_deadband_thresholds(void)
+{
+    astarte_deadband_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_init(&table, 4));
+
+    const astarte_deadband_config_t absolute = { .absolute = 0.5 };
+    const astarte_deadband_config_t relative = { .relative = 0.1 };
+    const astarte_deadband_config_t any_change = { 0 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/abs", &absolute));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/rel", &relative));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/any", &any_change));
+
+    astarte_deadband_filter_t *filter = astarte_deadband_table_find(&table, "a", "/abs");
+    TEST_ASSERT_NOT_NULL(filter);
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, 10.0, 0));
+    astarte_deadband_filter_commit(filter, 10.0, 0);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 10.4, 0));
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 9.6, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, 10.6, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, 9.4, 0));
+
+    filter = astarte_deadband_table_find(&table, "a", "/rel");
+    TEST_ASSERT_NOT_NULL(filter);
+    astarte_deadband_filter_commit(filter, -200.0, 0);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, -219.0, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, -221.0, 0));
+
+    filter = astarte_deadband_table_find(&table, "a", "/any");
+    TEST_ASSERT_NOT_NULL(filter);
+    astarte_deadband_filter_commit(filter, 1.0, 0);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 1.0, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, 0.0, 0));
+
+    astarte_deadband_table_destroy(&table);
+}
+
+void test_astarte_deadband_heartbeat(void)
+{
+    astarte_deadband_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_init(&table, 1));
+
+    const astarte_deadband_config_t config = { .absolute = 100.0, .heartbeat_s = 10 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/v", &config));
+    astarte_deadband_filter_t *filter = astarte_deadband_table_find(&table, "a", "/v");
+    TEST_ASSERT_NOT_NULL(filter);
+
+    astarte_deadband_filter_commit(filter, 1.0, 1000000);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 1.0, 10999999));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes(filter, 1.0, 11000000));
+
+    // Updating the thresholds keeps the last published value
+    const astarte_deadband_config_t no_heartbeat = { .absolute = 100.0 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/v", &no_heartbeat));
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 1.0, 100000000));
+
+    astarte_deadband_table_destroy(&table);
+}
+
+void test_astarte_deadband_integers(void)
+{
+    astarte_deadband_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_init(&table, 2));
+
+    const astarte_deadband_config_t any_change = { 0 };
+    const astarte_deadband_config_t absolute = { .absolute = 2.5 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/any", &any_change));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/abs", &absolute));
+
+    // Above 2^53 neighbouring integers are the same double
+    const int64_t big = INT64_C(9007199254740993);
+    astarte_deadband_filter_t *filter = astarte_deadband_table_find(&table, "a", "/any");
+    TEST_ASSERT_NOT_NULL(filter);
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, big, 0));
+    astarte_deadband_filter_commit_integer(filter, big, 0);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes_integer(filter, big, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, big + 1, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, big - 1, 0));
+
+    // The distance between the extremes does not overflow
+    astarte_deadband_filter_commit_integer(filter, INT64_MIN, 0);
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, INT64_MAX, 0));
+
+    filter = astarte_deadband_table_find(&table, "a", "/abs");
+    TEST_ASSERT_NOT_NULL(filter);
+    astarte_deadband_filter_commit_integer(filter, big, 0);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes_integer(filter, big + 2, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, big + 3, 0));
+    TEST_ASSERT_TRUE(astarte_deadband_filter_passes_integer(filter, big - 3, 0));
+
+    astarte_deadband_table_destroy(&table);
+}
+
+void test_astarte_deadband_table(void)
+{
+    astarte_deadband_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_init(&table, 2));
+
+    const astarte_deadband_config_t config = { .absolute = 1.0 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/x", &config));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "b", "/x", &config));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR, astarte_deadband_table_set(&table, "a", "/y", &config));
+    TEST_ASSERT_NULL(astarte_deadband_table_find(&table, "a", "/y"));
+    TEST_ASSERT_NULL(astarte_deadband_table_find(&table, "ax", ""));
+
+    astarte_deadband_filter_commit(astarte_deadband_table_find(&table, "b", "/x"), 5.0, 0);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/x", NULL));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_deadband_table_set(&table, "a", "/x", NULL));
+    TEST_ASSERT_NULL(astarte_deadband_table_find(&table, "a", "/x"));
+
+    // The remaining filter has been moved and kept its state
+    astarte_deadband_filter_t *filter = astarte_deadband_table_find(&table, "b", "/x");
+    TEST_ASSERT_NOT_NULL(filter);
+    TEST_ASSERT_FALSE(astarte_deadband_filter_passes(filter, 5.5, 0));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_deadband_table_set(&table, "a", "/y", &config));
+
+    astarte_deadband_table_destroy(&table);
+}
@@ -0,0 +1,91 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_device_stats.h"
+#include "test_astarte_device_stats.h"
+
+#include <string.h>
+
+void test_astarte_device_stats_histogram_buckets(void)
+{
+    astarte_latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    astarte_latency_histogram_record(&histogram, 0);
+    astarte_latency_histogram_record(&histogram, 1);
+    astarte_latency_histogram_record(&histogram, 2);
+    astarte_latency_histogram_record(&histogram, 3);
+    astarte_latency_histogram_record(&histogram, 1000);
+
+    TEST_ASSERT_EQUAL_UINT32(5, histogram.count);
+    TEST_ASSERT_EQUAL_UINT64(1006, histogram.total_us);
+    TEST_ASSERT_EQUAL_UINT32(1000, histogram.max_us);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[1]);
+    TEST_ASSERT_EQUAL_UINT32(2, histogram.buckets[2]);
+    // 1000us falls in [512, 1024)
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[10]);
+}
+
+void test_astarte_device_stats_histogram_clamp(void)
+{
+    astarte_latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    astarte_latency_histogram_record(&histogram, -5);
+    astarte_latency_histogram_record(&histogram, INT64_MAX);
+
+    TEST_ASSERT_EQUAL_UINT32(2, histogram.count);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[0]);
+    TEST_ASSERT_EQUAL_UINT32(1, histogram.buckets[ASTARTE_LATENCY_HISTOGRAM_BUCKETS - 1]);
+    TEST_ASSERT_EQUAL_UINT32(UINT32_MAX, histogram.max_us);
+}
+
+void test_astarte_device_stats_histogram_percentile(void)
+{
+    astarte_latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    for (int i = 0; i < 95; i++) {
+        astarte_latency_histogram_record(&histogram, 100);
+    }
+    for (int i = 0; i < 5; i++) {
+        astarte_latency_histogram_record(&histogram, 5000);
+    }
+
+    // 100us falls in [64, 128), 5000us in [4096, 8192)
+    TEST_ASSERT_EQUAL_UINT32(127, astarte_latency_histogram_percentile(&histogram, 50));
+    TEST_ASSERT_EQUAL_UINT32(127, astarte_latency_histogram_percentile(&histogram, 95));
+    // Capped to the longest sample
+    TEST_ASSERT_EQUAL_UINT32(5000, astarte_latency_histogram_percentile(&histogram, 99));
+    TEST_ASSERT_EQUAL_UINT32(5000, astarte_latency_histogram_percentile(&histogram, 200));
+    TEST_ASSERT_EQUAL_UINT32(127, astarte_latency_histogram_percentile(&histogram, 0));
+}
+
+void test_astarte_device_stats_histogram_empty(void)
+{
+    astarte_latency_histogram_t histogram;
+    memset(&histogram, 0, sizeof(histogram));
+
+    TEST_ASSERT_EQUAL_UINT32(0, astarte_latency_histogram_percentile(&histogram, 95));
+}
@@ -0,0 +1,105 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+
+#include "unity.h"
+
+#include "astarte_inflight_table.h"
+#include "test_astarte_inflight_table.h"
+
+static astarte_publish_token_t insert(
+    astarte_inflight_table_t *table, const char *endpoint, bool windowed)
+{
+    astarte_inflight_entry_t entry;
+    if (astarte_inflight_entry_prepare(&entry, endpoint) != ASTARTE_OK) {
+        return ASTARTE_PUBLISH_TOKEN_NONE;
+    }
+    entry.windowed = windowed;
+    if (astarte_inflight_table_insert(table, &entry) != ASTARTE_OK) {
+        astarte_inflight_entry_free(&entry);
+        return ASTARTE_PUBLISH_TOKEN_NONE;
+    }
+    return entry.token;
+}
+
+void test_astarte_inflight_table_acks(void)
+{
+    astarte_inflight_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_inflight_table_init(&table, 2));
+
+    astarte_inflight_entry_t entry;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_ERR_INVALID_INTERFACE_PATH, astarte_inflight_entry_prepare(&entry, "a"));
+
+    astarte_publish_token_t first = insert(&table, "a/x/y", true);
+    astarte_publish_token_t second = insert(&table, "b/z", false);
+    TEST_ASSERT_NOT_EQUAL(ASTARTE_PUBLISH_TOKEN_NONE, first);
+    TEST_ASSERT_NOT_EQUAL(first, second);
+    TEST_ASSERT_EQUAL(ASTARTE_PUBLISH_TOKEN_NONE, insert(&table, "c/w", true));
+
+    // Entries without a message id are never acknowledged
+    TEST_ASSERT_FALSE(astarte_inflight_table_take_acked(&table, -1, 0, &entry));
+    astarte_inflight_table_assign(&table, first, 7, 1);
+    TEST_ASSERT_FALSE(astarte_inflight_table_take_acked(&table, 7, 2, &entry));
+    TEST_ASSERT_TRUE(astarte_inflight_table_take_acked(&table, 7, 1, &entry));
+    TEST_ASSERT_EQUAL(first, entry.token);
+    TEST_ASSERT_EQUAL_STRING("a", entry.interface_name);
+    TEST_ASSERT_EQUAL_STRING("/x/y", entry.path);
+    astarte_inflight_entry_free(&entry);
+    TEST_ASSERT_FALSE(astarte_inflight_table_take_acked(&table, 7, 1, &entry));
+
+    // A failed publish releases its entry through the token
+    TEST_ASSERT_TRUE(astarte_inflight_table_take(&table, second, &entry));
+    TEST_ASSERT_EQUAL_STRING("b", entry.interface_name);
+    astarte_inflight_entry_free(&entry);
+    TEST_ASSERT_FALSE(astarte_inflight_table_take(&table, second, &entry));
+
+    astarte_inflight_table_destroy(&table);
+}
+
+void test_astarte_inflight_table_count_and_stale(void)
+{
+    astarte_inflight_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_inflight_table_init(&table, 4));
+
+    astarte_publish_token_t old = insert(&table, "a/x", true);
+    astarte_publish_token_t current = insert(&table, "a/y", true);
+    insert(&table, "b/x", true);
+    insert(&table, "a/z", false);
+
+    // Only the windowed entries are counted
+    TEST_ASSERT_EQUAL(3, astarte_inflight_table_count(&table, NULL));
+    TEST_ASSERT_EQUAL(2, astarte_inflight_table_count(&table, "a"));
+    TEST_ASSERT_EQUAL(1, astarte_inflight_table_count(&table, "b"));
+    TEST_ASSERT_EQUAL(0, astarte_inflight_table_count(&table, "c"));
+
+    // Entries accepted by a previous MQTT client are stale, pending ones are not
+    astarte_inflight_table_assign(&table, old, 1, 1);
+    astarte_inflight_table_assign(&table, current, 1, 2);
+    astarte_inflight_entry_t entry;
+    TEST_ASSERT_TRUE(astarte_inflight_table_take_stale(&table, 2, &entry));
+    TEST_ASSERT_EQUAL(old, entry.token);
+    astarte_inflight_entry_free(&entry);
+    TEST_ASSERT_FALSE(astarte_inflight_table_take_stale(&table, 2, &entry));
+    TEST_ASSERT_EQUAL(1, astarte_inflight_table_count(&table, "a"));
+
+    astarte_inflight_table_destroy(&table);
+}
@@ -0,0 +1,165 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_json_extract.h"
+#include "test_astarte_json_extract.h"
+
+#include <string.h>
+
+static const char *const broker_url_path[]
+    = { "data", "protocols", "astarte_mqtt_v1", "broker_url" };
+static const char *const client_crt_path[] = { "data", "client_crt" };
+
+static const char device_info_response[] = "{\"data\": {"
+                                           "\"version\": \"1.1.1\", "
+                                           "\"status\": \"confirmed\", "
+                                           "\"protocols\": {\"astarte_mqtt_v1\": "
+                                           "{\"broker_url\": \"mqtts://broker.example.com:8883/\"}}"
+                                           "}}";
+
+void test_astarte_json_extract_nested_field(void)
+{
+    char out[64];
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, broker_url_path, 4, out, sizeof(out));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_json_extract_feed(
+            &extract, device_info_response, strlen(device_info_response)));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("mqtts://broker.example.com:8883/", out);
+}
+
+void test_astarte_json_extract_chunked(void)
+{
+    char out[64];
+    astarte_json_extract_t extract;
+
+    // One byte at a time, as the worst case of multiple data events
+    astarte_json_extract_init(&extract, broker_url_path, 4, out, sizeof(out));
+    for (size_t i = 0; i < strlen(device_info_response); i++) {
+        TEST_ASSERT_EQUAL(
+            ASTARTE_OK, astarte_json_extract_feed(&extract, device_info_response + i, 1));
+    }
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("mqtts://broker.example.com:8883/", out);
+
+    // Uneven chunks
+    astarte_json_extract_init(&extract, broker_url_path, 4, out, sizeof(out));
+    size_t len = strlen(device_info_response);
+    for (size_t i = 0; i < len; i += 7) {
+        size_t chunk_len = (len - i < 7) ? len - i : 7;
+        TEST_ASSERT_EQUAL(
+            ASTARTE_OK, astarte_json_extract_feed(&extract, device_info_response + i, chunk_len));
+    }
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("mqtts://broker.example.com:8883/", out);
+}
+
+void test_astarte_json_extract_escapes(void)
+{
+    const char response[] = "{\"data\":{\"client_crt\":"
+                            "\"-----BEGIN CERTIFICATE-----\\nMIIB\\/\\\"\\u0041\\u00e8\\n\"}}";
+    char out[64];
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_feed(&extract, response, strlen(response)));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("-----BEGIN CERTIFICATE-----\nMIIB/\"A\xc3\xa8\n", out);
+
+    // Escaped characters in keys are compared after unescaping
+    const char escaped_key[] = "{\"d\\u0061ta\":{\"client_crt\":\"crt\"}}";
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_json_extract_feed(&extract, escaped_key, strlen(escaped_key)));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("crt", out);
+}
+
+void test_astarte_json_extract_ignores_other_paths(void)
+{
+    // The same key appears at other depths, inside arrays and with other types before the match
+    const char response[] = "{\"client_crt\":\"root\","
+                            "\"other\":{\"data\":{\"client_crt\":\"nested\"}},"
+                            "\"list\":[{\"data\":{\"client_crt\":\"array\"}}, 1, true, null],"
+                            "\"data\":{\"number\":-1.5e3,\"obj\":{\"client_crt\":\"deep\"},"
+                            "\"client_crtx\":\"prefix\",\"client_crt\":\"right\"}}";
+    char out[64];
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_feed(&extract, response, strlen(response)));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_finish(&extract));
+    TEST_ASSERT_EQUAL_STRING("right", out);
+}
+
+void test_astarte_json_extract_not_found(void)
+{
+    char out[64];
+    astarte_json_extract_t extract;
+
+    const char missing[] = "{\"errors\":{\"detail\":\"Forbidden\"}}";
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_json_extract_feed(&extract, missing, strlen(missing)));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_json_extract_finish(&extract));
+
+    const char wrong_type[] = "{\"data\":{\"client_crt\":42}}";
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_json_extract_feed(&extract, wrong_type, strlen(wrong_type)));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_json_extract_finish(&extract));
+}
+
+void test_astarte_json_extract_small_buffer(void)
+{
+    const char response[] = "{\"data\":{\"client_crt\":\"0123456789\"}}";
+    char out[10];
+    astarte_json_extract_t extract;
+    astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_INVALID_SIZE,
+        astarte_json_extract_feed(&extract, response, strlen(response)));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_json_extract_finish(&extract));
+}
+
+void test_astarte_json_extract_malformed(void)
+{
+    const char *const malformed[] = {
+        "{\"data\" {}}",
+        "{\"data\":[}",
+        "{\"data\":,}",
+        "{\"data\":{},}",
+        "{\"data\":\"\\x\"}",
+        "<html>",
+    };
+    char out[64];
+    astarte_json_extract_t extract;
+
+    for (size_t i = 0; i < sizeof(malformed) / sizeof(malformed[0]); i++) {
+        astarte_json_extract_init(&extract, client_crt_path, 2, out, sizeof(out));
+        TEST_ASSERT_EQUAL(
+            ASTARTE_ERR, astarte_json_extract_feed(&extract, malformed[i], strlen(malformed[i])));
+        TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_json_extract_finish(&extract));
+    }
+}
@@ -83,6 +83,8 @@ void test_astarte_linked_list_append_remove_tail(void)
 
     TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_linked_list_append(&handle, item_1));
     TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_linked_list_append(&handle, item_2));
+
+    astarte_linked_list_destroy(&handle);
 }
 
 void test_astarte_linked_list_destroy(void)
@@ -0,0 +1,59 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+
+#include "unity.h"
+
+#include "astarte_outbox_governor.h"
+#include "test_astarte_outbox_governor.h"
+
+void test_astarte_outbox_governor_hysteresis(void)
+{
+    astarte_outbox_governor_t governor;
+    astarte_outbox_governor_init(&governor, 1000, 400);
+    TEST_ASSERT_FALSE(astarte_outbox_governor_congested(&governor));
+
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_NONE, astarte_outbox_governor_update(&governor, 999));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OUTBOX_CROSSING_HIGH, astarte_outbox_governor_update(&governor, 1000));
+    TEST_ASSERT_TRUE(astarte_outbox_governor_congested(&governor));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OUTBOX_CROSSING_NONE, astarte_outbox_governor_update(&governor, 2000));
+
+    // Between the marks the state does not change in either direction
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_NONE, astarte_outbox_governor_update(&governor, 401));
+    TEST_ASSERT_TRUE(astarte_outbox_governor_congested(&governor));
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_LOW, astarte_outbox_governor_update(&governor, 400));
+    TEST_ASSERT_FALSE(astarte_outbox_governor_congested(&governor));
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_NONE, astarte_outbox_governor_update(&governor, 999));
+    TEST_ASSERT_FALSE(astarte_outbox_governor_congested(&governor));
+}
+
+void test_astarte_outbox_governor_low_above_high(void)
+{
+    astarte_outbox_governor_t governor;
+    astarte_outbox_governor_init(&governor, 500, 800);
+
+    // The low-water mark is capped, the outbox must drain below the high-water mark
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_HIGH, astarte_outbox_governor_update(&governor, 600));
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_NONE, astarte_outbox_governor_update(&governor, 501));
+    TEST_ASSERT_EQUAL(ASTARTE_OUTBOX_CROSSING_LOW, astarte_outbox_governor_update(&governor, 500));
+}
@@ -0,0 +1,90 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_property_coalescer.h"
+#include "test_astarte_property_coalescer.h"
+
+void test_astarte_property_coalescer_replace(void)
+{
+    astarte_property_coalescer_t coalescer;
+    astarte_property_coalescer_init(&coalescer, 4);
+
+    bool replaced = false;
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/x", "1", 1, 2, &replaced));
+    TEST_ASSERT_FALSE(replaced);
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/y", "2", 1, 2, &replaced));
+    TEST_ASSERT_FALSE(replaced);
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_EQUAL(ASTARTE_OK,
+            astarte_property_coalescer_put(&coalescer, "a", "dev/a/x", "33", 2, 2, &replaced));
+        TEST_ASSERT_TRUE(replaced);
+    }
+    // An unset replaces the pending value too
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/y", "", 0, 2, &replaced));
+    TEST_ASSERT_TRUE(replaced);
+    TEST_ASSERT_EQUAL(2, astarte_property_coalescer_count(&coalescer));
+
+    // Properties keep the order they first became pending in
+    const astarte_pending_property_t *property = astarte_property_coalescer_front(&coalescer);
+    TEST_ASSERT_NOT_NULL(property);
+    TEST_ASSERT_EQUAL_STRING("a", property->interface_name);
+    TEST_ASSERT_EQUAL_STRING("dev/a/x", property->topic);
+    TEST_ASSERT_EQUAL(2, property->length);
+    TEST_ASSERT_EQUAL_MEMORY("33", property->data, 2);
+    astarte_property_coalescer_remove_front(&coalescer);
+
+    property = astarte_property_coalescer_front(&coalescer);
+    TEST_ASSERT_NOT_NULL(property);
+    TEST_ASSERT_EQUAL_STRING("dev/a/y", property->topic);
+    TEST_ASSERT_EQUAL(0, property->length);
+    astarte_property_coalescer_remove_front(&coalescer);
+
+    TEST_ASSERT_NULL(astarte_property_coalescer_front(&coalescer));
+    TEST_ASSERT_EQUAL(0, astarte_property_coalescer_count(&coalescer));
+    astarte_property_coalescer_destroy(&coalescer);
+}
+
+void test_astarte_property_coalescer_full(void)
+{
+    astarte_property_coalescer_t coalescer;
+    astarte_property_coalescer_init(&coalescer, 2);
+
+    bool replaced = false;
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/x", "1", 1, 2, &replaced));
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/y", "1", 1, 2, &replaced));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_PUBLISH_QUEUE_FULL,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/z", "1", 1, 2, &replaced));
+    // Pending properties can still be updated
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_property_coalescer_put(&coalescer, "a", "dev/a/y", "2", 1, 2, &replaced));
+    TEST_ASSERT_TRUE(replaced);
+    TEST_ASSERT_EQUAL(2, astarte_property_coalescer_count(&coalescer));
+
+    astarte_property_coalescer_destroy(&coalescer);
+    TEST_ASSERT_EQUAL(0, astarte_property_coalescer_count(&coalescer));
+}
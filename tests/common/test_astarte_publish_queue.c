@@ -0,0 +1,163 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_publish_queue.h"
+#include "test_astarte_publish_queue.h"
+
+#include <string.h>
+
+#define TEST_LANE_CAPACITY 16
+
+static void init_queue(astarte_publish_queue_t *queue, bool weighted)
+{
+    const astarte_publish_lane_config_t config[ASTARTE_PUBLISH_LANE_COUNT] = {
+        [ASTARTE_PUBLISH_LANE_CONTROL] = { .capacity = TEST_LANE_CAPACITY, .weight = 0 },
+        [ASTARTE_PUBLISH_LANE_PROPERTIES] = { .capacity = TEST_LANE_CAPACITY, .weight = 4 },
+        [ASTARTE_PUBLISH_LANE_ALARM] = { .capacity = TEST_LANE_CAPACITY, .weight = 2 },
+        [ASTARTE_PUBLISH_LANE_BULK] = { .capacity = TEST_LANE_CAPACITY, .weight = 1 },
+    };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_publish_queue_init(queue, config, weighted));
+}
+
+static void push_lane(astarte_publish_queue_t *queue, astarte_publish_lane_t lane, int count)
+{
+    for (int i = 0; i < count; i++) {
+        uint8_t payload = (uint8_t) lane;
+        TEST_ASSERT_EQUAL(
+            ASTARTE_OK, astarte_publish_queue_push(queue, lane, "topic", &payload, 1, 0));
+    }
+}
+
+// Returns the lane of the popped message, ASTARTE_PUBLISH_LANE_COUNT if the queue is empty
+static astarte_publish_lane_t pop_lane(astarte_publish_queue_t *queue)
+{
+    astarte_publish_queue_msg_t *msg = NULL;
+    if (astarte_publish_queue_pop(queue, &msg) != ASTARTE_OK) {
+        return ASTARTE_PUBLISH_LANE_COUNT;
+    }
+    uint8_t lane = *(uint8_t *) msg->data;
+    astarte_publish_queue_msg_free(msg);
+    return (astarte_publish_lane_t) lane;
+}
+
+void test_astarte_publish_queue_copy(void)
+{
+    astarte_publish_queue_t queue;
+    init_queue(&queue, false);
+
+    char topic[] = "realm/device/interface/path";
+    uint8_t payload[] = { 0x01, 0x02, 0x03 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_publish_queue_push(
+            &queue, ASTARTE_PUBLISH_LANE_ALARM, topic, payload, sizeof(payload), 2));
+    // The queue holds its own copy
+    memset(topic, 0, sizeof(topic));
+    memset(payload, 0, sizeof(payload));
+    TEST_ASSERT_EQUAL(1, astarte_publish_queue_count(&queue, ASTARTE_PUBLISH_LANE_ALARM));
+
+    astarte_publish_queue_msg_t *msg = NULL;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_publish_queue_pop(&queue, &msg));
+    TEST_ASSERT_EQUAL_STRING("realm/device/interface/path", msg->topic);
+    const uint8_t expected[] = { 0x01, 0x02, 0x03 };
+    TEST_ASSERT_EQUAL(sizeof(expected), msg->length);
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, msg->data, sizeof(expected));
+    TEST_ASSERT_EQUAL(2, msg->qos);
+    astarte_publish_queue_msg_free(msg);
+
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_publish_queue_pop(&queue, &msg));
+    astarte_publish_queue_destroy(&queue);
+}
+
+void test_astarte_publish_queue_full(void)
+{
+    astarte_publish_queue_t queue;
+    init_queue(&queue, false);
+
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_BULK, TEST_LANE_CAPACITY);
+    uint8_t payload = ASTARTE_PUBLISH_LANE_BULK;
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_PUBLISH_QUEUE_FULL,
+        astarte_publish_queue_push(&queue, ASTARTE_PUBLISH_LANE_BULK, "topic", &payload, 1, 0));
+    // Other lanes are not affected
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_ALARM, 1);
+
+    // Popping frees a slot, the ring wraps around
+    TEST_ASSERT_EQUAL(ASTARTE_PUBLISH_LANE_ALARM, pop_lane(&queue));
+    TEST_ASSERT_EQUAL(ASTARTE_PUBLISH_LANE_BULK, pop_lane(&queue));
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_BULK, 1);
+    TEST_ASSERT_EQUAL(
+        TEST_LANE_CAPACITY, astarte_publish_queue_count(&queue, ASTARTE_PUBLISH_LANE_BULK));
+
+    // Destroy releases the queued messages
+    astarte_publish_queue_destroy(&queue);
+}
+
+void test_astarte_publish_queue_strict(void)
+{
+    astarte_publish_queue_t queue;
+    init_queue(&queue, false);
+
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_BULK, 3);
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_ALARM, 2);
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_PROPERTIES, 1);
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_CONTROL, 1);
+
+    const astarte_publish_lane_t expected[] = {
+        ASTARTE_PUBLISH_LANE_CONTROL,
+        ASTARTE_PUBLISH_LANE_PROPERTIES,
+        ASTARTE_PUBLISH_LANE_ALARM,
+        ASTARTE_PUBLISH_LANE_ALARM,
+        ASTARTE_PUBLISH_LANE_BULK,
+        ASTARTE_PUBLISH_LANE_BULK,
+        ASTARTE_PUBLISH_LANE_BULK,
+    };
+    for (size_t i = 0; i < sizeof(expected) / sizeof(expected[0]); i++) {
+        TEST_ASSERT_EQUAL(expected[i], pop_lane(&queue));
+    }
+
+    astarte_publish_queue_destroy(&queue);
+}
+
+void test_astarte_publish_queue_weighted(void)
+{
+    astarte_publish_queue_t queue;
+    init_queue(&queue, true);
+
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_BULK, TEST_LANE_CAPACITY);
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_ALARM, TEST_LANE_CAPACITY);
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_PROPERTIES, TEST_LANE_CAPACITY);
+
+    // A round of 7 messages follows the 4:2:1 weights
+    int served[ASTARTE_PUBLISH_LANE_COUNT] = { 0 };
+    for (int i = 0; i < 7; i++) {
+        served[pop_lane(&queue)]++;
+    }
+    TEST_ASSERT_EQUAL(4, served[ASTARTE_PUBLISH_LANE_PROPERTIES]);
+    TEST_ASSERT_EQUAL(2, served[ASTARTE_PUBLISH_LANE_ALARM]);
+    TEST_ASSERT_EQUAL(1, served[ASTARTE_PUBLISH_LANE_BULK]);
+
+    // Control messages still go first
+    push_lane(&queue, ASTARTE_PUBLISH_LANE_CONTROL, 1);
+    TEST_ASSERT_EQUAL(ASTARTE_PUBLISH_LANE_CONTROL, pop_lane(&queue));
+
+    astarte_publish_queue_destroy(&queue);
+}
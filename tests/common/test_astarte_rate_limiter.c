@@ -0,0 +1,184 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_rate_limiter.h"
+#include "test_astarte_rate_limiter.h"
+
+#include <string.h>
+
+#define TEST_BACKLOG_CAPACITY 4
+
+static void push(astarte_rate_limit_backlog_t *backlog, astarte_rate_limiter_t *limiter,
+    const char *topic, uint8_t value, bool replace, bool expect_replaced)
+{
+    bool replaced = !expect_replaced;
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_rate_limit_backlog_push(
+            backlog, limiter, "interface", topic, &value, 1, 0, replace, &replaced));
+    TEST_ASSERT_EQUAL(expect_replaced, replaced);
+}
+
+// Returns the payload of the popped message, 0 if no message can be sent
+static uint8_t pop(astarte_rate_limit_backlog_t *backlog, int64_t now_us)
+{
+    astarte_rate_limit_msg_t *msg = NULL;
+    if (astarte_rate_limit_backlog_pop(backlog, NULL, now_us, &msg) != ASTARTE_OK) {
+        return 0;
+    }
+    uint8_t value = *(uint8_t *) msg->data;
+    astarte_rate_limit_backlog_msg_free(msg);
+    return value;
+}
+
+void test_astarte_rate_limiter_messages(void)
+{
+    const astarte_rate_limit_config_t config = { .messages_per_s = 2, .messages_burst = 2 };
+    astarte_rate_limiter_t limiter;
+    astarte_rate_limiter_init(&limiter, &config, 0);
+
+    // The burst is available right away, then a message every 500ms
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 0));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 0));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 0));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 499999));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 500000));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 500000));
+
+    // A long idle time refills the bucket up to the burst only
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, INT64_MAX / 2));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, INT64_MAX / 2));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, INT64_MAX / 2));
+}
+
+void test_astarte_rate_limiter_bytes(void)
+{
+    const astarte_rate_limit_config_t config = { .bytes_per_s = 100, .bytes_burst = 100 };
+    astarte_rate_limiter_t limiter;
+    astarte_rate_limiter_init(&limiter, &config, 0);
+
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 60, 0));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 60, 0));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 60, 200000));
+
+    // Messages larger than the burst need a full bucket
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 500, 200000));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 500, 1200000));
+    TEST_ASSERT_FALSE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 1200000));
+}
+
+void test_astarte_rate_limiter_both_limits(void)
+{
+    const astarte_rate_limit_config_t interface_config = { .messages_per_s = 1 };
+    const astarte_rate_limit_config_t device_config = { .messages_per_s = 1, .messages_burst = 2 };
+    astarte_rate_limiter_t interface_limiter;
+    astarte_rate_limiter_t other_interface_limiter;
+    astarte_rate_limiter_t device_limiter;
+    astarte_rate_limiter_init(&interface_limiter, &interface_config, 0);
+    astarte_rate_limiter_init(&other_interface_limiter, &interface_config, 0);
+    astarte_rate_limiter_init(&device_limiter, &device_config, 0);
+
+    TEST_ASSERT_TRUE(
+        astarte_rate_limiter_try_acquire(&interface_limiter, &device_limiter, 1, 0));
+    // Exceeds the interface limits only
+    TEST_ASSERT_FALSE(
+        astarte_rate_limiter_try_acquire(&interface_limiter, &device_limiter, 1, 0));
+    TEST_ASSERT_TRUE(
+        astarte_rate_limiter_try_acquire(&other_interface_limiter, &device_limiter, 1, 0));
+
+    // Exceeds the device limits only, the interface tokens must not be taken
+    astarte_rate_limiter_init(&other_interface_limiter, &interface_config, 0);
+    TEST_ASSERT_FALSE(
+        astarte_rate_limiter_try_acquire(&other_interface_limiter, &device_limiter, 1, 0));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&other_interface_limiter, NULL, 1, 0));
+
+    // An empty configuration does not limit
+    const astarte_rate_limit_config_t no_limits = { 0 };
+    astarte_rate_limiter_init(&device_limiter, &no_limits, 0);
+    for (int i = 0; i < 100; i++) {
+        TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(NULL, &device_limiter, 1000, 0));
+    }
+}
+
+void test_astarte_rate_limit_backlog_order(void)
+{
+    const astarte_rate_limit_config_t config = { .messages_per_s = 1 };
+    astarte_rate_limiter_t limiter_a;
+    astarte_rate_limiter_t limiter_b;
+    astarte_rate_limiter_init(&limiter_a, &config, 0);
+    astarte_rate_limiter_init(&limiter_b, &config, 0);
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter_a, NULL, 1, 0));
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter_b, NULL, 1, 0));
+
+    astarte_rate_limit_backlog_t backlog;
+    astarte_rate_limit_backlog_init(&backlog, TEST_BACKLOG_CAPACITY);
+    TEST_ASSERT_EQUAL(-1, astarte_rate_limit_backlog_wait_us(&backlog, NULL, 0));
+
+    push(&backlog, &limiter_a, "a/x", 1, true, false);
+    push(&backlog, &limiter_a, "a/y", 2, true, false);
+    push(&backlog, &limiter_b, "b/x", 3, true, false);
+    // Latest value on the same path keeps the place of the old one
+    push(&backlog, &limiter_a, "a/x", 4, true, true);
+    TEST_ASSERT_EQUAL(3, astarte_rate_limit_backlog_count(&backlog));
+    TEST_ASSERT_EQUAL(1000000, astarte_rate_limit_backlog_wait_us(&backlog, NULL, 0));
+
+    TEST_ASSERT_EQUAL(0, pop(&backlog, 500000));
+    // One token each, "a/y" waits behind "a/x" while "b/x" is released
+    TEST_ASSERT_EQUAL(4, pop(&backlog, 1000000));
+    TEST_ASSERT_EQUAL(3, pop(&backlog, 1000000));
+    TEST_ASSERT_EQUAL(0, pop(&backlog, 1000000));
+    TEST_ASSERT_EQUAL(1000000, astarte_rate_limit_backlog_wait_us(&backlog, NULL, 1000000));
+    TEST_ASSERT_EQUAL(2, pop(&backlog, 2000000));
+    TEST_ASSERT_EQUAL(0, astarte_rate_limit_backlog_count(&backlog));
+
+    astarte_rate_limit_backlog_destroy(&backlog);
+}
+
+void test_astarte_rate_limit_backlog_full(void)
+{
+    const astarte_rate_limit_config_t config = { .messages_per_s = 1 };
+    astarte_rate_limiter_t limiter;
+    astarte_rate_limiter_init(&limiter, &config, 0);
+    TEST_ASSERT_TRUE(astarte_rate_limiter_try_acquire(&limiter, NULL, 1, 0));
+
+    astarte_rate_limit_backlog_t backlog;
+    astarte_rate_limit_backlog_init(&backlog, TEST_BACKLOG_CAPACITY);
+    for (uint8_t i = 1; i <= TEST_BACKLOG_CAPACITY; i++) {
+        push(&backlog, &limiter, "topic", i, false, false);
+    }
+
+    uint8_t value = 0;
+    bool replaced = false;
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_PUBLISH_QUEUE_FULL,
+        astarte_rate_limit_backlog_push(
+            &backlog, &limiter, "interface", "other", &value, 1, 0, true, &replaced));
+    // Replacing a waiting value still works on a full backlog
+    push(&backlog, &limiter, "topic", 5, true, true);
+    TEST_ASSERT_EQUAL(TEST_BACKLOG_CAPACITY, astarte_rate_limit_backlog_count(&backlog));
+
+    TEST_ASSERT_EQUAL(5, pop(&backlog, 1000000));
+    TEST_ASSERT_EQUAL(2, pop(&backlog, 2000000));
+
+    // Destroying releases the messages still waiting
+    astarte_rate_limit_backlog_destroy(&backlog);
+    TEST_ASSERT_EQUAL(0, astarte_rate_limit_backlog_count(&backlog));
+}
@@ -0,0 +1,102 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_sample_window.h"
+#include "test_astarte_sample_window.h"
+
+void test_astarte_sample_window_summary(void)
+{
+    astarte_sample_window_t window;
+    astarte_sample_window_init(&window, 100);
+
+    const double samples[] = { 2.0, -1.5, 4.0, 0.5 };
+    for (size_t i = 0; i < sizeof(samples) / sizeof(samples[0]); i++) {
+        astarte_sample_window_push(&window, samples[i]);
+    }
+
+    astarte_window_summary_t summary;
+    TEST_ASSERT_FALSE(astarte_sample_window_collect(&window, &summary));
+    TEST_ASSERT_TRUE(astarte_sample_window_close(&window, 1100));
+    TEST_ASSERT_TRUE(astarte_sample_window_collect(&window, &summary));
+    TEST_ASSERT_EQUAL(4, summary.count);
+    TEST_ASSERT_EQUAL_DOUBLE(-1.5, summary.min);
+    TEST_ASSERT_EQUAL_DOUBLE(4.0, summary.max);
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, summary.sum);
+    TEST_ASSERT_EQUAL_DOUBLE(0.5, summary.last);
+    TEST_ASSERT_EQUAL(100, summary.start_us);
+    TEST_ASSERT_EQUAL(1100, summary.end_us);
+
+    // Collected only once
+    TEST_ASSERT_FALSE(astarte_sample_window_collect(&window, &summary));
+}
+
+void test_astarte_sample_window_swap(void)
+{
+    astarte_sample_window_t window;
+    astarte_sample_window_init(&window, 0);
+    astarte_window_summary_t summary;
+
+    // Windows without samples are still closed, with a zero count
+    TEST_ASSERT_TRUE(astarte_sample_window_close(&window, 1000));
+    TEST_ASSERT_TRUE(astarte_sample_window_collect(&window, &summary));
+    TEST_ASSERT_EQUAL(0, summary.count);
+
+    // Each window only holds its own samples, also after the slots have been reused
+    for (int round = 1; round <= 4; round++) {
+        for (int i = 0; i < round; i++) {
+            astarte_sample_window_push(&window, -round);
+        }
+        TEST_ASSERT_TRUE(astarte_sample_window_close(&window, 1000 * (round + 1)));
+        TEST_ASSERT_TRUE(astarte_sample_window_collect(&window, &summary));
+        TEST_ASSERT_EQUAL(round, summary.count);
+        TEST_ASSERT_EQUAL_DOUBLE(-round, summary.min);
+        TEST_ASSERT_EQUAL_DOUBLE(-round, summary.max);
+        TEST_ASSERT_EQUAL(1000 * round, summary.start_us);
+        TEST_ASSERT_EQUAL(1000 * (round + 1), summary.end_us);
+    }
+}
+
+void test_astarte_sample_window_overrun(void)
+{
+    astarte_sample_window_t window;
+    astarte_sample_window_init(&window, 0);
+    astarte_window_summary_t summary;
+
+    astarte_sample_window_push(&window, 1.0);
+    TEST_ASSERT_TRUE(astarte_sample_window_close(&window, 1000));
+    astarte_sample_window_push(&window, 2.0);
+    // The first window has not been collected, the second one gets longer
+    TEST_ASSERT_FALSE(astarte_sample_window_close(&window, 2000));
+    astarte_sample_window_push(&window, 3.0);
+
+    TEST_ASSERT_TRUE(astarte_sample_window_collect(&window, &summary));
+    TEST_ASSERT_EQUAL(1, summary.count);
+    TEST_ASSERT_EQUAL_DOUBLE(1.0, summary.last);
+
+    TEST_ASSERT_TRUE(astarte_sample_window_close(&window, 3000));
+    TEST_ASSERT_TRUE(astarte_sample_window_collect(&window, &summary));
+    TEST_ASSERT_EQUAL(2, summary.count);
+    TEST_ASSERT_EQUAL_DOUBLE(5.0, summary.sum);
+    TEST_ASSERT_EQUAL(1000, summary.start_us);
+    TEST_ASSERT_EQUAL(3000, summary.end_us);
+}
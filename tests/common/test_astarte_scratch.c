@@ -0,0 +1,209 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_alloc.h"
+#include "astarte_scratch.h"
+#include "test_astarte_scratch.h"
+
+#include <stdalign.h>
+#include <stdint.h>
+#include <string.h>
+
+#define TEST_SCRATCH_SIZE 256
+
+void test_astarte_scratch_alloc_aligned(void)
+{
+    astarte_scratch_t scratch;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&scratch, TEST_SCRATCH_SIZE));
+
+    void *ptr = NULL;
+    TEST_ASSERT_FALSE(astarte_scratch_is_active());
+    TEST_ASSERT_FALSE(astarte_scratch_alloc(10, &ptr));
+
+    astarte_scratch_mark_t mark = astarte_scratch_begin(&scratch);
+    TEST_ASSERT_TRUE(mark.activated);
+    TEST_ASSERT_TRUE(astarte_scratch_is_active());
+
+    void *first = NULL;
+    void *second = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(3, &first));
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(8, &second));
+    TEST_ASSERT_NOT_NULL(first);
+    TEST_ASSERT_NOT_NULL(second);
+    TEST_ASSERT_EQUAL(0, (uintptr_t) second % alignof(max_align_t));
+    TEST_ASSERT_TRUE((uint8_t *) second >= (uint8_t *) first + 3);
+    TEST_ASSERT_TRUE(astarte_scratch_owns(first));
+    TEST_ASSERT_TRUE(astarte_scratch_owns(second));
+    TEST_ASSERT_FALSE(astarte_scratch_owns(&scratch));
+
+    astarte_scratch_end(mark);
+    TEST_ASSERT_FALSE(astarte_scratch_is_active());
+    TEST_ASSERT_FALSE(astarte_scratch_owns(first));
+    TEST_ASSERT_EQUAL(alignof(max_align_t) + 8, astarte_scratch_high_water(&scratch));
+
+    astarte_scratch_destroy(&scratch);
+}
+
+void test_astarte_scratch_nested_scopes(void)
+{
+    astarte_scratch_t outer_scratch;
+    astarte_scratch_t inner_scratch;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&outer_scratch, TEST_SCRATCH_SIZE));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&inner_scratch, TEST_SCRATCH_SIZE));
+
+    astarte_scratch_mark_t outer_mark = astarte_scratch_begin(&outer_scratch);
+    void *outer = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, &outer));
+
+    // The nested scope keeps using the arena already active
+    astarte_scratch_mark_t inner_mark = astarte_scratch_begin(&inner_scratch);
+    TEST_ASSERT_FALSE(inner_mark.activated);
+    void *inner = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, &inner));
+    TEST_ASSERT_TRUE(astarte_scratch_owns(inner));
+    astarte_scratch_end(inner_mark);
+    TEST_ASSERT_TRUE(astarte_scratch_is_active());
+
+    // The memory of the nested scope is reused
+    void *reused = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, &reused));
+    TEST_ASSERT_EQUAL_PTR(inner, reused);
+    astarte_scratch_end(outer_mark);
+
+    TEST_ASSERT_FALSE(astarte_scratch_is_active());
+    TEST_ASSERT_EQUAL(0, astarte_scratch_high_water(&inner_scratch));
+
+    astarte_scratch_destroy(&outer_scratch);
+    astarte_scratch_destroy(&inner_scratch);
+}
+
+void test_astarte_scratch_save_restore(void)
+{
+    astarte_scratch_t scratch;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&scratch, TEST_SCRATCH_SIZE));
+
+    // A first publisher serializes its message, then saves the arena while waiting for the
+    // in-flight window of its interface
+    astarte_scratch_mark_t first_mark = astarte_scratch_begin(&scratch);
+    char *first_message = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, (void **) &first_message));
+    memcpy(first_message, "first message", 14);
+    astarte_scratch_saved_t first_saved;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_save(&scratch, &first_saved));
+    TEST_ASSERT_FALSE(astarte_scratch_is_active());
+
+    // A second publisher does the same, starting from the beginning of the arena
+    astarte_scratch_mark_t second_mark = astarte_scratch_begin(&scratch);
+    TEST_ASSERT_TRUE(second_mark.activated);
+    char *second_message = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(32, (void **) &second_message));
+    TEST_ASSERT_EQUAL_PTR(first_message, second_message);
+    memcpy(second_message, "second message", 15);
+    astarte_scratch_saved_t second_saved;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_save(&scratch, &second_saved));
+
+    // Meanwhile the device task publishes from the same arena
+    astarte_scratch_mark_t device_mark = astarte_scratch_begin(&scratch);
+    void *device_message = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(64, &device_message));
+    memset(device_message, 0xAA, 64);
+    astarte_scratch_end(device_mark);
+
+    // The first publisher completes before the second one, its message is intact
+    astarte_scratch_restore(&first_saved);
+    TEST_ASSERT_TRUE(astarte_scratch_is_active());
+    TEST_ASSERT_EQUAL_STRING("first message", first_message);
+    void *first_next = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, &first_next));
+    TEST_ASSERT_EQUAL_PTR((uint8_t *) first_message + 16, first_next);
+    astarte_scratch_end(first_mark);
+    TEST_ASSERT_FALSE(astarte_scratch_is_active());
+
+    // Then the second one, whose message is intact as well
+    astarte_scratch_restore(&second_saved);
+    TEST_ASSERT_EQUAL_STRING("second message", second_message);
+    void *second_next = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(16, &second_next));
+    TEST_ASSERT_EQUAL_PTR((uint8_t *) second_message + 32, second_next);
+    astarte_scratch_end(second_mark);
+
+    // The arena is empty again
+    astarte_scratch_mark_t last_mark = astarte_scratch_begin(&scratch);
+    void *last = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(TEST_SCRATCH_SIZE, &last));
+    TEST_ASSERT_NOT_NULL(last);
+    astarte_scratch_end(last_mark);
+
+    astarte_scratch_destroy(&scratch);
+}
+
+void test_astarte_scratch_exhausted(void)
+{
+    astarte_scratch_t scratch;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&scratch, TEST_SCRATCH_SIZE));
+
+    astarte_scratch_mark_t mark = astarte_scratch_begin(&scratch);
+    void *ptr = NULL;
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(TEST_SCRATCH_SIZE, &ptr));
+    TEST_ASSERT_NOT_NULL(ptr);
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(1, &ptr));
+    TEST_ASSERT_NULL(ptr);
+    TEST_ASSERT_TRUE(astarte_scratch_alloc(SIZE_MAX, &ptr));
+    TEST_ASSERT_NULL(ptr);
+    astarte_scratch_end(mark);
+
+    TEST_ASSERT_EQUAL(2, astarte_scratch_failures(&scratch));
+    TEST_ASSERT_EQUAL(TEST_SCRATCH_SIZE, astarte_scratch_high_water(&scratch));
+
+    astarte_scratch_destroy(&scratch);
+}
+
+void test_astarte_scratch_routes_sdk_allocations(void)
+{
+    astarte_scratch_t scratch;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_scratch_init(&scratch, TEST_SCRATCH_SIZE));
+
+    astarte_allocator_stats_t before;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_BSON, &before));
+
+    astarte_scratch_mark_t mark = astarte_scratch_begin(&scratch);
+    char *copy = astarte_alloc_strdup(ASTARTE_ALLOC_SUBSYSTEM_BSON, "scratch");
+    uint8_t *zeroed = astarte_alloc_calloc(ASTARTE_ALLOC_SUBSYSTEM_BSON, 4, sizeof(uint8_t));
+    TEST_ASSERT_TRUE(astarte_scratch_owns(copy));
+    TEST_ASSERT_TRUE(astarte_scratch_owns(zeroed));
+    TEST_ASSERT_EQUAL_STRING("scratch", copy);
+    const uint8_t expected[4] = { 0 };
+    TEST_ASSERT_EQUAL_HEX8_ARRAY(expected, zeroed, sizeof(expected));
+    astarte_alloc_free(copy);
+    astarte_alloc_free(zeroed);
+    astarte_scratch_end(mark);
+
+    // Nothing has been charged to the heap
+    astarte_allocator_stats_t after;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_allocator_get_stats(ASTARTE_ALLOC_SUBSYSTEM_BSON, &after));
+    TEST_ASSERT_EQUAL(before.total_allocations, after.total_allocations);
+
+    astarte_scratch_destroy(&scratch);
+}
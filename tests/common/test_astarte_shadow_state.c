@@ -0,0 +1,92 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include <stdbool.h>
+#include <string.h>
+
+#include "astarte_shadow_state.h"
+#include "test_astarte_shadow_state.h"
+
+struct test_shadow
+{
+    double threshold;
+    int32_t count;
+    bool enabled;
+    char name[8];
+};
+
+static const astarte_shadow_field_t test_fields[] = {
+    ASTARTE_SHADOW_FIELD(struct test_shadow, threshold, ASTARTE_SHADOW_TYPE_DOUBLE, "/threshold"),
+    ASTARTE_SHADOW_FIELD(struct test_shadow, count, ASTARTE_SHADOW_TYPE_INTEGER, "/count"),
+    ASTARTE_SHADOW_FIELD(struct test_shadow, enabled, ASTARTE_SHADOW_TYPE_BOOLEAN, "/enabled"),
+    ASTARTE_SHADOW_FIELD(struct test_shadow, name, ASTARTE_SHADOW_TYPE_STRING, "/name"),
+};
+
+#define TEST_FIELDS_COUNT (sizeof(test_fields) / sizeof(test_fields[0]))
+
+void test_astarte_shadow_state_diff(void)
+{
+    struct test_shadow data = { .threshold = 1.5, .count = 3, .enabled = true, .name = "abc" };
+    astarte_shadow_state_t state;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_shadow_state_init(&state, test_fields, TEST_FIELDS_COUNT));
+
+    // Fields never published are always changed
+    for (size_t i = 0; i < TEST_FIELDS_COUNT; i++) {
+        TEST_ASSERT_TRUE(astarte_shadow_state_changed(&state, &data, i));
+        astarte_shadow_state_update(&state, &data, i);
+        TEST_ASSERT_FALSE(astarte_shadow_state_changed(&state, &data, i));
+    }
+
+    data.count = 4;
+    TEST_ASSERT_FALSE(astarte_shadow_state_changed(&state, &data, 0));
+    TEST_ASSERT_TRUE(astarte_shadow_state_changed(&state, &data, 1));
+    TEST_ASSERT_FALSE(astarte_shadow_state_changed(&state, &data, 2));
+
+    // Bytes after the string terminator are ignored
+    data.name[5] = 'x';
+    TEST_ASSERT_FALSE(astarte_shadow_state_changed(&state, &data, 3));
+    strcpy(data.name, "abd");
+    TEST_ASSERT_TRUE(astarte_shadow_state_changed(&state, &data, 3));
+    astarte_shadow_state_update(&state, &data, 3);
+    TEST_ASSERT_FALSE(astarte_shadow_state_changed(&state, &data, 3));
+
+    astarte_shadow_state_destroy(&state);
+}
+
+void test_astarte_shadow_state_invalid(void)
+{
+    astarte_shadow_state_t state;
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_INVALID_SIZE, astarte_shadow_state_init(&state, test_fields, 0));
+
+    const astarte_shadow_field_t bad_path[] = {
+        ASTARTE_SHADOW_FIELD(struct test_shadow, count, ASTARTE_SHADOW_TYPE_INTEGER, "count"),
+    };
+    TEST_ASSERT_EQUAL(
+        ASTARTE_ERR_INVALID_INTERFACE_PATH, astarte_shadow_state_init(&state, bad_path, 1));
+
+    const astarte_shadow_field_t bad_size[] = {
+        ASTARTE_SHADOW_FIELD(struct test_shadow, count, ASTARTE_SHADOW_TYPE_LONGINTEGER, "/count"),
+    };
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_INVALID_SIZE, astarte_shadow_state_init(&state, bad_size, 1));
+}
@@ -0,0 +1,81 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_spsc_ring.h"
+#include "test_astarte_spsc_ring.h"
+
+void test_astarte_spsc_ring_order(void)
+{
+    astarte_ring_sample_t storage[4];
+    astarte_spsc_ring_t ring;
+    astarte_spsc_ring_init(&ring, storage, 4);
+
+    // Enough rounds to wrap around the storage several times
+    astarte_ring_sample_t out[3];
+    int64_t next_push = 0;
+    int64_t next_pop = 0;
+    for (int round = 0; round < 10; round++) {
+        for (int i = 0; i < 3; i++) {
+            astarte_ring_value_t value = { .longinteger_value = next_push * 10 };
+            TEST_ASSERT_TRUE(astarte_spsc_ring_push(&ring, next_push, value));
+            next_push++;
+        }
+        TEST_ASSERT_EQUAL(3, astarte_spsc_ring_count(&ring));
+        TEST_ASSERT_EQUAL(2, astarte_spsc_ring_pop(&ring, out, 2));
+        TEST_ASSERT_EQUAL(1, astarte_spsc_ring_count(&ring));
+        TEST_ASSERT_EQUAL(1, astarte_spsc_ring_pop(&ring, out + 2, 3));
+        for (int i = 0; i < 3; i++) {
+            TEST_ASSERT_EQUAL_INT64(next_pop, out[i].timestamp_us);
+            TEST_ASSERT_EQUAL_INT64(next_pop * 10, out[i].value.longinteger_value);
+            next_pop++;
+        }
+    }
+    TEST_ASSERT_EQUAL(0, astarte_spsc_ring_pop(&ring, out, 3));
+    TEST_ASSERT_EQUAL(0, astarte_spsc_ring_dropped(&ring));
+}
+
+void test_astarte_spsc_ring_full(void)
+{
+    astarte_ring_sample_t storage[2];
+    astarte_spsc_ring_t ring;
+    astarte_spsc_ring_init(&ring, storage, 2);
+
+    astarte_ring_value_t value = { .double_value = 1.5 };
+    TEST_ASSERT_TRUE(astarte_spsc_ring_push(&ring, 1, value));
+    TEST_ASSERT_TRUE(astarte_spsc_ring_push(&ring, 2, value));
+    // The samples already in the ring are kept, the new ones are dropped
+    TEST_ASSERT_FALSE(astarte_spsc_ring_push(&ring, 3, value));
+    TEST_ASSERT_FALSE(astarte_spsc_ring_push(&ring, 4, value));
+    TEST_ASSERT_EQUAL(2, astarte_spsc_ring_dropped(&ring));
+    TEST_ASSERT_EQUAL(2, astarte_spsc_ring_count(&ring));
+
+    astarte_ring_sample_t out[2];
+    TEST_ASSERT_EQUAL(1, astarte_spsc_ring_pop(&ring, out, 1));
+    TEST_ASSERT_EQUAL_INT64(1, out[0].timestamp_us);
+    TEST_ASSERT_TRUE(astarte_spsc_ring_push(&ring, 5, value));
+    TEST_ASSERT_EQUAL(2, astarte_spsc_ring_pop(&ring, out, 2));
+    TEST_ASSERT_EQUAL_INT64(2, out[0].timestamp_us);
+    TEST_ASSERT_EQUAL_INT64(5, out[1].timestamp_us);
+    TEST_ASSERT_EQUAL_DOUBLE(1.5, out[1].value.double_value);
+    TEST_ASSERT_EQUAL(2, astarte_spsc_ring_dropped(&ring));
+}
@@ -0,0 +1,179 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+#include "unity.h"
+
+#include "astarte_tlv.h"
+#include "test_astarte_tlv.h"
+
+#include <string.h>
+
+void test_astarte_tlv_crc32(void)
+{
+    const char *check = "123456789";
+    TEST_ASSERT_EQUAL_HEX32(
+        0xCBF43926U, astarte_tlv_crc32(0, (const uint8_t *) check, strlen(check)));
+
+    // The computation can be split in multiple steps
+    uint32_t crc = astarte_tlv_crc32(0, (const uint8_t *) check, 4);
+    crc = astarte_tlv_crc32(crc, (const uint8_t *) check + 4, strlen(check) - 4);
+    TEST_ASSERT_EQUAL_HEX32(0xCBF43926U, crc);
+}
+
+void test_astarte_tlv_header_encode_decode(void)
+{
+    astarte_tlv_header_t header = {
+        .sequence = 42,
+        .payload_len = 1234,
+        .payload_crc = 0xDEADBEEFU,
+    };
+    uint8_t buf[ASTARTE_TLV_HEADER_SIZE];
+    astarte_tlv_header_encode(&header, buf);
+
+    astarte_tlv_header_t decoded = { 0 };
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_header_decode(buf, &decoded));
+    TEST_ASSERT_EQUAL_UINT32(header.sequence, decoded.sequence);
+    TEST_ASSERT_EQUAL_UINT32(header.payload_len, decoded.payload_len);
+    TEST_ASSERT_EQUAL_UINT32(header.payload_crc, decoded.payload_crc);
+}
+
+void test_astarte_tlv_header_corrupted(void)
+{
+    astarte_tlv_header_t decoded = { 0 };
+    uint8_t buf[ASTARTE_TLV_HEADER_SIZE];
+
+    // Erased flash
+    memset(buf, 0xFF, sizeof(buf));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_tlv_header_decode(buf, &decoded));
+
+    astarte_tlv_header_t header = {
+        .sequence = 1,
+        .payload_len = 0,
+        .payload_crc = 0,
+    };
+    astarte_tlv_header_encode(&header, buf);
+    // Flip a bit of the sequence number
+    buf[8] ^= 0x01U;
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_NOT_FOUND, astarte_tlv_header_decode(buf, &decoded));
+
+    const uint8_t payload[] = { 0x01, 0x02, 0x00, 0xAA, 0xBB };
+    header.payload_len = sizeof(payload);
+    header.payload_crc = astarte_tlv_crc32(0, payload, sizeof(payload));
+    TEST_ASSERT_TRUE(astarte_tlv_payload_is_valid(&header, payload));
+    const uint8_t corrupted_payload[] = { 0x01, 0x02, 0x00, 0xAA, 0xBA };
+    TEST_ASSERT_FALSE(astarte_tlv_payload_is_valid(&header, corrupted_payload));
+}
+
+void test_astarte_tlv_select_newest(void)
+{
+    astarte_tlv_header_t older = { .sequence = 1 };
+    astarte_tlv_header_t newer = { .sequence = 2 };
+
+    TEST_ASSERT_EQUAL_INT(-1, astarte_tlv_select_newest(NULL, NULL));
+    TEST_ASSERT_EQUAL_INT(0, astarte_tlv_select_newest(&older, NULL));
+    TEST_ASSERT_EQUAL_INT(1, astarte_tlv_select_newest(NULL, &older));
+    TEST_ASSERT_EQUAL_INT(1, astarte_tlv_select_newest(&older, &newer));
+    TEST_ASSERT_EQUAL_INT(0, astarte_tlv_select_newest(&newer, &older));
+
+    // Wrap around of the sequence number
+    older.sequence = UINT32_MAX;
+    newer.sequence = 0;
+    TEST_ASSERT_EQUAL_INT(1, astarte_tlv_select_newest(&older, &newer));
+    TEST_ASSERT_EQUAL_INT(0, astarte_tlv_select_newest(&newer, &older));
+}
+
+void test_astarte_tlv_update_find(void)
+{
+    uint8_t first[64];
+    uint8_t second[64];
+    size_t first_len = 0;
+    size_t second_len = 0;
+    const uint8_t *value = NULL;
+    size_t value_len = 0;
+
+    // Add two records to an empty payload
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_tlv_update(NULL, 0, 1, "key", 3, first, sizeof(first), &first_len));
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_tlv_update(first, first_len, 2, "csr", 3, second, sizeof(second), &second_len));
+    TEST_ASSERT_EQUAL(2 * (ASTARTE_TLV_RECORD_HEADER_SIZE + 3), second_len);
+
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_find(second, second_len, 1, &value, &value_len));
+    TEST_ASSERT_EQUAL(3, value_len);
+    TEST_ASSERT_EQUAL_MEMORY("key", value, value_len);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_find(second, second_len, 2, &value, &value_len));
+    TEST_ASSERT_EQUAL_MEMORY("csr", value, value_len);
+    TEST_ASSERT_EQUAL(
+        ASTARTE_ERR_NOT_FOUND, astarte_tlv_find(second, second_len, 3, &value, &value_len));
+
+    // Replace the first record
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_tlv_update(second, second_len, 1, "new key", 7, first, sizeof(first), &first_len));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_find(first, first_len, 1, &value, &value_len));
+    TEST_ASSERT_EQUAL(7, value_len);
+    TEST_ASSERT_EQUAL_MEMORY("new key", value, value_len);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_find(first, first_len, 2, &value, &value_len));
+    TEST_ASSERT_EQUAL_MEMORY("csr", value, value_len);
+
+    // Remove the second record
+    TEST_ASSERT_EQUAL(ASTARTE_OK,
+        astarte_tlv_update(first, first_len, 2, NULL, 0, second, sizeof(second), &second_len));
+    TEST_ASSERT_EQUAL(ASTARTE_TLV_RECORD_HEADER_SIZE + 7, second_len);
+    TEST_ASSERT_EQUAL(
+        ASTARTE_ERR_NOT_FOUND, astarte_tlv_find(second, second_len, 2, &value, &value_len));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_tlv_find(second, second_len, 1, &value, &value_len));
+    TEST_ASSERT_EQUAL_MEMORY("new key", value, value_len);
+}
+
+void test_astarte_tlv_update_overflow(void)
+{
+    uint8_t out[8];
+    size_t out_len = 0;
+
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_INVALID_SIZE,
+        astarte_tlv_update(NULL, 0, 1, "too long", 8, out, sizeof(out), &out_len));
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_tlv_update(NULL, 0, 1, "fits", 4, out, sizeof(out), &out_len));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_INVALID_SIZE,
+        astarte_tlv_update(NULL, 0, 1, out, ASTARTE_TLV_VALUE_MAX_LEN + 1, out, sizeof(out),
+            &out_len));
+}
+
+void test_astarte_tlv_malformed_payload(void)
+{
+    const uint8_t *value = NULL;
+    size_t value_len = 0;
+    uint8_t out[16];
+    size_t out_len = 0;
+
+    // The record declares a value longer than the payload
+    const uint8_t truncated_value[] = { 0x01, 0x05, 0x00, 0xAA };
+    TEST_ASSERT_EQUAL(ASTARTE_ERR,
+        astarte_tlv_find(truncated_value, sizeof(truncated_value), 2, &value, &value_len));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR,
+        astarte_tlv_update(truncated_value, sizeof(truncated_value), 2, "a", 1, out, sizeof(out),
+            &out_len));
+
+    // The payload ends in the middle of a record header
+    const uint8_t truncated_header[] = { 0x01, 0x01, 0x00, 0xAA, 0x02 };
+    TEST_ASSERT_EQUAL(ASTARTE_ERR,
+        astarte_tlv_find(truncated_header, sizeof(truncated_header), 2, &value, &value_len));
+}
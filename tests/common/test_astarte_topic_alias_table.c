@@ -0,0 +1,88 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+
+#include "unity.h"
+
+#include "astarte_topic_alias_table.h"
+#include "test_astarte_topic_alias_table.h"
+
+void test_astarte_topic_alias_table_assign(void)
+{
+    astarte_topic_alias_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_init(&table, 2));
+
+    astarte_topic_alias_t a;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/a/x", &a));
+    TEST_ASSERT_EQUAL(1, a.alias);
+    TEST_ASSERT_FALSE(a.confirmed);
+    astarte_topic_alias_table_confirm(&table, &a);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/a/x", &a));
+    TEST_ASSERT_EQUAL(1, a.alias);
+    TEST_ASSERT_TRUE(a.confirmed);
+
+    astarte_topic_alias_t b;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/b/y", &b));
+    TEST_ASSERT_EQUAL(2, b.alias);
+    astarte_topic_alias_table_confirm(&table, &b);
+
+    // The least recently used alias is reassigned and must be sent with its topic again
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/a/x", &a));
+    astarte_topic_alias_t c;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/c/z", &c));
+    TEST_ASSERT_EQUAL(2, c.alias);
+    TEST_ASSERT_FALSE(c.confirmed);
+
+    astarte_topic_alias_table_destroy(&table);
+}
+
+void test_astarte_topic_alias_table_reset_and_refuse(void)
+{
+    astarte_topic_alias_table_t table;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_init(&table, 3));
+
+    astarte_topic_alias_t a;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/a/x", &a));
+    astarte_topic_alias_table_reset(&table);
+    // Confirmations of the previous connection are ignored
+    astarte_topic_alias_table_confirm(&table, &a);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/a/x", &a));
+    TEST_ASSERT_EQUAL(1, a.alias);
+    TEST_ASSERT_FALSE(a.confirmed);
+
+    astarte_topic_alias_t b;
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/b/y", &b));
+    TEST_ASSERT_EQUAL(2, b.alias);
+    astarte_topic_alias_table_refuse(&table, &b);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/b/y", &b));
+    TEST_ASSERT_EQUAL(1, b.alias);
+
+    astarte_topic_alias_table_refuse(&table, &b);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/b/y", &b));
+    TEST_ASSERT_EQUAL(0, b.alias);
+
+    // A new connection accepts all the aliases again
+    astarte_topic_alias_table_reset(&table);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_topic_alias_table_get(&table, "r/d/c/z", &b));
+    TEST_ASSERT_EQUAL(1, b.alias);
+
+    astarte_topic_alias_table_destroy(&table);
+}
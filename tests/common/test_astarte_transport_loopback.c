@@ -0,0 +1,175 @@
+/**
+ * This file is part of Astarte.
+ *
+ * Copyright 2024 SECO Mind Srl
+ *
+ * Licensed under the Apache License, Version 2.0 (the "License");
+ * you may not use this file except in compliance with the License.
+ * You may obtain a copy of the License at
+ *
+ *    http://www.apache.org/licenses/LICENSE-2.0
+ *
+ * Unless required by applicable law or agreed to in writing, software
+ * distributed under the License is distributed on an "AS IS" BASIS,
+ * WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+ * See the License for the specific language governing permissions and
+ * limitations under the License.
+ *
+ * SPDX-License-Identifier: LGPL-2.1-or-later OR Apache-2.0
+ *
+ **/
+
+
+#include "unity.h"
+
+#include "astarte_transport_loopback.h"
+#include "test_astarte_transport_loopback.h"
+
+#include <string.h>
+
+#define MAX_RECORDED_EVENTS 8
+
+typedef struct
+{
+    astarte_transport_event_id_t ids[MAX_RECORDED_EVENTS];
+    int msg_ids[MAX_RECORDED_EVENTS];
+    int count;
+} recorded_events_t;
+
+typedef struct
+{
+    char topic[64];
+    uint16_t topic_alias;
+    int count;
+} recorded_publish_t;
+
+static void record_event(void *handler_data, const astarte_transport_event_t *event)
+{
+    recorded_events_t *events = handler_data;
+    TEST_ASSERT_LESS_THAN(MAX_RECORDED_EVENTS, events->count);
+    events->ids[events->count] = event->id;
+    events->msg_ids[events->count] = event->msg_id;
+    events->count++;
+}
+
+static void record_publish(const astarte_transport_loopback_message_t *message, void *user_data)
+{
+    recorded_publish_t *publish = user_data;
+    strncpy(publish->topic, message->topic, sizeof(publish->topic) - 1);
+    publish->topic_alias = message->topic_alias;
+    publish->count++;
+}
+
+void test_astarte_transport_loopback_publish_and_acknowledge(void)
+{
+    astarte_transport_loopback_config_t config = { .device_topic = "realm/device" };
+    astarte_transport_loopback_handle_t loopback = astarte_transport_loopback_new(&config);
+    TEST_ASSERT_NOT_NULL(loopback);
+    const astarte_transport_t *transport = astarte_transport_loopback_get_transport(loopback);
+    TEST_ASSERT_EQUAL_STRING("realm/device", transport->device_topic);
+
+    recorded_events_t events = { 0 };
+    astarte_transport_config_t client_config = { 0 };
+    void *client = transport->ops->create(
+        transport->transport_data, &client_config, record_event, &events);
+    TEST_ASSERT_NOT_NULL(client);
+    // A single device at a time
+    TEST_ASSERT_NULL(transport->ops->create(
+        transport->transport_data, &client_config, record_event, &events));
+
+    TEST_ASSERT_EQUAL(
+        ASTARTE_ERR_DEVICE_NOT_READY, astarte_transport_loopback_connect(loopback, false));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, transport->ops->start(client));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_transport_loopback_connect(loopback, false));
+    TEST_ASSERT_EQUAL(2, events.count);
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_EVENT_BEFORE_CONNECT, events.ids[0]);
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_EVENT_CONNECTED, events.ids[1]);
+
+    TEST_ASSERT_GREATER_THAN(0, transport->ops->subscribe(client, "realm/device/a/#", 2));
+    TEST_ASSERT_EQUAL(0, transport->ops->publish(client, "realm/device/b/x", "0123", 4, 0, 0));
+    TEST_ASSERT_EQUAL(1, transport->ops->publish(client, "realm/device/b/x", "0123", 4, 1, 0));
+    TEST_ASSERT_EQUAL(2, transport->ops->publish(client, "realm/device/b/x", "01", 2, 2, 0));
+    TEST_ASSERT_EQUAL(6, transport->ops->get_outbox_size(client));
+
+    events.count = 0;
+    TEST_ASSERT_EQUAL(2, astarte_transport_loopback_acknowledge(loopback));
+    TEST_ASSERT_EQUAL(2, events.count);
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_EVENT_PUBLISHED, events.ids[0]);
+    TEST_ASSERT_EQUAL(1, events.msg_ids[0]);
+    TEST_ASSERT_EQUAL(2, events.msg_ids[1]);
+    TEST_ASSERT_EQUAL(0, transport->ops->get_outbox_size(client));
+
+    events.count = 0;
+    TEST_ASSERT_EQUAL(
+        ASTARTE_OK, astarte_transport_loopback_inject(loopback, "realm/device/a/y", "v", 1));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_transport_loopback_disconnect(loopback));
+    TEST_ASSERT_EQUAL(2, events.count);
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_EVENT_DATA, events.ids[0]);
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_EVENT_DISCONNECTED, events.ids[1]);
+
+    // QoS 0 messages are dropped while disconnected
+    TEST_ASSERT_LESS_THAN(0, transport->ops->publish(client, "realm/device/b/x", "0", 1, 0, 0));
+    TEST_ASSERT_EQUAL(ASTARTE_ERR_DEVICE_NOT_READY,
+        astarte_transport_loopback_inject(loopback, "realm/device/a/y", "v", 1));
+
+    astarte_transport_loopback_stats_t stats;
+    astarte_transport_loopback_get_stats(loopback, &stats);
+    TEST_ASSERT_EQUAL(3, stats.published);
+    TEST_ASSERT_EQUAL(10, stats.published_bytes);
+    TEST_ASSERT_EQUAL(1, stats.subscriptions);
+    TEST_ASSERT_EQUAL(2, stats.acknowledged);
+    TEST_ASSERT_EQUAL(1, stats.injected);
+
+    transport->ops->destroy(client);
+    astarte_transport_loopback_destroy(loopback);
+}
+
+void test_astarte_transport_loopback_topic_aliases(void)
+{
+    recorded_publish_t publish = { 0 };
+    astarte_transport_loopback_config_t config = {
+        .device_topic = "realm/device",
+        .topic_alias_maximum = 2,
+        .publish_callback = record_publish,
+        .callback_user_data = &publish,
+    };
+    astarte_transport_loopback_handle_t loopback = astarte_transport_loopback_new(&config);
+    TEST_ASSERT_NOT_NULL(loopback);
+    const astarte_transport_t *transport = astarte_transport_loopback_get_transport(loopback);
+
+    recorded_events_t events = { 0 };
+    astarte_transport_config_t client_config = { .mqtt5 = true };
+    void *client = transport->ops->create(
+        transport->transport_data, &client_config, record_event, &events);
+    TEST_ASSERT_NOT_NULL(client);
+    TEST_ASSERT_EQUAL(ASTARTE_OK, transport->ops->start(client));
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_transport_loopback_connect(loopback, false));
+
+    // Above the Topic Alias Maximum
+    TEST_ASSERT_EQUAL(ASTARTE_TRANSPORT_TOPIC_ALIAS_REFUSED,
+        transport->ops->publish(client, "realm/device/b/x", "0", 1, 0, 3));
+    TEST_ASSERT_EQUAL(0, publish.count);
+
+    TEST_ASSERT_EQUAL(0, transport->ops->publish(client, "realm/device/b/x", "0", 1, 0, 1));
+    TEST_ASSERT_EQUAL_STRING("realm/device/b/x", publish.topic);
+    TEST_ASSERT_EQUAL(1, publish.topic_alias);
+
+    // The empty topic is resolved from the alias
+    memset(publish.topic, 0, sizeof(publish.topic));
+    TEST_ASSERT_EQUAL(0, transport->ops->publish(client, "", "0", 1, 0, 1));
+    TEST_ASSERT_EQUAL_STRING("realm/device/b/x", publish.topic);
+    TEST_ASSERT_EQUAL(2, publish.count);
+
+    // A publish without alias does not keep the previous one
+    TEST_ASSERT_EQUAL(0, transport->ops->publish(client, "realm/device/b/y", "0", 1, 0, 0));
+    TEST_ASSERT_EQUAL_STRING("realm/device/b/y", publish.topic);
+    TEST_ASSERT_EQUAL(0, publish.topic_alias);
+
+    // Aliases are forgotten on a new connection
+    TEST_ASSERT_EQUAL(ASTARTE_OK, astarte_transport_loopback_connect(loopback, false));
+    TEST_ASSERT_LESS_THAN(0, transport->ops->publish(client, "", "0", 1, 0, 1));
+    TEST_ASSERT_EQUAL(3, publish.count);
+
+    transport->ops->destroy(client);
+    astarte_transport_loopback_destroy(loopback);
+}
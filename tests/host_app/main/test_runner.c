@@ -26,6 +26,25 @@
 #include "test_astarte_bson_deserializer.h"
 #include "test_astarte_bson_serializer.h"
 #include "test_astarte_linked_list.h"
+#include "test_astarte_tlv.h"
+#include "test_astarte_json_extract.h"
+#include "test_astarte_device_stats.h"
+#include "test_astarte_allocator.h"
+#include "test_astarte_publish_queue.h"
+#include "test_astarte_rate_limiter.h"
+#include "test_astarte_sample_window.h"
+#include "test_astarte_deadband_table.h"
+#include "test_astarte_property_coalescer.h"
+#include "test_astarte_shadow_state.h"
+#include "test_astarte_block_encoder.h"
+#include "test_astarte_burst_buffer.h"
+#include "test_astarte_spsc_ring.h"
+#include "test_astarte_inflight_table.h"
+#include "test_astarte_outbox_governor.h"
+#include "test_astarte_topic_alias_table.h"
+#include "test_astarte_blob_envelope.h"
+#include "test_astarte_transport_loopback.h"
+#include "test_astarte_scratch.h"
 #include "test_uuid.h"
 
 int main(int argc, char **argv)
@@ -33,6 +52,18 @@ int main(int argc, char **argv)
     // Disable logs for the modules under test to avoid garbage prints
     esp_log_level_set("ASTARTE_BSON_SERIALIZER", ESP_LOG_NONE);
     esp_log_level_set("ASTARTE_BSON_DESERIALIZER", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_TLV", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_JSON_EXTRACT", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_SCRATCH", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_PUBLISH_QUEUE", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_RATE_LIMITER", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_DEADBAND", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_PROPERTY_COALESCER", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_SHADOW", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_BURST_BUFFER", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_INFLIGHT_TABLE", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_TOPIC_ALIAS_TABLE", ESP_LOG_NONE);
+    esp_log_level_set("ASTARTE_TRANSPORT_LOOPBACK", ESP_LOG_NONE);
     esp_log_level_set("uuid", ESP_LOG_NONE);
 
     UNITY_BEGIN();
@@ -50,6 +81,72 @@ int main(int argc, char **argv)
     RUN_TEST(test_astarte_linked_list_iterator);
     RUN_TEST(test_astarte_linked_list_iterator_replace);
 
+    RUN_TEST(test_astarte_tlv_crc32);
+    RUN_TEST(test_astarte_tlv_header_encode_decode);
+    RUN_TEST(test_astarte_tlv_header_corrupted);
+    RUN_TEST(test_astarte_tlv_select_newest);
+    RUN_TEST(test_astarte_tlv_update_find);
+    RUN_TEST(test_astarte_tlv_update_overflow);
+    RUN_TEST(test_astarte_tlv_malformed_payload);
+    RUN_TEST(test_astarte_json_extract_nested_field);
+    RUN_TEST(test_astarte_json_extract_chunked);
+    RUN_TEST(test_astarte_json_extract_escapes);
+    RUN_TEST(test_astarte_json_extract_ignores_other_paths);
+    RUN_TEST(test_astarte_json_extract_not_found);
+    RUN_TEST(test_astarte_json_extract_small_buffer);
+    RUN_TEST(test_astarte_json_extract_malformed);
+    RUN_TEST(test_astarte_device_stats_histogram_buckets);
+    RUN_TEST(test_astarte_device_stats_histogram_clamp);
+    RUN_TEST(test_astarte_device_stats_histogram_percentile);
+    RUN_TEST(test_astarte_device_stats_histogram_empty);
+    RUN_TEST(test_astarte_allocator_accounting);
+    RUN_TEST(test_astarte_allocator_calloc_overflow);
+    RUN_TEST(test_astarte_allocator_strdup);
+    RUN_TEST(test_astarte_allocator_custom);
+    RUN_TEST(test_astarte_allocator_set_with_live_allocations);
+    RUN_TEST(test_astarte_scratch_alloc_aligned);
+    RUN_TEST(test_astarte_scratch_nested_scopes);
+    RUN_TEST(test_astarte_scratch_save_restore);
+    RUN_TEST(test_astarte_scratch_exhausted);
+    RUN_TEST(test_astarte_scratch_routes_sdk_allocations);
+    RUN_TEST(test_astarte_publish_queue_copy);
+    RUN_TEST(test_astarte_publish_queue_full);
+    RUN_TEST(test_astarte_publish_queue_strict);
+    RUN_TEST(test_astarte_publish_queue_weighted);
+    RUN_TEST(test_astarte_rate_limiter_messages);
+    RUN_TEST(test_astarte_rate_limiter_bytes);
+    RUN_TEST(test_astarte_rate_limiter_both_limits);
+    RUN_TEST(test_astarte_rate_limit_backlog_order);
+    RUN_TEST(test_astarte_rate_limit_backlog_full);
+    RUN_TEST(test_astarte_sample_window_summary);
+    RUN_TEST(test_astarte_sample_window_swap);
+    RUN_TEST(test_astarte_sample_window_overrun);
+    RUN_TEST(test_astarte_deadband_thresholds);
+    RUN_TEST(test_astarte_deadband_heartbeat);
+    RUN_TEST(test_astarte_deadband_integers);
+    RUN_TEST(test_astarte_deadband_table);
+    RUN_TEST(test_astarte_property_coalescer_replace);
+    RUN_TEST(test_astarte_property_coalescer_full);
+    RUN_TEST(test_astarte_shadow_state_diff);
+    RUN_TEST(test_astarte_shadow_state_invalid);
+    RUN_TEST(test_astarte_block_encoder_double);
+    RUN_TEST(test_astarte_block_encoder_longinteger);
+    RUN_TEST(test_astarte_block_encoder_full);
+    RUN_TEST(test_astarte_burst_buffer_thresholds);
+    RUN_TEST(test_astarte_burst_buffer_take_all);
+    RUN_TEST(test_astarte_spsc_ring_order);
+    RUN_TEST(test_astarte_spsc_ring_full);
+    RUN_TEST(test_astarte_inflight_table_acks);
+    RUN_TEST(test_astarte_inflight_table_count_and_stale);
+    RUN_TEST(test_astarte_outbox_governor_hysteresis);
+    RUN_TEST(test_astarte_outbox_governor_low_above_high);
+    RUN_TEST(test_astarte_topic_alias_table_assign);
+    RUN_TEST(test_astarte_topic_alias_table_reset_and_refuse);
+    RUN_TEST(test_astarte_blob_envelope_matches_serializer);
+    RUN_TEST(test_astarte_blob_envelope_empty_blob);
+    RUN_TEST(test_astarte_transport_loopback_publish_and_acknowledge);
+    RUN_TEST(test_astarte_transport_loopback_topic_aliases);
+
     RUN_TEST(test_uuid_from_string);
     RUN_TEST(test_uuid_to_string);
     RUN_TEST(test_uuid_generate_v4);